@@ -3,6 +3,8 @@
 
 
 // ================== PIN SETUP ==================
+// Step, dir and laser are driven with direct port writes:
+// D2 = PE4, D5 = PE3, D53 = PB0, encoder D50 = PB3, D51 = PB2
 const int stepYPin = 2;  // Y.STEP
 const int dirYPin  = 5;  // Y.DIR
 const int laser    = 53;
@@ -19,13 +21,23 @@ int ldr3 = A10;
 int ldr4 = A11;
 int ldr5 = A12;
 
+const int ldrCount = 5;
+
 int led1 = 17;
 int led2 = 18;
 int led3 = 19;
 int led4 = 20;
 int led5 = 21;
 
-int k = 100;
+// Beam detection: each dwell samples the LDRs with the laser off, then on.
+// The laser contribution (off - on, light pulls the LDR input down, minus the
+// change seen by the unlit LDRs) is compared to a running estimate of the intact
+// beam's contribution, so ambient light and its flicker cancel out instead of
+// crossing a fixed threshold.
+int breakPercent = 50;        // Broken below this share of the intact level
+int restorePercent = 75;      // Restored above this share
+int minLaserSignal = 20;      // Smaller intact levels cannot be judged
+int levelShift = 3;           // Intact level follows 1/8 of each change
 
 // ================== STEPPER SETTINGS ==================
 
@@ -40,32 +52,435 @@ short cordemezzi = stepsPerRev / corde;
 
 int analogVal;
 
+// ================== STEPPER DRIVER ==================
+// Timer1 in CTC mode at 2 MHz (prescaler 8) generates the step pulses from its
+// compare-match interrupt, two interrupts per step: pulse high for
+// pulseWidthMicros, then low for the rest of the step interval. Intervals come
+// from a table computed in setup(): an optional constant-acceleration ramp of
+// rampSteps at both ends of a move, cruise at pulseWidthMicros + millisBtwnSteps.
+const int ticksPerMicro = 2;
+const int maxRampSteps = 32;
+const int dirSetupTicks = 4;    // 2us between a direction change and the first pulse
+
+int rampSteps = 0;              // Acceleration steps per move, 0 = constant speed
+int rampStartMicros = 400;      // First step interval of the ramp
+
+unsigned int rampTable[maxRampSteps];
+unsigned int cruiseTicks;
+unsigned int pulseTicks;
+
+volatile bool stepperBusy = false;
+volatile unsigned int moveSteps = 0;
+volatile unsigned int stepIndex = 0;
+volatile byte stepPhase = 0;
+
+// ================== SCAN STATE MACHINE ==================
+// move -> ambient sample (laser off) -> laser on (dwell, ADC sampling in the
+// background) -> sample -> laser off, corde positions forward then corde
+// positions backward. loop() never blocks.
+enum ScanState { SCAN_MOVE, SCAN_MOVING, SCAN_AMBIENT, SCAN_DWELL, SCAN_SAMPLE };
+
+ScanState scanState = SCAN_MOVE;
+int scanPosition = 0;
+bool scanForward = true;
+unsigned long phaseStart = 0;
+unsigned long dwellSets = 0;
+int ambient[ldrCount];          // Laser-off set of the current position
+
+// Latest laser contribution of each beam, taken while that beam was lit
+int beamValues[ldrCount];
+int beamLevel[ldrCount];        // Running intact contribution, 0 = not learned yet
+bool beamBroken[ldrCount];
+
+// Measured timing of the last position, reported in the telemetry
+unsigned long lastMoveMicros = 0;
+unsigned long lastDwellMicros = 0;
+unsigned int lastMoveSteps = 0;
+
+// ================== ADC ==================
+// The ADC free-runs over A8-A12 (ADC8-ADC12) from its conversion-complete
+// interrupt: each channel is converted adcOversample[ch] times after one
+// discarded settling conversion, the average goes into the back half of a
+// double buffer and a finished set of 5 channels becomes the front half.
+// At prescaler 32 (500 kHz ADC clock) a conversion takes 26us, so a full set
+// with 4x oversampling takes about 650us instead of 5 x 112us per analogRead.
+const byte adcPrescalerBits = (1 << ADPS2) | (1 << ADPS0);    // /32
+byte adcOversample[ldrCount] = { 4, 4, 4, 4, 4 };             // 1-64 conversions per channel
+
+volatile unsigned int adcSets[2][ldrCount];
+volatile byte adcFront = 0;
+volatile unsigned long adcSetCount = 0;     // Completed sets
+volatile bool adcRestart = false;
+byte adcChannel = 0;
+byte adcConversions = 0;
+bool adcSettling = true;
+unsigned int adcAccum = 0;
+
+// ================== TELEMETRY ==================
+// One binary frame per sweep instead of text prints: COBS encoded, 0x00 delimited.
+// Frame: type, sequence (u16), micros() (u32), 5 beam values (u16), last move and
+// dwell duration (u32 us), steps of the last move (u16), CRC-16/CCITT, all
+// little-endian. A frame is only queued when the TX buffer has room, so the
+// scan never waits on the serial port; skipped frames still use a sequence
+// number and show up as drops on the host (telemetry_decoder.py).
+const long telemetryBaud = 1000000;
+const byte frameSweep = 1;
+const int telemetryRawSize = 29;                        // type + seq + time + 5 x beam + timing + CRC
+const int maxFrameSize = telemetryRawSize + 2;          // Largest frame, COBS overhead + delimiter
+
+int telemetryDecimation = 1;    // Send one frame every N sweeps, 0 = off
+
+unsigned int telemetrySeq = 0;
+int telemetryCount = 0;
+
+// ================== BEAM LINK ==================
+// Every dwell sends the sensed beam to the Daisy on Serial3 (TX3 = D14, to the
+// Daisy's D11), framed like the telemetry: type, sequence (u16), micros() (u32),
+// beam, beam count, flags (bit 0 = forward sweep, bit 1 = broken), laser
+// contribution (u16, laser-off minus laser-on reading), CRC.
+// The LED outputs keep working as the fallback for a Daisy without the link.
+const long linkBaud = 1000000;
+const byte frameBeam = 2;
+const int linkRawSize = 14;     // type + seq + time + beam + count + flags + value + CRC
+
+bool linkEnabled = true;
+unsigned int linkSeq = 0;
+
 // ====== VARIABLES ADDED FOR THE ENCODER ======
-volatile int lastEnc1 = HIGH;
-volatile int lastEnc2 = HIGH;
+// Full 4x quadrature decoding from the pin change interrupt of D50/D51
+// (PCINT3/PCINT2). Every edge looks up (previous AB, current AB) in the table:
+// +1 / -1 for a step, 0 for no change or a skipped state. The count is applied
+// to stepsPerRev only at the start of a forward sweep, when the mirror is back
+// at station 0, so the geometry never changes in the middle of a round trip.
+const signed char encoderTable[16] = {
+   0, -1,  1,  0,
+   1,  0,  0, -1,
+  -1,  0,  0,  1,
+   0,  1, -1,  0
+};
+int encoderCountsPerStep = 4;   // Counts per stepsPerRev change, 4 = one full quadrature cycle
+
+volatile int encoderCount = 0;
+volatile byte encoderState = 0;
+
+// ====== FUNCTIONS ADDED FOR THE ENCODER ======
+// A = enc1 (PB3) in bit 1, B = enc2 (PB2) in bit 0
+byte encoderRead() {
+  return (PINB >> PB2) & 0x03;
+}
+
+void encoderBegin() {
+  encoderState = encoderRead();
+  PCMSK0 |= (1 << PCINT2) | (1 << PCINT3);
+  PCICR |= (1 << PCIE0);
+}
+
+ISR(PCINT0_vect) {
+  byte state = encoderRead();
+  encoderCount += encoderTable[(encoderState << 2) | state];
+  encoderState = state;
+}
+
+// Applies the turns counted since the last sweep, B low on a rising A is clockwise (+)
+void applyEncoder() {
+  byte sreg = SREG;
+  cli();
+  int steps = encoderCount / encoderCountsPerStep;
+  encoderCount -= steps * encoderCountsPerStep;
+  SREG = sreg;
+  if (steps == 0) return;
+
+  stepsPerRev += steps;
+  if (stepsPerRev < 10) stepsPerRev = 10; // minimum limit
+  cordemezzi = stepsPerRev / corde;       // update
+}
+
+
+// ====== ADC FUNCTIONS ======
+void adcSelect(byte channel) {
+  ADMUX = (1 << REFS0) | (channel & 0x07);  // AVcc reference, ADC8 + channel
+  ADCSRB |= (1 << MUX5);
+}
+
+void adcBegin() {
+  DIDR2 = (1 << ldrCount) - 1;   // No digital input buffers on A8-A12
+  adcSelect(0);
+  ADCSRA = (1 << ADEN) | (1 << ADIE) | adcPrescalerBits;
+  ADCSRA |= (1 << ADSC);
+}
+
+ISR(ADC_vect) {
+  unsigned int value = ADC;
+
+  if (adcRestart) {
+    // Start a new set on channel 0, it only holds samples taken from now on
+    adcRestart = false;
+    adcChannel = 0;
+    adcConversions = 0;
+    adcAccum = 0;
+    adcSettling = true;
+    adcSelect(0);
+  } else if (adcSettling) {
+    adcSettling = false;
+  } else {
+    adcAccum += value;
+    if (++adcConversions >= adcOversample[adcChannel]) {
+      byte back = adcFront ^ 1;
+      adcSets[back][adcChannel] = adcAccum / adcConversions;
+      adcAccum = 0;
+      adcConversions = 0;
+      adcSettling = true;
+
+      if (++adcChannel >= ldrCount) {
+        adcChannel = 0;
+        adcFront = back;
+        adcSetCount++;
+      }
+      adcSelect(adcChannel);
+    }
+  }
+
+  ADCSRA |= (1 << ADSC);
+}
+
+// Discards the set in progress, e.g. right after the laser turned on.
+// Returns the set count to wait on with adcWaitSet().
+unsigned long adcSync() {
+  byte sreg = SREG;
+  cli();
+  adcRestart = true;
+  unsigned long count = adcSetCount;
+  SREG = sreg;
+  return count;
+}
+
+// Copies the latest complete set, returns its number
+unsigned long adcRead(int values[ldrCount]) {
+  byte sreg = SREG;
+  cli();
+  byte front = adcFront;
+  for (int i = 0; i < ldrCount; i++) values[i] = adcSets[front][i];
+  unsigned long count = adcSetCount;
+  SREG = sreg;
+  return count;
+}
+
+// True once a set started after adcSync() is complete
+bool adcSetReady(unsigned long after) {
+  byte sreg = SREG;
+  cli();
+  unsigned long count = adcSetCount;
+  SREG = sreg;
+  return count > after;
+}
+
+// ====== STEPPER FUNCTIONS ======
+void buildStepTable() {
+  pulseTicks = pulseWidthMicros * ticksPerMicro;
+  cruiseTicks = (pulseWidthMicros + millisBtwnSteps) * ticksPerMicro;
+  if (rampSteps > maxRampSteps) rampSteps = maxRampSteps;
+
+  // Constant acceleration: interval n = c0 * (sqrt(n + 1) - sqrt(n))
+  for (int i = 0; i < rampSteps; i++) {
+    float interval = rampStartMicros * (sqrt(i + 1.0) - sqrt((float)i));
+    unsigned int ticks = interval * ticksPerMicro;
+    rampTable[i] = ticks > cruiseTicks ? ticks : cruiseTicks;
+  }
+}
+
+unsigned int stepInterval(unsigned int index) {
+  unsigned int fromEnd = moveSteps - 1 - index;
+  unsigned int edge = index < fromEnd ? index : fromEnd;
+  return (int)edge < rampSteps ? rampTable[edge] : cruiseTicks;
+}
 
-// ====== FUNCTION ADDED FOR THE ENCODER ======
-void readEncoder() {
-  int a = digitalRead(enc1);
-  int b = digitalRead(enc2);
+void stepperBegin() {
+  buildStepTable();
+  TCCR1A = 0;
+  TCCR1B = 0;
+  TIMSK1 = 0;
+}
+
+void startMove(unsigned int steps, bool forward) {
+  if (forward) PORTE |= (1 << PE3);   // dir
+  else PORTE &= ~(1 << PE3);
+
+  moveSteps = steps;
+  stepIndex = 0;
+  stepPhase = 0;
+  stepperBusy = steps > 0;
+  if (!stepperBusy) return;
+
+  TCNT1 = 0;
+  OCR1A = dirSetupTicks - 1;
+  TIFR1 = (1 << OCF1A);
+  TIMSK1 = (1 << OCIE1A);
+  TCCR1B = (1 << WGM12) | (1 << CS11);  // CTC, clk/8
+}
 
-  if (a != lastEnc1) {       // change on A
-    if (a == HIGH) {         // rising edge
-      if (b == LOW) stepsPerRev++;   // clockwise
-      else stepsPerRev--;            // counterclockwise
+ISR(TIMER1_COMPA_vect) {
+  if (stepPhase == 0) {
+    if (stepIndex >= moveSteps) {
+      // Last step interval elapsed
+      TCCR1B = 0;
+      TIMSK1 = 0;
+      stepperBusy = false;
+      return;
+    }
+    PORTE |= (1 << PE4);     // step high
+    OCR1A = pulseTicks - 1;
+    stepPhase = 1;
+  } else {
+    PORTE &= ~(1 << PE4);    // step low
+    OCR1A = stepInterval(stepIndex) - pulseTicks - 1;
+    stepIndex++;
+    stepPhase = 0;
+  }
+}
 
-      if (stepsPerRev < 10) stepsPerRev = 10; // minimum limit
-      cordemezzi = stepsPerRev / corde;       // update
+// ====== TELEMETRY FUNCTIONS ======
+unsigned int crc16(const byte* data, int length) {
+  unsigned int crc = 0xFFFF;
+  for (int i = 0; i < length; i++) {
+    crc ^= (unsigned int)data[i] << 8;
+    for (int b = 0; b < 8; b++) {
+      crc = (crc & 0x8000) ? (crc << 1) ^ 0x1021 : crc << 1;
     }
   }
+  return crc;
+}
 
-  lastEnc1 = a;
-  lastEnc2 = b;
+// COBS: every zero byte is replaced by the distance to the next one,
+// so 0x00 only appears as the frame delimiter
+int cobsEncode(const byte* input, int length, byte* output) {
+  int codeIndex = 0;
+  int out = 1;
+  byte code = 1;
+  for (int i = 0; i < length; i++) {
+    if (input[i] == 0) {
+      output[codeIndex] = code;
+      codeIndex = out++;
+      code = 1;
+    } else {
+      output[out++] = input[i];
+      code++;
+    }
+  }
+  output[codeIndex] = code;
+  output[out++] = 0;
+  return out;
+}
+
+// Adds the CRC to raw (last two bytes) and queues the frame on port. The frame
+// is dropped rather than blocking the scan when the TX buffer is full.
+void sendFrame(HardwareSerial& port, byte* raw, int rawSize) {
+  unsigned int crc = crc16(raw, rawSize - 2);
+  raw[rawSize - 2] = crc;
+  raw[rawSize - 1] = crc >> 8;
+
+  if (port.availableForWrite() < rawSize + 2) return;
+
+  byte frame[maxFrameSize];
+  int length = cobsEncode(raw, rawSize, frame);
+  port.write(frame, length);
+}
+
+void sendTelemetry(const int values[ldrCount]) {
+  if (telemetryDecimation <= 0) return;
+  if (++telemetryCount < telemetryDecimation) return;
+  telemetryCount = 0;
+
+  byte raw[telemetryRawSize];
+  unsigned long now = micros();
+
+  raw[0] = frameSweep;
+  raw[1] = telemetrySeq;
+  raw[2] = telemetrySeq >> 8;
+  for (int i = 0; i < 4; i++) raw[3 + i] = now >> (8 * i);
+  for (int i = 0; i < ldrCount; i++) {
+    raw[7 + 2 * i] = values[i];
+    raw[8 + 2 * i] = values[i] >> 8;
+  }
+  for (int i = 0; i < 4; i++) {
+    raw[17 + i] = lastMoveMicros >> (8 * i);
+    raw[21 + i] = lastDwellMicros >> (8 * i);
+  }
+  raw[25] = lastMoveSteps;
+  raw[26] = lastMoveSteps >> 8;
+  telemetrySeq++;
+
+  // Skipped frames still use a sequence number, the host counts them as drops
+  sendFrame(Serial, raw, telemetryRawSize);
+}
+
+// ====== BEAM LINK FUNCTIONS ======
+void sendBeam(int beam) {
+  if (!linkEnabled) return;
+
+  byte raw[linkRawSize];
+  unsigned long now = micros();
+
+  raw[0] = frameBeam;
+  raw[1] = linkSeq;
+  raw[2] = linkSeq >> 8;
+  for (int i = 0; i < 4; i++) raw[3 + i] = now >> (8 * i);
+  raw[7] = beam;
+  raw[8] = ldrCount;
+  raw[9] = (scanForward ? 1 : 0) | (beamBroken[beam] ? 2 : 0);
+  raw[10] = beamValues[beam];
+  raw[11] = beamValues[beam] >> 8;
+  linkSeq++;
+
+  sendFrame(Serial3, raw, linkRawSize);
+}
+
+// ====== BEAM SENSING ======
+// Station the mirror stops at for the current dwell. Forward dwells end on
+// stations 1..corde and backward ones on corde-1..0, so the station is the
+// beam index in both directions.
+int scanStation() {
+  return scanForward ? scanPosition + 1 : corde - 1 - scanPosition;
+}
+
+// Reads the lit beam's LDR, subtracts the ambient reading and updates its output to the Daisy
+void senseBeam(int beam) {
+  if (beam < 0 || beam >= ldrCount) return;
+
+  const int leds[ldrCount] = { led1, led2, led3, led4, led5 };
+  int ldr[ldrCount];
+  adcRead(ldr);
+
+  // The other LDRs are dark at this station: their drift since the ambient set
+  // is the ambient change during the dwell (flicker), removed as common mode
+  long drift = 0;
+  for (int i = 0; i < ldrCount; i++) {
+    if (i != beam) drift += ambient[i] - ldr[i];
+  }
+  int signal = ambient[beam] - ldr[beam] - drift / (ldrCount - 1);
+  if (signal < 0) signal = 0;
+  beamValues[beam] = signal;
+
+  // Compare against the intact level, which only learns while the beam is intact
+  long level = beamLevel[beam];
+  if (level >= minLaserSignal) {
+    if (!beamBroken[beam] && signal * 100L < level * breakPercent) beamBroken[beam] = true;
+    else if (beamBroken[beam] && signal * 100L > level * restorePercent) beamBroken[beam] = false;
+  }
+  if (!beamBroken[beam]) {
+    if (beamLevel[beam] == 0) beamLevel[beam] = signal;
+    else beamLevel[beam] += (signal - beamLevel[beam]) >> levelShift;
+  }
+  sendBeam(beam);
+
+  if (beamBroken[beam]) {
+    digitalWrite(leds[beam], HIGH);
+  } else digitalWrite(leds[beam], LOW);
 }
 
 
 void setup() {
-  Serial.begin(9600);
+  Serial.begin(telemetryBaud);
+  Serial3.begin(linkBaud);
 
   pinMode(stepPin, OUTPUT);
   pinMode(dirPin, OUTPUT);
@@ -73,6 +488,7 @@ void setup() {
 
   pinMode(enc1, INPUT_PULLUP);
   pinMode(enc2, INPUT_PULLUP);  
+  encoderBegin();
 
   // ===== LDRs  pull-up =====
   pinMode(ldr1, INPUT_PULLUP);
@@ -80,6 +496,8 @@ void setup() {
   pinMode(ldr3, INPUT_PULLUP);
   pinMode(ldr4, INPUT_PULLUP);
   pinMode(ldr5, INPUT_PULLUP);
+  adcBegin();
+  stepperBegin();
 
   //========== OUTPUT SIGNALS FOR THE DAISY =====
 
@@ -94,91 +512,64 @@ void setup() {
 
 void loop() {
 
-  readEncoder();
-
-
-  int v1 = analogRead(ldr1);
-  int v2 = analogRead(ldr2);
-  int v3 = analogRead(ldr3);
-  int v4 = analogRead(ldr4);
-  int v5 = analogRead(ldr5);
-
-   //Debug print
-  Serial.print("LDRs: ");
-  Serial.print(v1); Serial.print(" ");
-  Serial.print(v2); Serial.print(" ");
-  Serial.print(v3); Serial.print(" ");
-  Serial.print(v4); Serial.print(" ");
-  Serial.println(v5);
-
-  // ================== FORWARD ==================
-
-  for (int j = 0; j < corde; j++) {
-
-    digitalWrite(dirPin, HIGH);  // dir 
-  
-    for (int i = 0; i < cordemezzi; i++) {
-      digitalWrite(stepPin, HIGH);
-      delayMicroseconds(pulseWidthMicros);
-      digitalWrite(stepPin, LOW);
-      delayMicroseconds(millisBtwnSteps);
-      
-      readEncoder();   // encoder also during movement
-    }
-
-    digitalWrite(laser, HIGH);
-  
-    int v1 = analogRead(ldr1);
-    int v2 = analogRead(ldr2);
-    int v3 = analogRead(ldr3);
-    int v4 = analogRead(ldr4);
-    int v5 = analogRead(ldr5);
-
-    if(v1>k){
-      digitalWrite(led1, HIGH);
-    }else digitalWrite(led1, LOW);
-    
-    if(v2>k){
-      digitalWrite(led2, HIGH);
-    }else digitalWrite(led2, LOW);
-    
-    if(v3>k){
-      digitalWrite(led3, HIGH);
-    }else digitalWrite(led3, LOW);
-    
-    if(v4>k){
-      digitalWrite(led4, HIGH);
-    }else digitalWrite(led4, LOW);
-
-    if(v5>k){
-      digitalWrite(led5, HIGH);
-    }else digitalWrite(led5, LOW);
-
-    
-    delay(tempo);
-    digitalWrite(laser, LOW);
+  unsigned long now = micros();
+
+  switch (scanState) {
+    case SCAN_MOVE:
+      if (scanForward && scanPosition == 0) {
+        // Knob turns take effect between round trips
+        applyEncoder();
+
+        // Binary telemetry once per sweep (decode with telemetry_decoder.py)
+        sendTelemetry(beamValues);
+      }
+      lastMoveSteps = cordemezzi;
+      startMove(cordemezzi, scanForward);
+      phaseStart = now;
+      scanState = SCAN_MOVING;
+      break;
+
+    case SCAN_MOVING:
+      if (stepperBusy) break;
+      lastMoveMicros = now - phaseStart;
+
+      // Ambient reference, a set taken entirely after the mirror stopped
+      dwellSets = adcSync();
+      scanState = SCAN_AMBIENT;
+      break;
+
+    case SCAN_AMBIENT:
+      if (!adcSetReady(dwellSets)) break;
+      adcRead(ambient);
+
+      PORTB |= (1 << PB0);     // laser on
+      dwellSets = adcSync();
+      phaseStart = now;
+      scanState = SCAN_DWELL;
+      break;
+
+    case SCAN_DWELL:
+      // The ADC samples in the background during the dwell
+      if (now - phaseStart < (unsigned long)tempo * 1000) break;
+      scanState = SCAN_SAMPLE;
+      break;
+
+    case SCAN_SAMPLE:
+      // Newest set, taken entirely with the laser on
+      if (!adcSetReady(dwellSets)) break;
+
+      // Both directions sense, the station gives the lit beam
+      senseBeam(scanStation());
+
+      PORTB &= ~(1 << PB0);    // laser off
+      lastDwellMicros = now - phaseStart;
+
+      // Next position, the direction reverses after corde positions
+      if (++scanPosition >= corde) {
+        scanPosition = 0;
+        scanForward = !scanForward;
+      }
+      scanState = SCAN_MOVE;
+      break;
   }
-
-  // ================== BACKWARD ==================
-
-  for (int j = 0; j < corde; j++) {
-
-    digitalWrite(dirPin, LOW); // setting dir pin to 0 reverses the direction
-
-    for (int i = 0; i < cordemezzi; i++) {
-      digitalWrite(stepPin, HIGH);
-      delayMicroseconds(pulseWidthMicros);
-      digitalWrite(stepPin, LOW);
-      delayMicroseconds(millisBtwnSteps);
-
-      readEncoder();   //
-    }
-
-    digitalWrite(laser, HIGH);
-
-    delay(tempo);
-    digitalWrite(laser, LOW);
-  }
-
-  //delay(10);
-}  
+}
@@ -0,0 +1,180 @@
+#!/usr/bin/env python3
+"""Decoder for the binary telemetry of code_arduino.cpp.
+
+Frames are COBS encoded and 0x00 delimited. Payload, little-endian:
+type (u8), sequence (u16), micros (u32), values, CRC-16/CCITT (u16).
+Sweep frame values: 5 beam laser contributions (u16, laser-off minus laser-on
+reading), duration of the last move and of the
+last laser dwell (u32, us), steps of the last move (u16).
+
+    python telemetry_decoder.py /dev/ttyACM0            # Live, needs pyserial
+    python telemetry_decoder.py --file capture.bin      # Raw capture
+"""
+import argparse
+import struct
+import sys
+import time
+
+BAUD = 1000000
+FRAME_SWEEP = 1
+FRAME_FORMATS = {FRAME_SWEEP: "<5H2IH"}
+FRAME_NAMES = {FRAME_SWEEP: "sweep"}
+
+
+def crc16(data):
+    crc = 0xFFFF
+    for byte in data:
+        crc ^= byte << 8
+        for _ in range(8):
+            crc = ((crc << 1) ^ 0x1021) if crc & 0x8000 else crc << 1
+            crc &= 0xFFFF
+    return crc
+
+
+def cobs_decode(data):
+    out = bytearray()
+    i = 0
+    while i < len(data):
+        code = data[i]
+        if code == 0 or i + code > len(data) + 1:
+            return None
+        out += data[i + 1:i + code]
+        i += code
+        if code < 0xFF and i < len(data):
+            out.append(0)
+    return bytes(out)
+
+
+class Stats:
+    """Frame, drop and CRC counters plus the scan rate from device timestamps"""
+
+    def __init__(self, decimation):
+        self.decimation = decimation
+        self.frames = 0
+        self.dropped = 0
+        self.crc_errors = 0
+        self.framing_errors = 0
+        self.last_seq = None
+        self.first = None           # (seq count, micros) at the start of the window
+        self.last = None
+        self.seq_total = 0          # Sequence numbers seen including drops, unwrapped
+
+    def add(self, seq, micros):
+        if self.last_seq is not None:
+            gap = (seq - self.last_seq) & 0xFFFF
+            if gap == 0:
+                return
+            self.dropped += gap - 1
+            self.seq_total += gap
+        self.last_seq = seq
+        self.frames += 1
+        if self.first is None:
+            self.first = (self.seq_total, micros)
+        self.last = (self.seq_total, micros)
+
+    def scan_rate(self):
+        """Sweeps per second over the window, drops included"""
+        if self.first is None or self.last == self.first:
+            return 0.0
+        elapsed = (self.last[1] - self.first[1]) & 0xFFFFFFFF
+        if elapsed == 0:
+            return 0.0
+        return (self.last[0] - self.first[0]) * self.decimation * 1e6 / elapsed
+
+    def report(self):
+        total = self.frames + self.dropped
+        loss = 100.0 * self.dropped / total if total else 0.0
+        return (f"frames={self.frames} dropped={self.dropped} ({loss:.1f}%) "
+                f"crc_errors={self.crc_errors} framing_errors={self.framing_errors} "
+                f"scan_rate={self.scan_rate():.1f}/s")
+
+    def restart_window(self):
+        self.first = self.last
+
+
+def parse_frame(encoded, stats):
+    raw = cobs_decode(encoded)
+    if raw is None or len(raw) < 9:
+        stats.framing_errors += 1
+        return None
+    if crc16(raw[:-2]) != struct.unpack_from("<H", raw, len(raw) - 2)[0]:
+        stats.crc_errors += 1
+        return None
+    frame_type, seq, micros = struct.unpack_from("<BHI", raw)
+    fmt = FRAME_FORMATS.get(frame_type)
+    if fmt is None or struct.calcsize(fmt) != len(raw) - 9:
+        stats.framing_errors += 1
+        return None
+    stats.add(seq, micros)
+    return frame_type, seq, micros, struct.unpack_from(fmt, raw, 7)
+
+
+class FrameReader:
+    """Splits a byte stream at 0x00 delimiters"""
+
+    def __init__(self):
+        self.buffer = bytearray()
+        self.synced = False
+
+    def feed(self, data):
+        self.buffer += data
+        while True:
+            end = self.buffer.find(0)
+            if end < 0:
+                return
+            frame = bytes(self.buffer[:end])
+            del self.buffer[:end + 1]
+            # The first delimiter only synchronizes, data before it may be partial
+            if self.synced and frame:
+                yield frame
+            self.synced = True
+
+
+def main():
+    parser = argparse.ArgumentParser(description="LaserHarp Arduino telemetry decoder")
+    parser.add_argument("port", nargs="?", help="Serial port")
+    parser.add_argument("--file", help="Decode a raw capture instead of a port")
+    parser.add_argument("--baud", type=int, default=BAUD)
+    parser.add_argument("--decimation", type=int, default=1, help="telemetryDecimation of the sketch")
+    parser.add_argument("--interval", type=float, default=1.0, help="Statistics interval (s)")
+    parser.add_argument("--quiet", action="store_true", help="Statistics only")
+    args = parser.parse_args()
+
+    stats = Stats(args.decimation)
+    reader = FrameReader()
+
+    def handle(data):
+        for encoded in reader.feed(data):
+            frame = parse_frame(encoded, stats)
+            if frame and not args.quiet:
+                frame_type, seq, micros, values = frame
+                ldr = " ".join(map(str, values[:5]))
+                move_us, dwell_us, steps = values[5:]
+                print(f"{FRAME_NAMES[frame_type]} seq={seq} t={micros} ldr={ldr} "
+                      f"move={move_us}us/{steps} steps dwell={dwell_us}us")
+
+    if args.file:
+        with open(args.file, "rb") as f:
+            reader.synced = True
+            handle(f.read())
+        print(stats.report())
+        return
+    if not args.port:
+        parser.error("a port or --file is required")
+
+    import serial
+    port = serial.Serial(args.port, args.baud, timeout=0.1)
+    last_report = time.monotonic()
+    try:
+        while True:
+            handle(port.read(port.in_waiting or 1))
+            if time.monotonic() - last_report >= args.interval:
+                print(stats.report(), file=sys.stderr)
+                stats.restart_window()
+                last_report = time.monotonic()
+    except KeyboardInterrupt:
+        print(stats.report(), file=sys.stderr)
+
+
+if __name__ == "__main__":
+    main()
@@ -0,0 +1,104 @@
+// Two-MCU latency from a hand entering a beam until the Daisy's main loop sees
+// the break, replayed on the simulated Mega: LDRs with a 0.5/2 ms first-order
+// response, steady light, a hand letting a fifth of the laser through. The
+// Daisy polls the LED inputs and the UART link once per millisecond, so each
+// break is seen at the next poll after the LED edge or after the end of the
+// beam frame on Serial3. Prints the mean and worst latency of both paths.
+#include <stdio.h>
+#include <stdlib.h>
+#include <algorithm>
+#include "Arduino.h"
+#include "code_arduino.cpp"
+
+const double LASER = 600.0;             // Drop of an intact lit beam
+const double HAND = 0.2;                // Share of the laser a hand lets through
+const double ATTACK_US = 500.0;
+const double DECAY_US = 2000.0;
+const int DARK = 1000;
+const uint32_t DAISY_LOOP_US = 1000;
+const uint32_t DAISY_PHASE_US = 370;    // The two clocks are unrelated
+const uint32_t POLL_US = 10;
+const uint32_t HOLD_US = 20000;
+const int TRIALS = 600;
+
+static int handBeam = -1;
+static double response[ldrCount];
+static uint32_t lastUs = 0;
+
+static bool Lit(int beam) {
+    return (PORTB & (1 << PB0)) && host::Position() == beam * cordemezzi;
+}
+
+static int Reading(uint8_t channel, uint32_t timeUs) {
+    double dt = timeUs - lastUs;
+    lastUs = timeUs;
+    for (int b = 0; b < ldrCount; b++) {
+        double light = Lit(b) ? LASER * (b == handBeam ? HAND : 1.0) : 0.0;
+        double tau = light > response[b] ? ATTACK_US : DECAY_US;
+        response[b] += (light - response[b]) * (1.0 - exp(-dt / tau));
+    }
+    return (int)(DARK - response[channel - 8]) + rand() % 9 - 4;
+}
+
+static bool Broken(int beam) {
+    const int leds[ldrCount] = { led1, led2, led3, led4, led5 };
+    return host::Pins()[leds[beam]] == HIGH;
+}
+
+// First Daisy main loop pass at or after the given time
+static uint32_t NextPoll(uint32_t us) {
+    return (us - DAISY_PHASE_US + DAISY_LOOP_US - 1) / DAISY_LOOP_US * DAISY_LOOP_US + DAISY_PHASE_US;
+}
+
+struct Latency {
+    double sum;
+    uint32_t worst;
+
+    void Add(uint32_t us) {
+        sum += us;
+        worst = std::max(worst, us);
+    }
+    void Print(const char* name) const {
+        printf("two-MCU latency, %-18s mean %.1f ms, max %.1f ms over %d entries\n",
+               name, sum / TRIALS / 1000.0, worst / 1000.0, TRIALS);
+    }
+};
+
+int main() {
+    srand(1);
+    host::Adc() = Reading;
+    host::Start();
+    host::Run(500000);      // Clear beams first, the levels are learned
+
+    Latency scan = { 0.0, 0 };
+    Latency digital = { 0.0, 0 };
+    Latency link = { 0.0, 0 };
+    for (int trial = 0; trial < TRIALS; trial++) {
+        host::Run(5000 + rand() % 50000);
+        handBeam = rand() % ldrCount;
+        uint32_t entered = micros();
+        while (!Broken(handBeam)) host::Run(POLL_US);
+        uint32_t edge = micros();
+
+        // The frame carrying the break is the first to end after the LED edge
+        host::Run(1000);
+        uint32_t frameEnd = edge;
+        const std::vector<uint64_t>& ends = Serial3.frameEnds;
+        for (size_t i = ends.size(); i-- > 0 && ends[i] / host::TICKS_PER_US >= edge;) {
+            frameEnd = (uint32_t)(ends[i] / host::TICKS_PER_US);
+        }
+        scan.Add(edge - entered);
+        digital.Add(NextPoll(edge) - entered);
+        link.Add(NextPoll(frameEnd) - entered);
+
+        host::Run(HOLD_US);
+        int beam = handBeam;
+        handBeam = -1;
+        while (Broken(beam)) host::Run(POLL_US);
+    }
+
+    scan.Print("Arduino scan:");
+    digital.Print("digital inputs:");
+    link.Print("UART link:");
+    return 0;
+}
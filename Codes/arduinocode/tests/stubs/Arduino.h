@@ -0,0 +1,258 @@
+#pragma once
+#include <stdint.h>
+#include <stddef.h>
+#include <math.h>
+#include <vector>
+
+// Host stand-in for the Arduino Mega core, enough to compile the sketch and
+// run it on a simulated clock. The AVR registers the sketch touches are plain
+// variables; host::Run() calls loop() and fires the Timer1, ADC and pin change
+// interrupts at their simulated times. Interrupts only run between loop()
+// calls, so cli()/SREG sections are trivially atomic.
+
+typedef uint8_t byte;
+
+#define HIGH 1
+#define LOW 0
+#define INPUT 0
+#define OUTPUT 1
+#define INPUT_PULLUP 2
+
+// Mega 2560 analog pins
+#define A8 62
+#define A9 63
+#define A10 64
+#define A11 65
+#define A12 66
+
+// Registers
+volatile uint8_t SREG, PORTB, PORTE, PINB, PCMSK0, PCICR;
+volatile uint8_t ADMUX, ADCSRA, ADCSRB, DIDR2;
+volatile uint16_t ADC;
+volatile uint8_t TCCR1A, TCCR1B, TIMSK1, TIFR1;
+volatile uint16_t TCNT1, OCR1A;
+
+// Register bits
+#define PB0 0
+#define PB2 2
+#define PB3 3
+#define PE3 3
+#define PE4 4
+#define PCINT2 2
+#define PCINT3 3
+#define PCIE0 0
+#define REFS0 6
+#define MUX5 3
+#define ADEN 7
+#define ADSC 6
+#define ADIE 3
+#define ADPS2 2
+#define ADPS0 0
+#define WGM12 3
+#define CS11 1
+#define OCIE1A 1
+#define OCF1A 1
+
+#define ISR(vector) void vector()
+void TIMER1_COMPA_vect();
+void ADC_vect();
+void PCINT0_vect();
+void setup();
+void loop();
+
+inline void cli() {}
+inline void sei() {}
+
+namespace host {
+
+const uint32_t TICKS_PER_US = 2;        // Simulation resolution, the Timer1 clock
+
+// Simulated time in Timer1 ticks (0.5 us)
+inline uint64_t& Now() { static uint64_t now = 0; return now; }
+
+// ADC reading of a channel (8-12 for A8-A12) at the start of its conversion
+typedef int (*AdcSource)(uint8_t channel, uint32_t timeUs);
+inline AdcSource& Adc() { static AdcSource source = nullptr; return source; }
+
+inline int (&Pins())[70] { static int pins[70]; return pins; }
+
+// Step pulses seen on STEP (PE4) and the mirror position they add up to
+struct StepEdge {
+    uint64_t rise;          // Rising edge, in ticks
+    uint64_t fall;          // Falling edge, in ticks
+    bool forward;
+};
+inline std::vector<StepEdge>& Steps() { static std::vector<StepEdge> steps; return steps; }
+inline int& Position() { static int position = 0; return position; }
+
+// Laser (PB0) switching times, in ticks: on, off, on, off...
+inline std::vector<uint64_t>& LaserEdges() { static std::vector<uint64_t> edges; return edges; }
+
+} // namespace host
+
+inline unsigned long micros() { return (unsigned long)(uint32_t)(host::Now() / host::TICKS_PER_US); }
+inline void pinMode(int pin, int mode) {}
+inline void digitalWrite(int pin, int value) { host::Pins()[pin] = value; }
+
+// TX side of a UART: a 64-byte ring as in the Arduino core, drained at the
+// baud rate into a capture of everything that went out on the wire
+class HardwareSerial {
+public:
+    HardwareSerial() : baud_(0), queued_(0), nextByte_(0), fullEvery_(0), queries_(0), forcedFull_(0) {}
+
+    void begin(long baud) { baud_ = baud; }
+
+    int availableForWrite() {
+        // Test hook: report a full buffer on every Nth query
+        if (fullEvery_ > 0 && ++queries_ % fullEvery_ == 0) {
+            forcedFull_++;
+            return 0;
+        }
+        return TX_BUFFER_SIZE - 1 - queued_;
+    }
+
+    size_t write(const uint8_t* data, size_t length) {
+        for (size_t i = 0; i < length; i++) {
+            if (queued_ == 0) nextByte_ = host::Now() + ByteTicks();
+            pending_.push_back(data[i]);
+            queued_++;
+        }
+        return length;
+    }
+
+    // Simulation: moves the bytes whose transmission ended to the capture
+    void Drain() {
+        while (queued_ > 0 && nextByte_ <= host::Now()) {
+            uint8_t sent = pending_[pending_.size() - queued_];
+            wire.push_back(sent);
+            if (sent == 0) frameEnds.push_back(nextByte_);
+            queued_--;
+            nextByte_ += ByteTicks();
+        }
+        if (queued_ == 0) pending_.clear();
+    }
+
+    void ForceFullEvery(int queries) { fullEvery_ = queries; queries_ = 0; }
+    int GetForcedFull() const { return forcedFull_; }
+
+    std::vector<uint8_t> wire;
+    std::vector<uint64_t> frameEnds;    // Ticks at which each 0x00 delimiter was out
+
+private:
+    static const int TX_BUFFER_SIZE = 64;
+
+    uint64_t ByteTicks() const { return 10ull * 1000000 * host::TICKS_PER_US / baud_; }
+
+    long baud_;
+    int queued_;
+    uint64_t nextByte_;
+    std::vector<uint8_t> pending_;
+    int fullEvery_;
+    int queries_;
+    int forcedFull_;
+};
+
+HardwareSerial Serial, Serial3;
+
+namespace host {
+
+const uint32_t LOOP_TICKS = 12;         // One pass of loop(), 6us
+const uint32_t ADC_CONVERSION_TICKS = 52;   // 13 ADC clocks at 500 kHz
+
+struct Interrupts {
+    bool timerRunning;
+    uint64_t timerMatch;
+    bool adcRunning;
+    uint64_t adcDone;
+    uint8_t adcChannel;     // Channel of the conversion in progress
+    int adcValue;
+    uint8_t portE;
+    uint8_t portB;
+};
+inline Interrupts& State() { static Interrupts state = {}; return state; }
+
+inline uint8_t AdcChannel() {
+    return (ADMUX & 0x07) | ((ADCSRB & (1 << MUX5)) ? 8 : 0);
+}
+
+// Notices conversions and timer runs started by the code that just ran
+inline void Watch() {
+    Interrupts& s = State();
+    if (!s.adcRunning && (ADCSRA & (1 << ADEN)) && (ADCSRA & (1 << ADSC))) {
+        s.adcRunning = true;
+        s.adcDone = Now() + ADC_CONVERSION_TICKS;
+        s.adcChannel = AdcChannel();
+        s.adcValue = Adc() ? Adc()(s.adcChannel, (uint32_t)(Now() / TICKS_PER_US)) : 0;
+    }
+    bool timerOn = (TCCR1B & (1 << CS11)) && (TIMSK1 & (1 << OCIE1A));
+    if (timerOn && !s.timerRunning) {
+        s.timerMatch = Now() + OCR1A + 1 - TCNT1;
+    }
+    s.timerRunning = timerOn;
+
+    // Step and laser edges
+    if ((PORTE ^ s.portE) & (1 << PE4)) {
+        if (PORTE & (1 << PE4)) {
+            bool forward = (PORTE & (1 << PE3)) != 0;
+            StepEdge edge = { Now(), 0, forward };
+            Steps().push_back(edge);
+            Position() += forward ? 1 : -1;
+        } else if (!Steps().empty()) {
+            Steps().back().fall = Now();
+        }
+    }
+    if ((PORTB ^ s.portB) & (1 << PB0)) {
+        LaserEdges().push_back(Now());
+    }
+    s.portE = PORTE;
+    s.portB = PORTB;
+}
+
+// Quadrature input on D50 (A, PB3) and D51 (B, PB2), fires the pin change interrupt
+inline void SetEncoder(bool a, bool b) {
+    uint8_t pins = (PINB & ~((1 << PB3) | (1 << PB2))) | (a << PB3) | (b << PB2);
+    uint8_t changed = pins ^ PINB;
+    PINB = pins;
+    if ((PCICR & (1 << PCIE0)) && (changed & PCMSK0)) PCINT0_vect();
+}
+
+// Runs the sketch for the given time: loop() every LOOP_TICKS, interrupts in
+// between at their due times. withLoop = false runs the interrupts only.
+inline void Run(uint32_t us, bool withLoop = true) {
+    Interrupts& s = State();
+    uint64_t end = Now() + (uint64_t)us * TICKS_PER_US;
+    uint64_t nextLoop = Now();
+    while (Now() < end) {
+        uint64_t next = withLoop ? nextLoop : end;
+        if (s.timerRunning && s.timerMatch < next) next = s.timerMatch;
+        if (s.adcRunning && s.adcDone < next) next = s.adcDone;
+        Now() = next;
+        Serial.Drain();
+        Serial3.Drain();
+
+        if (s.timerRunning && s.timerMatch == Now()) {
+            TCNT1 = 0;
+            TIMER1_COMPA_vect();
+            s.timerMatch = Now() + OCR1A + 1;
+        } else if (s.adcRunning && s.adcDone == Now()) {
+            s.adcRunning = false;
+            ADCSRA &= ~(1 << ADSC);
+            ADC = s.adcValue;
+            ADC_vect();
+        } else if (withLoop && nextLoop == Now()) {
+            loop();
+            nextLoop = Now() + LOOP_TICKS;
+        } else {
+            continue;
+        }
+        Watch();
+    }
+}
+
+// setup() plus the first look at the peripherals it started
+inline void Start() {
+    setup();
+    Watch();
+}
+
+} // namespace host
@@ -0,0 +1,90 @@
+// ADC interrupt test of the sketch on the simulated Mega (see stubs/Arduino.h).
+// The first conversion after a channel switch reads full scale and must be
+// discarded; the next ones read base + 1, base + 2, ... so every channel's
+// average tells how many conversions went into it. Checks the per-channel
+// averages, the set period and that adcSync() only waits for fresh sets.
+#include <stdio.h>
+#include "Arduino.h"
+#include "code_arduino.cpp"
+
+static int failures = 0;
+
+#define CHECK(cond) do { \
+    if (!(cond)) { \
+        if (++failures <= 10) printf("FAIL line %d: %s\n", __LINE__, #cond); \
+    } \
+} while (0)
+
+const uint32_t CONVERSION_US = host::ADC_CONVERSION_TICKS / host::TICKS_PER_US;
+
+static uint8_t lastChannel = 0xFF;
+static int conversion = 0;          // Conversions since the last channel switch
+
+static int Reading(uint8_t channel, uint32_t timeUs) {
+    if (channel != lastChannel) {
+        lastChannel = channel;
+        conversion = 0;
+        return 1023;
+    }
+    return (channel - 8 + 1) * 100 + ++conversion;
+}
+
+// Runs the ADC alone (no loop()) and checks the averages of the sets it completes
+static void CheckSets(const char* name) {
+    uint32_t expectedUs = 0;
+    for (int i = 0; i < ldrCount; i++) expectedUs += (adcOversample[i] + 1) * CONVERSION_US;
+
+    host::Run(2 * expectedUs, false);
+    unsigned long firstSet = adcSetCount;
+    uint32_t start = micros();
+    int wrong = 0;
+    for (int set = 0; set < 100; set++) {
+        unsigned long count = adcSetCount;
+        while (adcSetCount == count) host::Run(CONVERSION_US, false);
+        int values[ldrCount];
+        adcRead(values);
+        for (int i = 0; i < ldrCount; i++) {
+            // Mean of 1..n, truncated
+            int expected = (i + 1) * 100 + (adcOversample[i] + 1) / 2;
+            if (values[i] != expected) wrong++;
+        }
+    }
+    double periodUs = (double)(micros() - start) / (adcSetCount - firstSet);
+    CHECK(wrong == 0);
+    CHECK(periodUs > expectedUs - CONVERSION_US && periodUs < expectedUs + CONVERSION_US);
+    printf("sets, %s: 100 sets, %d wrong averages, %.1f us per set (%u expected)\n",
+           name, wrong, periodUs, expectedUs);
+}
+
+// A set ready after adcSync() holds only conversions started after it
+static void CheckSync() {
+    host::Run(300, false);
+    uint32_t synced = micros();
+    unsigned long count = adcSync();
+    while (!adcSetReady(count)) host::Run(CONVERSION_US, false);
+    uint32_t waited = micros() - synced;
+
+    uint32_t setUs = 0;
+    for (int i = 0; i < ldrCount; i++) setUs += (adcOversample[i] + 1) * CONVERSION_US;
+    CHECK(waited >= setUs);
+    CHECK(waited <= setUs + 2 * CONVERSION_US);
+    printf("sync: fresh set after %u us (a set takes %u)\n", waited, setUs);
+}
+
+int main() {
+    host::Adc() = Reading;
+    host::Start();
+    CheckSets("4x");
+
+    const byte oversample[ldrCount] = { 1, 2, 4, 8, 16 };
+    for (int i = 0; i < ldrCount; i++) adcOversample[i] = oversample[i];
+    CheckSets("1/2/4/8/16x");
+    CheckSync();
+
+    if (failures > 0) {
+        printf("%d failures\n", failures);
+        return 1;
+    }
+    printf("ok\n");
+    return 0;
+}
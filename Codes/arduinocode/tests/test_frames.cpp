@@ -0,0 +1,167 @@
+// Telemetry and beam link test of the sketch on the simulated Mega (see
+// stubs/Arduino.h). Decodes what went out on Serial and Serial3: COBS framing,
+// CRC, the fields of the sweep and beam frames, and sweep frames dropped on a
+// full TX buffer, which must show up as sequence gaps.
+#include <stdio.h>
+#include "Arduino.h"
+#include "code_arduino.cpp"
+
+static int failures = 0;
+
+#define CHECK(cond) do { \
+    if (!(cond)) { \
+        if (++failures <= 10) printf("FAIL line %d: %s\n", __LINE__, #cond); \
+    } \
+} while (0)
+
+// Laser contribution of each intact beam, the LDR input drops by it when lit
+const int CONTRIBUTION[ldrCount] = { 150, 180, 210, 240, 270 };
+const int DARK = 800;
+const int HAND_BEAM = 2;
+const uint32_t HAND_START_US = 400000;
+const uint32_t HAND_END_US = 600000;
+
+static bool Lit(int beam) {
+    return (PORTB & (1 << PB0)) && host::Position() == beam * cordemezzi;
+}
+
+// LDR reading: a hand in the beam lets a fifth of the laser through
+static int Reading(uint8_t channel, uint32_t timeUs) {
+    int beam = channel - 8;
+    if (!Lit(beam)) return DARK;
+    bool hand = beam == HAND_BEAM && timeUs >= HAND_START_US && timeUs < HAND_END_US;
+    return DARK - (hand ? CONTRIBUTION[beam] / 5 : CONTRIBUTION[beam]);
+}
+
+struct Decoded {
+    std::vector<std::vector<uint8_t> > frames;
+    int crcErrors;
+    int framingErrors;
+};
+
+static Decoded Decode(const std::vector<uint8_t>& wire, int rawSize) {
+    Decoded decoded;
+    decoded.crcErrors = 0;
+    decoded.framingErrors = 0;
+    std::vector<uint8_t> encoded;
+    for (size_t i = 0; i < wire.size(); i++) {
+        if (wire[i] != 0) {
+            encoded.push_back(wire[i]);
+            continue;
+        }
+        // COBS: each code byte gives the distance to the next zero
+        std::vector<uint8_t> raw;
+        size_t at = 0;
+        bool framed = true;
+        while (at < encoded.size()) {
+            uint8_t code = encoded[at];
+            if (code == 0 || at + code > encoded.size() + 1) {
+                framed = false;
+                break;
+            }
+            raw.insert(raw.end(), encoded.begin() + at + 1, encoded.begin() + at + code);
+            at += code;
+            if (code < 0xFF && at < encoded.size()) raw.push_back(0);
+        }
+        encoded.clear();
+        if (!framed || (int)raw.size() != rawSize) {
+            decoded.framingErrors++;
+            continue;
+        }
+        // crc16() keeps 16 bits in an AVR int, a wider host int collects carries above them
+        unsigned int crc = raw[rawSize - 2] | (raw[rawSize - 1] << 8);
+        if (crc != (crc16(&raw[0], rawSize - 2) & 0xFFFF)) {
+            decoded.crcErrors++;
+            continue;
+        }
+        decoded.frames.push_back(raw);
+    }
+    return decoded;
+}
+
+static uint32_t U16(const std::vector<uint8_t>& raw, int at) {
+    return raw[at] | (raw[at + 1] << 8);
+}
+
+static uint32_t U32(const std::vector<uint8_t>& raw, int at) {
+    return U16(raw, at) | (U16(raw, at + 2) << 16);
+}
+
+static void CheckTelemetry(const std::vector<uint8_t>& wire, int forcedFull) {
+    Decoded decoded = Decode(wire, telemetryRawSize);
+    CHECK(decoded.crcErrors == 0 && decoded.framingErrors == 0);
+    CHECK(decoded.frames.size() > 50);
+
+    int dropped = 0;
+    bool fields = true;
+    for (size_t i = 0; i < decoded.frames.size(); i++) {
+        const std::vector<uint8_t>& raw = decoded.frames[i];
+        fields = fields && raw[0] == frameSweep;
+        if (i > 0) dropped += ((U16(raw, 1) - U16(decoded.frames[i - 1], 1)) & 0xFFFF) - 1;
+        if (U16(raw, 1) == 0) continue;     // No move yet
+
+        // Contributions of the previous sweep and the timing of its last position
+        for (int b = 0; b < ldrCount; b++) {
+            uint32_t value = U16(raw, 7 + 2 * b);
+            fields = fields && (value == (uint32_t)CONTRIBUTION[b] || (b == HAND_BEAM && value == 42));
+        }
+        uint32_t move = U32(raw, 17);
+        uint32_t dwell = U32(raw, 21);
+        fields = fields && move >= 2 + 100u * cordemezzi && move < 3 * 100u * cordemezzi;
+        fields = fields && dwell >= (uint32_t)tempo * 1000 && dwell < (uint32_t)tempo * 1000 + 20;
+        fields = fields && U16(raw, 25) == (uint32_t)cordemezzi;
+    }
+    CHECK(fields);
+    CHECK(dropped == forcedFull);
+    CHECK(decoded.frames.size() + dropped == telemetrySeq);
+    printf("telemetry: %zu frames, %d dropped (%d forced), fields %s, no CRC or framing errors\n",
+           decoded.frames.size(), dropped, forcedFull, fields ? "ok" : "wrong");
+}
+
+static void CheckLink(const std::vector<uint8_t>& wire) {
+    Decoded decoded = Decode(wire, linkRawSize);
+    CHECK(decoded.crcErrors == 0 && decoded.framingErrors == 0);
+    CHECK(decoded.frames.size() == linkSeq);
+
+    // Stations 1..4 forward, then 3..0 backward
+    const int ORDER[8] = { 1, 2, 3, 4, 3, 2, 1, 0 };
+    int wrong = 0;
+    int broken = 0;
+    for (size_t i = 0; i < decoded.frames.size(); i++) {
+        const std::vector<uint8_t>& raw = decoded.frames[i];
+        int beam = raw[7];
+        bool forward = (raw[9] & 1) != 0;
+        bool isBroken = (raw[9] & 2) != 0;
+        uint32_t time = U32(raw, 3);
+        bool hand = beam == HAND_BEAM && time >= HAND_START_US && time < HAND_END_US + 10000;
+        uint32_t value = U16(raw, 10);
+        if (raw[0] != frameBeam || U16(raw, 1) != (i & 0xFFFF) || beam != ORDER[i % 8] || raw[8] != ldrCount ||
+            forward != (i % 8 < 4) || value != (uint32_t)(isBroken ? CONTRIBUTION[beam] / 5 : CONTRIBUTION[beam])) {
+            wrong++;
+        }
+        // Broken while the hand is in, and only then
+        if (isBroken) broken++;
+        if (isBroken != (hand && value < (uint32_t)CONTRIBUTION[beam])) wrong++;
+    }
+    CHECK(wrong == 0);
+    CHECK(broken > 0);
+    printf("link: %zu beam frames, %d with a field wrong, %d broken while the hand was in\n",
+           decoded.frames.size(), wrong, broken);
+}
+
+int main() {
+    host::Adc() = Reading;
+    Serial.ForceFullEvery(10);
+    host::Start();
+    host::Run(5000000);
+
+    CheckTelemetry(Serial.wire, Serial.GetForcedFull());
+    CheckLink(Serial3.wire);
+
+    if (failures > 0) {
+        printf("%d failures\n", failures);
+        return 1;
+    }
+    printf("ok\n");
+    return 0;
+}
@@ -0,0 +1,160 @@
+// Beam sensing replay of the sketch on the simulated Mega (see stubs/Arduino.h).
+// Each LDR follows the light on it (its beam's laser, ambient light with a
+// different share per LDR, mains flicker) with a first-order response, slower
+// when the light falls, and ADC noise. Hands enter random beams; each must be
+// reported broken, stay broken while the hand is in, be restored after it
+// leaves, and no other beam may break.
+#include <stdio.h>
+#include <stdlib.h>
+#include "Arduino.h"
+#include "code_arduino.cpp"
+
+static int failures = 0;
+
+#define CHECK(cond) do { \
+    if (!(cond)) { \
+        if (++failures <= 10) printf("FAIL line %d: %s\n", __LINE__, #cond); \
+    } \
+} while (0)
+
+const double PI = 3.14159265358979;
+const int DARK = 1000;                  // LDR input with no light
+const double LASER = 600.0;             // Drop of an intact lit beam
+const double HAND = 0.2;                // Share of the laser a hand lets through
+const double AMBIENT_SHARE[ldrCount] = { 0.7, 1.3, 1.0, 0.85, 1.15 };
+const uint32_t WARMUP_US = 500000;      // Clear beams first, the levels are learned
+const uint32_t HOLD_US = 150000;        // About two round trips
+const uint32_t RELEASE_US = 150000;     // Restore timeout, and the gap before the next hand
+const uint32_t POLL_US = 100;
+const int TRIALS = 100;
+
+struct Scene {
+    const char* name;
+    double ambient;         // Mean ambient drop
+    double flicker;         // Flicker peak to peak, as a drop
+    double flickerHz;       // 100 Hz from mains lamps, 50 Hz from half-wave LED drivers
+    double laserEnd;        // Laser power at the end of the scene, from 1
+    double attackUs;        // LDR time constant while the light rises
+    double decayUs;         // LDR time constant while the light falls
+};
+
+static Scene scene;
+static int handBeam = -1;
+static uint32_t sceneStartUs = 0;
+static uint32_t sceneUs = 1;
+static double response[ldrCount];
+static uint32_t lastUs = 0;
+
+static bool Lit(int beam) {
+    return (PORTB & (1 << PB0)) && host::Position() == beam * cordemezzi;
+}
+
+// Light on each LDR as a drop of its input, followed with the LDR's time constants
+static void Advance(uint32_t timeUs) {
+    double t = timeUs * 1e-6;
+    double progress = (double)(timeUs - sceneStartUs) / sceneUs;
+    double laser = 1.0 + (scene.laserEnd - 1.0) * (progress > 1.0 ? 1.0 : progress);
+    double ambient = scene.ambient + scene.flicker * 0.5 * (1.0 + sin(2.0 * PI * scene.flickerHz * t));
+    double dt = timeUs - lastUs;
+    lastUs = timeUs;
+    for (int b = 0; b < ldrCount; b++) {
+        double light = ambient * AMBIENT_SHARE[b];
+        if (Lit(b)) light += LASER * laser * (b == handBeam ? HAND : 1.0);
+        double tau = light > response[b] ? scene.attackUs : scene.decayUs;
+        response[b] += (light - response[b]) * (1.0 - exp(-dt / tau));
+    }
+}
+
+static int Reading(uint8_t channel, uint32_t timeUs) {
+    Advance(timeUs);
+    int value = (int)(DARK - response[channel - 8]) + rand() % 9 - 4;
+    return value < 0 ? 0 : value > 1023 ? 1023 : value;
+}
+
+// Beam output to the Daisy (the LED pin)
+static bool Broken(int beam) {
+    const int leds[ldrCount] = { led1, led2, led3, led4, led5 };
+    return host::Pins()[leds[beam]] == HIGH;
+}
+
+struct Result {
+    int missed;             // Never broken while the hand was in
+    int dropped;            // Restored while the hand was still in
+    int stuck;              // Not restored after the hand left
+    int falseBreaks;        // Another beam broke
+};
+
+// Runs the sketch for one poll, counts new breaks of beams other than the given one
+static void Poll(int beam, bool* wasBroken, Result* result) {
+    host::Run(POLL_US);
+    for (int b = 0; b < ldrCount; b++) {
+        bool now = Broken(b);
+        if (b != beam && now && !wasBroken[b]) result->falseBreaks++;
+        wasBroken[b] = now;
+    }
+}
+
+static bool Replay(const Scene& s) {
+    scene = s;
+    Result result = { 0, 0, 0, 0 };
+    bool wasBroken[ldrCount] = {};
+    sceneStartUs = micros();
+    sceneUs = TRIALS * (HOLD_US + RELEASE_US);
+
+    for (int trial = 0; trial < TRIALS; trial++) {
+        // Every hold starts on a restored beam: a break, and no restore until the hand leaves
+        int beam = rand() % ldrCount;
+        bool broken = false;
+        bool dropped = false;
+        handBeam = beam;
+        for (uint32_t t = 0; t < HOLD_US; t += POLL_US) {
+            Poll(beam, wasBroken, &result);
+            if (Broken(beam)) broken = true;
+            else if (broken) dropped = true;
+        }
+        if (!broken) result.missed++;
+        if (dropped) result.dropped++;
+
+        handBeam = -1;
+        for (uint32_t t = 0; t < RELEASE_US; t += POLL_US) {
+            Poll(beam, wasBroken, &result);
+        }
+        if (Broken(beam)) result.stuck++;
+    }
+
+    bool ok = result.missed == 0 && result.dropped == 0 && result.stuck == 0 && result.falseBreaks == 0;
+    printf("sense, %-20s %d trials: missed %d, dropped %d, stuck %d, false %d%s\n",
+           s.name, TRIALS, result.missed, result.dropped, result.stuck, result.falseBreaks, ok ? "" : "  FAIL");
+    return ok;
+}
+
+int main() {
+    srand(5);
+    const Scene warmup = { "warmup", 0.0, 0.0, 0.0, 1.0, 500.0, 2000.0 };
+    scene = warmup;
+    host::Adc() = Reading;
+    host::Start();
+    host::Run(WARMUP_US);
+
+    const Scene scenes[] = {
+        // Flicker up to 400 p-p is tolerated, more drives the brightest lit LDR
+        // into the bottom of the ADC range
+        // name                   ambient flicker Hz      laser  rise    fall
+        { "dark room",            0.0,    0.0,    0.0,    1.0,   500.0,  2000.0 },
+        { "bright ambient",       300.0,  0.0,    0.0,    1.0,   500.0,  2000.0 },
+        { "100 Hz flicker",       50.0,   400.0,  100.0,  1.0,   500.0,  2000.0 },
+        { "50 Hz ripple",         50.0,   400.0,  50.0,   1.0,   500.0,  2000.0 },
+        { "50 Hz ripple, slow",   50.0,   400.0,  50.0,   1.0,   1000.0, 3000.0 },
+        { "laser drift to 40%",   0.0,    0.0,    0.0,    0.4,   500.0,  2000.0 },
+    };
+    for (const Scene& s : scenes) {
+        CHECK(Replay(s));
+    }
+
+    if (failures > 0) {
+        printf("%d failures\n", failures);
+        return 1;
+    }
+    printf("ok\n");
+    return 0;
+}
@@ -0,0 +1,198 @@
+// Stepper, dwell and encoder test of the sketch on the simulated Mega (see
+// stubs/Arduino.h). Checks the Timer1 step pulses at cruise (100us period, 50us
+// high), the 4.0 ms laser dwell, the acceleration ramp intervals, and that
+// encoder turns reach stepsPerRev at round trip boundaries only.
+#include <stdio.h>
+#include <stdlib.h>
+#include "Arduino.h"
+#include "code_arduino.cpp"
+
+static int failures = 0;
+
+#define CHECK(cond) do { \
+    if (!(cond)) { \
+        if (++failures <= 10) printf("FAIL line %d: %s\n", __LINE__, #cond); \
+    } \
+} while (0)
+
+const uint32_t T = host::TICKS_PER_US;
+const uint32_t LOOP_US = host::LOOP_TICKS / host::TICKS_PER_US;
+
+// Step pulses grouped into moves: a pause of more than a few step periods ends a move
+struct Move {
+    size_t first;           // Index in host::Steps()
+    int steps;
+    bool forward;
+};
+
+static std::vector<Move> Moves(size_t from) {
+    std::vector<Move> moves;
+    const std::vector<host::StepEdge>& steps = host::Steps();
+    for (size_t i = from; i < steps.size(); i++) {
+        bool starts = moves.empty() || steps[i].rise - steps[i - 1].rise > 1000 * T ||
+                      steps[i].forward != steps[i - 1].forward;
+        if (starts) {
+            Move move = { i, 0, steps[i].forward };
+            moves.push_back(move);
+        }
+        moves.back().steps++;
+    }
+    return moves;
+}
+
+// Runs the sketch until it is in the given state, at most one second
+static bool RunUntil(ScanState state) {
+    for (int i = 0; i < 200000 && scanState != state; i++) host::Run(5);
+    return scanState == state;
+}
+
+// Quadrature detents on the encoder, clockwise A leads B (00 -> 10 -> 11 -> 01)
+static void TurnEncoder(int edges) {
+    static const bool a[4] = { 0, 1, 1, 0 };
+    static const bool b[4] = { 0, 0, 1, 1 };
+    static int phase = 0;
+    for (int i = 0; i < abs(edges); i++) {
+        phase = (phase + (edges > 0 ? 1 : 3)) % 4;
+        host::SetEncoder(a[phase], b[phase]);
+        host::Run(200);
+    }
+}
+
+static void CheckCruise() {
+    // One round trip at constant speed
+    host::Run(80000);
+    std::vector<Move> moves = Moves(0);
+    CHECK(moves.size() >= 8);
+
+    const std::vector<host::StepEdge>& steps = host::Steps();
+    uint64_t minPeriod = ~0ull, maxPeriod = 0, minWidth = ~0ull, maxWidth = 0;
+    for (size_t m = 0; m < moves.size() && m < 8; m++) {
+        CHECK(moves[m].steps == cordemezzi);
+        CHECK(moves[m].forward == (m < 4));
+        for (int i = 0; i < moves[m].steps; i++) {
+            const host::StepEdge& edge = steps[moves[m].first + i];
+            uint64_t width = edge.fall - edge.rise;
+            if (width < minWidth) minWidth = width;
+            if (width > maxWidth) maxWidth = width;
+            if (i == 0) continue;
+            uint64_t period = edge.rise - steps[moves[m].first + i - 1].rise;
+            if (period < minPeriod) minPeriod = period;
+            if (period > maxPeriod) maxPeriod = period;
+        }
+    }
+    // Exact on the 0.5us timer clock
+    CHECK(minPeriod == 100 * T && maxPeriod == 100 * T);
+    CHECK(minWidth == 50 * T && maxWidth == 50 * T);
+    printf("cruise: step period %.1f-%.1f us, pulse %.1f-%.1f us, %d steps per move\n",
+           (double)minPeriod / T, (double)maxPeriod / T, (double)minWidth / T, (double)maxWidth / T,
+           cordemezzi);
+
+    // A move lasts 2us of direction setup plus its step intervals
+    CHECK(lastMoveMicros >= 2 + 100u * cordemezzi && lastMoveMicros <= 2 + 100u * cordemezzi + LOOP_US);
+}
+
+static void CheckDwell() {
+    // Laser on from the end of the ambient set to the end of the dwell
+    const std::vector<uint64_t>& edges = host::LaserEdges();
+    CHECK(edges.size() >= 16);
+    uint64_t shortest = ~0ull, longest = 0;
+    for (size_t i = 0; i + 1 < edges.size(); i += 2) {
+        uint64_t on = edges[i + 1] - edges[i];
+        if (on < shortest) shortest = on;
+        if (on > longest) longest = on;
+    }
+    // tempo ms, plus the loop() passes that see its end and sample
+    const unsigned long dwell = (unsigned long)tempo * 1000;
+    CHECK(shortest >= dwell * T && longest <= (dwell + 2 * LOOP_US) * T);
+    CHECK(lastDwellMicros >= dwell && lastDwellMicros <= dwell + 2 * LOOP_US);
+    printf("dwell: laser on %.1f-%.1f us over %zu dwells\n",
+           (double)shortest / T, (double)longest / T, edges.size() / 2);
+}
+
+static void CheckRamp() {
+    // The table is rebuilt during a dwell, the mirror is still then
+    CHECK(RunUntil(SCAN_DWELL));
+    rampSteps = 5;
+    buildStepTable();
+    size_t from = host::Steps().size();
+    host::Run(20000);
+
+    std::vector<Move> moves = Moves(from);
+    CHECK(moves.size() >= 2);
+    const std::vector<host::StepEdge>& steps = host::Steps();
+    const double expected[5] = { 400.0, 165.5, 127.0, 107.0, 100.0 };
+    bool ok = !moves.empty() && moves[0].steps == cordemezzi;
+    printf("ramp intervals:");
+    for (int i = 0; ok && i < 5; i++) {
+        // Interval i follows step i, the same intervals in reverse end the move
+        // (the last one after the last step, it ends the move)
+        size_t up = moves[0].first + i;
+        size_t down = moves[0].first + moves[0].steps - 1 - i;
+        double rising = (double)(steps[up + 1].rise - steps[up].rise) / T;
+        double falling = i == 0 ? expected[0] : (double)(steps[down + 1].rise - steps[down].rise) / T;
+        printf(" %.1f", rising);
+        ok = rising == expected[i] && falling == expected[i] && rampTable[i] == expected[i] * T;
+    }
+    printf(" us\n");
+    CHECK(ok);
+    rampSteps = 0;
+    buildStepTable();
+}
+
+static void CheckEncoder() {
+    // Turns in the middle of a forward sweep wait for the mirror to come back to station 0
+    do {
+        CHECK(RunUntil(SCAN_MOVE));
+        CHECK(RunUntil(SCAN_DWELL));
+    } while (!(scanForward && scanPosition == 2));
+    int before = stepsPerRev;
+    size_t from = host::Steps().size();
+    TurnEncoder(20 * 4);
+    CHECK(stepsPerRev == before);
+
+    host::Run(250000);
+    CHECK(stepsPerRev == before + 20);
+    int afterCw = stepsPerRev;
+
+    TurnEncoder(-30);   // 7.5 detents back
+    host::Run(250000);
+    CHECK(stepsPerRev == afterCw - 7);
+
+    // Moves keep one length through each round trip and the mirror comes back to 0
+    std::vector<Move> moves = Moves(from);
+    size_t firstForward = 1;
+    while (firstForward < moves.size() && !(moves[firstForward].forward && !moves[firstForward - 1].forward)) {
+        firstForward++;
+    }
+    int changes = 0;
+    bool steady = true;
+    for (size_t m = 0; m < firstForward; m++) steady = steady && moves[m].steps == before / corde;
+    for (size_t m = firstForward; m + 8 <= moves.size(); m += 8) {
+        int position = 0;
+        for (size_t k = 0; k < 8; k++) {
+            steady = steady && moves[m + k].steps == moves[m].steps && moves[m + k].forward == (k < 4);
+            position += moves[m + k].forward ? moves[m + k].steps : -moves[m + k].steps;
+        }
+        steady = steady && position == 0;
+        if (moves[m].steps != moves[m - 1].steps) changes++;
+    }
+    CHECK(steady);
+    CHECK(changes == 2);
+    printf("encoder: 20 detents -> %+d, 7.5 back -> %+d, spacing %d -> %d steps, changes at round trip starts: %s\n",
+           afterCw - before, stepsPerRev - afterCw, before, stepsPerRev, steady ? "yes" : "no");
+}
+
+int main() {
+    host::Start();
+    CheckCruise();
+    CheckDwell();
+    CheckRamp();
+    CheckEncoder();
+
+    if (failures > 0) {
+        printf("%d failures\n", failures);
+        return 1;
+    }
+    printf("ok\n");
+    return 0;
+}
@@ -0,0 +1,312 @@
+#include "Arpeggiator.h"
+#include "MidiController.h"
+#include <cmath>
+
+// Clock ticks per step for each ArpRate
+static const uint8_t RATE_TICKS[ARP_RATE_COUNT] = {
+    24,     // 1/4
+    12,     // 1/8
+    8,      // 1/8 triplet
+    6,      // 1/16
+    4,      // 1/16 triplet
+    3       // 1/32
+};
+
+// MIDI clock tracking (alpha-beta filter): gains of the tick error on the
+// predicted tick time and on the tick period once locked. Low enough to absorb
+// the main loop jitter of received ticks, critically damped (beta = alpha^2 / (2 - alpha)).
+const float TICK_PHASE_GAIN = 0.05f;
+const float TICK_PERIOD_GAIN = 0.00128f;
+const uint16_t MAX_TICK_COUNT = 1000;
+
+// Constructor
+Arpeggiator::Arpeggiator()
+    : scheduler_(nullptr), config_(nullptr), sampleRate_(48000.0f), configVersion_(0),
+      mode_(ARP_OFF), ticksPerStep_(6), gate_(0.5f), octaves_(1), pattern_(0xFFFF),
+      steps_(MAX_STEPS), tempo_(120.0f), clockSource_(CLOCK_INTERNAL), heldCount_(0),
+      stepIndex_(0), sequenceIndex_(0), randomState_(0x12345678),
+      running_(false), nextStepTime_(0), stepRemainder_(0.0f),
+      midiRunning_(true), tickPhase_(0), tickValid_(false), lastTickTime_(0),
+      tickTime_(0), tickFraction_(0.0f), tickPeriod_(1000.0f), tickCount_(0), stepScheduled_(false) {
+}
+
+// Destructor
+Arpeggiator::~Arpeggiator() {
+}
+
+// Initialization
+void Arpeggiator::Init(NoteScheduler* scheduler, ConfigManager* config, float sampleRate) {
+    scheduler_ = scheduler;
+    config_ = config;
+    sampleRate_ = sampleRate;
+    heldCount_ = 0;
+    running_ = false;
+    
+    configVersion_ = config_->GetVersion();
+    UpdateSettings(*config_->GetSnapshot());
+    tickPeriod_ = sampleRate_ * 60.0f / (tempo_ * CLOCK_PPQN);
+}
+
+// Rates
+uint8_t Arpeggiator::GetRateTicks(uint8_t rate) {
+    return RATE_TICKS[rate < ARP_RATE_COUNT ? rate : ARP_RATE_SIXTEENTH];
+}
+
+// Held notes
+void Arpeggiator::NoteOn(uint8_t note, uint8_t velocity, uint8_t beam) {
+    for (int i = 0; i < heldCount_; i++) {
+        if (held_[i].note == note) return;
+    }
+    if (heldCount_ >= MAX_HELD_NOTES) return;
+    
+    held_[heldCount_].note = note;
+    held_[heldCount_].velocity = velocity;
+    held_[heldCount_].beam = beam;
+    heldCount_++;
+}
+
+void Arpeggiator::NoteOff(uint8_t note) {
+    for (int i = 0; i < heldCount_; i++) {
+        if (held_[i].note == note) {
+            // Keep the playing order of the remaining notes
+            for (int j = i; j < heldCount_ - 1; j++) {
+                held_[j] = held_[j + 1];
+            }
+            heldCount_--;
+            return;
+        }
+    }
+}
+
+void Arpeggiator::AllNotesOff() {
+    heldCount_ = 0;
+}
+
+bool Arpeggiator::IsEnabled() const {
+    return mode_ != ARP_OFF;
+}
+
+// Main loop processing
+void Arpeggiator::Update() {
+    if (config_->GetVersion() != configVersion_) {
+        configVersion_ = config_->GetVersion();
+        UpdateSettings(*config_->GetSnapshot());
+    }
+    
+    if (mode_ == ARP_OFF || heldCount_ == 0) {
+        running_ = false;
+        return;
+    }
+    if (clockSource_ != CLOCK_INTERNAL) return;
+    
+    uint32_t now = scheduler_->Now();
+    float period = GetStepPeriod();
+    
+    // The first held note starts the sequence on the next audio block
+    if (!running_) {
+        running_ = true;
+        nextStepTime_ = now;
+        stepRemainder_ = 0.0f;
+        ResetSequence();
+    }
+    
+    // After a stall of more than a step, continue from now instead of catching up
+    if ((int32_t)(now - nextStepTime_) > (int32_t)period) {
+        nextStepTime_ = now;
+    }
+    
+    while ((int32_t)(nextStepTime_ - now) < (int32_t)NoteScheduler::LOOKAHEAD) {
+        ScheduleStep(nextStepTime_, period);
+        
+        float advance = period + stepRemainder_;
+        uint32_t samples = (uint32_t)advance;
+        stepRemainder_ = advance - samples;
+        nextStepTime_ += samples;
+    }
+}
+
+// MIDI clock input. A step is scheduled one tick ahead at the predicted time of
+// the next tick, so the jitter of received ticks is not passed on to the notes.
+void Arpeggiator::OnMidiClock(uint8_t message, uint32_t sampleTime) {
+    switch (message) {
+        case MIDI_START:
+            midiRunning_ = true;
+            tickPhase_ = 0;
+            stepScheduled_ = false;
+            ResetSequence();
+            return;
+        case MIDI_CONTINUE:
+            midiRunning_ = true;
+            return;
+        case MIDI_STOP:
+            midiRunning_ = false;
+            return;
+        case MIDI_TIMING_CLOCK:
+            break;
+        default:
+            return;
+    }
+    
+    // Follow the clock: the predicted tick moves on by one period and is pulled
+    // towards the received tick, the period follows the tempo. A gap of more
+    // than a second restarts from the received tick.
+    if (tickValid_ && sampleTime - lastTickTime_ < sampleRate_) {
+        // Until the fixed gains are lower, the gains of a least-squares line
+        // through the ticks so far, so the tempo is locked within a few ticks
+        if (tickCount_ < MAX_TICK_COUNT) tickCount_++;
+        float n = tickCount_;
+        float phaseGain = fmaxf(TICK_PHASE_GAIN, 2.0f * (2.0f * n - 1.0f) / (n * (n + 1.0f)));
+        float periodGain = fmaxf(TICK_PERIOD_GAIN, 6.0f / (n * (n + 1.0f)));
+        
+        float error = (float)(int32_t)(sampleTime - tickTime_) - tickFraction_ - tickPeriod_;
+        float advance = tickFraction_ + tickPeriod_ + phaseGain * error;
+        tickPeriod_ += periodGain * error;
+        int32_t whole = (int32_t)floorf(advance);
+        tickTime_ += whole;
+        tickFraction_ = advance - whole;
+    } else {
+        tickTime_ = sampleTime;
+        tickFraction_ = 0.0f;
+        tickCount_ = 1;
+    }
+    tickValid_ = true;
+    lastTickTime_ = sampleTime;
+    
+    if (!midiRunning_) return;
+    
+    bool play = (mode_ != ARP_OFF && clockSource_ == CLOCK_MIDI);
+    float period = tickPeriod_ * ticksPerStep_;
+    
+    // Boundary tick without a prediction (first tick after a start)
+    if (tickPhase_ == 0 && !stepScheduled_ && play) {
+        ScheduleStep(tickTime_, period);
+    }
+    stepScheduled_ = false;
+    
+    // Last tick before a boundary: schedule the step at the predicted next tick
+    if (tickPhase_ == ticksPerStep_ - 1 && play) {
+        ScheduleStep(tickTime_ + (uint32_t)(tickFraction_ + tickPeriod_ + 0.5f), period);
+        stepScheduled_ = true;
+    }
+    
+    tickPhase_++;
+    if (tickPhase_ >= ticksPerStep_) {
+        tickPhase_ = 0;
+    }
+}
+
+// Private methods
+void Arpeggiator::UpdateSettings(const LaserHarpConfig& config) {
+    uint8_t mode = config.arpMode < ARP_MODE_COUNT ? config.arpMode : ARP_OFF;
+    if (mode == ARP_OFF && mode_ != ARP_OFF) {
+        heldCount_ = 0;
+    }
+    mode_ = mode;
+    ticksPerStep_ = GetRateTicks(config.arpRate);
+    gate_ = config.arpGate;
+    octaves_ = config.arpOctaves > 0 ? config.arpOctaves : 1;
+    pattern_ = config.arpPattern;
+    steps_ = (config.arpSteps > 0 && config.arpSteps <= MAX_STEPS) ? config.arpSteps : MAX_STEPS;
+    tempo_ = config.tempo > 0.0f ? config.tempo : 120.0f;
+    clockSource_ = config.clockSource;
+    
+    if (tickPhase_ >= ticksPerStep_) {
+        tickPhase_ = 0;
+    }
+    if (stepIndex_ >= steps_) {
+        stepIndex_ = 0;
+    }
+}
+
+float Arpeggiator::GetStepPeriod() const {
+    return sampleRate_ * 60.0f / tempo_ * ticksPerStep_ / CLOCK_PPQN;
+}
+
+void Arpeggiator::ResetSequence() {
+    stepIndex_ = 0;
+    sequenceIndex_ = 0;
+}
+
+void Arpeggiator::ScheduleStep(uint32_t time, float period) {
+    bool active = (pattern_ >> stepIndex_) & 1;
+    stepIndex_++;
+    if (stepIndex_ >= steps_) {
+        stepIndex_ = 0;
+    }
+    if (!active || heldCount_ == 0) return;
+    
+    uint32_t gateLength = (uint32_t)(period * gate_);
+    if (gateLength < 1) gateLength = 1;
+    
+    if (mode_ == ARP_CHORD) {
+        for (int i = 0; i < heldCount_; i++) {
+            scheduler_->ScheduleNoteOn(time, held_[i].note, held_[i].velocity, held_[i].beam);
+            scheduler_->ScheduleNoteOff(time + gateLength, held_[i].note);
+        }
+        return;
+    }
+    
+    HeldNote next;
+    if (NextNote(&next)) {
+        scheduler_->ScheduleNoteOn(time, next.note, next.velocity, next.beam);
+        scheduler_->ScheduleNoteOff(time + gateLength, next.note);
+    }
+}
+
+// Picks the next note of the sequence: held notes repeated over the octave range
+bool Arpeggiator::NextNote(HeldNote* out) {
+    // Held notes sorted by pitch, the list is short
+    uint8_t order[MAX_HELD_NOTES];
+    for (int i = 0; i < heldCount_; i++) {
+        order[i] = i;
+    }
+    if (mode_ != ARP_AS_PLAYED) {
+        for (int i = 1; i < heldCount_; i++) {
+            uint8_t index = order[i];
+            int j = i - 1;
+            while (j >= 0 && held_[order[j]].note > held_[index].note) {
+                order[j + 1] = order[j];
+                j--;
+            }
+            order[j + 1] = index;
+        }
+    }
+    
+    uint16_t length = heldCount_ * octaves_;
+    uint16_t position;
+    switch (mode_) {
+        case ARP_DOWN:
+            position = length - 1 - (sequenceIndex_ % length);
+            break;
+        case ARP_UP_DOWN:
+            if (length > 1) {
+                uint16_t cycle = 2 * length - 2;
+                position = sequenceIndex_ % cycle;
+                if (position >= length) position = cycle - position;
+            } else {
+                position = 0;
+            }
+            break;
+        case ARP_RANDOM:
+            position = NextRandom(length);
+            break;
+        default:
+            position = sequenceIndex_ % length;
+            break;
+    }
+    sequenceIndex_++;
+    
+    *out = held_[order[position % heldCount_]];
+    int note = out->note + 12 * (position / heldCount_);
+    if (note > 127) return false;
+    out->note = note;
+    return true;
+}
+
+uint8_t Arpeggiator::NextRandom(uint8_t range) {
+    // xorshift32
+    randomState_ ^= randomState_ << 13;
+    randomState_ ^= randomState_ >> 17;
+    randomState_ ^= randomState_ << 5;
+    return randomState_ % range;
+}
\ No newline at end of file
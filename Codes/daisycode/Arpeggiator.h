@@ -0,0 +1,120 @@
+#pragma once
+#include <stdint.h>
+#include "ConfigManager.h"
+#include "NoteScheduler.h"
+
+// Order in which the held notes are played
+enum ArpMode {
+    ARP_OFF = 0,                // Beams play their notes directly
+    ARP_UP,
+    ARP_DOWN,
+    ARP_UP_DOWN,                // End notes are not repeated
+    ARP_AS_PLAYED,
+    ARP_RANDOM,
+    ARP_CHORD,                  // All held notes on every step
+    ARP_MODE_COUNT
+};
+
+// Step length
+enum ArpRate {
+    ARP_RATE_QUARTER = 0,
+    ARP_RATE_EIGHTH,
+    ARP_RATE_EIGHTH_TRIPLET,
+    ARP_RATE_SIXTEENTH,
+    ARP_RATE_SIXTEENTH_TRIPLET,
+    ARP_RATE_THIRTY_SECOND,
+    ARP_RATE_COUNT
+};
+
+// Tempo source
+enum ClockSource {
+    CLOCK_INTERNAL = 0,         // Configured tempo
+    CLOCK_MIDI                  // 24 PPQN clock from USB or DIN MIDI
+};
+
+// Arpeggiator and step sequencer fed by beam holds. Steps are computed in the
+// main loop ahead of time and handed to the NoteScheduler with sample times,
+// so note starts and gate lengths do not depend on the main loop period. The
+// 16-step pattern gates which steps play (bit 0 = first step).
+class Arpeggiator {
+public:
+    Arpeggiator();
+    ~Arpeggiator();
+    
+    // Initialization
+    void Init(NoteScheduler* scheduler, ConfigManager* config, float sampleRate);
+    
+    // Held notes (main loop)
+    void NoteOn(uint8_t note, uint8_t velocity, uint8_t beam);
+    void NoteOff(uint8_t note);
+    void AllNotesOff();
+    bool IsEnabled() const;
+    
+    // Main loop processing: follows the configuration and schedules internal clock steps
+    void Update();
+    
+    // MIDI clock input (MidiRealTime message), sampleTime = NoteScheduler::Now()
+    void OnMidiClock(uint8_t message, uint32_t sampleTime);
+    
+    // Clock ticks per step of an ArpRate, also the looper quantize grid
+    static uint8_t GetRateTicks(uint8_t rate);
+    
+    static const uint8_t MAX_HELD_NOTES = 16;
+    static const uint8_t MAX_STEPS = 16;
+    static const uint8_t CLOCK_PPQN = 24;
+    
+private:
+    struct HeldNote {
+        uint8_t note;
+        uint8_t velocity;
+        uint8_t beam;
+    };
+    
+    NoteScheduler* scheduler_;
+    ConfigManager* config_;
+    float sampleRate_;
+    uint32_t configVersion_;
+    
+    // Settings (from the published configuration)
+    uint8_t mode_;
+    uint8_t ticksPerStep_;      // Clock ticks at 24 PPQN
+    float gate_;                // Fraction of the step
+    uint8_t octaves_;
+    uint16_t pattern_;
+    uint8_t steps_;
+    float tempo_;               // BPM
+    uint8_t clockSource_;
+    
+    // Held notes in playing order
+    HeldNote held_[MAX_HELD_NOTES];
+    uint8_t heldCount_;
+    
+    // Sequence position
+    uint8_t stepIndex_;         // Pattern step
+    uint16_t sequenceIndex_;    // Position in the note sequence
+    uint32_t randomState_;
+    
+    // Internal clock
+    bool running_;
+    uint32_t nextStepTime_;     // Sample time of the next unscheduled step
+    float stepRemainder_;       // Fractional samples carried between steps
+    
+    // MIDI clock
+    bool midiRunning_;
+    uint8_t tickPhase_;         // Ticks since the last step boundary
+    bool tickValid_;
+    uint32_t lastTickTime_;     // Last received tick
+    uint32_t tickTime_;         // Predicted time of the last tick, whole samples
+    float tickFraction_;        // and the fraction
+    float tickPeriod_;          // Smoothed samples per tick
+    uint16_t tickCount_;        // Ticks since the tracking (re)started
+    bool stepScheduled_;        // Next boundary step already scheduled from the tick before
+    
+    // Private methods
+    void UpdateSettings(const LaserHarpConfig& config);
+    float GetStepPeriod() const;
+    void ResetSequence();
+    void ScheduleStep(uint32_t time, float period);
+    bool NextNote(HeldNote* out);
+    uint8_t NextRandom(uint8_t range);
+};
\ No newline at end of file
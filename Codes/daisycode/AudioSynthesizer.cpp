@@ -1,26 +1,60 @@
 #include "AudioSynthesizer.h"
+#include <cstring>
+
+// Constants
+const float FILTER_MOD_DEPTH_OCTAVES = 4.0f;    // Modulation wheel sweeps the cutoff up to 4 octaves
+const float VOICE_GAIN = 0.25f;                 // Per-voice headroom before the master stage
+const float STEAL_FADE_TIME = 0.002f;           // 2ms crossfade when a voice is stolen
+const float SILENCE_THRESHOLD = 1.0e-5f;        // -100 dBFS
+const float REVERB_DAMPING_FREQ = 0.1f;         // Normalized cutoff of the reverb placeholder
+const float PAN_QUARTER_PI = 0.78539816f;       // Constant-power pan law maps [-1, 1] to [0, pi/2]
+const float MONO_DOWNMIX_GAIN = 0.70710678f;    // Centre voice keeps unity gain in the mono sum
 
 // Constructor
 AudioSynthesizer::AudioSynthesizer() 
-    : config_(nullptr), sampleRate_(48000.0f), activeVoiceCount_(0), 
-      voiceAllocationIndex_(0), masterVolume_(0.8f), currentWaveform_(WAVE_SINE),
-      pitchBendAmount_(0.0f), modulationAmount_(0.0f), reverbEnabled_(true), 
+    : config_(nullptr), presets_(nullptr), configVersion_(0), pendingPatch_(nullptr),
+      activePatch_(nullptr), sampleRate_(48000.0f), activeVoiceCount_(0), 
+      freeVoiceCount_(0), sampleClock_(0), noteEventHead_(0), noteEventTail_(0),
+      scheduledCount_(0), renderClock_(0),
+      masterVolume_(0.8f), stereoWidth_(1.0f),
+      pitchBendAmount_(0.0f), modulationAmount_(0.0f), reverbEnabled_(false), 
       reverbLevel_(0.3f), delayEnabled_(false), delayTime_(0.25f), 
-      delayFeedback_(0.4f), filterCutoff_(1000.0f), filterResonance_(0.5f),
+      delayFeedback_(0.4f), filterModDepth_(FILTER_MOD_DEPTH_OCTAVES),
+      effectsIdle_(true), effectSilentSamples_(0),
       lastProcessingTime_(0), currentOutputLevel_(0.0f) {
     
-    // Initialize voice array
+    // Initialize voice array, all voices start on the free list
     for (int i = 0; i < MAX_VOICES; i++) {
+        voices_[i].index = i;
+        voices_[i].activeSlot = 0;
         voices_[i].active = false;
+        voices_[i].gate = false;
         voices_[i].note = 0;
         voices_[i].velocity = 0;
         voices_[i].frequency = 440.0f;
         voices_[i].amplitude = 0.0f;
+        voices_[i].level = 0.0f;
+        voices_[i].panLeft = MONO_DOWNMIX_GAIN;
+        voices_[i].panRight = MONO_DOWNMIX_GAIN;
         voices_[i].state = VOICE_IDLE;
         voices_[i].noteOnTime = 0;
         voices_[i].noteOffTime = 0;
         voices_[i].pitchBend = 0.0f;
         voices_[i].modulation = 0.0f;
+        voices_[i].stealing = false;
+        voices_[i].fadeGain = 1.0f;
+        voices_[i].fadeStep = 0.0f;
+        voices_[i].pendingNote = 0;
+        voices_[i].pendingVelocity = 0;
+        voices_[i].pendingGate = false;
+        voices_[i].pendingPan = 0.0f;
+        
+        // Push in reverse so voice 0 is handed out first
+        freeVoices_[freeVoiceCount_++] = MAX_VOICES - 1 - i;
+    }
+    
+    for (int i = 0; i < 128; i++) {
+        noteToVoice_[i] = -1;
     }
 }
 
@@ -34,51 +68,113 @@ void AudioSynthesizer::Init(float sampleRate, ConfigManager* config) {
     sampleRate_ = sampleRate;
     config_ = config;
     
-    // TODO: Initialize DSP components
-    // Initialize reverb, delay, filters, LFOs, etc.
+    // Initialize per-voice DSP
+    for (int i = 0; i < MAX_VOICES; i++) {
+        Voice* voice = &voices_[i];
+        voice->oscillator.Init(sampleRate_);
+        voice->oscillator.SetAmp(1.0f);
+        voice->envelope.Init(sampleRate_);
+        voice->filter.Init(sampleRate_);
+    }
+    
+    // Initialize effects
+    reverb_.Init();
+    reverb_.SetFilterMode(daisysp::OnePole::FILTER_MODE_LOW_PASS);
+    reverb_.SetFrequency(REVERB_DAMPING_FREQ);
+    delay_.Init();
+    delay_.SetDelay(delayTime_ * sampleRate_);
+    effectsIdle_ = true;
+    effectSilentSamples_ = 0;
+    
+    // Master bus saturation/limiting
+    masterBus_.Init(sampleRate_);
+    
+    // Callback profiler (audio block size is 48 samples, see InitializeSystem)
+    cpuMeter_.Init(sampleRate_, 48);
+    
+    // Pull waveform and envelope settings from the configuration, audio is not
+    // running yet so the patch is applied right away
+    if (config_ != nullptr) {
+        UpdateFromConfig();
+        SwapPendingPatch();
+    }
+}
+
+void AudioSynthesizer::SetPresetBank(PresetBank* presets) {
+    presets_ = presets;
+}
+
+void AudioSynthesizer::Update() {
+    if (config_ != nullptr && config_->GetVersion() != configVersion_) {
+        UpdateFromConfig();
+    }
 }
 
 // Main audio processing
 void AudioSynthesizer::Process(float* output, size_t size) {
-    // TODO: Implement main audio processing
-    // ProcessVoices(output, size);
-    // ProcessEffects(output, size);
-    // ApplyMasterVolume(output, size);
+    cpuMeter_.OnBlockStart();
+    uint32_t startTime = daisy::System::GetUs();
+    SwapPendingPatch();
+    
+    // Render in stereo and fold down to mono
+    for (size_t offset = 0; offset < size; offset += MAX_BLOCK_SIZE) {
+        size_t count = (size - offset) < MAX_BLOCK_SIZE ? (size - offset) : MAX_BLOCK_SIZE;
+        float* out = output + offset;
+        
+        RenderStereo(out, monoScratch_, count);
+        for (size_t i = 0; i < count; i++) {
+            out[i] = (out[i] + monoScratch_[i]) * MONO_DOWNMIX_GAIN;
+        }
+    }
     
-    // For now, just clear the buffer
-    ClearBuffer(output, size);
+    lastProcessingTime_ = daisy::System::GetUs() - startTime;
+    cpuMeter_.OnBlockEnd();
 }
 
 void AudioSynthesizer::ProcessStereo(float* outputLeft, float* outputRight, size_t size) {
-    // TODO: Implement stereo processing
-    ClearBuffer(outputLeft, size);
-    ClearBuffer(outputRight, size);
+    cpuMeter_.OnBlockStart();
+    uint32_t startTime = daisy::System::GetUs();
+    SwapPendingPatch();
+    
+    RenderStereo(outputLeft, outputRight, size);
+    
+    lastProcessingTime_ = daisy::System::GetUs() - startTime;
+    cpuMeter_.OnBlockEnd();
 }
 
-// Note control
+// Note control (main loop side, voices are allocated in the audio callback)
 void AudioSynthesizer::NoteOn(uint8_t note, uint8_t velocity) {
-    // TODO: Implement note on
-    Voice* voice = GetFreeVoice();
-    if (voice != nullptr) {
-        InitializeVoice(voice, note, velocity);
-    }
+    if (note > 127) return;
+    PushNoteEvent(NOTE_EVENT_ON, note, velocity, 0.0f);
+}
+
+void AudioSynthesizer::NoteOn(uint8_t note, uint8_t velocity, uint8_t beamIndex) {
+    if (note > 127) return;
+    PushNoteEvent(NOTE_EVENT_ON, note, velocity, GetBeamPan(beamIndex));
 }
 
 void AudioSynthesizer::NoteOff(uint8_t note) {
-    // TODO: Implement note off
-    Voice* voice = FindVoice(note);
-    if (voice != nullptr) {
-        ReleaseVoice(voice);
-    }
+    if (note > 127) return;
+    PushNoteEvent(NOTE_EVENT_OFF, note, 0, 0.0f);
 }
 
 void AudioSynthesizer::AllNotesOff() {
-    // TODO: Implement all notes off
-    for (int i = 0; i < MAX_VOICES; i++) {
-        if (voices_[i].active) {
-            ReleaseVoice(&voices_[i]);
-        }
-    }
+    PushNoteEvent(NOTE_EVENT_ALL_OFF, 0, 0, 0.0f);
+}
+
+// Sample-accurate note control
+uint32_t AudioSynthesizer::GetSampleTime() const {
+    return renderClock_.load(std::memory_order_acquire);
+}
+
+bool AudioSynthesizer::NoteOnAt(uint32_t time, uint8_t note, uint8_t velocity, uint8_t beamIndex) {
+    if (note > 127) return false;
+    return PushNoteEvent(NOTE_EVENT_ON, note, velocity, GetBeamPan(beamIndex), true, time);
+}
+
+bool AudioSynthesizer::NoteOffAt(uint32_t time, uint8_t note) {
+    if (note > 127) return false;
+    return PushNoteEvent(NOTE_EVENT_OFF, note, 0, 0.0f, true, time);
 }
 
 // Voice management
@@ -101,58 +197,8 @@ Voice* AudioSynthesizer::GetVoice(uint8_t voiceIndex) {
 }
 
 // Real-time parameter control
-void AudioSynthesizer::SetMasterVolume(float volume) {
-    masterVolume_ = volume;
-}
-
-void AudioSynthesizer::SetWaveform(WaveformType waveform) {
-    currentWaveform_ = waveform;
-}
-
-void AudioSynthesizer::SetReverbLevel(float level) {
-    reverbLevel_ = level;
-}
-
-void AudioSynthesizer::SetFilterCutoff(float cutoff) {
-    filterCutoff_ = cutoff;
-}
-
-void AudioSynthesizer::SetFilterResonance(float resonance) {
-    filterResonance_ = resonance;
-}
-
-// ADSR envelope control
-void AudioSynthesizer::SetAttackTime(float timeSeconds) {
-    // TODO: Implement attack time setting for all voices
-}
-
-void AudioSynthesizer::SetDecayTime(float timeSeconds) {
-    // TODO: Implement decay time setting for all voices
-}
-
-void AudioSynthesizer::SetSustainLevel(float level) {
-    // TODO: Implement sustain level setting for all voices
-}
-
-void AudioSynthesizer::SetReleaseTime(float timeSeconds) {
-    // TODO: Implement release time setting for all voices
-}
-
-// Effects control
-void AudioSynthesizer::SetReverbEnabled(bool enabled) {
-    reverbEnabled_ = enabled;
-}
-
-void AudioSynthesizer::SetDelayEnabled(bool enabled) {
-    delayEnabled_ = enabled;
-}
-
-void AudioSynthesizer::SetDelayTime(float timeSeconds) {
-    delayTime_ = timeSeconds;
-}
-
-void AudioSynthesizer::SetDelayFeedback(float feedback) {
-    delayFeedback_ = feedback;
+void AudioSynthesizer::SetStereoWidth(float width) {
+    stereoWidth_ = ClampValue(width, 0.0f, 1.0f);
 }
 
 // Modulation
@@ -164,25 +210,36 @@ void AudioSynthesizer::SetModulation(float amount) {
     modulationAmount_ = amount;
 }
 
-void AudioSynthesizer::SetVibratoRate(float hz) {
-    // TODO: Implement vibrato rate setting
-}
-
-void AudioSynthesizer::SetVibratoDepth(float semitones) {
-    // TODO: Implement vibrato depth setting
-}
-
 // Presets and configuration
+// A recalled preset is written into the configuration and published; the patch
+// is then prepared by Update() like any other configuration change.
 void AudioSynthesizer::LoadPreset(uint8_t presetNumber) {
-    // TODO: Implement preset loading
+    if (presets_ != nullptr && presets_->Recall(presetNumber, config_)) {
+        UpdateFromConfig();
+    }
 }
 
 void AudioSynthesizer::SavePreset(uint8_t presetNumber) {
-    // TODO: Implement preset saving
+    if (presets_ != nullptr && config_ != nullptr) {
+        presets_->Store(presetNumber, *config_->GetSnapshot());
+    }
 }
 
+// Builds the patch for the published configuration into the inactive buffer
+// and posts it. The audio callback picks it up at the start of the next block.
 void AudioSynthesizer::UpdateFromConfig() {
-    // TODO: Implement configuration update
+    if (config_ == nullptr) return;
+    
+    // Withdraw an unconsumed patch first, after that the callback cannot switch
+    // buffers and the inactive one is safe to overwrite
+    pendingPatch_.exchange(nullptr, std::memory_order_acq_rel);
+    SynthPatch* back = (activePatch_.load(std::memory_order_acquire) == &patches_[0])
+                       ? &patches_[1] : &patches_[0];
+    
+    LaserHarpConfig snapshot;
+    configVersion_ = config_->CopySnapshot(&snapshot);
+    PreparePatch(snapshot, back);
+    pendingPatch_.store(back, std::memory_order_release);
 }
 
 // Analysis and monitoring
@@ -191,112 +248,464 @@ float AudioSynthesizer::GetOutputLevel() {
 }
 
 float AudioSynthesizer::GetCPUUsage() {
-    // TODO: Implement CPU usage calculation
-    return 0.0f;
+    return cpuMeter_.GetAvgCpuLoad();
+}
+
+float AudioSynthesizer::GetPeakCPUUsage() {
+    return cpuMeter_.GetMaxCpuLoad();
+}
+
+float AudioSynthesizer::GetLimiterGain() {
+    return masterBus_.GetGainReduction();
 }
 
 uint32_t AudioSynthesizer::GetProcessingTime() {
     return lastProcessingTime_;
 }
 
-// Private methods - stubs for now
+// Private methods
+
+// Pop a voice from the free list, O(1)
 Voice* AudioSynthesizer::GetFreeVoice() {
-    // TODO: Implement free voice finding
-    for (int i = 0; i < MAX_VOICES; i++) {
-        if (!voices_[i].active) {
-            return &voices_[i];
-        }
+    if (freeVoiceCount_ == 0) {
+        return nullptr; // No free voices
     }
-    return nullptr; // No free voices
+    
+    Voice* voice = &voices_[freeVoices_[--freeVoiceCount_]];
+    voice->active = true;
+    voice->activeSlot = activeVoiceCount_;
+    activeVoices_[activeVoiceCount_++] = voice->index;
+    return voice;
 }
 
+// Note -> voice table lookup, O(1)
 Voice* AudioSynthesizer::FindVoice(uint8_t note) {
-    // TODO: Implement voice finding by note
+    int8_t index = noteToVoice_[note & 0x7F];
+    return index >= 0 ? &voices_[index] : nullptr;
+}
+
+// Pick a victim when all voices are busy: the quietest released voice,
+// otherwise the oldest held voice. Ties go to the older voice.
+Voice* AudioSynthesizer::FindVoiceToSteal() {
+    Voice* quietestReleased = nullptr;
+    Voice* oldest = nullptr;
+    Voice* oldestStealing = nullptr;
+    
     for (int i = 0; i < MAX_VOICES; i++) {
-        if (voices_[i].active && voices_[i].note == note) {
-            return &voices_[i];
+        Voice* voice = &voices_[i];
+        if (!voice->active) continue;
+        
+        uint32_t age = sampleClock_ - voice->noteOnTime;
+        
+        // A voice already being stolen still carries its victim's age, taking it
+        // again would replace a note that has not sounded yet
+        if (voice->stealing) {
+            if (oldestStealing == nullptr || age > sampleClock_ - oldestStealing->noteOnTime) {
+                oldestStealing = voice;
+            }
+            continue;
+        }
+        
+        if (voice->state == VOICE_RELEASE) {
+            if (quietestReleased == nullptr || voice->level < quietestReleased->level ||
+                (voice->level == quietestReleased->level &&
+                 age > sampleClock_ - quietestReleased->noteOnTime)) {
+                quietestReleased = voice;
+            }
+        }
+        
+        if (oldest == nullptr || age > sampleClock_ - oldest->noteOnTime) {
+            oldest = voice;
         }
     }
-    return nullptr;
+    
+    if (quietestReleased != nullptr) return quietestReleased;
+    return oldest != nullptr ? oldest : oldestStealing;
 }
 
-void AudioSynthesizer::InitializeVoice(Voice* voice, uint8_t note, uint8_t velocity) {
-    // TODO: Implement voice initialization
+void AudioSynthesizer::InitializeVoice(Voice* voice, uint8_t note, uint8_t velocity, float pan) {
     if (voice != nullptr) {
-        voice->active = true;
         voice->note = note;
         voice->velocity = velocity;
         voice->frequency = GetNoteFrequency(note);
+        voice->amplitude = (velocity / 127.0f) * VOICE_GAIN;
         voice->state = VOICE_ATTACK;
-        activeVoiceCount_++;
+        voice->gate = true;
+        voice->noteOnTime = sampleClock_;
+        
+        // Constant-power pan law, evaluated once per note
+        float angle = (pan + 1.0f) * PAN_QUARTER_PI;
+        voice->panLeft = cosf(angle);
+        voice->panRight = sinf(angle);
+        
+        voice->oscillator.SetFreq(voice->frequency);
+        const SynthPatch* patch = activePatch_.load(std::memory_order_relaxed);
+        if (patch != nullptr) {
+            ApplyFilterPatch(voice, *patch);
+        }
+        voice->envelope.Retrigger(false);
+        noteToVoice_[note] = voice->index;
     }
 }
 
 void AudioSynthesizer::ReleaseVoice(Voice* voice) {
-    // TODO: Implement voice release
     if (voice != nullptr && voice->active) {
         voice->state = VOICE_RELEASE;
-        // Don't set active = false yet, let the envelope finish
+        voice->gate = false;
+        voice->noteOffTime = sampleClock_;
+        // Don't set active = false yet, OnEnvelopeComplete returns it to the pool
     }
 }
 
-void AudioSynthesizer::UpdateVoiceParameters(Voice* voice) {
-    // TODO: Implement voice parameter updates
+// Fade the victim out, the new note starts once the fade has finished
+void AudioSynthesizer::StealVoice(Voice* voice, uint8_t note, uint8_t velocity, float pan) {
+    uint8_t oldNote = voice->stealing ? voice->pendingNote : voice->note;
+    if (noteToVoice_[oldNote] == voice->index) {
+        noteToVoice_[oldNote] = -1;
+    }
+    
+    if (!voice->stealing) {
+        voice->stealing = true;
+        voice->fadeStep = 1.0f / (STEAL_FADE_TIME * sampleRate_);
+    }
+    voice->pendingNote = note;
+    voice->pendingVelocity = velocity;
+    voice->pendingGate = true;
+    voice->pendingPan = pan;
+    noteToVoice_[note] = voice->index;
+}
+
+void AudioSynthesizer::FinishSteal(Voice* voice) {
+    voice->stealing = false;
+    voice->fadeGain = 1.0f;
+    voice->fadeStep = 0.0f;
+    
+    // Start the pending note from silence
+    voice->envelope.Retrigger(true);
+    voice->filter.Reset();
+    InitializeVoice(voice, voice->pendingNote, voice->pendingVelocity, voice->pendingPan);
+    if (!voice->pendingGate) {
+        ReleaseVoice(voice);
+    }
 }
 
-void AudioSynthesizer::ProcessVoices(float* buffer, size_t size) {
-    // TODO: Implement voice processing
+// Envelope completion callback: the release has finished, return the voice to the pool
+void AudioSynthesizer::OnEnvelopeComplete(Voice* voice) {
+    if (noteToVoice_[voice->note] == voice->index) {
+        noteToVoice_[voice->note] = -1;
+    }
+    
+    voice->active = false;
+    voice->gate = false;
+    voice->state = VOICE_IDLE;
+    voice->level = 0.0f;
+    
+    // Swap-remove from the active list
+    uint8_t last = activeVoices_[--activeVoiceCount_];
+    activeVoices_[voice->activeSlot] = last;
+    voices_[last].activeSlot = voice->activeSlot;
+    
+    freeVoices_[freeVoiceCount_++] = voice->index;
 }
 
-void AudioSynthesizer::ProcessEffects(float* buffer, size_t size) {
-    // TODO: Implement effects processing
+// Note event queue
+bool AudioSynthesizer::PushNoteEvent(uint8_t type, uint8_t note, uint8_t velocity, float pan,
+                                     bool timed, uint32_t time) {
+    uint8_t tail = noteEventTail_.load(std::memory_order_relaxed);
+    uint8_t head = noteEventHead_.load(std::memory_order_acquire);
+    if ((uint8_t)(tail - head) >= NOTE_EVENT_QUEUE_SIZE) {
+        return false; // Queue full, drop event
+    }
+    
+    NoteEvent& event = noteEvents_[tail & (NOTE_EVENT_QUEUE_SIZE - 1)];
+    event.type = type;
+    event.note = note;
+    event.velocity = velocity;
+    event.timed = timed;
+    event.time = time;
+    event.pan = pan;
+    noteEventTail_.store(tail + 1, std::memory_order_release);
+    return true;
+}
+
+void AudioSynthesizer::ProcessNoteEvents() {
+    uint8_t head = noteEventHead_.load(std::memory_order_relaxed);
+    uint8_t tail = noteEventTail_.load(std::memory_order_acquire);
+    
+    while (head != tail) {
+        const NoteEvent& event = noteEvents_[head & (NOTE_EVENT_QUEUE_SIZE - 1)];
+        if (event.timed) {
+            ScheduleNoteEvent(event);
+        } else {
+            ApplyNoteEvent(event);
+        }
+        head++;
+    }
+    noteEventHead_.store(head, std::memory_order_release);
 }
 
-void AudioSynthesizer::ProcessGlobalFilter(float* buffer, size_t size) {
-    // TODO: Implement global filter processing
+void AudioSynthesizer::ApplyNoteEvent(const NoteEvent& event) {
+    switch (event.type) {
+        case NOTE_EVENT_ON:      HandleNoteOn(event.note, event.velocity, event.pan); break;
+        case NOTE_EVENT_OFF:     HandleNoteOff(event.note); break;
+        case NOTE_EVENT_ALL_OFF: HandleAllNotesOff(); break;
+    }
 }
 
-void AudioSynthesizer::ApplyMasterVolume(float* buffer, size_t size) {
-    // TODO: Implement master volume application
+// Insertion into the timed list, kept latest first so the next event is at the end.
+// At equal times a note off goes first, so a retriggered note is not cut short.
+void AudioSynthesizer::ScheduleNoteEvent(const NoteEvent& event) {
+    if (scheduledCount_ >= SCHEDULED_EVENT_SIZE) {
+        // Full: a note off is applied early rather than lost, a note on is dropped
+        if (event.type != NOTE_EVENT_ON) {
+            ApplyNoteEvent(event);
+        }
+        return;
+    }
+    
+    int i = scheduledCount_;
+    while (i > 0) {
+        const NoteEvent& later = scheduled_[i - 1];
+        int32_t diff = (int32_t)(later.time - event.time);
+        if (diff > 0 || (diff == 0 && later.type == NOTE_EVENT_ON && event.type != NOTE_EVENT_ON)) {
+            break;
+        }
+        scheduled_[i] = later;
+        i--;
+    }
+    scheduled_[i] = event;
+    scheduledCount_++;
 }
 
-float AudioSynthesizer::GetNoteFrequency(uint8_t midiNote) {
-    // Standard MIDI note to frequency conversion
-    return 440.0f * powf(2.0f, (midiNote - 69) / 12.0f);
+bool AudioSynthesizer::HasEventBefore(uint32_t time) const {
+    return scheduledCount_ > 0 && (int32_t)(scheduled_[scheduledCount_ - 1].time - time) < 0;
 }
 
-float AudioSynthesizer::MidiToFrequency(float midiNote) {
-    return 440.0f * powf(2.0f, (midiNote - 69.0f) / 12.0f);
+void AudioSynthesizer::HandleNoteOn(uint8_t note, uint8_t velocity, float pan) {
+    // Same note already sounding: retrigger its voice
+    Voice* voice = FindVoice(note);
+    if (voice != nullptr) {
+        if (voice->stealing) {
+            voice->pendingVelocity = velocity;
+            voice->pendingGate = true;
+            voice->pendingPan = pan;
+        } else {
+            InitializeVoice(voice, note, velocity, pan);
+        }
+        return;
+    }
+    
+    voice = GetFreeVoice();
+    if (voice != nullptr) {
+        voice->envelope.Retrigger(true);
+        voice->filter.Reset();
+        InitializeVoice(voice, note, velocity, pan);
+        return;
+    }
+    
+    voice = FindVoiceToSteal();
+    if (voice != nullptr) {
+        StealVoice(voice, note, velocity, pan);
+    }
 }
 
-float AudioSynthesizer::SemitonesToRatio(float semitones) {
-    return powf(2.0f, semitones / 12.0f);
+void AudioSynthesizer::HandleNoteOff(uint8_t note) {
+    Voice* voice = FindVoice(note);
+    if (voice == nullptr) return;
+    
+    if (voice->stealing) {
+        voice->pendingGate = false;
+    } else {
+        ReleaseVoice(voice);
+    }
 }
 
-void AudioSynthesizer::UpdateModulation() {
-    // TODO: Implement modulation updates
+void AudioSynthesizer::HandleAllNotesOff() {
+    for (int i = 0; i < MAX_VOICES; i++) {
+        if (voices_[i].active) {
+            voices_[i].pendingGate = false;
+            ReleaseVoice(&voices_[i]);
+        }
+    }
 }
 
-float AudioSynthesizer::GetVibratoValue() {
-    // TODO: Implement vibrato value calculation
-    return 0.0f;
+// State of a voice whose gate is still on, from its envelope segment
+VoiceState AudioSynthesizer::GetHeldState(VoiceEnvelope::Segment segment) {
+    switch (segment) {
+        case VoiceEnvelope::SEGMENT_ATTACK:     return VOICE_ATTACK;
+        case VoiceEnvelope::SEGMENT_SUSTAIN:    return VOICE_SUSTAIN;
+        default:                                return VOICE_DECAY;
+    }
 }
 
-float AudioSynthesizer::GetLFOValue() {
-    // TODO: Implement LFO value calculation
-    return 0.0f;
+void AudioSynthesizer::UpdateVoiceParameters(Voice* voice) {
+    // Control-rate update, coefficients are only recomputed if the cutoff actually moved
+    voice->filter.SetModulation(modulationAmount_ * filterModDepth_);
+}
+
+void AudioSynthesizer::ProcessVoices(float* left, float* right, size_t size) {
+    for (size_t offset = 0; offset < size; offset += MAX_BLOCK_SIZE) {
+        size_t count = (size - offset) < MAX_BLOCK_SIZE ? (size - offset) : MAX_BLOCK_SIZE;
+        
+        // Only sounding voices are on the active list, idle voices cost nothing
+        uint8_t n = 0;
+        while (n < activeVoiceCount_) {
+            Voice* voice = &voices_[activeVoices_[n]];
+            
+            UpdateVoiceParameters(voice);
+            
+            // Oscillator -> filter (block) -> envelope/amplitude -> panned stereo mix
+            for (size_t i = 0; i < count; i++) {
+                voiceBuffer_[i] = voice->oscillator.Process();
+            }
+            voice->filter.ProcessBlock(voiceBuffer_, count);
+            
+            float env = 0.0f;
+            float fade = voice->fadeGain;
+            float fadeStep = voice->fadeStep;
+            for (size_t i = 0; i < count; i++) {
+                env = voice->envelope.Process(voice->gate);
+                voiceBuffer_[i] *= env * voice->amplitude * fade;
+                fade = fmaxf(0.0f, fade - fadeStep);
+            }
+            voice->fadeGain = fade;
+            voice->level = env;
+            if (voice->gate) {
+                voice->state = GetHeldState(voice->envelope.GetSegment());
+            }
+            
+            MixBuffersStereo(left + offset, right + offset, voiceBuffer_, count,
+                             voice->panLeft, voice->panRight);
+            
+            // Stolen voice faded out, or envelope finished (or decayed below -100 dBFS) in release
+            if (voice->stealing) {
+                if (fade <= 0.0f) {
+                    FinishSteal(voice);
+                }
+            } else if (!voice->envelope.IsRunning() ||
+                       (voice->state == VOICE_RELEASE && env < SILENCE_THRESHOLD)) {
+                OnEnvelopeComplete(voice);
+                continue; // Slot n now holds the last active voice
+            }
+            n++;
+        }
+        
+        sampleClock_ += count;
+    }
 }
 
-void AudioSynthesizer::ClearBuffer(float* buffer, size_t size) {
+// Render one stereo block, with a fast path when nothing is sounding
+void AudioSynthesizer::RenderStereo(float* left, float* right, size_t size) {
+    // Apply note events queued by the main loop at the block boundary
+    ProcessNoteEvents();
+    uint32_t blockStart = renderClock_.load(std::memory_order_relaxed);
+    renderClock_.store(blockStart + size, std::memory_order_release);
+    bool eventsDue = HasEventBefore(blockStart + size);
+    
+    // Silent block: no voices and effect tails already below -100 dBFS
+    if (activeVoiceCount_ == 0 && effectsIdle_ && !eventsDue) {
+        ClearBuffer(left, size);
+        ClearBuffer(right, size);
+        currentOutputLevel_ = 0.0f;
+        return;
+    }
+    
+    bool inputSilent = (activeVoiceCount_ == 0 && !eventsDue);
+    
+    ClearBuffer(left, size);
+    ClearBuffer(right, size);
+    
+    // Voices are rendered in segments split at the timed events of this block
+    size_t position = 0;
+    while (position < size) {
+        size_t end = size;
+        while (scheduledCount_ > 0) {
+            const NoteEvent& next = scheduled_[scheduledCount_ - 1];
+            int32_t offset = (int32_t)(next.time - blockStart);
+            if (offset > (int32_t)position) {
+                end = (offset < (int32_t)size) ? (size_t)offset : size;
+                break;
+            }
+            ApplyNoteEvent(next);
+            scheduledCount_--;
+        }
+        ProcessVoices(left + position, right + position, end - position);
+        position = end;
+    }
+    
+    if (inputSilent) {
+        effectSilentSamples_ += size;
+    } else {
+        effectSilentSamples_ = 0;
+    }
+    ProcessEffects(left, right, size);
+    ApplyMasterVolume(left, right, size);
+}
+
+// Effects run on a mono send and the wet signal is returned to both channels
+void AudioSynthesizer::ProcessEffects(float* left, float* right, size_t size) {
+    if (!delayEnabled_ && !reverbEnabled_) {
+        effectsIdle_ = true;
+        return;
+    }
+    
+    float tailPeak = 0.0f;
     for (size_t i = 0; i < size; i++) {
-        buffer[i] = 0.0f;
+        float dry = (left[i] + right[i]) * MONO_DOWNMIX_GAIN;
+        float wet = 0.0f;
+        
+        if (delayEnabled_) {
+            float echo = delay_.Read();
+            delay_.Write(dry + echo * delayFeedback_);
+            wet += echo;
+        }
+        
+        if (reverbEnabled_) {
+            // Placeholder until ReverbSc is in place
+            wet += reverb_.Process(dry) * reverbLevel_;
+        }
+        
+        tailPeak = fmaxf(tailPeak, fabsf(wet));
+        left[i] += wet;
+        right[i] += wet;
+    }
+    
+    // The tails are over once the input has been silent for a full delay
+    // period and nothing audible came out of the effects in this block
+    if (tailPeak >= SILENCE_THRESHOLD) {
+        effectSilentSamples_ = 0;
     }
+    uint32_t delaySamples = (uint32_t)(delayTime_ * sampleRate_);
+    effectsIdle_ = (effectSilentSamples_ > delaySamples);
 }
 
-void AudioSynthesizer::MixBuffers(float* dest, const float* src, size_t size, float gain) {
+void AudioSynthesizer::ApplyMasterVolume(float* left, float* right, size_t size) {
     for (size_t i = 0; i < size; i++) {
-        dest[i] += src[i] * gain;
+        left[i] *= masterVolume_;
+        right[i] *= masterVolume_;
+    }
+    
+    // Keep the summed voices inside the codec's range
+    masterBus_.Process(left, right, size);
+}
+
+float AudioSynthesizer::GetNoteFrequency(uint8_t midiNote) {
+    // Standard MIDI note to frequency conversion
+    return 440.0f * powf(2.0f, (midiNote - 69) / 12.0f);
+}
+
+void AudioSynthesizer::ClearBuffer(float* buffer, size_t size) {
+    memset(buffer, 0, size * sizeof(float));
+}
+
+// Spread the beams evenly across the stereo field, first beam on the left
+float AudioSynthesizer::GetBeamPan(uint8_t beamIndex) {
+    uint8_t numBeams = config_ != nullptr ? config_->GetNumBeams() : 1;
+    if (numBeams < 2) {
+        return 0.0f;
     }
+    float position = (float)beamIndex / (float)(numBeams - 1);
+    return ClampValue((position * 2.0f - 1.0f) * stereoWidth_, -1.0f, 1.0f);
 }
 
 float AudioSynthesizer::ClampValue(float value, float min, float max) {
@@ -305,14 +714,87 @@ float AudioSynthesizer::ClampValue(float value, float min, float max) {
     return value;
 }
 
-void AudioSynthesizer::ApplyConfigToVoices() {
-    // TODO: Implement config application to voices
+// All conversions (waveform mapping, delay length, clamping) happen here in the
+// main loop so the audio callback only copies finished values
+void AudioSynthesizer::PreparePatch(const LaserHarpConfig& config, SynthPatch* patch) {
+    patch->waveform = (WaveformType)config.waveform;
+    switch (patch->waveform) {
+        case WAVE_SAW:      patch->oscWaveform = daisysp::Oscillator::WAVE_POLYBLEP_SAW; break;
+        case WAVE_SQUARE:   patch->oscWaveform = daisysp::Oscillator::WAVE_POLYBLEP_SQUARE; break;
+        case WAVE_TRIANGLE: patch->oscWaveform = daisysp::Oscillator::WAVE_POLYBLEP_TRI; break;
+        case WAVE_SINE:
+        default:            patch->oscWaveform = daisysp::Oscillator::WAVE_SIN; break;
+    }
+    
+    patch->masterVolume = ClampValue(config.masterVolume, 0.0f, 1.0f);
+    VoiceEnvelope::ComputeCoefficients(config.attackTime, config.decayTime, config.sustainLevel,
+                                       config.releaseTime, sampleRate_, &patch->envelope);
+    
+    // Filter coefficients for every note, a note-on only looks up its own
+    float keyTracking = ClampValue(config.filterKeyTracking, 0.0f, 1.0f);
+    patch->filterK = VoiceFilter::ComputeK(config.filterResonance);
+    for (int note = 0; note < 128; note++) {
+        float cutoff = config.filterCutoff * VoiceFilter::KeyTrackRatio((float)note, keyTracking);
+        patch->filterCutoffs[note] = VoiceFilter::ClampCutoff(cutoff, sampleRate_);
+        patch->filterG[note] = VoiceFilter::ComputeG(patch->filterCutoffs[note], sampleRate_);
+    }
+    
+    patch->reverbEnabled = config.reverbEnabled;
+    patch->reverbLevel = ClampValue(config.reverbLevel, 0.0f, 1.0f);
+    patch->delayEnabled = config.delayEnabled;
+    patch->delayTime = ClampValue(config.delayTime, 0.001f, 0.999f);
+    patch->delaySamples = patch->delayTime * sampleRate_;
+    patch->delayFeedback = ClampValue(config.delayFeedback, 0.0f, 0.95f);
+    patch->oversampling = config.oversampling >= 4 ? OVERSAMPLE_4X
+                        : config.oversampling >= 2 ? OVERSAMPLE_2X : OVERSAMPLE_1X;
+}
+
+// Audio callback side: one atomic exchange per block, O(1) when nothing changed
+void AudioSynthesizer::SwapPendingPatch() {
+    SynthPatch* patch = pendingPatch_.exchange(nullptr, std::memory_order_acq_rel);
+    if (patch != nullptr) {
+        activePatch_.store(patch, std::memory_order_release);
+        ApplyPatch(*patch);
+    }
 }
 
-void AudioSynthesizer::UpdateEnvelopeSettings() {
-    // TODO: Implement envelope settings update
+void AudioSynthesizer::ApplyPatch(const SynthPatch& patch) {
+    masterVolume_ = patch.masterVolume;
+    for (int i = 0; i < MAX_VOICES; i++) {
+        voices_[i].oscillator.SetWaveform(patch.oscWaveform);
+    }
+    
+    // Idle voices pick up their filter at note-on
+    for (uint8_t n = 0; n < activeVoiceCount_; n++) {
+        ApplyFilterPatch(&voices_[activeVoices_[n]], patch);
+    }
+    
+    UpdateEnvelopeSettings(patch);
+    UpdateEffectSettings(patch);
+    
+    // The clipper switches at the next block, start a fresh CPU measurement for it
+    if (patch.oversampling != masterBus_.GetOversampling()) {
+        masterBus_.SetOversampling(patch.oversampling);
+        cpuMeter_.Reset();
+    }
+}
+
+void AudioSynthesizer::ApplyFilterPatch(Voice* voice, const SynthPatch& patch) {
+    voice->filter.SetPrecomputed(patch.filterCutoffs[voice->note], patch.filterG[voice->note],
+                                 patch.filterK);
+}
+
+void AudioSynthesizer::UpdateEnvelopeSettings(const SynthPatch& patch) {
+    for (int i = 0; i < MAX_VOICES; i++) {
+        voices_[i].envelope.SetCoefficients(patch.envelope);
+    }
 }
 
-void AudioSynthesizer::UpdateEffectSettings() {
-    // TODO: Implement effect settings update
+void AudioSynthesizer::UpdateEffectSettings(const SynthPatch& patch) {
+    reverbEnabled_ = patch.reverbEnabled;
+    reverbLevel_ = patch.reverbLevel;
+    delayEnabled_ = patch.delayEnabled;
+    delayTime_ = patch.delayTime;
+    delay_.SetDelay(patch.delaySamples);
+    delayFeedback_ = patch.delayFeedback;
 }
\ No newline at end of file
@@ -1,6 +1,14 @@
 #pragma once
+#include <atomic>
+#include "daisy_seed.h"
 #include "daisysp.h"
 #include "ConfigManager.h"
+#include "PresetBank.h"
+#include "VoiceFilter.h"
+#include "VoiceEnvelope.h"
+#include "MasterBus.h"
+#include "StereoMix.h"
+#include "NoteSink.h"
 
 // Voice states
 enum VoiceState {
@@ -24,15 +32,21 @@ enum WaveformType {
 struct Voice {
     // DSP components
     daisysp::Oscillator oscillator;
-    daisysp::Adsr envelope;
-    daisysp::OnePole filter;
+    VoiceEnvelope envelope;
+    VoiceFilter filter;
     
     // Voice parameters
+    uint8_t index;          // Position in the voice array
+    uint8_t activeSlot;     // Position in the active voice list
     bool active;
+    bool gate;
     uint8_t note;
     uint8_t velocity;
     float frequency;
     float amplitude;
+    float level;            // Envelope level at the end of the last block
+    float panLeft;          // Constant-power pan gains
+    float panRight;
     VoiceState state;
     
     // Timing
@@ -42,15 +56,64 @@ struct Voice {
     // Modulation
     float pitchBend;
     float modulation;
+    
+    // Voice stealing crossfade
+    bool stealing;          // Fading out before the pending note starts
+    float fadeGain;
+    float fadeStep;
+    uint8_t pendingNote;
+    uint8_t pendingVelocity;
+    bool pendingGate;       // False if the pending note was released during the fade
+    float pendingPan;
+};
+
+// Note events passed from the main loop to the audio callback
+enum NoteEventType {
+    NOTE_EVENT_ON,
+    NOTE_EVENT_OFF,
+    NOTE_EVENT_ALL_OFF
+};
+
+struct NoteEvent {
+    uint8_t type;
+    uint8_t note;
+    uint8_t velocity;
+    bool timed;             // False: applied at the next block start
+    uint32_t time;          // Sample time of timed events, see GetSampleTime()
+    float pan;              // -1.0 (left) to 1.0 (right)
 };
 
-class AudioSynthesizer {
+// Render state derived from the configuration in the main loop and handed to
+// the audio callback as a whole, so a sound change lands on one block boundary.
+// Envelope and filter coefficients are finished values, the callback only copies them.
+struct SynthPatch {
+    WaveformType waveform;
+    uint8_t oscWaveform;        // daisysp::Oscillator waveform
+    float masterVolume;
+    EnvelopeCoefficients envelope;
+    float filterK;              // SVF damping for the resonance
+    float filterCutoffs[128];   // Key-tracked, clamped cutoff of each note (Hz)
+    float filterG[128];         // SVF gain of each note's cutoff
+    bool reverbEnabled;
+    float reverbLevel;
+    bool delayEnabled;
+    float delayTime;
+    float delaySamples;
+    float delayFeedback;
+    OversamplingFactor oversampling;
+};
+
+class AudioSynthesizer : public TimedNoteSink {
 public:
     AudioSynthesizer();
     ~AudioSynthesizer();
     
     // Initialization
     void Init(float sampleRate, ConfigManager* config);
+    void SetPresetBank(PresetBank* presets);
+    
+    // Main loop processing, prepares a new patch when the configuration changes
+    void Update();
     
     // Main audio processing (call from audio callback)
     void Process(float* output, size_t size);
@@ -58,40 +121,31 @@ public:
     
     // Note control
     void NoteOn(uint8_t note, uint8_t velocity);
+    void NoteOn(uint8_t note, uint8_t velocity, uint8_t beamIndex);  // Panned by beam position
     void NoteOff(uint8_t note);
     void AllNotesOff();
     
+    // Sample-accurate note control (main loop), events start at the given sample
+    // time inside the block that renders it. Times already passed apply at once.
+    uint32_t GetSampleTime() const override;     // First sample of the next block to render
+    bool NoteOnAt(uint32_t time, uint8_t note, uint8_t velocity, uint8_t beamIndex) override;
+    bool NoteOffAt(uint32_t time, uint8_t note) override;
+    
     // Voice management
     uint8_t GetActiveVoiceCount();
     bool IsVoiceActive(uint8_t voiceIndex);
     Voice* GetVoice(uint8_t voiceIndex);
     
-    // Real-time parameter control
-    void SetMasterVolume(float volume);
-    void SetWaveform(WaveformType waveform);
-    void SetReverbLevel(float level);
-    void SetFilterCutoff(float cutoff);
-    void SetFilterResonance(float resonance);
-    
-    // ADSR envelope control
-    void SetAttackTime(float timeSeconds);
-    void SetDecayTime(float timeSeconds);
-    void SetSustainLevel(float level);
-    void SetReleaseTime(float timeSeconds);
-    
-    // Effects control
-    void SetReverbEnabled(bool enabled);
-    void SetDelayEnabled(bool enabled);
-    void SetDelayTime(float timeSeconds);
-    void SetDelayFeedback(float feedback);
+    // Real-time parameter control. Sound parameters (waveform, envelope, filter,
+    // effects, volume, clipper oversampling) are not set here: write them to the
+    // configuration and Publish(), Update() turns them into the next patch.
+    void SetStereoWidth(float width);                   // 0.0 = mono, 1.0 = beams spread across the full stereo field
     
     // Modulation
     void SetPitchBend(float semitones);
     void SetModulation(float amount);
-    void SetVibratoRate(float hz);
-    void SetVibratoDepth(float semitones);
     
-    // Presets and configuration
+    // Presets and configuration (main loop)
     void LoadPreset(uint8_t presetNumber);
     void SavePreset(uint8_t presetNumber);
     void UpdateFromConfig();
@@ -99,32 +153,59 @@ public:
     // Analysis and monitoring
     float GetOutputLevel();
     float GetCPUUsage();
+    float GetPeakCPUUsage();
+    float GetLimiterGain();
     uint32_t GetProcessingTime();
     
 private:
     // Configuration
     ConfigManager* config_;
+    PresetBank* presets_;
+    uint32_t configVersion_;            // Published version the last patch was built from
+    
+    // Patch double buffer (main loop prepares, audio callback swaps at block start)
+    SynthPatch patches_[2];
+    std::atomic<SynthPatch*> pendingPatch_;
+    std::atomic<SynthPatch*> activePatch_;
     float sampleRate_;
     
     // Voice management
     static const uint8_t MAX_VOICES = 16;
     Voice voices_[MAX_VOICES];
     uint8_t activeVoiceCount_;
-    uint8_t voiceAllocationIndex_; // Round-robin voice allocation
+    uint8_t activeVoices_[MAX_VOICES]; // Dense list of sounding voices, only these are rendered
+    uint8_t freeVoices_[MAX_VOICES];   // Free list (stack of voice indices)
+    uint8_t freeVoiceCount_;
+    int8_t noteToVoice_[128];          // Note -> voice index, -1 if not sounding
+    uint32_t sampleClock_;             // Samples rendered, used for voice age
+    
+    // Note event queue (main loop -> audio callback, single producer/single consumer)
+    static const uint8_t NOTE_EVENT_QUEUE_SIZE = 32;   // Must be a power of two
+    NoteEvent noteEvents_[NOTE_EVENT_QUEUE_SIZE];
+    std::atomic<uint8_t> noteEventHead_;
+    std::atomic<uint8_t> noteEventTail_;
+    
+    // Timed events waiting for their block (audio callback only), latest first
+    static const uint8_t SCHEDULED_EVENT_SIZE = 64;   // As many as NoteScheduler holds back for MIDI
+    NoteEvent scheduled_[SCHEDULED_EVENT_SIZE];
+    uint8_t scheduledCount_;
+    std::atomic<uint32_t> renderClock_; // Samples rendered since start
+    
+    // Per-voice render scratch buffers
+    static const size_t MAX_BLOCK_SIZE = 64;
+    float voiceBuffer_[MAX_BLOCK_SIZE];
+    float monoScratch_[MAX_BLOCK_SIZE];
     
     // Global parameters
     float masterVolume_;
-    WaveformType currentWaveform_;
+    float stereoWidth_;
     
     // Global effects
-    daisysp::OnePole reverb_;  // Will be replaced with ReverbSc later
+    daisysp::OnePole reverb_;  // Placeholder (low-passed send), off by default until ReverbSc replaces it
     daisysp::DelayLine<float, 48000> delay_;
-    daisysp::OnePole globalLowPass_;
-    daisysp::OnePole globalHighPass_;
+    MasterBus masterBus_;       // Oversampled soft clipper + look-ahead limiter
     
-    // Modulation sources
-    daisysp::Oscillator lfo_;           // Low frequency oscillator
-    daisysp::Oscillator vibratoLfo_;    // Vibrato LFO
+    // Modulation
     float pitchBendAmount_;
     float modulationAmount_;
     
@@ -134,45 +215,61 @@ private:
     bool delayEnabled_;
     float delayTime_;
     float delayFeedback_;
-    float filterCutoff_;
-    float filterResonance_;
+    float filterModDepth_;          // Cutoff modulation depth in octaves
+    
+    // Silence tracking
+    bool effectsIdle_;              // Effect tails below the silence threshold
+    uint32_t effectSilentSamples_;  // Samples since the effects last produced audible output
     
     // Performance monitoring
     uint32_t lastProcessingTime_;
     float currentOutputLevel_;
+    daisy::CpuLoadMeter cpuMeter_;
     
     // Private methods
     
     // Voice management
     Voice* GetFreeVoice();
     Voice* FindVoice(uint8_t note);
-    void InitializeVoice(Voice* voice, uint8_t note, uint8_t velocity);
+    Voice* FindVoiceToSteal();
+    void InitializeVoice(Voice* voice, uint8_t note, uint8_t velocity, float pan);
     void ReleaseVoice(Voice* voice);
+    void StealVoice(Voice* voice, uint8_t note, uint8_t velocity, float pan);
+    void FinishSteal(Voice* voice);
+    void OnEnvelopeComplete(Voice* voice);
+    
+    // Note event handling (audio callback side)
+    bool PushNoteEvent(uint8_t type, uint8_t note, uint8_t velocity, float pan,
+                       bool timed = false, uint32_t time = 0);
+    void ProcessNoteEvents();
+    void ApplyNoteEvent(const NoteEvent& event);
+    void ScheduleNoteEvent(const NoteEvent& event);
+    bool HasEventBefore(uint32_t time) const;
+    void HandleNoteOn(uint8_t note, uint8_t velocity, float pan);
+    void HandleNoteOff(uint8_t note);
+    void HandleAllNotesOff();
     void UpdateVoiceParameters(Voice* voice);
+    VoiceState GetHeldState(VoiceEnvelope::Segment segment);
     
     // Audio processing helpers
-    void ProcessVoices(float* buffer, size_t size);
-    void ProcessEffects(float* buffer, size_t size);
-    void ProcessGlobalFilter(float* buffer, size_t size);
-    void ApplyMasterVolume(float* buffer, size_t size);
+    void RenderStereo(float* left, float* right, size_t size);
+    void ProcessVoices(float* left, float* right, size_t size);
+    void ProcessEffects(float* left, float* right, size_t size);
+    void ApplyMasterVolume(float* left, float* right, size_t size);
     
     // Frequency and note conversion
     float GetNoteFrequency(uint8_t midiNote);
-    float MidiToFrequency(float midiNote);
-    float SemitonesToRatio(float semitones);
-    
-    // Modulation processing
-    void UpdateModulation();
-    float GetVibratoValue();
-    float GetLFOValue();
     
     // Utility functions
     void ClearBuffer(float* buffer, size_t size);
-    void MixBuffers(float* dest, const float* src, size_t size, float gain);
+    float GetBeamPan(uint8_t beamIndex);
     float ClampValue(float value, float min, float max);
     
     // Configuration helpers
-    void ApplyConfigToVoices();
-    void UpdateEnvelopeSettings();
-    void UpdateEffectSettings();
+    void PreparePatch(const LaserHarpConfig& config, SynthPatch* patch);
+    void SwapPendingPatch();
+    void ApplyPatch(const SynthPatch& patch);
+    void ApplyFilterPatch(Voice* voice, const SynthPatch& patch);
+    void UpdateEnvelopeSettings(const SynthPatch& patch);
+    void UpdateEffectSettings(const SynthPatch& patch);
 };
\ No newline at end of file
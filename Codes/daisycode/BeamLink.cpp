@@ -0,0 +1,170 @@
+#include "BeamLink.h"
+
+using namespace daisy;
+
+// DMA target, non-cached D2 SRAM. Frames are decoded in place from here.
+static uint8_t DMA_BUFFER_MEM_SECTION linkRxBuffer[BeamLink::RX_BUFFER_SIZE];
+
+// Constructor
+BeamLink::BeamLink()
+    : sampleHandler_(nullptr), received_(0), consumed_(0), frameLength_(0),
+      blockRemaining_(0), blockZero_(false), frameOverflow_(false),
+      nextSequence_(0), sequenceValid_(false), lastFrameTime_(0),
+      frameCount_(0), droppedFrames_(0), errorCount_(0), overrunCount_(0) {
+}
+
+// Destructor
+BeamLink::~BeamLink() {
+}
+
+// Initialization
+void BeamLink::Init() {
+    UartHandler::Config config;
+    config.periph = UartHandler::Config::Peripheral::UART_4;
+    config.mode = UartHandler::Config::Mode::RX;
+    config.baudrate = BAUD_RATE;
+    config.pin_config.rx = seed::D11;
+    config.pin_config.tx = seed::D12;
+    uart_.Init(config);
+
+    received_.store(0, std::memory_order_relaxed);
+    consumed_ = 0;
+    ResetDecoder();
+    uart_.DmaListenStart(linkRxBuffer, RX_BUFFER_SIZE, RxCallback, this);
+}
+
+void BeamLink::SetSampleHandler(SampleHandler handler) {
+    sampleHandler_ = handler;
+}
+
+// Called from the UART/DMA interrupt with the bytes just written to
+// linkRxBuffer (at half, full and idle line), only the count is published
+void BeamLink::RxCallback(uint8_t* data, size_t size, void* context, UartHandler::Result result) {
+    BeamLink* link = static_cast<BeamLink*>(context);
+    uint32_t received = link->received_.load(std::memory_order_relaxed);
+    link->received_.store(received + size, std::memory_order_release);
+}
+
+// Main loop processing
+void BeamLink::Update() {
+    uint32_t received = received_.load(std::memory_order_acquire);
+
+    // The DMA has wrapped over unread bytes, resynchronize on the next delimiter
+    if (received - consumed_ > RX_BUFFER_SIZE) {
+        consumed_ = received - RX_BUFFER_SIZE;
+        overrunCount_++;
+        ResetDecoder();
+        frameOverflow_ = true;
+    }
+
+    while (consumed_ != received) {
+        DecodeByte(linkRxBuffer[consumed_ % RX_BUFFER_SIZE]);
+        consumed_++;
+    }
+}
+
+bool BeamLink::IsAlive() const {
+    return frameCount_ > 0 && System::GetUs() - lastFrameTime_ < TIMEOUT_US;
+}
+
+// Statistics
+uint32_t BeamLink::GetFrameCount() const {
+    return frameCount_;
+}
+
+uint32_t BeamLink::GetDroppedFrames() const {
+    return droppedFrames_;
+}
+
+uint32_t BeamLink::GetErrorCount() const {
+    return errorCount_;
+}
+
+uint32_t BeamLink::GetOverrunCount() const {
+    return overrunCount_;
+}
+
+// COBS decoding, one byte at a time
+void BeamLink::DecodeByte(uint8_t byte) {
+    if (byte == 0) {
+        // Delimiter, the zero implied by the last block is not part of the frame
+        if (frameOverflow_ || blockRemaining_ != 0) {
+            errorCount_++;
+        } else if (frameLength_ > 0) {
+            HandleFrame();
+        }
+        ResetDecoder();
+        return;
+    }
+
+    if (blockRemaining_ == 0) {
+        // Code byte: the previous block ended on an encoded zero
+        if (blockZero_) AppendByte(0);
+        blockRemaining_ = byte - 1;
+        blockZero_ = byte != 0xFF;
+        return;
+    }
+
+    AppendByte(byte);
+    blockRemaining_--;
+}
+
+void BeamLink::AppendByte(uint8_t byte) {
+    if (frameLength_ >= BEAM_FRAME_SIZE) {
+        frameOverflow_ = true;
+        return;
+    }
+    frame_[frameLength_++] = byte;
+}
+
+void BeamLink::ResetDecoder() {
+    frameLength_ = 0;
+    blockRemaining_ = 0;
+    blockZero_ = false;
+    frameOverflow_ = false;
+}
+
+void BeamLink::HandleFrame() {
+    if (frameLength_ != BEAM_FRAME_SIZE || frame_[0] != FRAME_BEAM) {
+        errorCount_++;
+        return;
+    }
+    uint16_t crc = frame_[BEAM_FRAME_SIZE - 2] | (frame_[BEAM_FRAME_SIZE - 1] << 8);
+    if (Crc16(frame_, BEAM_FRAME_SIZE - 2) != crc) {
+        errorCount_++;
+        return;
+    }
+
+    // Sequence gaps are frames the Arduino dropped on a full TX buffer or lost on the line
+    uint16_t sequence = frame_[1] | (frame_[2] << 8);
+    if (sequenceValid_) {
+        droppedFrames_ += (uint16_t)(sequence - nextSequence_);
+    }
+    nextSequence_ = sequence + 1;
+    sequenceValid_ = true;
+
+    BeamSample sample;
+    sample.remoteTime = frame_[3] | (frame_[4] << 8) | (frame_[5] << 16) | ((uint32_t)frame_[6] << 24);
+    sample.beam = frame_[7];
+    sample.beamCount = frame_[8];
+    sample.forward = frame_[9] & 0x01;
+    sample.broken = frame_[9] & 0x02;
+    sample.value = frame_[10] | (frame_[11] << 8);
+    sample.localTime = System::GetUs();
+
+    frameCount_++;
+    lastFrameTime_ = sample.localTime;
+    if (sampleHandler_) sampleHandler_(sample);
+}
+
+// CRC-16/CCITT (0x1021, initial 0xFFFF), same as the Arduino sketch
+uint16_t BeamLink::Crc16(const uint8_t* data, size_t length) {
+    uint16_t crc = 0xFFFF;
+    for (size_t i = 0; i < length; i++) {
+        crc ^= (uint16_t)data[i] << 8;
+        for (int b = 0; b < 8; b++) {
+            crc = (crc & 0x8000) ? (crc << 1) ^ 0x1021 : crc << 1;
+        }
+    }
+    return crc;
+}
\ No newline at end of file
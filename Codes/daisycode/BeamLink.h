@@ -0,0 +1,84 @@
+#pragma once
+#include <stdint.h>
+#include <stddef.h>
+#include <atomic>
+#include "daisy_seed.h"
+
+// One beam reading from the Arduino scanner
+struct BeamSample {
+    uint8_t beam;               // Beam index (station of the mirror)
+    uint8_t beamCount;          // Beams in the Arduino scan
+    bool forward;               // Scan direction of the dwell
+    bool broken;                // Arduino decision against its learned beam level
+    uint16_t value;             // Laser contribution: ambient reading minus lit reading
+    uint32_t remoteTime;        // Arduino micros() at the end of the dwell
+    uint32_t localTime;         // System::GetUs() when the frame was parsed
+};
+
+// Framed serial link from the Arduino scanner (Serial3, 1 Mbaud) on UART4 RX (D11).
+// Frames are COBS encoded and 0x00 delimited: type, sequence (u16), time (u32),
+// beam, beam count, flags (bit 0 = forward, bit 1 = broken), value (u16), CRC-16/CCITT, all
+// little-endian. DMA writes into a circular buffer and the receive callback only
+// publishes the write position; Update() decodes the frames straight out of that
+// buffer in the main loop.
+class BeamLink {
+public:
+    BeamLink();
+    ~BeamLink();
+
+    typedef void (*SampleHandler)(const BeamSample& sample);
+
+    // Initialization, starts DMA reception
+    void Init();
+    void SetSampleHandler(SampleHandler handler);
+
+    // Main loop processing, calls the sample handler for every valid frame
+    void Update();
+
+    // The link counts as alive while frames keep arriving
+    bool IsAlive() const;
+
+    // Statistics
+    uint32_t GetFrameCount() const;
+    uint32_t GetDroppedFrames() const;      // Sequence gaps
+    uint32_t GetErrorCount() const;         // CRC, length and type errors
+    uint32_t GetOverrunCount() const;       // Receive buffer overwritten before Update() read it
+
+    static const uint32_t BAUD_RATE = 1000000;
+    static const size_t RX_BUFFER_SIZE = 256;       // 2.5ms of data at full rate
+    static const uint32_t TIMEOUT_US = 100000;
+    static const uint8_t FRAME_BEAM = 2;
+    static const uint8_t BEAM_FRAME_SIZE = 14;
+
+private:
+    daisy::UartHandler uart_;
+    SampleHandler sampleHandler_;
+
+    // Written by the DMA callback: total bytes received
+    std::atomic<uint32_t> received_;
+    uint32_t consumed_;
+
+    // COBS decoder state
+    uint8_t frame_[BEAM_FRAME_SIZE];
+    uint8_t frameLength_;
+    uint8_t blockRemaining_;    // Data bytes left in the current block, 0 = next byte is a code
+    bool blockZero_;            // The current block ends with an encoded zero
+    bool frameOverflow_;
+
+    uint16_t nextSequence_;
+    bool sequenceValid_;
+    uint32_t lastFrameTime_;
+
+    uint32_t frameCount_;
+    uint32_t droppedFrames_;
+    uint32_t errorCount_;
+    uint32_t overrunCount_;
+
+    // Private methods
+    static void RxCallback(uint8_t* data, size_t size, void* context, daisy::UartHandler::Result result);
+    void DecodeByte(uint8_t byte);
+    void AppendByte(uint8_t byte);
+    void HandleFrame();
+    void ResetDecoder();
+    static uint16_t Crc16(const uint8_t* data, size_t length);
+};
\ No newline at end of file
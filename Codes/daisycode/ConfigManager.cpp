@@ -1,8 +1,16 @@
 #include "ConfigManager.h"
+#include "ConfigSchema.h"
+
+// Constants
+const uint32_t CONFIG_STORE_ADDRESS = 0x7FC000;    // Last 16KB of the 8MB QSPI flash
+const uint8_t CONFIG_STORE_SECTORS = 4;
+const uint16_t CONFIG_RECORD_VERSION = 4;     // 4: ConfigSchema entries (1-3 were raw structs)
 
 // Constructor
-ConfigManager::ConfigManager() : isCalibrating_(false), configLoaded_(false) {
-    // Constructor body - will be implemented later
+ConfigManager::ConfigManager()
+    : frontIndex_(0), version_(0), isCalibrating_(false), configLoaded_(false),
+      storageReady_(false), saveRequested_(false), savedChecksum_(0) {
+    LoadDefaults();
 }
 
 // Destructor
@@ -11,40 +19,71 @@ ConfigManager::~ConfigManager() {
 }
 
 // Initialization
-void ConfigManager::Init() {
-    // TODO: Implement initialization
+void ConfigManager::Init(FlashDevice* flash) {
     LoadDefaults();
+    
+    if (flash) {
+        // Init() mounts the log; an empty region is still usable for writing
+        store_.Init(flash, CONFIG_STORE_ADDRESS, CONFIG_STORE_SECTORS,
+                    storageBuffer_, STORAGE_BUFFER_SIZE);
+        storageReady_ = true;
+        LoadConfig();
+    }
+}
+
+void ConfigManager::Update() {
+    if (!storageReady_) {
+        return;
+    }
+    
+    // Start a pending save once the previous write has finished
+    if (saveRequested_ && !store_.IsBusy()) {
+        if (WriteToStorage()) {
+            saveRequested_ = false;
+        }
+    }
+    
+    store_.Update();
+    
+    // Retry on the next save request if the write did not verify
+    if (!store_.IsBusy() && store_.LastWriteFailed()) {
+        savedChecksum_ = 0;
+    }
 }
 
 // Configuration management
 void ConfigManager::LoadDefaults() {
-    config_.numBeams = 7;           // 7 inputs from Arduino
-    config_.baseNote = 60;          // C4
-    config_.noteInterval = 2;       // Whole tone scale
-    config_.midiChannel = 1;
-    config_.midiVelocity = 100;
-    config_.midiEnabled = true;
-    config_.audioEnabled = true;
-    config_.reverbLevel = 0.3f;
-    config_.masterVolume = 0.8f;
-    config_.waveform = 0;           // Sine wave
-    config_.attackTime = 0.01f;
-    config_.decayTime = 0.1f;
-    config_.sustainLevel = 0.7f;
-    config_.releaseTime = 0.3f;
+    FillDefaults(&config_);
+    Publish();
+}
+
+void ConfigManager::FillDefaults(LaserHarpConfig* config) {
+    ConfigSchema::LoadDefaults(config);
 }
 
 void ConfigManager::SaveConfig() {
-    // TODO: Implement configuration saving to persistent storage
+    if (storageReady_) {
+        saveRequested_ = true;
+    }
 }
 
 void ConfigManager::LoadConfig() {
-    // TODO: Implement configuration loading from persistent storage
+    if (ReadFromStorage() && IsConfigValid()) {
+        configLoaded_ = true;
+    } else {
+        LoadDefaults();
+        configLoaded_ = false;
+    }
+    savedChecksum_ = configLoaded_ ? CalculateChecksum() : 0;
+    Publish();
 }
 
 bool ConfigManager::IsConfigValid() {
-    // TODO: Implement configuration validation
-    return true;
+    return ConfigSchema::Validate(config_);
+}
+
+bool ConfigManager::IsSaving() const {
+    return saveRequested_ || store_.IsBusy();
 }
 
 // Getters
@@ -56,62 +95,124 @@ const LaserHarpConfig* ConfigManager::GetConfig() const {
     return &config_;
 }
 
+// Published configuration
+// The writer fills the back buffer and then flips the front index. Readers in
+// the audio callback interrupt the main loop, so a copy can never be overtaken
+// by a second Publish() and always sees one complete configuration.
+void ConfigManager::Publish() {
+    ValidateConfig();
+    uint8_t back = 1 - frontIndex_.load(std::memory_order_relaxed);
+    snapshots_[back] = config_;
+    frontIndex_.store(back, std::memory_order_release);
+    version_.fetch_add(1, std::memory_order_release);
+}
+
+const LaserHarpConfig* ConfigManager::GetSnapshot() const {
+    return &snapshots_[frontIndex_.load(std::memory_order_acquire)];
+}
+
+uint32_t ConfigManager::GetVersion() const {
+    return version_.load(std::memory_order_acquire);
+}
+
+uint32_t ConfigManager::CopySnapshot(LaserHarpConfig* out) const {
+    uint32_t version = version_.load(std::memory_order_acquire);
+    *out = snapshots_[frontIndex_.load(std::memory_order_acquire)];
+    return version;
+}
+
 // Individual parameter access
 uint8_t ConfigManager::GetNumBeams() const {
-    return config_.numBeams;
+    return GetSnapshot()->numBeams;
 }
 
 uint8_t ConfigManager::GetBaseNote() const {
-    return config_.baseNote;
+    return GetSnapshot()->baseNote;
 }
 
 uint8_t ConfigManager::GetMidiChannel() const {
-    return config_.midiChannel;
+    return GetSnapshot()->midiChannel;
 }
 
 float ConfigManager::GetMasterVolume() const {
-    return config_.masterVolume;
+    return GetSnapshot()->masterVolume;
 }
 
 bool ConfigManager::IsAudioEnabled() const {
-    return config_.audioEnabled;
+    return GetSnapshot()->audioEnabled;
 }
 
 bool ConfigManager::IsMidiEnabled() const {
-    return config_.midiEnabled;
+    return GetSnapshot()->midiEnabled;
+}
+
+// Generic parameter access by ConfigFieldId
+bool ConfigManager::GetParameter(uint8_t id, uint8_t index, float* value) const {
+    return ConfigSchema::GetValue(*GetSnapshot(), id, index, value);
+}
+
+bool ConfigManager::SetParameter(uint8_t id, uint8_t index, float value) {
+    if (!ConfigSchema::SetValue(&config_, id, index, value)) {
+        return false;
+    }
+    Publish();
+    return true;
 }
 
 // Individual parameter setters
 void ConfigManager::SetNumBeams(uint8_t numBeams) {
     if (numBeams > 0 && numBeams <= 16) {
         config_.numBeams = numBeams;
+        Publish();
     }
 }
 
 void ConfigManager::SetBaseNote(uint8_t baseNote) {
     if (baseNote < 128) {
         config_.baseNote = baseNote;
+        Publish();
     }
 }
 
 void ConfigManager::SetMidiChannel(uint8_t channel) {
     if (channel >= 1 && channel <= 16) {
         config_.midiChannel = channel;
+        Publish();
     }
 }
 
 void ConfigManager::SetMasterVolume(float volume) {
     if (volume >= 0.0f && volume <= 1.0f) {
         config_.masterVolume = volume;
+        Publish();
     }
 }
 
 void ConfigManager::SetAudioEnabled(bool enabled) {
     config_.audioEnabled = enabled;
+    Publish();
 }
 
 void ConfigManager::SetMidiEnabled(bool enabled) {
     config_.midiEnabled = enabled;
+    Publish();
+}
+
+void ConfigManager::SetScale(uint8_t scale) {
+    config_.scale = scale;
+    Publish();
+}
+
+void ConfigManager::SetChordMode(uint8_t chordMode) {
+    config_.chordMode = chordMode;
+    Publish();
+}
+
+void ConfigManager::SetTranspose(int8_t semitones) {
+    if (semitones >= -48 && semitones <= 48) {
+        config_.transpose = semitones;
+        Publish();
+    }
 }
 
 // Calibration helpers
@@ -131,23 +232,58 @@ bool ConfigManager::IsCalibrating() const {
 
 // Private methods
 void ConfigManager::ValidateConfig() {
-    // TODO: Implement configuration validation
+    if (!IsConfigValid()) {
+        ClampValues();
+    }
 }
 
 void ConfigManager::ClampValues() {
-    // TODO: Implement value clamping
+    ConfigSchema::Clamp(&config_);
 }
 
-void ConfigManager::WriteToStorage() {
-    // TODO: Implement storage write
+// Queues the current configuration as a new record, skipped when nothing
+// changed since the last save so repeated saves cost no flash wear
+bool ConfigManager::WriteToStorage() {
+    ValidateConfig();
+    uint8_t buffer[ConfigSchema::MAX_SERIALIZED_SIZE];
+    size_t length = ConfigSchema::Serialize(config_, buffer, sizeof(buffer));
+    uint32_t checksum = RecordStore::Crc32(buffer, length);
+    if (checksum == savedChecksum_) {
+        return true;
+    }
+    
+    if (!store_.BeginWrite(buffer, length, CONFIG_RECORD_VERSION)) {
+        return false;
+    }
+    savedChecksum_ = checksum;
+    return true;
 }
 
 bool ConfigManager::ReadFromStorage() {
-    // TODO: Implement storage read
-    return false;
+    if (!store_.HasRecord() ||
+        store_.GetRecordVersion() != CONFIG_RECORD_VERSION ||
+        store_.GetRecordLength() > ConfigSchema::MAX_SERIALIZED_SIZE) {
+        return false;
+    }
+    
+    uint8_t buffer[ConfigSchema::MAX_SERIALIZED_SIZE];
+    uint32_t length = store_.GetRecordLength();
+    if (!store_.ReadRecord(buffer, sizeof(buffer))) {
+        return false;
+    }
+    
+    // Fields missing from an older firmware's record keep their defaults
+    LaserHarpConfig loaded;
+    if (!ConfigSchema::Deserialize(buffer, length, &loaded)) {
+        return false;
+    }
+    config_ = loaded;
+    return true;
 }
 
+// CRC32 of the serialized form, independent of struct padding
 uint32_t ConfigManager::CalculateChecksum() {
-    // TODO: Implement checksum calculation
-    return 0;
+    uint8_t buffer[ConfigSchema::MAX_SERIALIZED_SIZE];
+    size_t length = ConfigSchema::Serialize(config_, buffer, sizeof(buffer));
+    return RecordStore::Crc32(buffer, length);
 }
\ No newline at end of file
@@ -1,19 +1,28 @@
 #pragma once
 #include <stdint.h>
+#include <stddef.h>
+#include <atomic>
+#include "RecordStore.h"
 
 // Configuration structure for the Laser Harp
 // Simplified version: Arduino handles beam detection, Daisy handles MIDI/Audio
+// Ranges, defaults and the stored format come from the table in ConfigSchema.cpp,
+// a new member needs an entry there.
 struct LaserHarpConfig {
-    // Beam configuration (7 inputs from Arduino)
-    uint8_t numBeams;           // Number of laser beams (fixed to 7)
+    // Beam configuration
+    uint8_t numBeams;           // Number of laser beams (1-16, 7 with the digital input fallback)
     uint8_t baseNote;           // MIDI note for first beam (C4 = 60)
     uint8_t noteInterval;       // Interval between notes (1=chromatic, 2=whole tone, etc.)
+    uint16_t sensorThresholds[16];  // Per-beam laser contribution thresholds, 0 = half the learned beam level
     
     // MIDI configuration
     uint8_t midiChannel;        // MIDI channel (1-16)
     uint8_t midiVelocity;       // Default MIDI velocity
     bool midiEnabled;           // Enable/disable MIDI output
     bool audioEnabled;          // Enable/disable audio output
+    bool mpeEnabled;            // MPE lower zone: master channel 1, one member channel per note
+    uint8_t mpeMemberChannels;  // Member channels 2..(1 + count), 1-15
+    uint8_t mpeBendRange;       // Member channel pitch bend range (semitones)
     
     // Audio configuration
     float reverbLevel;          // Reverb level (0.0 - 1.0)
@@ -23,6 +32,38 @@ struct LaserHarpConfig {
     float decayTime;            // ADSR decay time (seconds)
     float sustainLevel;         // ADSR sustain level (0.0 - 1.0)
     float releaseTime;          // ADSR release time (seconds)
+    
+    // Voice filter and effects
+    float filterCutoff;         // Voice filter cutoff (Hz)
+    float filterResonance;      // Voice filter resonance (0.0 - 1.0)
+    float filterKeyTracking;    // Cutoff follows note pitch (0.0 - 1.0)
+    bool reverbEnabled;
+    bool delayEnabled;
+    float delayTime;            // Delay time (seconds)
+    float delayFeedback;        // Delay feedback (0.0 - 0.95)
+    uint8_t oversampling;       // Master clipper oversampling factor (1, 2 or 4)
+    
+    // Note mapping
+    uint8_t scale;              // ScaleType used by the beam note mapping
+    uint8_t chordMode;          // ChordMode played by each beam
+    int8_t transpose;           // Live transposition in semitones (-48 - 48)
+    uint16_t customScaleMask;   // Pitch classes of SCALE_CUSTOM (bit 0 = root)
+    
+    // Arpeggiator and clock
+    uint8_t arpMode;            // ArpMode, 0 = beams play directly
+    uint8_t arpRate;            // ArpRate step length
+    float arpGate;              // Note length as a fraction of the step (0.05 - 1.0)
+    uint8_t arpOctaves;         // Octave range (1-4)
+    uint16_t arpPattern;        // Active steps (bit 0 = first step)
+    uint8_t arpSteps;           // Pattern length (1-16)
+    float tempo;                // Internal clock tempo (BPM)
+    uint8_t clockSource;        // ClockSource, internal or MIDI clock
+    
+    // Looper
+    uint8_t loopQuantize;       // Playback grid as ArpRate + 1, 0 = off
+    
+    // Presets
+    uint8_t currentPreset;      // Last recalled preset (0-127)
 };
 
 class ConfigManager {
@@ -30,20 +71,31 @@ public:
     ConfigManager();
     ~ConfigManager();
     
-    // Initialization
-    void Init();
+    // Initialization (without a flash device the configuration is RAM only)
+    void Init(FlashDevice* flash = nullptr);
+    
+    // Main loop processing, advances pending flash writes one step per call
+    void Update();
     
     // Configuration management
     void LoadDefaults();
-    void SaveConfig();
+    static void FillDefaults(LaserHarpConfig* config);
+    void SaveConfig();          // Non-blocking, written by Update()
     void LoadConfig();
     bool IsConfigValid();
+    bool IsSaving() const;
     
-    // Getters
+    // Working copy (main loop only), edits become visible to readers on Publish()
     LaserHarpConfig* GetConfig();
     const LaserHarpConfig* GetConfig() const;
     
-    // Individual parameter access
+    // Published configuration (lock-free double buffer, single writer in the main loop)
+    void Publish();
+    const LaserHarpConfig* GetSnapshot() const;         // Main loop readers
+    uint32_t GetVersion() const;                         // Incremented by every Publish()
+    uint32_t CopySnapshot(LaserHarpConfig* out) const;   // Audio callback, returns the copied version
+    
+    // Individual parameter access (published values)
     uint8_t GetNumBeams() const;
     uint8_t GetBaseNote() const;
     uint8_t GetMidiChannel() const;
@@ -51,13 +103,20 @@ public:
     bool IsAudioEnabled() const;
     bool IsMidiEnabled() const;
     
-    // Individual parameter setters
+    // Generic parameter access by ConfigFieldId (SysEx), values are clamped
+    bool GetParameter(uint8_t id, uint8_t index, float* value) const;
+    bool SetParameter(uint8_t id, uint8_t index, float value);
+    
+    // Individual parameter setters (publish immediately)
     void SetNumBeams(uint8_t numBeams);
     void SetBaseNote(uint8_t baseNote);
     void SetMidiChannel(uint8_t channel);
     void SetMasterVolume(float volume);
     void SetAudioEnabled(bool enabled);
     void SetMidiEnabled(bool enabled);
+    void SetScale(uint8_t scale);
+    void SetChordMode(uint8_t chordMode);
+    void SetTranspose(int8_t semitones);
     
     // Calibration helpers
     void StartCalibration();
@@ -65,16 +124,27 @@ public:
     bool IsCalibrating() const;
     
 private:
-    LaserHarpConfig config_;
+    LaserHarpConfig config_;                // Working copy
+    LaserHarpConfig snapshots_[2];          // Published front/back buffers
+    std::atomic<uint8_t> frontIndex_;
+    std::atomic<uint32_t> version_;
     bool isCalibrating_;
     bool configLoaded_;
     
+    // Persistent storage
+    static const size_t STORAGE_BUFFER_SIZE = 512;
+    RecordStore store_;
+    uint8_t storageBuffer_[STORAGE_BUFFER_SIZE];
+    bool storageReady_;
+    bool saveRequested_;
+    uint32_t savedChecksum_;    // Checksum of the configuration last written or loaded
+    
     // Internal validation
     void ValidateConfig();
     void ClampValues();
     
-    // Storage helpers (for future EEPROM/Flash storage)
-    void WriteToStorage();
+    // Storage helpers (QSPI flash record log)
+    bool WriteToStorage();
     bool ReadFromStorage();
     uint32_t CalculateChecksum();
 };
\ No newline at end of file
@@ -0,0 +1,285 @@
+#include "ConfigSchema.h"
+#include "NoteMapper.h"
+#include "Arpeggiator.h"
+#include <cmath>
+#include <cstring>
+
+static constexpr size_t TypeSize(uint8_t type) {
+    return (type == FIELD_U16) ? 2 : (type == FIELD_FLOAT) ? 4 : 1;
+}
+
+// Serialization copies count * TypeSize(type) bytes at the member offset
+template <size_t MemberSize, size_t FieldSize>
+static constexpr uint16_t CheckedOffset(size_t offset) {
+    static_assert(MemberSize == FieldSize, "Config field table: type and count do not match the member size");
+    return (uint16_t)offset;
+}
+
+#define CONFIG_FIELD(id, type, member, count, minValue, maxValue, defaultValue) \
+    { id, type, count, \
+      CheckedOffset<sizeof(LaserHarpConfig::member), (count) * TypeSize(type)>(offsetof(LaserHarpConfig, member)), \
+      minValue, maxValue, defaultValue }
+
+// Field table, the single source for defaults, ranges and the stored format
+static constexpr ConfigField CONFIG_FIELDS[] = {
+    // Beams
+    CONFIG_FIELD(CFG_NUM_BEAMS,           FIELD_U8,    numBeams,          1,  1.0f,     16.0f,    7.0f),
+    CONFIG_FIELD(CFG_BASE_NOTE,           FIELD_U8,    baseNote,          1,  0.0f,     127.0f,   60.0f),
+    CONFIG_FIELD(CFG_NOTE_INTERVAL,       FIELD_U8,    noteInterval,      1,  0.0f,     24.0f,    2.0f),
+    CONFIG_FIELD(CFG_SENSOR_THRESHOLDS,   FIELD_U16,   sensorThresholds,  16, 0.0f,     65535.0f, 0.0f),
+
+    // MIDI
+    CONFIG_FIELD(CFG_MIDI_CHANNEL,        FIELD_U8,    midiChannel,       1,  1.0f,     16.0f,    1.0f),
+    CONFIG_FIELD(CFG_MIDI_VELOCITY,       FIELD_U8,    midiVelocity,      1,  1.0f,     127.0f,   100.0f),
+    CONFIG_FIELD(CFG_MIDI_ENABLED,        FIELD_BOOL,  midiEnabled,       1,  0.0f,     1.0f,     1.0f),
+    CONFIG_FIELD(CFG_AUDIO_ENABLED,       FIELD_BOOL,  audioEnabled,      1,  0.0f,     1.0f,     1.0f),
+    CONFIG_FIELD(CFG_MPE_ENABLED,         FIELD_BOOL,  mpeEnabled,        1,  0.0f,     1.0f,     0.0f),
+    CONFIG_FIELD(CFG_MPE_MEMBER_CHANNELS, FIELD_U8,    mpeMemberChannels, 1,  1.0f,     15.0f,    15.0f),
+    CONFIG_FIELD(CFG_MPE_BEND_RANGE,      FIELD_U8,    mpeBendRange,      1,  1.0f,     96.0f,    48.0f),
+
+    // Audio
+    CONFIG_FIELD(CFG_REVERB_LEVEL,        FIELD_FLOAT, reverbLevel,       1,  0.0f,     1.0f,     0.3f),
+    CONFIG_FIELD(CFG_MASTER_VOLUME,       FIELD_FLOAT, masterVolume,      1,  0.0f,     1.0f,     0.8f),
+    CONFIG_FIELD(CFG_WAVEFORM,            FIELD_U8,    waveform,          1,  0.0f,     4.0f,     0.0f),
+    CONFIG_FIELD(CFG_ATTACK_TIME,         FIELD_FLOAT, attackTime,        1,  0.0f,     10.0f,    0.01f),
+    CONFIG_FIELD(CFG_DECAY_TIME,          FIELD_FLOAT, decayTime,         1,  0.0f,     10.0f,    0.1f),
+    CONFIG_FIELD(CFG_SUSTAIN_LEVEL,       FIELD_FLOAT, sustainLevel,      1,  0.0f,     1.0f,     0.7f),
+    CONFIG_FIELD(CFG_RELEASE_TIME,        FIELD_FLOAT, releaseTime,       1,  0.0f,     10.0f,    0.3f),
+
+    // Voice filter and effects
+    CONFIG_FIELD(CFG_FILTER_CUTOFF,       FIELD_FLOAT, filterCutoff,      1,  20.0f,    20000.0f, 1000.0f),
+    CONFIG_FIELD(CFG_FILTER_RESONANCE,    FIELD_FLOAT, filterResonance,   1,  0.0f,     1.0f,     0.5f),
+    CONFIG_FIELD(CFG_FILTER_KEY_TRACKING, FIELD_FLOAT, filterKeyTracking, 1,  0.0f,     1.0f,     0.0f),
+    CONFIG_FIELD(CFG_REVERB_ENABLED,      FIELD_BOOL,  reverbEnabled,     1,  0.0f,     1.0f,     0.0f),   // Off until ReverbSc replaces the placeholder
+    CONFIG_FIELD(CFG_DELAY_ENABLED,       FIELD_BOOL,  delayEnabled,      1,  0.0f,     1.0f,     0.0f),
+    CONFIG_FIELD(CFG_DELAY_TIME,          FIELD_FLOAT, delayTime,         1,  0.001f,   0.999f,   0.25f),
+    CONFIG_FIELD(CFG_DELAY_FEEDBACK,      FIELD_FLOAT, delayFeedback,     1,  0.0f,     0.95f,    0.4f),
+    CONFIG_FIELD(CFG_OVERSAMPLING,        FIELD_U8,    oversampling,      1,  1.0f,     4.0f,     2.0f),   // 3 rounds down to 2x
+
+    // Note mapping
+    CONFIG_FIELD(CFG_SCALE,               FIELD_U8,    scale,             1,  0.0f,     (float)(SCALE_COUNT - 1), 0.0f),
+    CONFIG_FIELD(CFG_CHORD_MODE,          FIELD_U8,    chordMode,         1,  0.0f,     (float)(CHORD_MODE_COUNT - 1), 0.0f),
+    CONFIG_FIELD(CFG_TRANSPOSE,           FIELD_I8,    transpose,         1,  -48.0f,   48.0f,    0.0f),
+    CONFIG_FIELD(CFG_CUSTOM_SCALE_MASK,   FIELD_U16,   customScaleMask,   1,  1.0f,     4095.0f,  4095.0f),
+
+    // Arpeggiator and clock
+    CONFIG_FIELD(CFG_ARP_MODE,            FIELD_U8,    arpMode,           1,  0.0f,     (float)(ARP_MODE_COUNT - 1), 0.0f),
+    CONFIG_FIELD(CFG_ARP_RATE,            FIELD_U8,    arpRate,           1,  0.0f,     (float)(ARP_RATE_COUNT - 1), 3.0f),
+    CONFIG_FIELD(CFG_ARP_GATE,            FIELD_FLOAT, arpGate,           1,  0.05f,    1.0f,     0.5f),
+    CONFIG_FIELD(CFG_ARP_OCTAVES,         FIELD_U8,    arpOctaves,        1,  1.0f,     4.0f,     1.0f),
+    CONFIG_FIELD(CFG_ARP_PATTERN,         FIELD_U16,   arpPattern,        1,  1.0f,     65535.0f, 65535.0f),
+    CONFIG_FIELD(CFG_ARP_STEPS,           FIELD_U8,    arpSteps,          1,  1.0f,     16.0f,    16.0f),
+    CONFIG_FIELD(CFG_TEMPO,               FIELD_FLOAT, tempo,             1,  20.0f,    300.0f,   120.0f),
+    CONFIG_FIELD(CFG_CLOCK_SOURCE,        FIELD_U8,    clockSource,       1,  0.0f,     1.0f,     0.0f),
+    CONFIG_FIELD(CFG_LOOP_QUANTIZE,       FIELD_U8,    loopQuantize,      1,  0.0f,     (float)ARP_RATE_COUNT, 0.0f),
+
+    // Presets
+    CONFIG_FIELD(CFG_CURRENT_PRESET,      FIELD_U8,    currentPreset,     1,  0.0f,     127.0f,   0.0f)
+};
+
+static constexpr size_t FIELD_COUNT = sizeof(CONFIG_FIELDS) / sizeof(CONFIG_FIELDS[0]);
+
+// Compile-time checks of the table
+static constexpr bool FieldsAreConsistent() {
+    for (size_t i = 0; i < FIELD_COUNT; i++) {
+        const ConfigField& field = CONFIG_FIELDS[i];
+        if (field.count == 0 ||
+            field.offset + field.count * TypeSize(field.type) > sizeof(LaserHarpConfig) ||
+            field.defaultValue < field.minValue || field.defaultValue > field.maxValue) {
+            return false;
+        }
+        for (size_t j = i + 1; j < FIELD_COUNT; j++) {
+            if (CONFIG_FIELDS[j].id == field.id) return false;
+        }
+    }
+    return true;
+}
+
+static constexpr size_t SerializedSize() {
+    size_t size = 0;
+    for (size_t i = 0; i < FIELD_COUNT; i++) {
+        size += 3 + CONFIG_FIELDS[i].count * TypeSize(CONFIG_FIELDS[i].type);
+    }
+    return size;
+}
+
+static_assert(FieldsAreConsistent(), "Config field table: bad offset, range, default or duplicate id");
+static_assert(SerializedSize() <= ConfigSchema::MAX_SERIALIZED_SIZE, "Serialized config exceeds MAX_SERIALIZED_SIZE");
+
+// Table access
+size_t ConfigSchema::GetFieldCount() {
+    return FIELD_COUNT;
+}
+
+const ConfigField* ConfigSchema::GetField(size_t index) {
+    return index < FIELD_COUNT ? &CONFIG_FIELDS[index] : nullptr;
+}
+
+const ConfigField* ConfigSchema::FindField(uint8_t id) {
+    for (size_t i = 0; i < FIELD_COUNT; i++) {
+        if (CONFIG_FIELDS[i].id == id) {
+            return &CONFIG_FIELDS[i];
+        }
+    }
+    return nullptr;
+}
+
+size_t ConfigSchema::GetTypeSize(uint8_t type) {
+    return TypeSize(type);
+}
+
+// Defaults and validation
+void ConfigSchema::LoadDefaults(LaserHarpConfig* config) {
+    memset(config, 0, sizeof(LaserHarpConfig));
+    for (size_t i = 0; i < FIELD_COUNT; i++) {
+        const ConfigField& field = CONFIG_FIELDS[i];
+        uint8_t* data = (uint8_t*)config + field.offset;
+        for (uint8_t e = 0; e < field.count; e++) {
+            WriteElement(data + e * TypeSize(field.type), field.type, field.defaultValue);
+        }
+    }
+}
+
+bool ConfigSchema::Validate(const LaserHarpConfig& config) {
+    for (size_t i = 0; i < FIELD_COUNT; i++) {
+        const ConfigField& field = CONFIG_FIELDS[i];
+        const uint8_t* data = (const uint8_t*)&config + field.offset;
+        for (uint8_t e = 0; e < field.count; e++) {
+            float value = ReadElement(data + e * TypeSize(field.type), field.type);
+            if (!(value >= field.minValue && value <= field.maxValue)) {
+                return false;
+            }
+        }
+    }
+    return true;
+}
+
+void ConfigSchema::Clamp(LaserHarpConfig* config) {
+    for (size_t i = 0; i < FIELD_COUNT; i++) {
+        const ConfigField& field = CONFIG_FIELDS[i];
+        uint8_t* data = (uint8_t*)config + field.offset;
+        for (uint8_t e = 0; e < field.count; e++) {
+            uint8_t* element = data + e * TypeSize(field.type);
+            WriteElement(element, field.type, ClampToField(field, ReadElement(element, field.type)));
+        }
+    }
+}
+
+// Parameter access by id
+bool ConfigSchema::GetValue(const LaserHarpConfig& config, uint8_t id, uint8_t index, float* value) {
+    const ConfigField* field = FindField(id);
+    if (field == nullptr || index >= field->count) {
+        return false;
+    }
+    const uint8_t* data = (const uint8_t*)&config + field->offset + index * TypeSize(field->type);
+    *value = ReadElement(data, field->type);
+    return true;
+}
+
+bool ConfigSchema::SetValue(LaserHarpConfig* config, uint8_t id, uint8_t index, float value) {
+    const ConfigField* field = FindField(id);
+    if (field == nullptr || index >= field->count) {
+        return false;
+    }
+    uint8_t* data = (uint8_t*)config + field->offset + index * TypeSize(field->type);
+    WriteElement(data, field->type, ClampToField(*field, value));
+    return true;
+}
+
+// Serialization
+size_t ConfigSchema::Serialize(const LaserHarpConfig& config, uint8_t* buffer, size_t size) {
+    size_t position = 0;
+    for (size_t i = 0; i < FIELD_COUNT; i++) {
+        const ConfigField& field = CONFIG_FIELDS[i];
+        size_t bytes = field.count * TypeSize(field.type);
+        if (position + 3 + bytes > size) {
+            return 0;
+        }
+        buffer[position++] = field.id;
+        buffer[position++] = field.type;
+        buffer[position++] = field.count;
+        memcpy(buffer + position, (const uint8_t*)&config + field.offset, bytes);
+        position += bytes;
+    }
+    return position;
+}
+
+bool ConfigSchema::Deserialize(const uint8_t* buffer, size_t length, LaserHarpConfig* config) {
+    LoadDefaults(config);
+
+    size_t position = 0;
+    while (position + 3 <= length) {
+        uint8_t id = buffer[position];
+        uint8_t type = buffer[position + 1];
+        uint8_t count = buffer[position + 2];
+        position += 3;
+
+        if (type > FIELD_FLOAT) {
+            return false;       // Entry size unknown, the rest cannot be parsed
+        }
+        size_t storedSize = TypeSize(type);
+        if (position + count * storedSize > length) {
+            return false;
+        }
+
+        // Unknown ids are skipped, known ones are converted element by element
+        const ConfigField* field = FindField(id);
+        if (field != nullptr) {
+            uint8_t* data = (uint8_t*)config + field->offset;
+            uint8_t elements = count < field->count ? count : field->count;
+            for (uint8_t e = 0; e < elements; e++) {
+                float value = ReadElement(buffer + position + e * storedSize, type);
+                WriteElement(data + e * TypeSize(field->type), field->type, ClampToField(*field, value));
+            }
+        }
+        position += count * storedSize;
+    }
+    return position == length;
+}
+
+// Private methods
+float ConfigSchema::ReadElement(const uint8_t* data, uint8_t type) {
+    switch (type) {
+        case FIELD_U8:   return (float)data[0];
+        case FIELD_I8:   return (float)(int8_t)data[0];
+        case FIELD_BOOL: return data[0] ? 1.0f : 0.0f;
+        case FIELD_U16: {
+            uint16_t value;
+            memcpy(&value, data, sizeof(value));
+            return (float)value;
+        }
+        case FIELD_FLOAT: {
+            float value;
+            memcpy(&value, data, sizeof(value));
+            return value;
+        }
+        default:
+            return 0.0f;
+    }
+}
+
+void ConfigSchema::WriteElement(uint8_t* data, uint8_t type, float value) {
+    switch (type) {
+        case FIELD_U8:   data[0] = (uint8_t)lroundf(value); break;
+        case FIELD_I8:   data[0] = (uint8_t)(int8_t)lroundf(value); break;
+        case FIELD_BOOL: data[0] = value >= 0.5f ? 1 : 0; break;
+        case FIELD_U16: {
+            uint16_t stored = (uint16_t)lroundf(value);
+            memcpy(data, &stored, sizeof(stored));
+            break;
+        }
+        case FIELD_FLOAT:
+            memcpy(data, &value, sizeof(value));
+            break;
+        default:
+            break;
+    }
+}
+
+// NaN falls back to the default
+float ConfigSchema::ClampToField(const ConfigField& field, float value) {
+    if (value != value) return field.defaultValue;
+    if (value < field.minValue) return field.minValue;
+    if (value > field.maxValue) return field.maxValue;
+    return value;
+}
\ No newline at end of file
@@ -0,0 +1,101 @@
+#pragma once
+#include <stdint.h>
+#include <stddef.h>
+#include "ConfigManager.h"
+
+// Field types
+enum ConfigFieldType {
+    FIELD_U8 = 0,
+    FIELD_I8,
+    FIELD_U16,
+    FIELD_BOOL,
+    FIELD_FLOAT
+};
+
+// Stable field ids used by the stored format and SysEx, never reuse an id
+enum ConfigFieldId {
+    CFG_NUM_BEAMS = 1,
+    CFG_BASE_NOTE = 2,
+    CFG_NOTE_INTERVAL = 3,
+    CFG_MIDI_CHANNEL = 4,
+    CFG_MIDI_VELOCITY = 5,
+    CFG_MIDI_ENABLED = 6,
+    CFG_AUDIO_ENABLED = 7,
+    CFG_REVERB_LEVEL = 8,
+    CFG_MASTER_VOLUME = 9,
+    CFG_WAVEFORM = 10,
+    CFG_ATTACK_TIME = 11,
+    CFG_DECAY_TIME = 12,
+    CFG_SUSTAIN_LEVEL = 13,
+    CFG_RELEASE_TIME = 14,
+    CFG_FILTER_CUTOFF = 15,
+    CFG_FILTER_RESONANCE = 16,
+    CFG_FILTER_KEY_TRACKING = 17,
+    CFG_REVERB_ENABLED = 18,
+    CFG_DELAY_ENABLED = 19,
+    CFG_DELAY_TIME = 20,
+    CFG_DELAY_FEEDBACK = 21,
+    CFG_SCALE = 22,
+    CFG_CHORD_MODE = 23,
+    CFG_TRANSPOSE = 24,
+    CFG_CUSTOM_SCALE_MASK = 25,
+    CFG_CURRENT_PRESET = 26,
+    CFG_SENSOR_THRESHOLDS = 27,
+    CFG_MPE_ENABLED = 28,
+    CFG_MPE_MEMBER_CHANNELS = 29,
+    CFG_MPE_BEND_RANGE = 30,
+    CFG_ARP_MODE = 31,
+    CFG_ARP_RATE = 32,
+    CFG_ARP_GATE = 33,
+    CFG_ARP_OCTAVES = 34,
+    CFG_ARP_PATTERN = 35,
+    CFG_ARP_STEPS = 36,
+    CFG_TEMPO = 37,
+    CFG_CLOCK_SOURCE = 38,
+    CFG_LOOP_QUANTIZE = 39,
+    CFG_OVERSAMPLING = 40
+};
+
+// Descriptor of one LaserHarpConfig member
+struct ConfigField {
+    uint8_t id;
+    uint8_t type;               // ConfigFieldType
+    uint8_t count;              // Array length, 1 for scalars
+    uint16_t offset;            // offsetof(LaserHarpConfig, member)
+    float minValue;
+    float maxValue;
+    float defaultValue;         // Applied to every element of an array
+};
+
+// Table-driven defaults, validation, parameter access and serialization.
+// The stored format is a list of [id][type][count][little-endian values]
+// entries. Reading starts from the defaults and converts every known entry
+// into the current field type, so added, removed, resized or retyped fields
+// migrate without hand-written code.
+class ConfigSchema {
+public:
+    // Table access
+    static size_t GetFieldCount();
+    static const ConfigField* GetField(size_t index);
+    static const ConfigField* FindField(uint8_t id);
+    static size_t GetTypeSize(uint8_t type);
+
+    // Defaults and validation
+    static void LoadDefaults(LaserHarpConfig* config);
+    static bool Validate(const LaserHarpConfig& config);
+    static void Clamp(LaserHarpConfig* config);
+
+    // Parameter access by id (values are converted to and from float)
+    static bool GetValue(const LaserHarpConfig& config, uint8_t id, uint8_t index, float* value);
+    static bool SetValue(LaserHarpConfig* config, uint8_t id, uint8_t index, float value);
+
+    // Serialization
+    static const size_t MAX_SERIALIZED_SIZE = 256;
+    static size_t Serialize(const LaserHarpConfig& config, uint8_t* buffer, size_t size);
+    static bool Deserialize(const uint8_t* buffer, size_t length, LaserHarpConfig* config);
+
+private:
+    static float ReadElement(const uint8_t* data, uint8_t type);
+    static void WriteElement(uint8_t* data, uint8_t type, float value);
+    static float ClampToField(const ConfigField& field, float value);
+};
\ No newline at end of file
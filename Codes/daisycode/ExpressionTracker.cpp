@@ -0,0 +1,86 @@
+#include "ExpressionTracker.h"
+#include <cmath>
+
+// Constants
+const float SLOPE_FULL_SCALE = 0.025f;      // Threshold fractions per ms for velocity 127 (full break in 40ms)
+const float PRESSURE_SMOOTHING = 0.5f;      // One-pole smoothing of the depth, per visit
+const uint32_t SCAN_TIMEOUT_US = 250000;    // An older visit says nothing about the entry speed
+
+// Constructor
+ExpressionTracker::ExpressionTracker() {
+    Reset();
+}
+
+// Destructor
+ExpressionTracker::~ExpressionTracker() {
+}
+
+// Tracking
+void ExpressionTracker::Reset() {
+    for (int i = 0; i < MAX_BEAMS; i++) {
+        beams_[i].lastValue = 0.0f;
+        beams_[i].lastTime = 0;
+        beams_[i].slope = 0.0f;
+        beams_[i].depth = 0.0f;
+        beams_[i].valid = false;
+    }
+}
+
+void ExpressionTracker::AddScan(uint8_t beam, float value, float threshold, uint32_t timeUs) {
+    if (beam >= MAX_BEAMS) {
+        return;
+    }
+
+    BeamTrack& track = beams_[beam];
+    track.slope = FallRate(track, value, threshold, timeUs);
+    track.depth += PRESSURE_SMOOTHING * (Depth(value, threshold) - track.depth);
+    track.lastValue = value;
+    track.lastTime = timeUs;
+    track.valid = true;
+}
+
+// Expression
+// A hand entering slowly spreads the fall over several visits, so the faster of
+// the last two intervals counts. Without a recent visit the depth is used instead.
+uint8_t ExpressionTracker::GetVelocity(uint8_t beam, float value, float threshold, uint32_t timeUs) const {
+    if (beam >= MAX_BEAMS) {
+        return 1;
+    }
+
+    const BeamTrack& track = beams_[beam];
+    float amount;
+    if (track.valid && timeUs - track.lastTime < SCAN_TIMEOUT_US) {
+        float slope = fmaxf(FallRate(track, value, threshold, timeUs), track.slope);
+        amount = sqrtf(fminf(1.0f, slope / SLOPE_FULL_SCALE));
+    } else {
+        float depth = Depth(value, threshold);
+        amount = depth * depth;
+    }
+
+    return (uint8_t)(amount * 126.0f) + 1;
+}
+
+uint8_t ExpressionTracker::GetPressure(uint8_t beam) const {
+    if (beam >= MAX_BEAMS) {
+        return 0;
+    }
+    return (uint8_t)(beams_[beam].depth * 127.0f + 0.5f);
+}
+
+// Private methods
+float ExpressionTracker::Depth(float value, float threshold) {
+    if (threshold <= 0.0f) {
+        return 0.0f;
+    }
+    float depth = (threshold - value) / threshold;
+    return fmaxf(0.0f, fminf(1.0f, depth));
+}
+
+float ExpressionTracker::FallRate(const BeamTrack& track, float value, float threshold, uint32_t timeUs) {
+    uint32_t elapsed = timeUs - track.lastTime;
+    if (!track.valid || elapsed == 0 || elapsed >= SCAN_TIMEOUT_US || threshold <= 0.0f) {
+        return 0.0f;
+    }
+    float fall = (track.lastValue - value) / threshold;
+    return fmaxf(0.0f, fall) / (elapsed * 0.001f);
+}
\ No newline at end of file
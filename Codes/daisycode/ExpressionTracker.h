@@ -0,0 +1,37 @@
+#pragma once
+#include <stdint.h>
+
+// Continuous expression from the filtered LDR signal of each beam. The scanner
+// visits a beam once per sweep and reports the settled value of every visit;
+// velocity comes from how fast the signal falls across visits (how fast the
+// hand enters), pressure from how deep the beam stays broken.
+class ExpressionTracker {
+public:
+    ExpressionTracker();
+    ~ExpressionTracker();
+
+    static const uint8_t MAX_BEAMS = 16;
+
+    // Tracking
+    void Reset();
+    void AddScan(uint8_t beam, float value, float threshold, uint32_t timeUs);
+
+    // Expression
+    uint8_t GetVelocity(uint8_t beam, float value, float threshold, uint32_t timeUs) const;
+    uint8_t GetPressure(uint8_t beam) const;
+
+private:
+    struct BeamTrack {
+        float lastValue;        // Settled value of the previous visit
+        uint32_t lastTime;      // us
+        float slope;            // Fall rate into the previous visit, threshold fractions per ms
+        float depth;            // Smoothed break depth (0.0 - 1.0)
+        bool valid;
+    };
+
+    BeamTrack beams_[MAX_BEAMS];
+
+    // Private methods
+    static float Depth(float value, float threshold);
+    static float FallRate(const BeamTrack& track, float value, float threshold, uint32_t timeUs);
+};
\ No newline at end of file
@@ -2,34 +2,51 @@
 #include <cmath>
 
 // Constants based on Arduino implementation
-const float FILTER_ALPHA = 0.3f;                    // Low-pass filter coefficient
 const uint32_t DEBOUNCE_TIME_MS = 5;                // Debounce time in milliseconds
 const uint32_t SENSOR_UPDATE_INTERVAL_US = 200;     // 200us = 5kHz update rate
-const uint16_t DEFAULT_THRESHOLD = 700;             // From Arduino: analogVal <= 700
+const float MIN_LASER_SIGNAL = 20.0f;               // Weaker intact beams are not evaluated
+const float MIN_DEVIATION = 4.0f;                   // Noise floor of the visit statistics
+const uint16_t MIN_VISITS = 4;                      // Visits before a learned threshold is used
+const uint16_t CALIBRATION_VISITS = 32;             // Intact visits per beam to end a calibration
+const uint16_t STATISTICS_WINDOW = 128;             // Visits remembered by the drift tracking
+// Visit timing for an LDR that rises with a time constant up to 0.5 ms and
+// decays with one up to 2 ms (the replay test models both). The lit readings
+// wait 3 rise time constants (95%). The move between beams (4.2 ms with 7
+// beams, 5 ms with 6) is over 2 decay time constants, so the previous beam's
+// light is down to 12% or less when the ambient readings start. Both windows are short and close together: flicker
+// changes little between them.
+const uint32_t AMBIENT_TIME_US = 500;               // Laser off sampling at the start of a visit
+const uint32_t SETTLE_TIME_US = 1500;               // LDR rise after the laser turns on
+const uint32_t LIT_TIME_US = 500;                   // Laser on sampling after the rise
 const int STEPS_PER_REVOLUTION = 200;               // Arduino: stepsPerRev = 200
 const int DEFAULT_BEAMS = 6;                        // Arduino: corde = 6
 const int PULSE_WIDTH_US = 50;                      // Arduino: pulseWidthMicros = 50
 const int STEP_DELAY_US = 100;                      // Arduino: millisBtwnSteps = 100
-const int BEAM_CHECK_TIME_MS = 3;                   // Arduino: tempo = 3
 
 // Constructor
 LaserBeamManager::LaserBeamManager() 
     : hardware_(nullptr), config_(nullptr), currentServoPosition_(0.0f), 
       targetServoPosition_(0.0f), lastServoUpdate_(0), servoState_(SERVO_IDLE),
-      servoDirection_(1.0f), eventQueueHead_(0), eventQueueTail_(0), 
-      eventQueueCount_(0), isCalibrating_(false), calibrationBeam_(0),
-      calibrationSampleCount_(0), lastUpdateTime_(0), updateInterval_(SENSOR_UPDATE_INTERVAL_US) {
+      servoDirection_(1.0f), isCalibrating_(false),
+      calibrationRequested_(false), lastUpdateTime_(0),
+      updateInterval_(SENSOR_UPDATE_INTERVAL_US),
+      configVersion_(0) {
     
     // Initialize arrays with Arduino-based defaults
     for (int i = 0; i < 16; i++) {
         sensorValues_[i] = 0.0f;
-        filteredValues_[i] = 1000.0f;              // Start above threshold
+        ambientValues_[i] = 0.0f;
+        filteredValues_[i] = 0.0f;
         beamStates_[i] = true;                     // Beam not broken initially
         previousStates_[i] = true;
         lastStateChange_[i] = 0;
-        thresholds_[i] = DEFAULT_THRESHOLD;        // Arduino threshold
+        thresholds_[i] = 0;
+        lastPressure_[i] = 0;
     }
     
+    // Thresholds are learned on the first intact visits
+    ResetCalibrationData();
+    
     // Initialize stepper motor variables
     currentStepPosition_ = 0;
     targetStepPosition_ = 0;
@@ -39,7 +56,12 @@ LaserBeamManager::LaserBeamManager()
     stepsPerBeam_ = STEPS_PER_REVOLUTION / DEFAULT_BEAMS;  // Arduino: cordemezzi = stepsPerRev/corde
     atBeamPosition_ = false;
     beamCheckStartTime_ = 0;
+    ambientSum_ = 0.0f;
+    ambientCount_ = 0;
+    litSum_ = 0.0f;
+    litCount_ = 0;
     laserState_ = false;
+    stepHigh_ = false;
     
     // Initialize GPIO pin structures
     stepPin_ = {};
@@ -65,29 +87,38 @@ void LaserBeamManager::Init(daisy::DaisySeed* hw, ConfigManager* config) {
     
     // Load configuration
     if (config_) {
+        configVersion_ = config_->GetVersion();
         LoadConfigurationParameters();
     }
     
-    // Start in scanning mode
+    // Start in scanning mode, driven from here on by the update interrupt
     StartScanning();
+    InitializeTimer();
 }
 
-// Main update function - Non-blocking state machine
+// Main update function - Non-blocking state machine, runs in the timer interrupt
 void LaserBeamManager::Update() {
-    uint32_t currentTime = daisy::System::GetNow();
+    uint32_t currentTime = daisy::System::GetUs();
+    
+    // Follow threshold and beam count changes. The main loop cannot publish
+    // while this interrupt runs, so the snapshot stays valid meanwhile.
+    if (config_ && config_->GetVersion() != configVersion_) {
+        configVersion_ = config_->GetVersion();
+        LoadConfigurationParameters();
+    }
+    
+    if (calibrationRequested_.exchange(false, std::memory_order_acquire)) {
+        BeginCalibration();
+    }
+    
+    // Stepper motion keeps its own step timing
+    UpdateServo();
     
     // Check if it's time to update
     if ((currentTime - lastUpdateTime_) >= updateInterval_) {
         
-        // Always read sensors at high frequency
+        // Readings are averaged per visit, the beam is judged at its end
         ReadSensors();
-        FilterSensorValues();
-        
-        // Update stepper motor position
-        UpdateServo();
-        
-        // Process beam state changes
-        ProcessBeamStates();
         DetectBeamEvents();
         
         // Handle calibration if active
@@ -101,44 +132,54 @@ void LaserBeamManager::Update() {
 
 // Event management
 bool LaserBeamManager::HasEvents() {
-    return eventQueueCount_ > 0;
+    return !events_.IsEmpty();
 }
 
 bool LaserBeamManager::GetNextEvent(BeamEvent* event) {
-    // TODO: Implement event dequeue
-    if (eventQueueCount_ == 0) {
-        return false;
-    }
-    
-    *event = eventQueue_[eventQueueHead_];
-    eventQueueHead_ = (eventQueueHead_ + 1) % EVENT_QUEUE_SIZE;
-    eventQueueCount_--;
-    return true;
+    return events_.Pop(event);
 }
 
+// Drops the waiting events, only the consumer index moves
 void LaserBeamManager::ClearEvents() {
-    eventQueueHead_ = 0;
-    eventQueueTail_ = 0;
-    eventQueueCount_ = 0;
+    events_.Clear();
+}
+
+uint32_t LaserBeamManager::GetEventOverflowCount() const {
+    return events_.GetOverflowCount();
 }
 
-// Calibration functions
+uint8_t LaserBeamManager::GetEventHighWater() const {
+    return events_.GetHighWater();
+}
+
+// Calibration functions: the beams must be left clear until the calibration
+// ends, other beams keep being detected meanwhile. The start only raises a
+// request, Update() is the one producer of the event queue.
 void LaserBeamManager::StartCalibration() {
-    // TODO: Implement calibration start
+    calibrationRequested_.store(true, std::memory_order_release);
+}
+
+void LaserBeamManager::BeginCalibration() {
+    ResetCalibrationData();
+    
+    // Release held beams, without statistics they would not be restored
+    for (int i = 0; i < 16; i++) {
+        if (!beamStates_[i]) {
+            beamStates_[i] = true;
+            lastStateChange_[i] = daisy::System::GetUs();
+            QueueEvent(BEAM_RESTORED, i, 0, filteredValues_[i]);
+            lastPressure_[i] = 0;
+        }
+    }
     isCalibrating_ = true;
 }
 
 void LaserBeamManager::EndCalibration() {
-    // TODO: Implement calibration end
     isCalibrating_ = false;
 }
 
 bool LaserBeamManager::IsCalibrating() {
-    return isCalibrating_;
-}
-
-void LaserBeamManager::CalibrateCurrentBeam() {
-    // TODO: Implement current beam calibration
+    return isCalibrating_ || calibrationRequested_.load(std::memory_order_acquire);
 }
 
 // Servo control
@@ -153,7 +194,7 @@ void LaserBeamManager::StartScanning() {
     // Reset sensor states
     for (int i = 0; i < 16; i++) {
         beamStates_[i] = true; // Not broken initially
-        lastStateChange_[i] = daisy::System::GetNow();
+        lastStateChange_[i] = daisy::System::GetUs();
     }
 }
 
@@ -202,33 +243,29 @@ uint32_t LaserBeamManager::GetLastUpdateTime() {
 }
 
 uint8_t LaserBeamManager::GetActiveBeamCount() {
-    return config_ ? config_->GetConfig()->numBeams : DEFAULT_BEAMS;
-}
-
-bool LaserBeamManager::SelfTest() {
-    // TODO: Implement self test
-    return true;
+    return config_ ? config_->GetSnapshot()->numBeams : DEFAULT_BEAMS;
 }
 
 // Private methods - Hardware initialization and core functionality
 
 // Initialize stepper motor (replaces Arduino stepper setup)
 void LaserBeamManager::InitializeServo() {
-    // Configure step pin (equivalent to Arduino stepYPin = 3)
+    // Configure step pin (equivalent to Arduino stepYPin = 2)
     daisy::GPIO::Config step_cfg;
-    step_cfg.pin = daisy::seed::D0;  // Use Daisy Seed pin D3
+    step_cfg.pin = daisy::seed::D0;  // Use Daisy Seed pin D0
     step_cfg.mode = daisy::GPIO::Mode::OUTPUT;
     stepPin_.Init(step_cfg);
     
-    // Configure direction pin (equivalent to Arduino dirYPin = 6)  
+    // Configure direction pin (equivalent to Arduino dirYPin = 5)  
     daisy::GPIO::Config dir_cfg;
-    dir_cfg.pin = daisy::seed::D1;   // Use Daisy Seed pin D6
+    dir_cfg.pin = daisy::seed::D1;   // Use Daisy Seed pin D1
     dir_cfg.mode = daisy::GPIO::Mode::OUTPUT;
     dirPin_.Init(dir_cfg);
     
     // Initialize pins to LOW
     stepPin_.Write(false);
-    dirPin_.Write(false);
+    dirPin_.Write(true);            // Forward, the first move
+    stepHigh_ = false;
     
     // Initialize position tracking
     currentStepPosition_ = 0;
@@ -265,6 +302,23 @@ void LaserBeamManager::InitializeGPIO() {
     InitializeLaser();
 }
 
+// Update() at UPDATE_RATE_HZ from TIM5: a 50 us tick keeps the 50 us step
+// pulse and the 150 us step period of the Arduino
+void LaserBeamManager::InitializeTimer() {
+    daisy::TimerHandle::Config timerConfig;
+    timerConfig.periph = daisy::TimerHandle::Config::Peripheral::TIM_5;
+    timerConfig.dir = daisy::TimerHandle::Config::CounterDir::UP;
+    timerConfig.enable_irq = true;
+    updateTimer_.Init(timerConfig);
+    updateTimer_.SetPeriod(updateTimer_.GetFreq() / UPDATE_RATE_HZ - 1);
+    updateTimer_.SetCallback(TimerCallback, this);
+    updateTimer_.Start();
+}
+
+void LaserBeamManager::TimerCallback(void* data) {
+    static_cast<LaserBeamManager*>(data)->Update();
+}
+
 // Set laser state
 void LaserBeamManager::SetLaserState(bool on) {
     laserPin_.Write(on);
@@ -273,17 +327,13 @@ void LaserBeamManager::SetLaserState(bool on) {
 
 // Non-blocking stepper motor update (replaces Arduino blocking for-loops)
 void LaserBeamManager::UpdateServo() {
-    uint32_t currentTime = daisy::System::GetNow();
+    uint32_t currentTime = daisy::System::GetUs();
     
     switch (servoState_) {
         case SERVO_SCANNING:
             UpdateScanningMotion(currentTime);
             break;
             
-        case SERVO_CALIBRATING:
-            UpdateCalibrationMotion(currentTime);
-            break;
-            
         case SERVO_IDLE:
             // Motor stopped
             break;
@@ -294,90 +344,95 @@ void LaserBeamManager::UpdateServo() {
     }
 }
 
-// Update motion during calibration
-void LaserBeamManager::UpdateCalibrationMotion(uint32_t currentTime) {
-    // For calibration, move slowly and methodically
-    // TODO: Implement specific calibration motion
-    UpdateScanningMotion(currentTime);
-}
-
-// Improved scanning motion (non-blocking version of Arduino loop)
+// Improved scanning motion (non-blocking version of Arduino loop):
+// move -> ambient with the laser off -> laser on, settle, lit readings -> judge
+// the beam, laser off -> next beam, times in us
 void LaserBeamManager::UpdateScanningMotion(uint32_t currentTime) {
-    // Check if it's time to make a step
-    if ((currentTime - lastStepTime_) >= STEP_DELAY_US) {
-        
-        // Make one step
-        MakeStep();
-        lastStepTime_ = currentTime;
-        
-        // Check if we completed movement to current beam position
-        if (HasReachedTargetPosition()) {
-            
-            // Turn on laser and check sensor
+    // End of the step pulse
+    if (stepHigh_) {
+        if ((currentTime - lastStepTime_) < PULSE_WIDTH_US) return;
+        stepPin_.Write(false);
+        stepHigh_ = false;
+    }
+    
+    if (atBeamPosition_) {
+        // Ambient first, ReadSensors() averages it while the laser is still off
+        if (!laserState_) {
+            if ((currentTime - beamCheckStartTime_) < AMBIENT_TIME_US || ambientCount_ == 0) return;
+            ambientValues_[currentBeamIndex_] = ambientSum_ / ambientCount_;
+            litSum_ = 0.0f;
+            litCount_ = 0;
             SetLaserState(true);
-            
-            // Mark that we're at a beam position for sensor reading
-            atBeamPosition_ = true;
             beamCheckStartTime_ = currentTime;
-            
-            // Calculate next target position
-            CalculateNextBeamPosition();
+            return;
         }
         
-        // If we've been at beam position long enough, move to next
-        if (atBeamPosition_ && (currentTime - beamCheckStartTime_) >= BEAM_CHECK_TIME_MS * 1000) { // Convert ms to us
-            SetLaserState(false);
-            atBeamPosition_ = false;
-            currentBeamIndex_ = GetCurrentBeamIndex();
-        }
+        // Dwell with the laser on, ReadSensors() averages the readings after the rise
+        if ((currentTime - beamCheckStartTime_) < SETTLE_TIME_US + LIT_TIME_US || litCount_ == 0) return;
+        FilterSensorValues();
+        ProcessBeamStates();
+        FinishBeamVisit(currentBeamIndex_);
+        SetLaserState(false);
+        atBeamPosition_ = false;
+        
+        // Only now move on, readings up to here belong to the beam just visited
+        CalculateNextBeamPosition();
+        return;
+    }
+    
+    if (HasReachedTargetPosition()) {
+        // Sample the ambient light before turning on the laser
+        atBeamPosition_ = true;
+        beamCheckStartTime_ = currentTime;
+        ambientSum_ = 0.0f;
+        ambientCount_ = 0;
+        return;
+    }
+    
+    // Step period as on the Arduino: pulse width + delay between steps
+    if ((currentTime - lastStepTime_) >= PULSE_WIDTH_US + STEP_DELAY_US) {
+        MakeStep(currentTime);
     }
 }
 
-// Make a single stepper motor step (non-blocking)
-void LaserBeamManager::MakeStep() {
-    // Set direction
-    dirPin_.Write(scanDirection_ > 0);
-    
-    // Generate step pulse
+// Start a step pulse, UpdateScanningMotion() ends it after PULSE_WIDTH_US
+void LaserBeamManager::MakeStep(uint32_t currentTime) {
     stepPin_.Write(true);
-    daisy::System::DelayUs(PULSE_WIDTH_US); // 50us pulse width
-    stepPin_.Write(false);
+    stepHigh_ = true;
+    lastStepTime_ = currentTime;
     
     // Update position
     currentStepPosition_ += scanDirection_;
 }
 
-// Calculate next beam position (replaces Arduino direction logic)
+// Calculate next beam position (replaces Arduino direction logic), the end
+// beams are visited once per round trip
 void LaserBeamManager::CalculateNextBeamPosition() {
-    int beamsPerDirection = config_ ? config_->GetConfig()->numBeams : DEFAULT_BEAMS;
+    int beamsPerDirection = GetActiveBeamCount();
     
-    if (scanDirection_ > 0) {
-        // Moving forward
-        if (currentBeamIndex_ >= (beamsPerDirection - 1)) {
+    if (beamsPerDirection < 2) {
+        currentBeamIndex_ = 0;
+    } else {
+        if (scanDirection_ > 0 && currentBeamIndex_ >= (beamsPerDirection - 1)) {
             // Reached end, reverse direction
             scanDirection_ = -1;
-            currentBeamIndex_ = beamsPerDirection - 1;
-        } else {
-            currentBeamIndex_++;
-        }
-    } else {
-        // Moving backward  
-        if (currentBeamIndex_ <= 0) {
+        } else if (scanDirection_ < 0 && currentBeamIndex_ == 0) {
             // Reached start, reverse direction
             scanDirection_ = 1;
-            currentBeamIndex_ = 0;
-        } else {
-            currentBeamIndex_--;
         }
+        currentBeamIndex_ += scanDirection_;
     }
     
+    // Direction is set well before the first step pulse
+    dirPin_.Write(scanDirection_ > 0);
+    
     // Calculate target step position for this beam
     targetStepPosition_ = currentBeamIndex_ * stepsPerBeam_;
 }
 
 // Check if motor reached target position
 bool LaserBeamManager::HasReachedTargetPosition() {
-    return abs(currentStepPosition_ - targetStepPosition_) <= 1;
+    return currentStepPosition_ == targetStepPosition_;
 }
 
 // Get next beam index in sequence
@@ -392,15 +447,23 @@ void LaserBeamManager::ReadSensors() {
     
     // Convert to Arduino-equivalent scale (0-1023)
     sensorValues_[currentBeamIndex_] = rawValue * 1023.0f;
+    
+    if (atBeamPosition_ && !laserState_) {
+        ambientSum_ += sensorValues_[currentBeamIndex_];
+        ambientCount_++;
+    } else if (atBeamPosition_ && (daisy::System::GetUs() - beamCheckStartTime_) >= SETTLE_TIME_US) {
+        litSum_ += sensorValues_[currentBeamIndex_];
+        litCount_++;
+    }
 }
 
-// Apply filtering to reduce noise
+// Laser contribution of the visit: the lit average minus the ambient average.
+// A filter over the whole dwell would follow the LDR's rise and take early
+// readings for a broken beam.
 void LaserBeamManager::FilterSensorValues() {
-    if (atBeamPosition_ && laserState_) {
-        // Only process when laser is on and we're at beam position
-        ApplyLowPassFilter(&filteredValues_[currentBeamIndex_], 
-                          sensorValues_[currentBeamIndex_], 
-                          FILTER_ALPHA);
+    if (atBeamPosition_ && laserState_ && litCount_ > 0) {
+        uint8_t beamIndex = currentBeamIndex_;
+        filteredValues_[beamIndex] = litSum_ / litCount_ - ambientValues_[beamIndex];
     }
 }
 
@@ -412,28 +475,36 @@ void LaserBeamManager::ProcessBeamStates() {
     
     uint8_t beamIndex = currentBeamIndex_;
     float sensorValue = filteredValues_[beamIndex];
-    uint16_t threshold = thresholds_[beamIndex];
+    float threshold = GetThreshold(beamIndex);
+    if (threshold <= 0.0f) {
+        return; // Beam level not learned yet
+    }
     
-    // Determine beam state (Arduino: analogVal <= 700)
-    bool beamBroken = (sensorValue <= threshold);
-    bool previousState = beamStates_[beamIndex];
+    // Determine beam state, a broken beam loses its laser contribution. A held
+    // beam is only restored well above the threshold, so a hand resting on it
+    // does not retrigger the note.
+    bool previousState = !beamStates_[beamIndex];   // beamStates_ is true while intact
+    bool beamBroken = previousState ? (sensorValue < GetRestoreThreshold(beamIndex, threshold))
+                                    : (sensorValue <= threshold);
     
     // Check for state change with debouncing
-    uint32_t currentTime = daisy::System::GetNow();
+    uint32_t currentTime = daisy::System::GetUs();
     if (beamBroken != previousState) {
         if ((currentTime - lastStateChange_[beamIndex]) > DEBOUNCE_TIME_MS * 1000) { // Convert ms to us
             // State change confirmed
-            beamStates_[beamIndex] = beamBroken;
+            beamStates_[beamIndex] = !beamBroken;
             lastStateChange_[beamIndex] = currentTime;
             
             // Generate event
             if (beamBroken && !previousState) {
-                // Beam just broken
-                uint8_t velocity = CalculateVelocity(sensorValue, beamIndex);
+                // Beam just broken, velocity from how fast the signal fell since the last visits
+                uint8_t velocity = expression_.GetVelocity(beamIndex, sensorValue, threshold,
+                                                           daisy::System::GetUs());
                 QueueEvent(BEAM_BROKEN, beamIndex, velocity, sensorValue);
             } else if (!beamBroken && previousState) {
                 // Beam restored
                 QueueEvent(BEAM_RESTORED, beamIndex, 0, sensorValue);
+                lastPressure_[beamIndex] = 0;
             }
         }
     }
@@ -443,7 +514,7 @@ void LaserBeamManager::ProcessBeamStates() {
 void LaserBeamManager::LoadConfigurationParameters() {
     if (!config_) return;
     
-    LaserHarpConfig* cfg = config_->GetConfig();
+    const LaserHarpConfig* cfg = config_->GetSnapshot();
     
     // Update number of beams
     if (cfg->numBeams > 0 && cfg->numBeams <= 16) {
@@ -451,58 +522,57 @@ void LaserBeamManager::LoadConfigurationParameters() {
         stepsPerBeam_ = STEPS_PER_REVOLUTION / cfg->numBeams; // Maintain Arduino logic
     }
     
-    // Update thresholds if configured
-    for (int i = 0; i < cfg->numBeams; i++) {
-        if (cfg->sensorThresholds[i] > 0) {
-            thresholds_[i] = cfg->sensorThresholds[i];
-        }
+    // Update thresholds, 0 = from the learned beam level
+    for (int i = 0; i < 16; i++) {
+        thresholds_[i] = cfg->sensorThresholds[i];
     }
 }
 
-// Improved velocity calculation
-uint8_t LaserBeamManager::CalculateVelocity(float analogValue, uint8_t beamIndex) {
-    float threshold = (float)thresholds_[beamIndex];
-    
-    // How far below threshold (deeper break = higher velocity)
-    float breakDepth = (threshold - analogValue) / threshold;
-    breakDepth = fmaxf(0.0f, fminf(1.0f, breakDepth)); // Clamp 0-1
+// Effective threshold of a beam, 0 while it is not learned
+float LaserBeamManager::GetThreshold(uint8_t beamIndex) {
+    if (thresholds_[beamIndex] > 0) {
+        return thresholds_[beamIndex];
+    }
+    return learnedThresholds_[beamIndex];
+}
+
+// Restore point of a broken beam, halfway from the threshold to the intact
+// level. With the threshold at half the level this is the Arduino pair: broken
+// below 50%, restored above 75%.
+float LaserBeamManager::GetRestoreThreshold(uint8_t beamIndex, float threshold) {
+    const BeamStatistics& intact = intactStats_[beamIndex];
+    float level = (intact.count >= MIN_VISITS && intact.mean > threshold) ? intact.mean
+                                                                          : 2.0f * threshold;
+    return 0.5f * (threshold + level);
+}
+
+// End of a visit: feed the settled value to the expression tracker and report
+// pressure changes of a held beam. Coalescing towards MIDI happens in MidiController.
+void LaserBeamManager::FinishBeamVisit(uint8_t beamIndex) {
+    UpdateStatistics(beamIndex);
     
-    // Apply curve for musical response
-    float velocity = breakDepth * breakDepth; // Square for exponential feel
+    expression_.AddScan(beamIndex, filteredValues_[beamIndex], GetThreshold(beamIndex),
+                        daisy::System::GetUs());
     
-    // Convert to MIDI velocity (1-127)
-    uint8_t midiVel = (uint8_t)(velocity * 126.0f) + 1;
-    return midiVel;
+    if (!beamStates_[beamIndex]) {
+        uint8_t pressure = expression_.GetPressure(beamIndex);
+        if (pressure != lastPressure_[beamIndex]) {
+            lastPressure_[beamIndex] = pressure;
+            QueueEvent(BEAM_PRESSURE, beamIndex, pressure, filteredValues_[beamIndex]);
+        }
+    }
 }
 
-// Queue event (thread-safe)
+// Queue event (producer side, lock-free)
 void LaserBeamManager::QueueEvent(BeamEventType type, uint8_t beam, uint8_t velocity, float analogValue) {
-    if (IsEventQueueFull()) {
-        return; // Drop event if queue full
-    }
-    
-    // Create event
+    // Dropped and counted as overflow if the queue is full
     BeamEvent event;
     event.type = type;
     event.beamIndex = beam;
     event.velocity = velocity;
-    event.timestamp = daisy::System::GetNow();
+    event.timestamp = daisy::System::GetUs();
     event.analogValue = analogValue;
-    
-    // Add to queue
-    eventQueue_[eventQueueTail_] = event;
-    eventQueueTail_ = (eventQueueTail_ + 1) % EVENT_QUEUE_SIZE;
-    eventQueueCount_++;
-}
-
-// Apply low pass filter (anti-noise)
-void LaserBeamManager::ApplyLowPassFilter(float* value, float newValue, float alpha) {
-    *value = alpha * newValue + (1.0f - alpha) * (*value);
-}
-
-// Check if event queue is full
-bool LaserBeamManager::IsEventQueueFull() {
-    return eventQueueCount_ >= EVENT_QUEUE_SIZE;
+    events_.Push(event);
 }
 
 void LaserBeamManager::CalculateServoPosition() {
@@ -522,44 +592,83 @@ void LaserBeamManager::QueueEvent(BeamEventType type, uint8_t beam, uint8_t velo
     QueueEvent(type, beam, velocity, 0.0f);
 }
 
+// Samples are taken per visit in FinishBeamVisit(), the calibration is complete
+// once every active beam has been seen intact often enough
 void LaserBeamManager::ProcessCalibration() {
-    // TODO: Implement calibration processing
     if (!isCalibrating_) return;
     
-    // Store calibration samples for current beam
-    if (calibrationSampleCount_ < 100) {
-        calibrationValues_[calibrationBeam_][calibrationSampleCount_] = sensorValues_[calibrationBeam_];
-        calibrationSampleCount_++;
+    uint8_t numBeams = GetActiveBeamCount();
+    for (int i = 0; i < numBeams && i < 16; i++) {
+        if (intactStats_[i].count < CALIBRATION_VISITS) return;
+    }
+    EndCalibration();
+}
+
+// Feed the settled value of a visit to the statistics of the state the beam
+// was in. Visits with a state change are mixed and skipped. The statistics keep
+// learning during play, so the thresholds follow slow laser and alignment drift.
+void LaserBeamManager::UpdateStatistics(uint8_t beamIndex) {
+    uint32_t currentTime = daisy::System::GetUs();
+    if ((currentTime - lastStateChange_[beamIndex]) <= (currentTime - beamCheckStartTime_)) {
+        return;
+    }
+    
+    if (beamStates_[beamIndex]) {
+        AddToStatistics(&intactStats_[beamIndex], filteredValues_[beamIndex], STATISTICS_WINDOW);
     } else {
-        // Calculate threshold for this beam
-        CalculateThresholds();
-        
-        // Move to next beam
-        calibrationBeam_++;
-        calibrationSampleCount_ = 0;
-        
-        if (calibrationBeam_ >= GetActiveBeamCount()) {
-            // Calibration complete
-            EndCalibration();
-        }
+        AddToStatistics(&brokenStats_[beamIndex], filteredValues_[beamIndex], STATISTICS_WINDOW);
     }
+    learnedThresholds_[beamIndex] = CalculateThreshold(beamIndex);
 }
 
-void LaserBeamManager::CalculateThresholds() {
-    // Calculate average and set threshold
-    float sum = 0.0f;
-    for (int i = 0; i < calibrationSampleCount_; i++) {
-        sum += calibrationValues_[calibrationBeam_][i];
+// Threshold between the intact and broken distributions, at the same number
+// of deviations from both means. Until broken visits are known the broken
+// distribution is taken as no contribution with the intact deviation.
+float LaserBeamManager::CalculateThreshold(uint8_t beamIndex) {
+    const BeamStatistics& intact = intactStats_[beamIndex];
+    const BeamStatistics& broken = brokenStats_[beamIndex];
+    if (intact.count < MIN_VISITS || intact.mean < MIN_LASER_SIGNAL) {
+        return 0.0f;
+    }
+    
+    float intactDeviation = GetDeviation(intact);
+    float brokenMean = 0.0f;
+    float brokenDeviation = intactDeviation;
+    if (broken.count >= MIN_VISITS && broken.mean < intact.mean) {
+        brokenMean = broken.mean;
+        brokenDeviation = GetDeviation(broken);
     }
-    float average = sum / calibrationSampleCount_;
     
-    // Set threshold slightly below average (85% of average)
-    thresholds_[calibrationBeam_] = (uint16_t)(average * 0.85f);
+    return (brokenMean * intactDeviation + intact.mean * brokenDeviation) /
+           (intactDeviation + brokenDeviation);
 }
 
 void LaserBeamManager::ResetCalibrationData() {
-    calibrationBeam_ = 0;
-    calibrationSampleCount_ = 0;
+    for (int i = 0; i < 16; i++) {
+        intactStats_[i] = {};
+        brokenStats_[i] = {};
+        learnedThresholds_[i] = 0.0f;
+    }
+}
+
+// Welford update, once the window is full the count stays and every visit
+// has the weight 1 / window
+void LaserBeamManager::AddToStatistics(BeamStatistics* stats, float value, uint16_t window) {
+    float delta = value - stats->mean;
+    if (stats->count < window) {
+        stats->count++;
+        stats->mean += delta / stats->count;
+        stats->m2 += delta * (value - stats->mean);
+    } else {
+        float alpha = 1.0f / window;
+        stats->mean += alpha * delta;
+        stats->m2 = (1.0f - alpha) * (stats->m2 + delta * delta);
+    }
+}
+
+float LaserBeamManager::GetDeviation(const BeamStatistics& stats) {
+    float variance = stats.count > 0 ? stats.m2 / stats.count : 0.0f;
+    return fmaxf(sqrtf(variance), MIN_DEVIATION);
 }
 
 float LaserBeamManager::MapAngleToBeam(float angle, uint8_t numBeams) {
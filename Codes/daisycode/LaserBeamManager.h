@@ -1,11 +1,15 @@
 #pragma once
+#include <atomic>
 #include "daisy_seed.h"
 #include "ConfigManager.h"
+#include "ExpressionTracker.h"
+#include "SpscQueue.h"
 
 // Event types for beam interruptions
 enum BeamEventType {
     BEAM_BROKEN,        // Beam was interrupted
     BEAM_RESTORED,      // Beam was restored
+    BEAM_PRESSURE,      // Break depth of a held beam changed (poly aftertouch)
     BEAM_CALIBRATION    // Calibration event
 };
 
@@ -13,16 +17,23 @@ enum BeamEventType {
 struct BeamEvent {
     BeamEventType type;     // Type of event
     uint8_t beamIndex;      // Which beam (0-15)
-    uint8_t velocity;       // Velocity/intensity (0-127)
-    uint32_t timestamp;     // When the event occurred
+    uint8_t velocity;       // Velocity (BEAM_BROKEN) or pressure (BEAM_PRESSURE), 0-127
+    uint32_t timestamp;     // When the event occurred (us)
     float analogValue;      // Raw analog sensor value
 };
 
+// Streaming mean and variance of the visit values of one beam (Welford), the
+// count stops at a window and older visits are then forgotten exponentially
+struct BeamStatistics {
+    float mean;
+    float m2;               // Sum of squared deviations, variance = m2 / count
+    uint16_t count;
+};
+
 // Servo control states
 enum ServoState {
     SERVO_IDLE,
     SERVO_SCANNING,
-    SERVO_CALIBRATING,
     SERVO_ERROR
 };
 
@@ -31,22 +42,26 @@ public:
     LaserBeamManager();
     ~LaserBeamManager();
     
-    // Initialization
+    // Initialization, starts scanning from the update timer
     void Init(daisy::DaisySeed* hw, ConfigManager* config);
     
-    // Main update function (call in main loop)
+    // Scanner state machine, run by a timer interrupt at UPDATE_RATE_HZ so slow
+    // main loop work (flash erases) never stalls the stepper or the sampling
     void Update();
+    static const uint32_t UPDATE_RATE_HZ = 20000;
     
-    // Event management
+    // Event management (consumer side of the event queue, one context only)
     bool HasEvents();
     bool GetNextEvent(BeamEvent* event);
     void ClearEvents();
+    uint32_t GetEventOverflowCount() const;     // Events dropped on a full queue
+    uint8_t GetEventHighWater() const;          // Most events ever waiting
+    static const uint8_t EVENT_QUEUE_SIZE = 32; // Events that can wait, a power of two
     
-    // Calibration functions
+    // Calibration functions, a start is carried out by the next Update()
     void StartCalibration();
     void EndCalibration();
     bool IsCalibrating();
-    void CalibrateCurrentBeam();
     
     // Servo control
     void StartScanning();
@@ -63,15 +78,19 @@ public:
     // Status and diagnostics
     uint32_t GetLastUpdateTime();
     uint8_t GetActiveBeamCount();
-    bool SelfTest();
+    
+    // Test hook: the host replay test follows the mirror and the laser
+    friend class ScannerProbe;
     
 private:
     // Hardware references
     daisy::DaisySeed* hardware_;
     ConfigManager* config_;
     
+    // Update interrupt
+    daisy::TimerHandle updateTimer_;
+    
     // Servo control
-    daisy::TimerHandle servo_;
     float currentServoPosition_;
     float targetServoPosition_;
     uint32_t lastServoUpdate_;
@@ -84,28 +103,33 @@ private:
     
     // Sensor data
     float sensorValues_[16];        // Current analog values
-    float filteredValues_[16];      // Filtered values for stability
+    float ambientValues_[16];       // Average with the laser off at the start of the visit
+    float filteredValues_[16];      // Laser contribution of the last visit (lit - ambient)
     bool beamStates_[16];           // Current beam states (true = beam intact)
     bool previousStates_[16];       // Previous states for edge detection
     uint32_t lastStateChange_[16];  // Timestamp of last state change
-    uint16_t thresholds_[16];       // Per-beam thresholds
+    uint16_t thresholds_[16];       // Per-beam contribution thresholds, 0 = learned threshold
+    float learnedThresholds_[16];   // Between the intact and broken statistics, 0 = not learned
+    
+    // Expression (velocity from entry speed, pressure from depth)
+    ExpressionTracker expression_;
+    uint8_t lastPressure_[16];      // Last pressure reported per beam
     
-    // Event queue
-    static const uint8_t EVENT_QUEUE_SIZE = 32;
-    BeamEvent eventQueue_[EVENT_QUEUE_SIZE];
-    uint8_t eventQueueHead_;
-    uint8_t eventQueueTail_;
-    uint8_t eventQueueCount_;
+    // Event queue (single producer/single consumer). Update() produces in the
+    // timer interrupt, GetNextEvent() and ClearEvents() consume in the main loop.
+    SpscQueue<BeamEvent, EVENT_QUEUE_SIZE> events_;
     
-    // Calibration data
+    // Calibration data, learned from every settled visit (intact and broken
+    // visits separately) and kept up to date during play
     bool isCalibrating_;
-    uint8_t calibrationBeam_;
-    float calibrationValues_[16][100];  // Store multiple readings per beam
-    uint8_t calibrationSampleCount_;
+    std::atomic<bool> calibrationRequested_;    // Set by StartCalibration(), taken by Update()
+    BeamStatistics intactStats_[16];
+    BeamStatistics brokenStats_[16];
     
-    // Timing
+    // Timing (us)
     uint32_t lastUpdateTime_;
     uint32_t updateInterval_;
+    uint32_t configVersion_;    // Config version the parameters were loaded from
     
     // Stepper motor control (from Arduino implementation)
     daisy::GPIO stepPin_;       // Step pin for stepper motor
@@ -113,12 +137,17 @@ private:
     daisy::GPIO laserPin_;      // Laser control pin
     int currentStepPosition_;  // Current step position
     int targetStepPosition_;   // Target step position
-    uint32_t lastStepTime_;    // Last step timestamp
+    uint32_t lastStepTime_;    // Last step timestamp (us)
+    bool stepHigh_;            // Step pulse in progress
     int scanDirection_;        // Scan direction (1 or -1)
     uint8_t currentBeamIndex_; // Current beam being scanned
     int stepsPerBeam_;         // Steps per beam position
     bool atBeamPosition_;      // Whether we're at a beam position
-    uint32_t beamCheckStartTime_; // When we started checking this beam
+    uint32_t beamCheckStartTime_; // When we started checking this beam (laser off, then on)
+    float ambientSum_;         // Laser off readings of the current visit
+    uint16_t ambientCount_;
+    float litSum_;             // Laser on readings of the current visit, after the LDR rise
+    uint16_t litCount_;
     bool laserState_;          // Current laser state
     
     // Private methods
@@ -133,34 +162,39 @@ private:
     void FilterSensorValues();
     void ProcessBeamStates();
     void DetectBeamEvents();
+    void FinishBeamVisit(uint8_t beamIndex);
+    float GetThreshold(uint8_t beamIndex);
+    float GetRestoreThreshold(uint8_t beamIndex, float threshold);
     
     // Event management
     void QueueEvent(BeamEventType type, uint8_t beam, uint8_t velocity);
     void QueueEvent(BeamEventType type, uint8_t beam, uint8_t velocity, float analogValue);
-    bool IsEventQueueFull();
     
     // Calibration helpers
+    void BeginCalibration();
     void ProcessCalibration();
-    void CalculateThresholds();
+    void UpdateStatistics(uint8_t beamIndex);
+    float CalculateThreshold(uint8_t beamIndex);
     void ResetCalibrationData();
+    static void AddToStatistics(BeamStatistics* stats, float value, uint16_t window);
+    static float GetDeviation(const BeamStatistics& stats);
     
     // Utility functions
-    uint8_t CalculateVelocity(float analogValue, uint8_t beamIndex);
     float MapAngleToBeam(float angle, uint8_t numBeams);
     uint8_t GetCurrentBeamIndex();
-    void ApplyLowPassFilter(float* value, float newValue, float alpha);
     
     // Hardware setup
     void InitializeServo();
     void InitializeADC();
     void InitializeGPIO();
+    void InitializeTimer();
+    static void TimerCallback(void* data);
     
     // Additional stepper motor methods
     void InitializeLaser();
     void SetLaserState(bool on);
     void UpdateScanningMotion(uint32_t currentTime);
-    void UpdateCalibrationMotion(uint32_t currentTime);
-    void MakeStep();
+    void MakeStep(uint32_t currentTime);
     void CalculateNextBeamPosition();
     bool HasReachedTargetPosition();
     void LoadConfigurationParameters();
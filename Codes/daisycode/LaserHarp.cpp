@@ -2,12 +2,29 @@
 #include "MidiController.h"
 #include "AudioSynthesizer.h"
 #include "ConfigManager.h"
+#include "PresetBank.h"
+#include "NoteMapper.h"
+#include "SysExProtocol.h"
+#include "NoteScheduler.h"
+#include "Arpeggiator.h"
+#include "Looper.h"
+#include "ExpressionTracker.h"
+#ifdef LASERHARP_SINGLE_MCU
+#include "LaserBeamManager.h"
+#else
+#include "BeamLink.h"
+#endif
 
 // ==============================================================================
 // LASER HARP - Daisy Seed MIDI/Audio Controller
 // ==============================================================================
-// Arduino handles: Stepper motor, laser, LDR sensors, beam detection
-// Daisy handles: 7 digital inputs → MIDI output + Audio synthesis
+// Two-MCU build (default):
+//   Arduino handles: Stepper motor, laser, LDR sensors, beam detection
+//   Daisy handles: beam readings over the UART link (7 digital inputs as fallback,
+//                  the link carries up to 16 beams)
+//                  → MIDI output + Audio synthesis
+// Single-MCU build (make LASERHARP_MODE=single, defines LASERHARP_SINGLE_MCU):
+//   Daisy drives stepper, laser and LDR itself through LaserBeamManager
 // ==============================================================================
 
 using namespace daisy;
@@ -15,21 +32,230 @@ using namespace daisy::seed;
 
 // Hardware
 DaisySeed hardware;
+QspiFlashDevice flashDevice;
 
 // System components
 ConfigManager configManager;
+PresetBank presetBank;
 MidiController midiController;
 AudioSynthesizer audioSynthesizer;
+SysExProtocol sysexProtocol;
+NoteScheduler noteScheduler;
+Arpeggiator arpeggiator;
+Looper looper;
 
-// 7 Digital inputs from Arduino (beam detection signals)
-GPIO beamInputs[7];
-bool beamStates[7];          // Current state of each beam
-bool previousBeamStates[7];  // Previous state for edge detection
-uint32_t lastDebounceTime[7]; // Debounce timing
+const uint8_t MAX_BEAMS = NoteMapper::MAX_BEAMS;
+bool beamStates[MAX_BEAMS];          // Current state of each beam
+bool previousBeamStates[MAX_BEAMS];  // Previous state for edge detection
+
+#ifdef LASERHARP_SINGLE_MCU
+// Stepper, laser and LDR on the Daisy, beam events straight from the scanner
+LaserBeamManager beamManager;
+#else
+// 7 Digital inputs from Arduino (beam detection signals), only D0-D6 are wired
+const uint8_t FALLBACK_INPUTS = 7;
+GPIO beamInputs[FALLBACK_INPUTS];
+uint32_t lastDebounceTime[FALLBACK_INPUTS]; // Debounce timing
 const uint32_t DEBOUNCE_DELAY_MS = 20; // 20ms debounce
 
-// MIDI note mapping (configured from ConfigManager)
-uint8_t beamNotes[7];
+// Analog beam readings from the Arduino, preferred over the digital inputs while alive
+BeamLink beamLink;
+const uint16_t LINK_HYSTERESIS = 10;           // A broken beam is restored at threshold + hysteresis
+const float LINK_BREAK_SHARE = 0.5f;           // Arduino breakPercent: broken below half the intact level
+ExpressionTracker linkExpression;              // Entry speed and break depth from the link readings
+float linkLevels[MAX_BEAMS];                   // Intact level of each beam (Arduino beamLevel, 1/8 per reading)
+uint8_t linkPressure[MAX_BEAMS];               // Last pressure sent for each held beam
+uint8_t linkBeamCount = 0;                     // Beams in the Arduino scan, at most numBeams
+#endif
+
+// MIDI note mapping (compiled from ConfigManager)
+NoteMapper noteMapper;
+BeamNotes heldNotes[MAX_BEAMS];      // Notes sounding on each beam, released even if the mapping changed
+bool heldByArp[MAX_BEAMS];           // Beam notes were given to the arpeggiator instead of played
+uint32_t noteMapVersion = 0;         // Config version the mapping was compiled from
+
+void SetBeamState(int i, bool broken, uint8_t velocity);
+
+// Beams in play, from the configuration
+uint8_t GetBeamCount() {
+    uint8_t numBeams = configManager.GetSnapshot()->numBeams;
+    return numBeams < MAX_BEAMS ? numBeams : MAX_BEAMS;
+}
+
+// Release the notes of beams that are no longer scanned
+void ReleaseBeamsFrom(uint8_t first) {
+    for (int i = first; i < MAX_BEAMS; i++) {
+        SetBeamState(i, false, 0);
+    }
+}
+
+// Recompile the beam note mapping after a configuration or preset change
+void UpdateNoteMapping() {
+    if (configManager.GetVersion() == noteMapVersion) return;
+    noteMapVersion = configManager.GetVersion();
+    noteMapper.Compile(*configManager.GetSnapshot());
+    ReleaseBeamsFrom(GetBeamCount());
+}
+
+// MIDI program change recalls a preset, the new sound starts on the next audio block
+void OnProgramChange(uint8_t program) {
+    audioSynthesizer.LoadPreset(program);
+}
+
+// Remote parameter access and bulk transfers from a host
+void OnSysEx(const uint8_t* data, size_t length) {
+    sysexProtocol.FeedMessage(data, length);
+}
+
+// MIDI clock and transport drive the arpeggiator when it follows an external clock
+void OnMidiClock(uint8_t message) {
+    arpeggiator.OnMidiClock(message, noteScheduler.Now());
+}
+
+// Looper transport from the host
+bool OnLooperControl(uint8_t action) {
+    return looper.Control(action);
+}
+
+// Telemetry frame streamed to the host on request
+void FillTelemetry(SysExTelemetry* frame) {
+    frame->cpuLoad = audioSynthesizer.GetCPUUsage();
+    frame->peakCpuLoad = audioSynthesizer.GetPeakCPUUsage();
+    frame->limiterGain = audioSynthesizer.GetLimiterGain();
+    frame->outputLevel = audioSynthesizer.GetOutputLevel();
+    frame->messagesSent = midiController.GetMessagesSent();
+    frame->activeVoices = audioSynthesizer.GetActiveVoiceCount();
+    frame->currentPreset = configManager.GetSnapshot()->currentPreset;
+    frame->beamStates = 0;
+    for (int i = 0; i < MAX_BEAMS; i++) {
+        if (beamStates[i]) frame->beamStates |= (1 << i);
+    }
+}
+
+// Beam edge: notes on when broken, off when restored. Only beams within
+// numBeams can be broken, any held beam can be restored.
+void SetBeamState(int i, bool broken, uint8_t velocity) {
+    if (broken == beamStates[i]) return;
+    if (broken && i >= GetBeamCount()) return;
+    beamStates[i] = broken;
+    const LaserHarpConfig* cfg = configManager.GetSnapshot();
+    
+    if (broken && !previousBeamStates[i]) {
+        // Rising edge: Beam broken (Note ON)
+        const BeamNotes& notes = noteMapper.GetBeamNotes(i);
+        heldNotes[i] = notes;
+        heldByArp[i] = arpeggiator.IsEnabled();
+        looper.RecordBeam(i, true, System::GetUs());
+        
+        for (int n = 0; n < notes.count; n++) {
+            if (heldByArp[i]) {
+                arpeggiator.NoteOn(notes.notes[n], velocity, i);
+                continue;
+            }
+            if (cfg->midiEnabled) {
+                midiController.SendNoteOn(notes.notes[n], velocity);
+            }
+            if (cfg->audioEnabled) {
+                audioSynthesizer.NoteOn(notes.notes[n], velocity, i);  // Panned by beam position
+            }
+        }
+        
+        // LED feedback
+        hardware.SetLed(true);
+    }
+    else if (!broken && previousBeamStates[i]) {
+        // Falling edge: Beam restored (Note OFF)
+        const BeamNotes& notes = heldNotes[i];
+        looper.RecordBeam(i, false, System::GetUs());
+        
+        for (int n = 0; n < notes.count; n++) {
+            if (heldByArp[i]) {
+                arpeggiator.NoteOff(notes.notes[n]);
+                continue;
+            }
+            if (cfg->midiEnabled) {
+                midiController.SendNoteOff(notes.notes[n]);
+            }
+            if (cfg->audioEnabled) {
+                audioSynthesizer.NoteOff(notes.notes[n]);
+            }
+        }
+        heldNotes[i].count = 0;
+        
+        // Turn off LED if no beams active
+        bool anyActive = false;
+        for (int j = 0; j < MAX_BEAMS; j++) {
+            if (beamStates[j]) anyActive = true;
+        }
+        if (!anyActive) hardware.SetLed(false);
+    }
+    
+    previousBeamStates[i] = broken;
+}
+
+// Break depth of a held beam as poly pressure (member channel pressure in MPE mode)
+void SetBeamPressure(int i, uint8_t pressure) {
+    if (!beamStates[i] || heldByArp[i]) return;
+    if (!configManager.GetSnapshot()->midiEnabled) return;
+    
+    const BeamNotes& notes = heldNotes[i];
+    for (int n = 0; n < notes.count; n++) {
+        midiController.SendNotePressure(notes.notes[n], pressure);
+    }
+}
+
+#ifndef LASERHARP_SINGLE_MCU
+// Beam reading from the link. The value is already averaged over the dwell
+// with the laser on, so a threshold with hysteresis replaces the debounce.
+// Velocity and pressure come from the readings as in the single-MCU build,
+// timed by the Arduino clock so link jitter does not change the entry speed.
+void OnBeamSample(const BeamSample& sample) {
+    // Beams the Arduino stopped scanning are released, they get no more samples
+    uint8_t beamCount = sample.beamCount < GetBeamCount() ? sample.beamCount : GetBeamCount();
+    if (beamCount != linkBeamCount) {
+        ReleaseBeamsFrom(beamCount);
+        linkBeamCount = beamCount;
+    }
+    if (sample.beam >= beamCount) return;
+    
+    const LaserHarpConfig* cfg = configManager.GetSnapshot();
+    uint8_t beam = sample.beam;
+    float value = sample.value;
+    float threshold = cfg->sensorThresholds[beam];
+    bool broken = beamStates[beam];
+    
+    if (threshold > 0.0f) {
+        // The value is the laser contribution, a broken beam loses it
+        if (value < threshold) {
+            broken = true;
+        } else if (value >= threshold + LINK_HYSTERESIS) {
+            broken = false;
+        }
+    } else {
+        // Without a threshold the Arduino decides against its learned beam level,
+        // the expression is measured against the same point
+        broken = sample.broken;
+        threshold = linkLevels[beam] * LINK_BREAK_SHARE;
+    }
+    
+    if (broken && !beamStates[beam]) {
+        SetBeamState(beam, true, linkExpression.GetVelocity(beam, value, threshold, sample.remoteTime));
+    }
+    linkExpression.AddScan(beam, value, threshold, sample.remoteTime);
+    
+    if (broken) {
+        uint8_t pressure = linkExpression.GetPressure(beam);
+        if (pressure != linkPressure[beam]) {
+            linkPressure[beam] = pressure;
+            SetBeamPressure(beam, pressure);
+        }
+    } else {
+        SetBeamState(beam, false, 0);
+        linkPressure[beam] = 0;
+        linkLevels[beam] += (linkLevels[beam] > 0.0f ? 0.125f : 1.0f) * (value - linkLevels[beam]);
+    }
+}
+#endif
 
 // Audio callback
 void AudioCallback(AudioHandle::InputBuffer in, AudioHandle::OutputBuffer out, size_t size) {
@@ -44,12 +270,29 @@ void InitializeSystem() {
     hardware.Init();
     hardware.SetAudioBlockSize(48); // 48 samples = 1ms @ 48kHz
     
-    // Initialize configuration
-    configManager.Init();
+    // Initialize configuration (restored from QSPI flash when available)
+    flashDevice.Init(&hardware.qspi);
+    configManager.Init(&flashDevice);
     
+    for (int i = 0; i < MAX_BEAMS; i++) {
+        beamStates[i] = false;
+        previousBeamStates[i] = false;
+        heldNotes[i].count = 0;
+        heldByArp[i] = false;
+#ifndef LASERHARP_SINGLE_MCU
+        linkLevels[i] = 0.0f;
+        linkPressure[i] = 0;
+#endif
+    }
+    
+#ifdef LASERHARP_SINGLE_MCU
+    // Stepper (D0/D1), laser (D17) and LDR (A0) driven from the Daisy, the
+    // scanner runs in a timer interrupt so flash erases cannot stall it
+    beamManager.Init(&hardware, &configManager);
+#else
     // Configure 7 digital input pins from Arduino
     // Using pins D0-D6 as inputs with pull-down resistors
-    for (int i = 0; i < 7; i++) {
+    for (int i = 0; i < FALLBACK_INPUTS; i++) {
         Pin inputPin;
         switch(i) {
             case 0: inputPin = D0; break;
@@ -61,23 +304,38 @@ void InitializeSystem() {
             case 6: inputPin = D6; break;
         }
         beamInputs[i].Init(inputPin, GPIO::Mode::INPUT, GPIO::Pull::PULLDOWN);
-        beamStates[i] = false;
-        previousBeamStates[i] = false;
         lastDebounceTime[i] = 0;
     }
     
+    // Framed UART link from the Arduino (UART4 RX on D11)
+    beamLink.SetSampleHandler(OnBeamSample);
+    beamLink.Init();
+#endif
+    
     // Initialize MIDI controller
     midiController.Init(&hardware, &configManager);
+    midiController.SetProgramChangeCallback(OnProgramChange);
     
-    // Initialize audio synthesizer
+    // Initialize preset bank and audio synthesizer
+    presetBank.Init(&flashDevice);
     audioSynthesizer.Init(hardware.AudioSampleRate(), &configManager);
+    audioSynthesizer.SetPresetBank(&presetBank);
+    
+    // Host SysEx protocol
+    sysexProtocol.Init(&configManager, &presetBank, &midiController);
+    sysexProtocol.SetTelemetryProvider(FillTelemetry);
+    midiController.SetSysExCallback(OnSysEx);
+    
+    // Sample-timed note output and the arpeggiator feeding it
+    noteScheduler.Init(&audioSynthesizer, &midiController, &configManager);
+    arpeggiator.Init(&noteScheduler, &configManager, hardware.AudioSampleRate());
+    midiController.SetClockCallback(OnMidiClock);
+    looper.Init(&noteScheduler, &noteMapper, &configManager, hardware.AudioSampleRate());
+    sysexProtocol.SetLooperHandler(OnLooperControl);
     
     // Setup note mapping based on configuration
-    uint8_t baseNote = configManager.GetBaseNote();
-    uint8_t interval = configManager.GetConfig()->noteInterval;
-    for (int i = 0; i < 7; i++) {
-        beamNotes[i] = baseNote + (i * interval);
-    }
+    noteMapVersion = configManager.GetVersion() - 1;
+    UpdateNoteMapping();
     
     // Start audio
     hardware.StartAudio(AudioCallback);
@@ -92,11 +350,37 @@ void InitializeSystem() {
     hardware.SetLed(false);
 }
 
+#ifdef LASERHARP_SINGLE_MCU
+// Play the beam events of the scanner (it runs from its own timer interrupt)
+void UpdateBeamInputs() {
+    BeamEvent event;
+    while (beamManager.GetNextEvent(&event)) {
+        if (event.beamIndex >= MAX_BEAMS) continue;
+        switch (event.type) {
+            case BEAM_BROKEN:
+                SetBeamState(event.beamIndex, true, event.velocity);
+                break;
+            case BEAM_RESTORED:
+                SetBeamState(event.beamIndex, false, 0);
+                break;
+            case BEAM_PRESSURE:
+                SetBeamPressure(event.beamIndex, event.velocity);
+                break;
+            default:
+                break;
+        }
+    }
+}
+#else
 // Read and debounce beam inputs from Arduino
 void UpdateBeamInputs() {
+    // Frames from the link call OnBeamSample(), the digital inputs are only the fallback
+    beamLink.Update();
+    if (beamLink.IsAlive()) return;
+    
     uint32_t currentTime = System::GetNow();
     
-    for (int i = 0; i < 7; i++) {
+    for (int i = 0; i < FALLBACK_INPUTS; i++) {
         // Read current state (HIGH = beam broken)
         bool currentState = beamInputs[i].Read();
         
@@ -104,49 +388,13 @@ void UpdateBeamInputs() {
         if (currentState != beamStates[i]) {
             if ((currentTime - lastDebounceTime[i]) > DEBOUNCE_DELAY_MS) {
                 // State change confirmed
-                beamStates[i] = currentState;
                 lastDebounceTime[i] = currentTime;
-                
-                // Detect edges and trigger MIDI/Audio
-                if (currentState && !previousBeamStates[i]) {
-                    // Rising edge: Beam broken (Note ON)
-                    uint8_t note = beamNotes[i];
-                    uint8_t velocity = configManager.GetConfig()->midiVelocity;
-                    
-                    if (configManager.IsMidiEnabled()) {
-                        midiController.SendNoteOn(note, velocity);
-                    }
-                    if (configManager.IsAudioEnabled()) {
-                        audioSynthesizer.NoteOn(note, velocity);
-                    }
-                    
-                    // LED feedback
-                    hardware.SetLed(true);
-                }
-                else if (!currentState && previousBeamStates[i]) {
-                    // Falling edge: Beam restored (Note OFF)
-                    uint8_t note = beamNotes[i];
-                    
-                    if (configManager.IsMidiEnabled()) {
-                        midiController.SendNoteOff(note);
-                    }
-                    if (configManager.IsAudioEnabled()) {
-                        audioSynthesizer.NoteOff(note);
-                    }
-                    
-                    // Turn off LED if no beams active
-                    bool anyActive = false;
-                    for (int j = 0; j < 7; j++) {
-                        if (beamStates[j]) anyActive = true;
-                    }
-                    if (!anyActive) hardware.SetLed(false);
-                }
-                
-                previousBeamStates[i] = currentState;
+                SetBeamState(i, currentState, configManager.GetSnapshot()->midiVelocity);
             }
         }
     }
 }
+#endif
 
 // Main loop
 int main(void) {
@@ -155,11 +403,25 @@ int main(void) {
     
     // Main loop
     for(;;) {
-        // Update beam inputs (read from Arduino)
+        // Update beam inputs (scanner events, or link frames / digital inputs from the Arduino)
         UpdateBeamInputs();
         
-        // Update MIDI controller
+        // Update MIDI controller (may recall a preset or change parameters over SysEx)
         midiController.Update();
+        sysexProtocol.Update();
+        
+        // Follow configuration changes: note mapping and synth patch
+        UpdateNoteMapping();
+        audioSynthesizer.Update();
+        
+        // Arpeggiator and looper schedule ahead of the audio clock, MIDI for notes that are due
+        arpeggiator.Update();
+        looper.Update();
+        noteScheduler.Update();
+        
+        // Advance pending configuration and preset writes
+        configManager.Update();
+        presetBank.Update();
         
         // Small delay to avoid CPU overload
         System::Delay(1);
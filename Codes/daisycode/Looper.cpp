@@ -0,0 +1,486 @@
+#include "Looper.h"
+
+// Event logs, ping-pong between playing and overdub
+static uint8_t DSY_SDRAM_BSS loopBuffers[2][Looper::BUFFER_SIZE];
+
+// Shorter recordings are discarded
+const uint32_t MIN_LOOP_US = 100000;
+
+// Bound on the events scheduled per Update(), the rest follow on the next call
+const int MAX_EVENTS_PER_UPDATE = 32;
+
+// Constructor
+Looper::Looper()
+    : scheduler_(nullptr), mapper_(nullptr), config_(nullptr), sampleRate_(48000.0f),
+      state_(LOOPER_IDLE), merging_(false), loopLengthUs_(0), loopLengthSamples_(0),
+      passStartSample_(0), passStartUs_(0), recordStartUs_(0), playBuffer_(0),
+      writeTimeUs_(0), writeHeld_(0), liveHeld_(0), scheduleStartSample_(0),
+      playingBeams_(0), lastScheduledSample_(0) {
+    for (int i = 0; i < 2; i++) {
+        usedBytes_[i] = 0;
+        eventCounts_[i] = 0;
+    }
+    copyReader_ = { 0, 0, 0 };
+    scheduleReader_ = { 0, 0, 0 };
+    for (int i = 0; i < MAX_LOOP_BEAMS; i++) {
+        playingNotes_[i].count = 0;
+        quantizeShift_[i] = 0;
+    }
+}
+
+// Destructor
+Looper::~Looper() {
+}
+
+// Initialization
+void Looper::Init(NoteScheduler* scheduler, NoteMapper* mapper, ConfigManager* config, float sampleRate) {
+    scheduler_ = scheduler;
+    mapper_ = mapper;
+    config_ = config;
+    sampleRate_ = sampleRate;
+    state_ = LOOPER_IDLE;
+    loopLengthUs_ = 0;
+}
+
+// Transport
+bool Looper::Control(uint8_t action) {
+    uint32_t nowSample = scheduler_->Now();
+    uint32_t nowUs = daisy::System::GetUs();
+    
+    switch (action) {
+        case LOOPER_STOP:
+            if (state_ == LOOPER_RECORDING) {
+                EndRecording(nowUs);
+            } else if (state_ == LOOPER_OVERDUBBING) {
+                EndOverdub(nowUs);
+            }
+            if (merging_) {
+                FinishMerge();
+            }
+            ReleasePlayingNotes(nowSample);
+            state_ = LOOPER_IDLE;
+            return true;
+            
+        case LOOPER_RECORD:
+            StartRecording(nowUs);
+            return true;
+            
+        case LOOPER_PLAY:
+            if (state_ == LOOPER_RECORDING) {
+                EndRecording(nowUs);
+                if (loopLengthUs_ == 0) return false;
+                StartPlayback(nowSample, nowUs);
+            } else if (state_ == LOOPER_OVERDUBBING) {
+                // The merge of this pass completes at its end
+                EndOverdub(nowUs);
+                state_ = LOOPER_PLAYING;
+            } else {
+                if (loopLengthUs_ == 0) return false;
+                if (merging_) {
+                    FinishMerge();
+                }
+                StartPlayback(nowSample, nowUs);
+            }
+            return true;
+            
+        case LOOPER_OVERDUB:
+            if (state_ == LOOPER_RECORDING) {
+                EndRecording(nowUs);
+                if (loopLengthUs_ == 0) return false;
+                StartPlayback(nowSample, nowUs);
+            } else if (state_ == LOOPER_IDLE) {
+                if (loopLengthUs_ == 0) return false;
+                StartPlayback(nowSample, nowUs);
+            }
+            if (!merging_) {
+                BeginMerge();
+                CopyUntil(nowUs - passStartUs_);
+            }
+            liveHeld_ = 0;
+            state_ = LOOPER_OVERDUBBING;
+            return true;
+            
+        case LOOPER_CLEAR:
+            ReleasePlayingNotes(nowSample);
+            state_ = LOOPER_IDLE;
+            merging_ = false;
+            loopLengthUs_ = 0;
+            usedBytes_[0] = usedBytes_[1] = 0;
+            eventCounts_[0] = eventCounts_[1] = 0;
+            return true;
+            
+        default:
+            return false;
+    }
+}
+
+LooperState Looper::GetState() const {
+    return state_;
+}
+
+// Beam input
+void Looper::RecordBeam(uint8_t beam, bool on, uint32_t timeUs) {
+    if (beam >= MAX_LOOP_BEAMS) return;
+    uint16_t mask = 1 << beam;
+    
+    if (state_ == LOOPER_RECORDING) {
+        if (!on && !(writeHeld_ & mask)) return;
+        if (!WriteEvent(beam, on, timeUs - recordStartUs_)) {
+            // Log full: close the loop here
+            Control(LOOPER_PLAY);
+        }
+    } else if (state_ == LOOPER_OVERDUBBING && merging_) {
+        if (!on && !(liveHeld_ & mask)) return;
+        uint32_t loopTime = timeUs - passStartUs_;
+        if (loopTime >= loopLengthUs_) {
+            loopTime = loopLengthUs_ - 1;
+        }
+        CopyUntil(loopTime);
+        if (!WriteEvent(beam, on, loopTime)) {
+            // Log full: drop this overdub pass, the loop keeps playing unchanged
+            merging_ = false;
+            state_ = LOOPER_PLAYING;
+            return;
+        }
+        liveHeld_ = on ? (liveHeld_ | mask) : (liveHeld_ & ~mask);
+    }
+}
+
+// Main loop processing
+void Looper::Update() {
+    if (state_ != LOOPER_PLAYING && state_ != LOOPER_OVERDUBBING) return;
+    
+    uint32_t nowSample = scheduler_->Now();
+    uint32_t nowUs = daisy::System::GetUs();
+    
+    // Overdub: copy the playing log as its events pass, interleaved with new ones
+    if (merging_) {
+        uint32_t loopTime = nowUs - passStartUs_;
+        CopyUntil(loopTime < loopLengthUs_ ? loopTime : loopLengthUs_ - 1);
+    }
+    
+    while ((int32_t)(nowSample - passStartSample_) >= (int32_t)loopLengthSamples_) {
+        EndPass(nowSample, nowUs);
+    }
+    
+    ScheduleAhead(nowSample);
+}
+
+// Status
+uint32_t Looper::GetLoopLengthUs() const {
+    return loopLengthUs_;
+}
+
+uint32_t Looper::GetEventCount() const {
+    return eventCounts_[playBuffer_];
+}
+
+uint32_t Looper::GetUsedBytes() const {
+    return usedBytes_[playBuffer_];
+}
+
+// Private methods
+// Appends one event to the write buffer, loopTimeUs must not go backwards
+bool Looper::WriteEvent(uint8_t beam, bool on, uint32_t loopTimeUs) {
+    uint8_t target = GetWriteBuffer();
+    uint8_t* data = loopBuffers[target];
+    uint32_t used = usedBytes_[target];
+    
+    // Deltas between whole ticks of loop time, so the rounding never accumulates
+    uint32_t tick = loopTimeUs / LOG_TICK_US;
+    uint32_t lastTick = writeTimeUs_ / LOG_TICK_US;
+    uint32_t delta = (tick > lastTick) ? tick - lastTick : 0;
+    
+    // Worst case: markers for the long gap and the event itself
+    if (used + (delta / MAX_DELTA + 1) * 4 > BUFFER_SIZE) return false;
+    
+    while (true) {
+        bool marker = delta > MAX_DELTA;
+        uint32_t value = marker ? MAX_DELTA : delta;
+        uint8_t bytes = (value < 2) ? 0 : (value < 512) ? 1 : (value < 131072) ? 2 : 3;
+        
+        uint8_t header = ((marker ? TIME_MARKER : beam) << 3) | (bytes << 1) | ((value >> (8 * bytes)) & 1);
+        if (on && !marker) header |= 0x80;
+        data[used++] = header;
+        for (int i = 0; i < bytes; i++) {
+            data[used++] = value >> (8 * i);
+        }
+        
+        if (!marker) break;
+        delta -= MAX_DELTA;
+    }
+    
+    usedBytes_[target] = used;
+    eventCounts_[target]++;
+    writeTimeUs_ = (tick > lastTick) ? tick * LOG_TICK_US : writeTimeUs_;
+    writeHeld_ = on ? (writeHeld_ | (1 << beam)) : (writeHeld_ & ~(1 << beam));
+    return true;
+}
+
+// Decodes the next beam event, time markers are folded into the time
+bool Looper::ReadEvent(LoopReader* reader, uint8_t* beam, bool* on) const {
+    const uint8_t* data = loopBuffers[reader->buffer];
+    uint32_t used = usedBytes_[reader->buffer];
+    
+    while (reader->position < used) {
+        uint8_t header = data[reader->position++];
+        uint8_t bytes = (header >> 1) & 0x03;
+        uint32_t delta = (uint32_t)(header & 1) << (8 * bytes);
+        for (int i = 0; i < bytes; i++) {
+            delta |= (uint32_t)data[reader->position++] << (8 * i);
+        }
+        reader->timeUs += delta * LOG_TICK_US;
+        
+        uint8_t index = (header >> 3) & 0x0F;
+        if (index == TIME_MARKER) continue;
+        *beam = index;
+        *on = (header & 0x80) != 0;
+        return true;
+    }
+    return false;
+}
+
+bool Looper::PeekEvent(const LoopReader& reader, uint32_t* timeUs) const {
+    LoopReader copy = reader;
+    uint8_t beam;
+    bool on;
+    if (!ReadEvent(&copy, &beam, &on)) return false;
+    *timeUs = copy.timeUs;
+    return true;
+}
+
+// Positions a reader after the events earlier than timeUs
+void Looper::SeekReader(LoopReader* reader, uint8_t buffer, uint32_t timeUs) {
+    *reader = { buffer, 0, 0 };
+    uint32_t eventTime;
+    while (PeekEvent(*reader, &eventTime) && eventTime < timeUs) {
+        uint8_t beam;
+        bool on;
+        ReadEvent(reader, &beam, &on);
+    }
+}
+
+uint8_t Looper::GetWriteBuffer() const {
+    return (state_ == LOOPER_RECORDING) ? playBuffer_ : 1 - playBuffer_;
+}
+
+void Looper::BeginMerge() {
+    uint8_t target = 1 - playBuffer_;
+    usedBytes_[target] = 0;
+    eventCounts_[target] = 0;
+    writeTimeUs_ = 0;
+    writeHeld_ = 0;
+    copyReader_ = { playBuffer_, 0, 0 };
+    merging_ = true;
+}
+
+// Completes the write buffer with the rest of the pass and makes it the playing log
+void Looper::FinishMerge() {
+    CopyUntil(loopLengthUs_);
+    if (!merging_) return;
+    
+    for (uint8_t beam = 0; beam < MAX_LOOP_BEAMS; beam++) {
+        if (writeHeld_ & (1 << beam)) {
+            WriteEvent(beam, false, loopLengthUs_);
+        }
+    }
+    liveHeld_ = 0;
+    playBuffer_ = 1 - playBuffer_;
+    merging_ = false;
+    
+    // A schedule reader left in the old log continues at the same time in the new one
+    if (scheduleReader_.buffer != playBuffer_) {
+        SeekReader(&scheduleReader_, playBuffer_, scheduleReader_.timeUs);
+    }
+}
+
+void Looper::CopyUntil(uint32_t loopTimeUs) {
+    uint32_t eventTime;
+    while (PeekEvent(copyReader_, &eventTime) && eventTime <= loopTimeUs) {
+        uint8_t beam;
+        bool on;
+        ReadEvent(&copyReader_, &beam, &on);
+        if (!WriteEvent(beam, on, eventTime)) {
+            merging_ = false;
+            if (state_ == LOOPER_OVERDUBBING) {
+                state_ = LOOPER_PLAYING;
+            }
+            return;
+        }
+    }
+}
+
+void Looper::EndRecording(uint32_t nowUs) {
+    loopLengthUs_ = nowUs - recordStartUs_;
+    if (loopLengthUs_ < MIN_LOOP_US || eventCounts_[playBuffer_] == 0) {
+        loopLengthUs_ = 0;
+        usedBytes_[playBuffer_] = 0;
+        eventCounts_[playBuffer_] = 0;
+        state_ = LOOPER_IDLE;
+        return;
+    }
+    
+    // Beams still held end with the loop
+    for (uint8_t beam = 0; beam < MAX_LOOP_BEAMS; beam++) {
+        if (writeHeld_ & (1 << beam)) {
+            WriteEvent(beam, false, loopLengthUs_);
+        }
+    }
+    loopLengthSamples_ = UsToSamples(loopLengthUs_);
+    state_ = LOOPER_IDLE;
+}
+
+// Beams held when overdub ends are released at that point of the loop
+void Looper::EndOverdub(uint32_t nowUs) {
+    if (!merging_) return;
+    uint32_t loopTime = nowUs - passStartUs_;
+    if (loopTime >= loopLengthUs_) {
+        loopTime = loopLengthUs_ - 1;
+    }
+    CopyUntil(loopTime);
+    for (uint8_t beam = 0; beam < MAX_LOOP_BEAMS; beam++) {
+        if (liveHeld_ & (1 << beam)) {
+            WriteEvent(beam, false, loopTime);
+        }
+    }
+    liveHeld_ = 0;
+}
+
+void Looper::EndPass(uint32_t nowSample, uint32_t nowUs) {
+    if (merging_) {
+        FinishMerge();
+        if (state_ == LOOPER_OVERDUBBING) {
+            BeginMerge();
+        }
+    }
+    
+    // Both clocks restart at the pass boundary, so the microsecond timeline of
+    // recorded events cannot drift from the audio clock over long sessions
+    passStartSample_ += loopLengthSamples_;
+    passStartUs_ = nowUs - SamplesToUs(nowSample - passStartSample_);
+}
+
+void Looper::ScheduleAhead(uint32_t nowSample) {
+    uint32_t grid = GetQuantizeGrid();
+    uint32_t horizon = nowSample + NoteScheduler::LOOKAHEAD + grid / 2;
+    
+    // An abandoned merge leaves the reader in the unfinished log
+    if (!merging_ && scheduleReader_.buffer != playBuffer_) {
+        SeekReader(&scheduleReader_, playBuffer_, scheduleReader_.timeUs);
+    }
+    
+    for (int i = 0; i < MAX_EVENTS_PER_UPDATE; i++) {
+        uint32_t eventTime;
+        if (PeekEvent(scheduleReader_, &eventTime)) {
+            uint32_t sample = scheduleStartSample_ + UsToSamples(eventTime);
+            if ((int32_t)(sample - horizon) >= 0) break;
+            
+            uint8_t beam;
+            bool on;
+            ReadEvent(&scheduleReader_, &beam, &on);
+            ScheduleBeam(beam, on, sample);
+        } else {
+            // The log being merged is still written, its end is not the end of the pass
+            if (scheduleReader_.buffer != playBuffer_) break;
+            
+            uint32_t nextStart = scheduleStartSample_ + loopLengthSamples_;
+            if ((int32_t)(nextStart - horizon) >= 0) break;
+            scheduleStartSample_ = nextStart;
+            scheduleReader_ = { (uint8_t)(merging_ ? 1 - playBuffer_ : playBuffer_), 0, 0 };
+        }
+    }
+}
+
+// Loop notes are mono per beam, overlapping overdubs collapse into one note
+void Looper::ScheduleBeam(uint8_t beam, bool on, uint32_t sampleTime) {
+    uint16_t mask = 1 << beam;
+    uint32_t grid = GetQuantizeGrid();
+    
+    if (on) {
+        if (playingBeams_ & mask) return;
+        
+        // Note starts snap to the grid, the note length is kept
+        quantizeShift_[beam] = 0;
+        if (grid > 0) {
+            uint32_t position = sampleTime - scheduleStartSample_;
+            uint32_t snapped = (position + grid / 2) / grid * grid;
+            quantizeShift_[beam] = (int32_t)(snapped - position);
+        }
+        sampleTime += quantizeShift_[beam];
+        
+        const BeamNotes& notes = mapper_->GetBeamNotes(beam);
+        uint8_t velocity = config_->GetSnapshot()->midiVelocity;
+        for (int n = 0; n < notes.count; n++) {
+            scheduler_->ScheduleNoteOn(sampleTime, notes.notes[n], velocity, beam);
+        }
+        playingNotes_[beam] = notes;
+        playingBeams_ |= mask;
+    } else {
+        if (!(playingBeams_ & mask)) return;
+        
+        sampleTime += quantizeShift_[beam];
+        const BeamNotes& notes = playingNotes_[beam];
+        for (int n = 0; n < notes.count; n++) {
+            scheduler_->ScheduleNoteOff(sampleTime, notes.notes[n]);
+        }
+        playingBeams_ &= ~mask;
+    }
+    
+    if ((int32_t)(sampleTime - lastScheduledSample_) > 0) {
+        lastScheduledSample_ = sampleTime;
+    }
+}
+
+// Releases after every note start already handed to the scheduler
+void Looper::ReleasePlayingNotes(uint32_t sampleTime) {
+    if ((int32_t)(lastScheduledSample_ - sampleTime) >= 0) {
+        sampleTime = lastScheduledSample_ + 1;
+    }
+    for (uint8_t beam = 0; beam < MAX_LOOP_BEAMS; beam++) {
+        if (playingBeams_ & (1 << beam)) {
+            const BeamNotes& notes = playingNotes_[beam];
+            for (int n = 0; n < notes.count; n++) {
+                scheduler_->ScheduleNoteOff(sampleTime, notes.notes[n]);
+            }
+        }
+    }
+    playingBeams_ = 0;
+}
+
+void Looper::StartRecording(uint32_t nowUs) {
+    ReleasePlayingNotes(scheduler_->Now());
+    state_ = LOOPER_RECORDING;
+    merging_ = false;
+    playBuffer_ = 0;
+    usedBytes_[0] = 0;
+    eventCounts_[0] = 0;
+    writeTimeUs_ = 0;
+    writeHeld_ = 0;
+    loopLengthUs_ = 0;
+    recordStartUs_ = nowUs;
+}
+
+void Looper::StartPlayback(uint32_t nowSample, uint32_t nowUs) {
+    ReleasePlayingNotes(nowSample);
+    state_ = LOOPER_PLAYING;
+    passStartSample_ = nowSample;
+    passStartUs_ = nowUs;
+    scheduleStartSample_ = nowSample;
+    scheduleReader_ = { playBuffer_, 0, 0 };
+}
+
+uint32_t Looper::GetQuantizeGrid() const {
+    const LaserHarpConfig* cfg = config_->GetSnapshot();
+    if (cfg->loopQuantize == 0 || cfg->loopQuantize > ARP_RATE_COUNT) return 0;
+    
+    uint8_t ticks = Arpeggiator::GetRateTicks(cfg->loopQuantize - 1);
+    return (uint32_t)(sampleRate_ * 60.0f / cfg->tempo * ticks / Arpeggiator::CLOCK_PPQN);
+}
+
+uint32_t Looper::UsToSamples(uint32_t us) const {
+    return (uint32_t)((uint64_t)us * (uint32_t)sampleRate_ / 1000000);
+}
+
+uint32_t Looper::SamplesToUs(uint32_t samples) const {
+    return (uint32_t)((uint64_t)samples * 1000000 / (uint32_t)sampleRate_);
+}
\ No newline at end of file
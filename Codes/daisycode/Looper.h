@@ -0,0 +1,126 @@
+#pragma once
+#include <stdint.h>
+#include "ConfigManager.h"
+#include "NoteMapper.h"
+#include "NoteScheduler.h"
+#include "Arpeggiator.h"
+
+// Transport actions (SysEx and host control)
+enum LooperAction {
+    LOOPER_STOP = 0,            // Stop playback, the loop is kept
+    LOOPER_RECORD,              // Record a new loop, replaces the current one
+    LOOPER_PLAY,                // End recording or overdub, or restart playback
+    LOOPER_OVERDUB,             // Add beam events to the playing loop
+    LOOPER_CLEAR,
+    LOOPER_ACTION_COUNT
+};
+
+enum LooperState {
+    LOOPER_IDLE = 0,
+    LOOPER_RECORDING,
+    LOOPER_PLAYING,
+    LOOPER_OVERDUBBING
+};
+
+// Event log position while decoding
+struct LoopReader {
+    uint8_t buffer;
+    uint32_t position;          // Byte offset of the next event
+    uint32_t timeUs;            // Loop time of the last decoded event
+};
+
+// Beam event looper. Events are stored as a delta-encoded log in SDRAM:
+//   header [on:1][beam:4][delta bytes:2][delta bit 24/16/8/0:1], then the
+//   little-endian low bytes of the delta to the previous event in 16us ticks
+//   (finer than a sample at 48kHz). Deltas below 8ms take 2 bytes, below 2.1s
+//   3 bytes, below 537s 4 bytes; beam 15 is a time-only marker for longer gaps. Beams are replayed through the NoteMapper, so a loop
+// follows scale and transposition changes, and the NoteScheduler, so loop notes
+// start on exact samples. Overdub merges the playing log and new events into
+// the second buffer, which becomes the playing log at the end of the pass.
+class Looper {
+public:
+    Looper();
+    ~Looper();
+    
+    // Initialization
+    void Init(NoteScheduler* scheduler, NoteMapper* mapper, ConfigManager* config, float sampleRate);
+    
+    // Transport (main loop)
+    bool Control(uint8_t action);
+    LooperState GetState() const;
+    
+    // Beam input while recording or overdubbing, timeUs from System::GetUs()
+    void RecordBeam(uint8_t beam, bool on, uint32_t timeUs);
+    
+    // Main loop processing: schedules loop events ahead of the audio clock
+    void Update();
+    
+    // Status
+    uint32_t GetLoopLengthUs() const;
+    uint32_t GetEventCount() const;
+    uint32_t GetUsedBytes() const;
+    
+    static const uint32_t BUFFER_SIZE = 1024 * 1024;   // Per buffer, 2 in SDRAM
+    static const uint8_t MAX_LOOP_BEAMS = 15;
+    static const uint8_t TIME_MARKER = 15;              // Beam index of time-only events
+    static const uint32_t LOG_TICK_US = 16;             // Time resolution of the log
+    static const uint32_t MAX_DELTA = (1u << 25) - 1;   // Ticks, 537s
+    
+private:
+    NoteScheduler* scheduler_;
+    NoteMapper* mapper_;
+    ConfigManager* config_;
+    float sampleRate_;
+    
+    LooperState state_;
+    bool merging_;              // This pass is copied into the write buffer
+    
+    // Loop
+    uint32_t loopLengthUs_;
+    uint32_t loopLengthSamples_;
+    
+    // Current pass, anchored in both clocks
+    uint32_t passStartSample_;
+    uint32_t passStartUs_;
+    uint32_t recordStartUs_;
+    
+    // Playing log and overdub target
+    uint8_t playBuffer_;
+    uint32_t usedBytes_[2];
+    uint32_t eventCounts_[2];
+    uint32_t writeTimeUs_;      // Loop time of the last event written, whole ticks
+    uint16_t writeHeld_;        // Beams held in the log being written
+    uint16_t liveHeld_;         // Beams held by the player during overdub
+    
+    // Copy of the playing log into the write buffer (overdub), follows the clock
+    LoopReader copyReader_;
+    
+    // Playback scheduling, runs ahead of the clock
+    LoopReader scheduleReader_;
+    uint32_t scheduleStartSample_;  // Pass the schedule reader is in
+    uint16_t playingBeams_;
+    BeamNotes playingNotes_[MAX_LOOP_BEAMS];
+    int32_t quantizeShift_[MAX_LOOP_BEAMS];
+    uint32_t lastScheduledSample_;
+    
+    // Private methods
+    bool WriteEvent(uint8_t beam, bool on, uint32_t loopTimeUs);
+    bool ReadEvent(LoopReader* reader, uint8_t* beam, bool* on) const;
+    bool PeekEvent(const LoopReader& reader, uint32_t* timeUs) const;
+    void SeekReader(LoopReader* reader, uint8_t buffer, uint32_t timeUs);
+    uint8_t GetWriteBuffer() const;
+    void BeginMerge();
+    void FinishMerge();
+    void CopyUntil(uint32_t loopTimeUs);
+    void EndRecording(uint32_t nowUs);
+    void EndOverdub(uint32_t nowUs);
+    void EndPass(uint32_t nowSample, uint32_t nowUs);
+    void ScheduleAhead(uint32_t nowSample);
+    void ScheduleBeam(uint8_t beam, bool on, uint32_t sampleTime);
+    void ReleasePlayingNotes(uint32_t sampleTime);
+    void StartRecording(uint32_t nowUs);
+    void StartPlayback(uint32_t nowSample, uint32_t nowUs);
+    uint32_t GetQuantizeGrid() const;
+    uint32_t UsToSamples(uint32_t us) const;
+    uint32_t SamplesToUs(uint32_t samples) const;
+};
\ No newline at end of file
@@ -0,0 +1,248 @@
+#include "MasterBus.h"
+#include <cmath>
+#include <cstring>
+
+// Constants
+const float CLIP_KNEE = 0.8f;                   // Soft clipper is linear below this level
+const float DEFAULT_CEILING = 0.966f;           // -0.3 dBFS
+const float DEFAULT_RELEASE_TIME = 0.1f;        // 100ms
+const float LOOKAHEAD_TIME = 0.001f;            // 1ms
+
+// Halfband side taps (Kaiser window, beta = 8), centre tap is 0.5
+// Passband -0.4 dB at 0.2 fs, stopband below -90 dB from 0.35 fs
+const float HalfbandFilter::COEFFICIENTS[HalfbandFilter::TAPS] = {
+    -0.000049630f,  0.000642254f, -0.002734441f,  0.008020324f,
+    -0.019227638f,  0.041536705f, -0.091224808f,  0.313045527f,
+     0.313045527f, -0.091224808f,  0.041536705f, -0.019227638f,
+     0.008020324f, -0.002734441f,  0.000642254f, -0.000049630f
+};
+
+// HalfbandFilter
+HalfbandFilter::HalfbandFilter() {
+    Reset();
+}
+
+void HalfbandFilter::Reset() {
+    memset(upHistory_, 0, sizeof(upHistory_));
+    memset(downHistory_, 0, sizeof(downHistory_));
+    memset(oddDelay_, 0, sizeof(oddDelay_));
+    upIndex_ = 0;
+    downIndex_ = 0;
+    oddIndex_ = 0;
+}
+
+float HalfbandFilter::Convolve(const float* window) {
+    float sum = 0.0f;
+    for (int k = 0; k < TAPS; k++) {
+        sum += COEFFICIENTS[k] * window[k];
+    }
+    return sum;
+}
+
+void HalfbandFilter::Upsample(float input, float* output) {
+    // Newest sample first in the window
+    upIndex_ = (upIndex_ + TAPS - 1) % TAPS;
+    upHistory_[upIndex_] = input;
+    upHistory_[upIndex_ + TAPS] = input;
+
+    // Even phase runs the FIR, odd phase is the centre tap (0.5 * 2 = delayed input)
+    output[0] = 2.0f * Convolve(&upHistory_[upIndex_]);
+    output[1] = upHistory_[upIndex_ + TAPS / 2 - 1];
+}
+
+float HalfbandFilter::Downsample(const float* input) {
+    downIndex_ = (downIndex_ + TAPS - 1) % TAPS;
+    downHistory_[downIndex_] = input[0];
+    downHistory_[downIndex_ + TAPS] = input[0];
+
+    // Odd sample from CENTER_DELAY pairs ago lines up with the centre tap
+    float centre = oddDelay_[oddIndex_];
+    oddDelay_[oddIndex_] = input[1];
+    oddIndex_ = (oddIndex_ + 1) % CENTER_DELAY;
+
+    return Convolve(&downHistory_[downIndex_]) + 0.5f * centre;
+}
+
+// MasterBus
+MasterBus::MasterBus()
+    : sampleRate_(48000.0f), clipperEnabled_(true), oversampling_(OVERSAMPLE_2X),
+      requestedOversampling_(OVERSAMPLE_2X), lookahead_(48), lookaheadIndex_(0),
+      ceiling_(DEFAULT_CEILING), gain_(1.0f), pendingTarget_(1.0f), attackStep_(0.0f),
+      holdCounter_(0), releaseCoeff_(0.0f) {
+    memset(lookaheadLeft_, 0, sizeof(lookaheadLeft_));
+    memset(lookaheadRight_, 0, sizeof(lookaheadRight_));
+}
+
+MasterBus::~MasterBus() {
+}
+
+void MasterBus::Init(float sampleRate) {
+    sampleRate_ = sampleRate;
+
+    lookahead_ = (int)(LOOKAHEAD_TIME * sampleRate_);
+    if (lookahead_ < 1) lookahead_ = 1;
+    if (lookahead_ > MAX_LOOKAHEAD) lookahead_ = MAX_LOOKAHEAD;
+
+    SetReleaseTime(DEFAULT_RELEASE_TIME);
+    Reset();
+}
+
+void MasterBus::Reset() {
+    for (int c = 0; c < 2; c++) {
+        clipper_[c].stage1.Reset();
+        clipper_[c].stage2.Reset();
+    }
+
+    memset(lookaheadLeft_, 0, sizeof(lookaheadLeft_));
+    memset(lookaheadRight_, 0, sizeof(lookaheadRight_));
+    lookaheadIndex_ = 0;
+    gain_ = 1.0f;
+    pendingTarget_ = 1.0f;
+    attackStep_ = 0.0f;
+    holdCounter_ = 0;
+}
+
+void MasterBus::Process(float* left, float* right, size_t size) {
+    // Apply an oversampling change at the block boundary, stale filter state is discarded
+    OversamplingFactor requested = requestedOversampling_.load(std::memory_order_relaxed);
+    if (requested != oversampling_) {
+        oversampling_ = requested;
+        for (int c = 0; c < 2; c++) {
+            clipper_[c].stage1.Reset();
+            clipper_[c].stage2.Reset();
+        }
+    }
+
+    if (clipperEnabled_) {
+        ProcessClipper(left, size, &clipper_[0]);
+        ProcessClipper(right, size, &clipper_[1]);
+    }
+    ProcessLimiter(left, right, size);
+}
+
+// Configuration
+void MasterBus::SetOversampling(OversamplingFactor factor) {
+    requestedOversampling_.store(factor, std::memory_order_relaxed);
+}
+
+void MasterBus::SetClipperEnabled(bool enabled) {
+    clipperEnabled_ = enabled;
+}
+
+void MasterBus::SetCeiling(float ceiling) {
+    if (ceiling > 0.0f && ceiling <= 1.0f) {
+        ceiling_ = ceiling;
+    }
+}
+
+void MasterBus::SetReleaseTime(float timeSeconds) {
+    if (timeSeconds > 0.0f) {
+        releaseCoeff_ = 1.0f - expf(-1.0f / (timeSeconds * sampleRate_));
+    }
+}
+
+// Monitoring
+OversamplingFactor MasterBus::GetOversampling() const {
+    return oversampling_;
+}
+
+float MasterBus::GetGainReduction() const {
+    return gain_;
+}
+
+// Private methods
+
+// Linear below the knee, smooth rational tanh approximation above it, asymptote at 1.0
+float MasterBus::SoftClip(float input) {
+    float magnitude = fabsf(input);
+    if (magnitude <= CLIP_KNEE) {
+        return input;
+    }
+
+    float x = (magnitude - CLIP_KNEE) / (1.0f - CLIP_KNEE);
+    float shaped = (x >= 3.0f) ? 1.0f : x * (27.0f + x * x) / (27.0f + 9.0f * x * x);
+    float output = CLIP_KNEE + (1.0f - CLIP_KNEE) * shaped;
+    return input < 0.0f ? -output : output;
+}
+
+float MasterBus::ClipSample(float input, ClipperChannel* channel) {
+    switch (oversampling_) {
+        case OVERSAMPLE_2X: {
+            float up[2];
+            channel->stage1.Upsample(input, up);
+            up[0] = SoftClip(up[0]);
+            up[1] = SoftClip(up[1]);
+            return channel->stage1.Downsample(up);
+        }
+
+        case OVERSAMPLE_4X: {
+            float up1[2];
+            float down1[2];
+            channel->stage1.Upsample(input, up1);
+            for (int j = 0; j < 2; j++) {
+                float up2[2];
+                channel->stage2.Upsample(up1[j], up2);
+                up2[0] = SoftClip(up2[0]);
+                up2[1] = SoftClip(up2[1]);
+                down1[j] = channel->stage2.Downsample(up2);
+            }
+            return channel->stage1.Downsample(down1);
+        }
+
+        case OVERSAMPLE_1X:
+        default:
+            return SoftClip(input);
+    }
+}
+
+void MasterBus::ProcessClipper(float* buffer, size_t size, ClipperChannel* channel) {
+    for (size_t i = 0; i < size; i++) {
+        buffer[i] = ClipSample(buffer[i], channel);
+    }
+}
+
+// Look-ahead limiter: the gain ramps down over the look-ahead window so it has
+// reached the required reduction when the peak leaves the delay line, then
+// holds until the peak has passed and releases exponentially. The gain state
+// carries over between blocks.
+void MasterBus::ProcessLimiter(float* left, float* right, size_t size) {
+    for (size_t i = 0; i < size; i++) {
+        float peak = fmaxf(fabsf(left[i]), fabsf(right[i]));
+        float target = peak > ceiling_ ? ceiling_ / peak : 1.0f;
+
+        if (target < 1.0f && target <= pendingTarget_) {
+            pendingTarget_ = target;
+            holdCounter_ = 2 * lookahead_;
+            float step = (target - gain_) / (float)lookahead_;
+            if (step < attackStep_) {
+                attackStep_ = step;
+            }
+        }
+
+        if (gain_ > pendingTarget_) {
+            gain_ += attackStep_;
+            if (gain_ < pendingTarget_) {
+                gain_ = pendingTarget_;
+            }
+        } else {
+            attackStep_ = 0.0f;
+            if (holdCounter_ > 0) {
+                holdCounter_--;
+            } else {
+                pendingTarget_ = 1.0f;
+                gain_ += (1.0f - gain_) * releaseCoeff_;
+            }
+        }
+
+        // Delay the signal by the look-ahead time
+        float delayedLeft = lookaheadLeft_[lookaheadIndex_];
+        float delayedRight = lookaheadRight_[lookaheadIndex_];
+        lookaheadLeft_[lookaheadIndex_] = left[i];
+        lookaheadRight_[lookaheadIndex_] = right[i];
+        lookaheadIndex_ = (lookaheadIndex_ + 1) % lookahead_;
+
+        // Final clamp keeps the ceiling a hard guarantee
+        left[i] = fmaxf(-ceiling_, fminf(ceiling_, delayedLeft * gain_));
+        right[i] = fmaxf(-ceiling_, fminf(ceiling_, delayedRight * gain_));
+    }
+}
\ No newline at end of file
@@ -0,0 +1,99 @@
+#pragma once
+#include <stdint.h>
+#include <stddef.h>
+#include <atomic>
+
+// Oversampling factors for the soft clipper
+enum OversamplingFactor {
+    OVERSAMPLE_1X = 1,
+    OVERSAMPLE_2X = 2,
+    OVERSAMPLE_4X = 4
+};
+
+// 31-tap polyphase halfband filter for 2x up/downsampling
+// Only the 16 even-phase taps are non-zero, the odd phase is a pure delay.
+class HalfbandFilter {
+public:
+    HalfbandFilter();
+
+    void Reset();
+
+    // One input sample -> two output samples at twice the rate
+    void Upsample(float input, float* output);
+
+    // Two input samples at twice the rate -> one output sample
+    float Downsample(const float* input);
+
+private:
+    static const int TAPS = 16;             // Non-zero side taps
+    static const int CENTER_DELAY = 8;      // Odd-phase delay in input pairs
+    static const float COEFFICIENTS[TAPS];
+
+    // Doubled circular buffers so the FIR window is always contiguous
+    float upHistory_[TAPS * 2];
+    int upIndex_;
+    float downHistory_[TAPS * 2];
+    int downIndex_;
+    float oddDelay_[CENTER_DELAY];
+    int oddIndex_;
+
+    float Convolve(const float* window);
+};
+
+// Master bus: oversampled soft clipper followed by a look-ahead brickwall limiter
+class MasterBus {
+public:
+    MasterBus();
+    ~MasterBus();
+
+    // Initialization
+    void Init(float sampleRate);
+    void Reset();
+
+    // Audio processing (in place, stereo linked)
+    void Process(float* left, float* right, size_t size);
+
+    // Configuration (applied at the next block boundary)
+    void SetOversampling(OversamplingFactor factor);
+    void SetClipperEnabled(bool enabled);
+    void SetCeiling(float ceiling);         // Linear, e.g. 0.966 = -0.3 dBFS
+    void SetReleaseTime(float timeSeconds);
+
+    // Monitoring
+    OversamplingFactor GetOversampling() const;
+    float GetGainReduction() const;         // Current limiter gain (1.0 = no reduction)
+
+private:
+    // Per-channel clipper state, one halfband filter per 2x stage
+    struct ClipperChannel {
+        HalfbandFilter stage1;              // fs <-> 2fs
+        HalfbandFilter stage2;              // 2fs <-> 4fs
+    };
+
+    float sampleRate_;
+
+    // Soft clipper
+    bool clipperEnabled_;
+    OversamplingFactor oversampling_;
+    std::atomic<OversamplingFactor> requestedOversampling_;   // Any context -> audio callback
+    ClipperChannel clipper_[2];
+
+    // Look-ahead limiter
+    static const int MAX_LOOKAHEAD = 96;    // 2ms at 48kHz
+    float lookaheadLeft_[MAX_LOOKAHEAD];
+    float lookaheadRight_[MAX_LOOKAHEAD];
+    int lookahead_;
+    int lookaheadIndex_;
+    float ceiling_;
+    float gain_;                // Current gain
+    float pendingTarget_;       // Lowest gain required by a peak still in the look-ahead window
+    float attackStep_;          // Per-sample gain ramp towards pendingTarget_
+    int holdCounter_;           // Samples until that peak has left the window
+    float releaseCoeff_;
+
+    // Private methods
+    float SoftClip(float input);
+    float ClipSample(float input, ClipperChannel* channel);
+    void ProcessClipper(float* buffer, size_t size, ClipperChannel* channel);
+    void ProcessLimiter(float* left, float* right, size_t size);
+};
\ No newline at end of file
@@ -1,10 +1,24 @@
 #include "MidiController.h"
 
+// Continuous messages are flushed at most every CONTINUOUS_INTERVAL_MS, a few at a time.
+// 3 messages per 10ms use about 30% of a 31250 baud DIN link.
+const uint32_t CONTINUOUS_INTERVAL_MS = 10;
+const uint8_t CONTINUOUS_MAX_PER_FLUSH = 3;
+const uint8_t PRESSURE_CHANGE_THRESHOLD = 2;    // Smaller pressure changes are not sent
+const uint16_t BEND_CHANGE_THRESHOLD = 16;      // 1/1024 of the bend range
+const uint8_t MPE_MASTER_CHANNEL = 1;           // Lower zone
+const uint16_t PITCH_BEND_CENTER = 0x2000;
+const uint8_t TIMBRE_CENTER = 64;
+
 // Constructor
 MidiController::MidiController() 
-    : hardware_(nullptr), config_(nullptr), midiChannel_(1), 
-      outputMode_(MIDI_USB_ONLY), enabled_(true), usbConnected_(false), 
+    : hardware_(nullptr), config_(nullptr), midiChannel_(1), configVersion_(0),
+      outputMode_(MIDI_USB_ONLY), enabled_(true), mpeEnabled_(false), mpeMemberCount_(15),
+      mpeBendRange_(48), usbConnected_(false), 
       uartConnected_(false), queueHead_(0), queueTail_(0), queueCount_(0),
+      continuousCursor_(0), lastContinuousFlush_(0),
+      programChangeCallback_(nullptr),
+      sysExCallback_(nullptr), clockCallback_(nullptr),
       messagesSent_(0), lastActivityTime_(0), runningStatus_(0), 
       activeNoteCount_(0), lastClockTime_(0), clockDivision_(24), 
       clockRunning_(false) {
@@ -13,6 +27,13 @@ MidiController::MidiController()
     for (int i = 0; i < 128; i++) {
         activeNotes_[i] = false;
     }
+    
+    for (int i = 0; i < CONTINUOUS_SLOTS; i++) {
+        continuous_[i].active = false;
+        continuous_[i].pending = false;
+    }
+    
+    ResetChannelAllocation();
 }
 
 // Destructor
@@ -25,9 +46,10 @@ void MidiController::Init(daisy::DaisySeed* hw, ConfigManager* config) {
     hardware_ = hw;
     config_ = config;
     
-    // Get MIDI channel from config
+    // Get MIDI channel from the published config
     if (config_) {
-        midiChannel_ = config_->GetMidiChannel();
+        configVersion_ = config_->GetVersion();
+        midiChannel_ = config_->GetSnapshot()->midiChannel;
     }
     
     // Initialize MIDI interfaces based on output mode
@@ -37,15 +59,45 @@ void MidiController::Init(daisy::DaisySeed* hw, ConfigManager* config) {
     // Reset message statistics
     messagesSent_ = 0;
     lastActivityTime_ = daisy::System::GetNow();
+    
+    // Announce the MPE zone to the receiver
+    if (config_ && config_->GetSnapshot()->mpeEnabled) {
+        const LaserHarpConfig* cfg = config_->GetSnapshot();
+        SetMpeMode(true, cfg->mpeMemberChannels, cfg->mpeBendRange);
+    }
 }
 
 // Main update function
 void MidiController::Update() {
+    // Follow MPE and channel changes, releasing held notes on the old channels first
+    if (config_ && config_->GetVersion() != configVersion_) {
+        configVersion_ = config_->GetVersion();
+        const LaserHarpConfig* cfg = config_->GetSnapshot();
+        uint8_t channel = cfg->midiChannel;
+        if (cfg->mpeEnabled != mpeEnabled_ ||
+            (mpeEnabled_ && (cfg->mpeMemberChannels != mpeMemberCount_ ||
+                             cfg->mpeBendRange != mpeBendRange_))) {
+            SetMpeMode(cfg->mpeEnabled, cfg->mpeMemberChannels, cfg->mpeBendRange);
+        } else if (!mpeEnabled_ && channel != midiChannel_ && IsValidChannel(channel)) {
+            if (activeNoteCount_ > 0) {
+                SendAllNotesOff();
+            }
+            for (int i = 0; i < CONTINUOUS_SLOTS; i++) {
+                continuous_[i].active = false;  // Coalesced values belong to the old channel
+            }
+            midiChannel_ = channel;
+        }
+    }
+    
     // Update connection status
     CheckUSBConnection();
     CheckUARTConnection();
     
-    // Process any pending messages in the queue
+    // Handle incoming messages (program changes)
+    ProcessIncomingMessages();
+    
+    // Release coalesced pressure and bend values, then send the queue
+    FlushContinuous();
     ProcessMessageQueue();
     
     // Update timestamp
@@ -58,7 +110,9 @@ void MidiController::SendNoteOn(uint8_t note, uint8_t velocity) {
         return;
     }
     
-    uint8_t status = CreateStatusByte(MIDI_NOTE_ON, midiChannel_);
+    // In MPE mode every note gets its own member channel
+    uint8_t channel = mpeEnabled_ ? AllocateChannel(note) : midiChannel_;
+    uint8_t status = CreateStatusByte(MIDI_NOTE_ON, channel);
     QueueMessage(status, note, velocity);
     TrackNoteOn(note);
 }
@@ -72,14 +126,32 @@ void MidiController::SendNoteOff(uint8_t note, uint8_t velocity) {
         return;
     }
     
-    uint8_t status = CreateStatusByte(MIDI_NOTE_OFF, midiChannel_);
+    uint8_t channel = midiChannel_;
+    if (mpeEnabled_ && noteChannel_[note] != 0) {
+        channel = noteChannel_[note];
+    }
+    
+    uint8_t status = CreateStatusByte(MIDI_NOTE_OFF, channel);
     QueueMessage(status, note, velocity);
     TrackNoteOff(note);
+    
+    // Expression of a released note is meaningless, drop it
+    if (mpeEnabled_) {
+        ReleaseChannel(note);
+    } else {
+        CancelContinuous(CreateStatusByte(MIDI_POLY_PRESSURE, midiChannel_), note);
+    }
 }
 
 void MidiController::SendAllNotesOff() {
     // Send MIDI CC All Notes Off
     SendControlChange(MIDI_CC_ALL_NOTES_OFF, 0);
+    if (mpeEnabled_) {
+        for (int i = 0; i < mpeMemberCount_; i++) {
+            QueueMessage(CreateStatusByte(MIDI_CONTROL_CHANGE, MPE_MASTER_CHANNEL + 1 + i),
+                         MIDI_CC_ALL_NOTES_OFF, 0);
+        }
+    }
     
     // Also send individual note offs for tracked notes
     for (int i = 0; i < 128; i++) {
@@ -114,9 +186,7 @@ void MidiController::SendPitchBend(uint16_t value) {
     }
     
     uint8_t status = CreateStatusByte(MIDI_PITCH_BEND, midiChannel_);
-    uint8_t lsb = value & 0x7F;
-    uint8_t msb = (value >> 7) & 0x7F;
-    QueueMessage(status, lsb, msb);
+    QueueContinuous(status, 0, value & 0x3FFF, 1);
 }
 
 void MidiController::SendChannelPressure(uint8_t pressure) {
@@ -125,7 +195,7 @@ void MidiController::SendChannelPressure(uint8_t pressure) {
     }
     
     uint8_t status = CreateStatusByte(MIDI_CHANNEL_PRESSURE, midiChannel_);
-    QueueMessage(status, pressure);
+    QueueContinuous(status, 0, pressure, PRESSURE_CHANGE_THRESHOLD);
 }
 
 void MidiController::SendPolyPressure(uint8_t note, uint8_t pressure) {
@@ -134,7 +204,20 @@ void MidiController::SendPolyPressure(uint8_t note, uint8_t pressure) {
     }
     
     uint8_t status = CreateStatusByte(MIDI_POLY_PRESSURE, midiChannel_);
-    QueueMessage(status, note, pressure);
+    QueueContinuous(status, note, pressure, PRESSURE_CHANGE_THRESHOLD);
+}
+
+// MIDI input
+void MidiController::SetProgramChangeCallback(ProgramChangeCallback callback) {
+    programChangeCallback_ = callback;
+}
+
+void MidiController::SetSysExCallback(SysExCallback callback) {
+    sysExCallback_ = callback;
+}
+
+void MidiController::SetClockCallback(ClockCallback callback) {
+    clockCallback_ = callback;
 }
 
 // Configuration
@@ -152,6 +235,42 @@ void MidiController::SetEnabled(bool enabled) {
     enabled_ = enabled;
 }
 
+void MidiController::SetMpeMode(bool enabled, uint8_t memberChannels, uint8_t bendRange) {
+    if (memberChannels < 1) memberChannels = 1;
+    if (memberChannels > 15) memberChannels = 15;
+    if (bendRange < 1) bendRange = 1;
+    if (bendRange > 96) bendRange = 96;
+    
+    // Notes were placed under the old channel layout
+    if (activeNoteCount_ > 0) {
+        SendAllNotesOff();
+    }
+    for (int i = 0; i < CONTINUOUS_SLOTS; i++) {
+        continuous_[i].active = false;
+    }
+    ProcessMessageQueue();
+    
+    bool wasEnabled = mpeEnabled_;
+    mpeEnabled_ = enabled;
+    mpeMemberCount_ = memberChannels;
+    mpeBendRange_ = bendRange;
+    ResetChannelAllocation();
+    
+    if (enabled) {
+        midiChannel_ = MPE_MASTER_CHANNEL;
+    } else if (config_) {
+        midiChannel_ = config_->GetSnapshot()->midiChannel;
+    }
+    
+    if (enabled || wasEnabled) {
+        SendMpeConfiguration();
+    }
+}
+
+bool MidiController::IsMpeEnabled() {
+    return mpeEnabled_;
+}
+
 // Queue management
 bool MidiController::HasPendingMessages() {
     return queueCount_ > 0;
@@ -205,10 +324,10 @@ bool MidiController::SelfTest() {
 
 // Advanced features
 void MidiController::SendSysEx(uint8_t* data, size_t length) {
-    if (!enabled_ || length < 1) return;
+    if (!enabled_ || length < 1 || length > SYSEX_BUFFER_SIZE - 2) return;
     
     // SysEx messages start with 0xF0 and end with 0xF7
-    uint8_t* sysexMsg = new uint8_t[length + 2];
+    uint8_t* sysexMsg = sysExBuffer_;
     sysexMsg[0] = 0xF0; // SysEx start
     for (size_t i = 0; i < length; i++) {
         sysexMsg[i + 1] = data[i];
@@ -227,7 +346,6 @@ void MidiController::SendSysEx(uint8_t* data, size_t length) {
         }
     }
     
-    delete[] sysexMsg;
     messagesSent_++;
 }
 
@@ -257,21 +375,21 @@ void MidiController::SendSongPosition(uint16_t position) {
 }
 
 void MidiController::SendClock() {
-    SendMidiMessage(0xF8); // MIDI Clock
+    SendMidiMessage(MIDI_TIMING_CLOCK);
 }
 
 void MidiController::SendStart() {
-    SendMidiMessage(0xFA); // MIDI Start
+    SendMidiMessage(MIDI_START);
     clockRunning_ = true;
 }
 
 void MidiController::SendStop() {
-    SendMidiMessage(0xFC); // MIDI Stop
+    SendMidiMessage(MIDI_STOP);
     clockRunning_ = false;
 }
 
 void MidiController::SendContinue() {
-    SendMidiMessage(0xFB); // MIDI Continue
+    SendMidiMessage(MIDI_CONTINUE);
     clockRunning_ = true;
 }
 
@@ -411,6 +529,260 @@ bool MidiController::IsQueueFull() {
     return queueCount_ >= MESSAGE_QUEUE_SIZE;
 }
 
+// Per-note expression
+void MidiController::SendNotePressure(uint8_t note, uint8_t pressure) {
+    if (!mpeEnabled_) {
+        SendPolyPressure(note, pressure);
+        return;
+    }
+    if (!enabled_ || !IsValidNote(note) || pressure > 127 || noteChannel_[note] == 0) {
+        return;
+    }
+    
+    uint8_t status = CreateStatusByte(MIDI_CHANNEL_PRESSURE, noteChannel_[note]);
+    QueueContinuous(status, 0, pressure, PRESSURE_CHANGE_THRESHOLD);
+}
+
+void MidiController::SendNoteBend(uint8_t note, uint16_t value) {
+    if (!enabled_ || !mpeEnabled_ || !IsValidNote(note) || noteChannel_[note] == 0) {
+        return;
+    }
+    
+    uint8_t status = CreateStatusByte(MIDI_PITCH_BEND, noteChannel_[note]);
+    QueueContinuous(status, 0, value & 0x3FFF, BEND_CHANGE_THRESHOLD);
+}
+
+void MidiController::SendNoteTimbre(uint8_t note, uint8_t value) {
+    if (!enabled_ || !mpeEnabled_ || !IsValidNote(note) || value > 127 || noteChannel_[note] == 0) {
+        return;
+    }
+    
+    uint8_t status = CreateStatusByte(MIDI_CONTROL_CHANGE, noteChannel_[note]);
+    QueueContinuous(status, MIDI_CC_BRIGHTNESS, value, PRESSURE_CHANGE_THRESHOLD);
+}
+
+// Continuous message coalescing
+// A new value replaces the pending one, so a fast sensor costs one slot instead of
+// a queue full of stale values. Changes below the threshold are dropped, except a
+// return to zero which always goes out.
+void MidiController::QueueContinuous(uint8_t status, uint8_t data1, uint16_t value, uint16_t threshold) {
+    ContinuousMessage* slot = nullptr;
+    ContinuousMessage* freeSlot = nullptr;
+    for (int i = 0; i < CONTINUOUS_SLOTS; i++) {
+        ContinuousMessage& entry = continuous_[i];
+        if (entry.active && entry.status == status && entry.data1 == data1) {
+            slot = &entry;
+            break;
+        }
+        if (!entry.active && freeSlot == nullptr) {
+            freeSlot = &entry;
+        }
+    }
+    
+    if (slot == nullptr) {
+        if (freeSlot == nullptr) {
+            return; // All slots in use, drop the update
+        }
+        slot = freeSlot;
+        slot->status = status;
+        slot->data1 = data1;
+        // Values start where a new note leaves them, see AllocateChannel()
+        if ((status & 0xF0) == MIDI_PITCH_BEND) {
+            slot->sentValue = PITCH_BEND_CENTER;
+        } else if ((status & 0xF0) == MIDI_CONTROL_CHANGE && data1 == MIDI_CC_BRIGHTNESS) {
+            slot->sentValue = TIMBRE_CENTER;
+        } else {
+            slot->sentValue = 0;
+        }
+        slot->pending = false;
+        slot->active = true;
+    }
+    
+    int change = (int)value - (int)slot->sentValue;
+    if (change < 0) change = -change;
+    if (change < threshold && value != 0 && !slot->pending) {
+        return;
+    }
+    
+    slot->value = value;
+    slot->pending = (value != slot->sentValue);
+}
+
+void MidiController::CancelContinuous(uint8_t status, uint8_t data1) {
+    for (int i = 0; i < CONTINUOUS_SLOTS; i++) {
+        ContinuousMessage& entry = continuous_[i];
+        if (entry.active && entry.status == status && entry.data1 == data1) {
+            entry.active = false;
+            entry.pending = false;
+        }
+    }
+}
+
+void MidiController::FlushContinuous() {
+    uint32_t now = daisy::System::GetNow();
+    if (now - lastContinuousFlush_ < CONTINUOUS_INTERVAL_MS) {
+        return;
+    }
+    lastContinuousFlush_ = now;
+    
+    uint8_t sent = 0;
+    for (int n = 0; n < CONTINUOUS_SLOTS && sent < CONTINUOUS_MAX_PER_FLUSH && !IsQueueFull(); n++) {
+        ContinuousMessage& entry = continuous_[continuousCursor_];
+        continuousCursor_ = (continuousCursor_ + 1) % CONTINUOUS_SLOTS;
+        if (!entry.active || !entry.pending) {
+            continue;
+        }
+        
+        switch (entry.status & 0xF0) {
+            case MIDI_PITCH_BEND:
+                QueueMessage(entry.status, entry.value & 0x7F, (entry.value >> 7) & 0x7F);
+                break;
+            case MIDI_CHANNEL_PRESSURE:
+                QueueMessage(entry.status, entry.value & 0x7F);
+                break;
+            default:
+                QueueMessage(entry.status, entry.data1, entry.value & 0x7F);
+                break;
+        }
+        entry.sentValue = entry.value;
+        entry.pending = false;
+        sent++;
+    }
+}
+
+// MPE channel allocation
+// Idle member channels wait in a FIFO so the channel released longest ago is
+// reused first and a release tail is not disturbed by the next note's reset.
+// When every channel is busy notes share channels round-robin.
+uint8_t MidiController::AllocateChannel(uint8_t note) {
+    if (noteChannel_[note] != 0) {
+        return noteChannel_[note];      // Retrigger on the same channel
+    }
+    
+    uint8_t channel;
+    if (freeCount_ > 0) {
+        channel = freeChannels_[freeHead_];
+        freeHead_ = (freeHead_ + 1) % 16;
+        freeCount_--;
+    } else {
+        channel = MPE_MASTER_CHANNEL + 1 + stealCursor_;
+        stealCursor_ = (stealCursor_ + 1) % mpeMemberCount_;
+    }
+    
+    // A fresh channel starts from neutral expression, sent before the note on
+    if (channelNotes_[channel - 1] == 0) {
+        CancelChannelExpression(channel);
+        QueueMessage(CreateStatusByte(MIDI_PITCH_BEND, channel),
+                     PITCH_BEND_CENTER & 0x7F, PITCH_BEND_CENTER >> 7);
+        QueueMessage(CreateStatusByte(MIDI_CONTROL_CHANGE, channel), MIDI_CC_BRIGHTNESS, TIMBRE_CENTER);
+        QueueMessage(CreateStatusByte(MIDI_CHANNEL_PRESSURE, channel), 0);
+    }
+    
+    channelNotes_[channel - 1]++;
+    noteChannel_[note] = channel;
+    return channel;
+}
+
+void MidiController::ReleaseChannel(uint8_t note) {
+    uint8_t channel = noteChannel_[note];
+    if (channel == 0) {
+        return;
+    }
+    noteChannel_[note] = 0;
+    
+    if (channelNotes_[channel - 1] > 0 && --channelNotes_[channel - 1] == 0) {
+        CancelChannelExpression(channel);
+        freeChannels_[(freeHead_ + freeCount_) % 16] = channel;
+        freeCount_++;
+    }
+}
+
+void MidiController::ResetChannelAllocation() {
+    for (int i = 0; i < 128; i++) {
+        noteChannel_[i] = 0;
+    }
+    for (int i = 0; i < 16; i++) {
+        channelNotes_[i] = 0;
+    }
+    
+    freeHead_ = 0;
+    freeCount_ = mpeMemberCount_;
+    stealCursor_ = 0;
+    for (int i = 0; i < mpeMemberCount_; i++) {
+        freeChannels_[i] = MPE_MASTER_CHANNEL + 1 + i;
+    }
+}
+
+void MidiController::CancelChannelExpression(uint8_t channel) {
+    CancelContinuous(CreateStatusByte(MIDI_PITCH_BEND, channel), 0);
+    CancelContinuous(CreateStatusByte(MIDI_CHANNEL_PRESSURE, channel), 0);
+    CancelContinuous(CreateStatusByte(MIDI_CONTROL_CHANGE, channel), MIDI_CC_BRIGHTNESS);
+}
+
+// MPE Configuration Message (RPN 6 on the master channel) and the member channel
+// pitch bend range (RPN 0). Sent directly, the burst is larger than the queue.
+void MidiController::SendMpeConfiguration() {
+    SendRpn(MPE_MASTER_CHANNEL, 0, 6, mpeEnabled_ ? mpeMemberCount_ : 0);
+    
+    if (mpeEnabled_) {
+        for (int i = 0; i < mpeMemberCount_; i++) {
+            SendRpn(MPE_MASTER_CHANNEL + 1 + i, 0, 0, mpeBendRange_);
+        }
+    }
+}
+
+void MidiController::SendRpn(uint8_t channel, uint8_t msb, uint8_t lsb, uint8_t value) {
+    uint8_t status = CreateStatusByte(MIDI_CONTROL_CHANGE, channel);
+    SendMidiMessage(status, MIDI_CC_RPN_MSB, msb);
+    SendMidiMessage(status, MIDI_CC_RPN_LSB, lsb);
+    SendMidiMessage(status, MIDI_CC_DATA_ENTRY, value);
+    SendMidiMessage(status, MIDI_CC_DATA_ENTRY_LSB, 0);
+    
+    // Null RPN so later data entry messages do not change the parameter
+    SendMidiMessage(status, MIDI_CC_RPN_MSB, 127);
+    SendMidiMessage(status, MIDI_CC_RPN_LSB, 127);
+}
+
+void MidiController::ProcessIncomingMessages() {
+    usbMidi_.Listen();
+    while (usbMidi_.HasEvents()) {
+        HandleMidiEvent(usbMidi_.PopEvent());
+    }
+    
+    uartMidi_.Listen();
+    while (uartMidi_.HasEvents()) {
+        HandleMidiEvent(uartMidi_.PopEvent());
+    }
+}
+
+void MidiController::HandleMidiEvent(daisy::MidiEvent event) {
+    // libDaisy channels are 0-15
+    if (event.type == daisy::ProgramChange && event.channel == midiChannel_ - 1) {
+        if (programChangeCallback_) {
+            programChangeCallback_(event.AsProgramChange().program);
+        }
+    }
+    
+    // SysEx is channel independent
+    if (event.type == daisy::SystemCommon && event.sc_type == daisy::SystemExclusive) {
+        if (sysExCallback_) {
+            daisy::SystemExclusiveEvent sysex = event.AsSystemExclusive();
+            sysExCallback_(sysex.data, sysex.length);
+        }
+    }
+    
+    // Transport and clock for the arpeggiator
+    if (event.type == daisy::SystemRealTime && clockCallback_) {
+        switch (event.srt_type) {
+            case daisy::TimingClock: clockCallback_(MIDI_TIMING_CLOCK); break;
+            case daisy::Start:       clockCallback_(MIDI_START); break;
+            case daisy::Continue:    clockCallback_(MIDI_CONTINUE); break;
+            case daisy::Stop:        clockCallback_(MIDI_STOP); break;
+            default: break;
+        }
+    }
+}
+
 void MidiController::SendViaUSB(uint8_t* data, size_t length) {
     usbMidi_.SendMessage(data, length);
     // Note: SendMessage returns void, no error checking available
@@ -424,6 +796,7 @@ void MidiController::InitializeUSB() {
     daisy::MidiUsbHandler::Config usbConfig;
     usbConfig.transport_config.periph = daisy::MidiUsbTransport::Config::INTERNAL;
     usbMidi_.Init(usbConfig);
+    usbMidi_.StartReceive();
     usbConnected_ = true; // Assume connected for now
 }
 
@@ -431,6 +804,7 @@ void MidiController::InitializeUART() {
     daisy::MidiUartHandler::Config uartConfig;
     // Use default UART configuration - pins D14/D15 for UART1
     uartMidi_.Init(uartConfig);
+    uartMidi_.StartReceive();
     uartConnected_ = true; // Assume connected for now
 }
 
@@ -2,6 +2,7 @@
 #include "daisy_seed.h"
 #include "ConfigManager.h"
 #include "hid/midi.h"
+#include "NoteSink.h"
 
 // MIDI message types
 enum MidiMessageType {
@@ -15,15 +16,28 @@ enum MidiMessageType {
     MIDI_SYSTEM_EXCLUSIVE = 0xF0
 };
 
+// System real-time messages
+enum MidiRealTime {
+    MIDI_TIMING_CLOCK = 0xF8,   // 24 per quarter note
+    MIDI_START = 0xFA,
+    MIDI_CONTINUE = 0xFB,
+    MIDI_STOP = 0xFC
+};
+
 // Common MIDI control change numbers
 enum MidiControlChange {
     MIDI_CC_MODULATION = 1,
+    MIDI_CC_DATA_ENTRY = 6,
     MIDI_CC_VOLUME = 7,
     MIDI_CC_PAN = 10,
     MIDI_CC_EXPRESSION = 11,
+    MIDI_CC_DATA_ENTRY_LSB = 38,
     MIDI_CC_SUSTAIN = 64,
+    MIDI_CC_BRIGHTNESS = 74,    // MPE timbre
     MIDI_CC_REVERB = 91,
     MIDI_CC_CHORUS = 93,
+    MIDI_CC_RPN_LSB = 100,
+    MIDI_CC_RPN_MSB = 101,
     MIDI_CC_ALL_NOTES_OFF = 123
 };
 
@@ -43,7 +57,26 @@ struct MidiMessage {
     bool hasData2;  // Some messages only have 1 data byte
 };
 
-class MidiController {
+// Latest value of a continuous message (pressure, pitch bend), sent at a bounded rate
+struct ContinuousMessage {
+    uint8_t status;
+    uint8_t data1;          // Note for poly pressure, unused otherwise
+    uint16_t value;         // 7-bit, 14-bit for pitch bend
+    uint16_t sentValue;
+    bool pending;
+    bool active;
+};
+
+// Called from Update() for program changes received on the configured channel
+typedef void (*ProgramChangeCallback)(uint8_t program);
+
+// Called from Update() for every received SysEx message, data excludes F0/F7
+typedef void (*SysExCallback)(const uint8_t* data, size_t length);
+
+// Called from Update() for received clock, start, continue and stop (MidiRealTime)
+typedef void (*ClockCallback)(uint8_t message);
+
+class MidiController : public NoteOutput {
 public:
     MidiController();
     ~MidiController();
@@ -55,8 +88,8 @@ public:
     void Update();
     
     // Note messages
-    void SendNoteOn(uint8_t note, uint8_t velocity);
-    void SendNoteOff(uint8_t note);
+    void SendNoteOn(uint8_t note, uint8_t velocity) override;
+    void SendNoteOff(uint8_t note) override;
     void SendNoteOff(uint8_t note, uint8_t velocity);
     void SendAllNotesOff();
     
@@ -67,10 +100,22 @@ public:
     void SendChannelPressure(uint8_t pressure);
     void SendPolyPressure(uint8_t note, uint8_t pressure);
     
+    // Per-note expression (MPE member channel, poly pressure otherwise)
+    void SendNotePressure(uint8_t note, uint8_t pressure);
+    void SendNoteBend(uint8_t note, uint16_t value);    // MPE only, 14-bit, 0x2000 = center
+    void SendNoteTimbre(uint8_t note, uint8_t value);   // MPE only, CC74
+    
+    // MIDI input
+    void SetProgramChangeCallback(ProgramChangeCallback callback);
+    void SetSysExCallback(SysExCallback callback);
+    void SetClockCallback(ClockCallback callback);
+    
     // Configuration
     void SetChannel(uint8_t channel);
     void SetOutputMode(MidiOutputMode mode);
     void SetEnabled(bool enabled);
+    void SetMpeMode(bool enabled, uint8_t memberChannels, uint8_t bendRange);
+    bool IsMpeEnabled();
     
     // Queue management
     bool HasPendingMessages();
@@ -86,7 +131,7 @@ public:
     bool SelfTest();
     
     // Advanced features
-    void SendSysEx(uint8_t* data, size_t length);
+    void SendSysEx(uint8_t* data, size_t length);   // Up to SYSEX_BUFFER_SIZE - 2 bytes
     void SendMTC(uint8_t frameType, uint8_t value);  // MIDI Time Code
     void SendSongPosition(uint16_t position);
     void SendClock();
@@ -109,8 +154,20 @@ private:
     
     // Configuration
     uint8_t midiChannel_;
+    uint32_t configVersion_;    // Published configuration version midiChannel_ was read from
     MidiOutputMode outputMode_;
     bool enabled_;
+    
+    // MPE lower zone, member channels are handed out per note in O(1)
+    bool mpeEnabled_;
+    uint8_t mpeMemberCount_;
+    uint8_t mpeBendRange_;
+    uint8_t noteChannel_[128];      // Member channel of each sounding note, 0 = none
+    uint8_t channelNotes_[16];      // Sounding notes per channel
+    uint8_t freeChannels_[16];      // FIFO of idle member channels, least recently used first
+    uint8_t freeHead_;
+    uint8_t freeCount_;
+    uint8_t stealCursor_;           // Round-robin channel sharing when all are busy
     bool usbConnected_;
     bool uartConnected_;
     
@@ -121,6 +178,21 @@ private:
     uint8_t queueTail_;
     uint8_t queueCount_;
     
+    // Continuous message coalescing, only the latest value per message is kept
+    static const uint8_t CONTINUOUS_SLOTS = 32;
+    ContinuousMessage continuous_[CONTINUOUS_SLOTS];
+    uint8_t continuousCursor_;      // Round-robin start of the next flush
+    uint32_t lastContinuousFlush_;
+    
+    // MIDI input
+    ProgramChangeCallback programChangeCallback_;
+    SysExCallback sysExCallback_;
+    ClockCallback clockCallback_;
+    
+    // Outgoing SysEx framing
+    static const size_t SYSEX_BUFFER_SIZE = 128;
+    uint8_t sysExBuffer_[SYSEX_BUFFER_SIZE];
+    
     // Status tracking
     uint32_t messagesSent_;
     uint32_t lastActivityTime_;
@@ -148,6 +220,23 @@ private:
     void ProcessMessageQueue();
     bool IsQueueFull();
     
+    // Continuous message coalescing
+    void QueueContinuous(uint8_t status, uint8_t data1, uint16_t value, uint16_t threshold);
+    void CancelContinuous(uint8_t status, uint8_t data1);
+    void FlushContinuous();
+    
+    // MPE
+    uint8_t AllocateChannel(uint8_t note);
+    void ReleaseChannel(uint8_t note);
+    void ResetChannelAllocation();
+    void CancelChannelExpression(uint8_t channel);
+    void SendMpeConfiguration();
+    void SendRpn(uint8_t channel, uint8_t msb, uint8_t lsb, uint8_t value);
+    
+    // MIDI input
+    void ProcessIncomingMessages();
+    void HandleMidiEvent(daisy::MidiEvent event);
+    
     // Hardware interfaces
     void SendViaUSB(uint8_t* data, size_t length);
     void SendViaUART(uint8_t* data, size_t length);
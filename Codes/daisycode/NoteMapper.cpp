@@ -0,0 +1,105 @@
+#include "NoteMapper.h"
+
+// Scale table, pitch classes as 12-bit masks (bit 0 = root)
+static const uint16_t SCALE_MASKS[SCALE_COUNT] = {
+    0x0FFF,     // Fixed interval (unused)
+    0x0FFF,     // Chromatic
+    0x0AB5,     // Major:            0 2 4 5 7 9 11
+    0x06AD,     // Dorian:           0 2 3 5 7 9 10
+    0x05AB,     // Phrygian:         0 1 3 5 7 8 10
+    0x0AD5,     // Lydian:           0 2 4 6 7 9 11
+    0x06B5,     // Mixolydian:       0 2 4 5 7 9 10
+    0x05AD,     // Minor:            0 2 3 5 7 8 10
+    0x056B,     // Locrian:          0 1 3 5 6 8 10
+    0x09AD,     // Harmonic minor:   0 2 3 5 7 8 11
+    0x0295,     // Major pentatonic: 0 2 4 7 9
+    0x04A9,     // Minor pentatonic: 0 3 5 7 10
+    0x04E9,     // Blues:            0 3 5 6 7 10
+    0x0555,     // Whole tone:       0 2 4 6 8 10
+    0x0FFF      // Custom (replaced by the configured mask)
+};
+
+// Chord table: scale degree offsets for diatonic chords, semitones otherwise
+struct ChordShape {
+    uint8_t count;
+    bool diatonic;
+    uint8_t offsets[NoteMapper::MAX_CHORD_NOTES];
+};
+
+static const ChordShape CHORD_SHAPES[CHORD_MODE_COUNT] = {
+    { 1, true,  { 0, 0, 0, 0 } },      // Off
+    { 3, true,  { 0, 2, 4, 0 } },      // Triad
+    { 4, true,  { 0, 2, 4, 6 } },      // Seventh
+    { 3, false, { 0, 7, 12, 0 } },     // Power
+    { 2, false, { 0, 12, 0, 0 } }      // Octave
+};
+
+// Constructor
+NoteMapper::NoteMapper()
+    : stepCount_(12), fixedInterval_(true), interval_(1), root_(60) {
+    for (int i = 0; i < 12; i++) {
+        steps_[i] = i;
+    }
+    for (int i = 0; i < MAX_BEAMS; i++) {
+        beams_[i].count = 1;
+        beams_[i].notes[0] = 60 + i;
+    }
+}
+
+// Destructor
+NoteMapper::~NoteMapper() {
+}
+
+// Compilation
+void NoteMapper::Compile(const LaserHarpConfig& config) {
+    LoadScale(config.scale, config.customScaleMask);
+    fixedInterval_ = (config.scale == SCALE_FIXED_INTERVAL);
+    interval_ = config.noteInterval;
+    root_ = config.baseNote + config.transpose;
+
+    uint8_t mode = config.chordMode < CHORD_MODE_COUNT ? config.chordMode : CHORD_OFF;
+    const ChordShape& shape = CHORD_SHAPES[mode];
+
+    for (int beam = 0; beam < MAX_BEAMS; beam++) {
+        BeamNotes* entry = &beams_[beam];
+        entry->count = 0;
+
+        int rootNote = DegreeToNote(beam);
+        for (int k = 0; k < shape.count; k++) {
+            int note = shape.diatonic ? DegreeToNote(beam + shape.offsets[k])
+                                      : rootNote + shape.offsets[k];
+            // Chord tones outside the MIDI range are dropped
+            if (note >= 0 && note <= 127) {
+                entry->notes[entry->count++] = (uint8_t)note;
+            }
+        }
+
+        // Keep at least one note so a beam never goes silent, clamped into range
+        if (entry->count == 0) {
+            entry->notes[0] = rootNote < 0 ? 0 : 127;
+            entry->count = 1;
+        }
+    }
+}
+
+// Private methods
+void NoteMapper::LoadScale(uint8_t scale, uint16_t customMask) {
+    uint16_t mask = SCALE_MASKS[scale < SCALE_COUNT ? scale : SCALE_CHROMATIC];
+    if (scale == SCALE_CUSTOM) {
+        mask = (customMask & 0x0FFF) | 0x0001;     // The root is always part of the scale
+    }
+
+    stepCount_ = 0;
+    for (int pitch = 0; pitch < 12; pitch++) {
+        if (mask & (1 << pitch)) {
+            steps_[stepCount_++] = pitch;
+        }
+    }
+}
+
+int NoteMapper::DegreeToNote(int degree) const {
+    if (fixedInterval_) {
+        return root_ + degree * interval_;
+    }
+    return root_ + 12 * (degree / stepCount_) + steps_[degree % stepCount_];
+}
\ No newline at end of file
@@ -0,0 +1,73 @@
+#pragma once
+#include <stdint.h>
+#include "ConfigManager.h"
+
+// Scales available for the beam note mapping
+enum ScaleType {
+    SCALE_FIXED_INTERVAL = 0,   // baseNote + beam * noteInterval
+    SCALE_CHROMATIC,
+    SCALE_MAJOR,                // Ionian
+    SCALE_DORIAN,
+    SCALE_PHRYGIAN,
+    SCALE_LYDIAN,
+    SCALE_MIXOLYDIAN,
+    SCALE_MINOR,                // Aeolian
+    SCALE_LOCRIAN,
+    SCALE_HARMONIC_MINOR,
+    SCALE_MAJOR_PENTATONIC,
+    SCALE_MINOR_PENTATONIC,
+    SCALE_BLUES,
+    SCALE_WHOLE_TONE,
+    SCALE_CUSTOM,               // 12-bit pitch class mask from the configuration
+    SCALE_COUNT
+};
+
+// Chord played by each beam
+enum ChordMode {
+    CHORD_OFF = 0,              // Single note
+    CHORD_TRIAD,                // Scale degrees 1-3-5
+    CHORD_SEVENTH,              // Scale degrees 1-3-5-7
+    CHORD_POWER,                // Root, fifth and octave (semitones)
+    CHORD_OCTAVE,               // Root and octave (semitones)
+    CHORD_MODE_COUNT
+};
+
+// Notes triggered by one beam
+struct BeamNotes {
+    uint8_t count;
+    uint8_t notes[4];
+};
+
+// Compiles the configuration into a per-beam note table so triggering a beam
+// is a single lookup, even for chords. Compile() runs in the main loop when the
+// configuration changes.
+class NoteMapper {
+public:
+    NoteMapper();
+    ~NoteMapper();
+
+    static const uint8_t MAX_BEAMS = 16;
+    static const uint8_t MAX_CHORD_NOTES = 4;
+
+    // Compilation
+    void Compile(const LaserHarpConfig& config);
+
+    // Lookup (hot path)
+    inline const BeamNotes& GetBeamNotes(uint8_t beam) const {
+        return beams_[beam < MAX_BEAMS ? beam : 0];
+    }
+
+private:
+    BeamNotes beams_[MAX_BEAMS];
+
+    // Scale being compiled
+    uint8_t steps_[12];         // Semitone offsets of the scale degrees within an octave
+    uint8_t stepCount_;
+    bool fixedInterval_;
+    uint8_t interval_;
+    int root_;
+
+    // Private methods
+    void LoadScale(uint8_t scale, uint16_t customMask);
+    int DegreeToNote(int degree) const;
+};
\ No newline at end of file
@@ -0,0 +1,96 @@
+#include "NoteScheduler.h"
+
+// Constructor
+NoteScheduler::NoteScheduler()
+    : synth_(nullptr), midi_(nullptr), config_(nullptr), pendingCount_(0) {
+}
+
+// Destructor
+NoteScheduler::~NoteScheduler() {
+}
+
+// Initialization
+void NoteScheduler::Init(TimedNoteSink* synth, NoteOutput* midi, ConfigManager* config) {
+    synth_ = synth;
+    midi_ = midi;
+    config_ = config;
+    pendingCount_ = 0;
+}
+
+// Scheduling
+uint32_t NoteScheduler::Now() const {
+    return synth_ ? synth_->GetSampleTime() : 0;
+}
+
+void NoteScheduler::ScheduleNoteOn(uint32_t time, uint8_t note, uint8_t velocity, uint8_t beam) {
+    if (note > 127 || velocity == 0) return;
+    
+    const LaserHarpConfig* cfg = config_ ? config_->GetSnapshot() : nullptr;
+    bool toSynth = synth_ && (!cfg || cfg->audioEnabled);
+    bool toMidi = midi_ && (!cfg || cfg->midiEnabled);
+    
+    // Room is checked on both sides before either output gets the note
+    if (toMidi && pendingCount_ >= MAX_PENDING) return;
+    if (toSynth && !synth_->NoteOnAt(time, note, velocity, beam)) return;
+    if (toMidi) {
+        QueueMidi(time, note, velocity);
+    }
+}
+
+void NoteScheduler::ScheduleNoteOff(uint32_t time, uint8_t note) {
+    if (note > 127) return;
+    
+    // Note offs are not filtered by the output switches so nothing is left hanging
+    if (synth_) {
+        synth_->NoteOffAt(time, note);
+    }
+    if (midi_) {
+        QueueMidi(time, note, 0);
+    }
+}
+
+// Main loop processing
+void NoteScheduler::Update() {
+    uint32_t now = Now();
+    while (pendingCount_ > 0) {
+        const ScheduledNote& next = pending_[pendingCount_ - 1];
+        if ((int32_t)(next.time - now) > 0) {
+            break;
+        }
+        SendMidi(next);
+        pendingCount_--;
+    }
+}
+
+// Private methods
+// Same ordering as the synthesizer: at equal times a note off goes first
+void NoteScheduler::QueueMidi(uint32_t time, uint8_t note, uint8_t velocity) {
+    ScheduledNote event = { time, note, velocity };
+    
+    if (pendingCount_ >= MAX_PENDING) {
+        // Full: a note off is sent early rather than lost (note ons never get here)
+        SendMidi(event);
+        return;
+    }
+    
+    int i = pendingCount_;
+    while (i > 0) {
+        const ScheduledNote& later = pending_[i - 1];
+        int32_t diff = (int32_t)(later.time - time);
+        if (diff > 0 || (diff == 0 && later.velocity != 0 && velocity == 0)) {
+            break;
+        }
+        pending_[i] = later;
+        i--;
+    }
+    pending_[i] = event;
+    pendingCount_++;
+}
+
+void NoteScheduler::SendMidi(const ScheduledNote& event) {
+    if (event.velocity > 0) {
+        midi_->SendNoteOn(event.note, event.velocity);
+    } else {
+        midi_->SendNoteOff(event.note);
+    }
+}
\ No newline at end of file
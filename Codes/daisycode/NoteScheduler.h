@@ -0,0 +1,49 @@
+#pragma once
+#include <stdint.h>
+#include "ConfigManager.h"
+#include "NoteSink.h"
+
+// Note event waiting for its MIDI send time
+struct ScheduledNote {
+    uint32_t time;              // Sample time, see TimedNoteSink::GetSampleTime()
+    uint8_t note;
+    uint8_t velocity;           // 0 = note off
+};
+
+// Timestamped note output shared by the arpeggiator and the looper. Times are
+// in samples of the audio render clock: the synthesizer starts each note on
+// its exact sample, MIDI goes out from Update() once the clock has reached the
+// note. Producers schedule ahead by at least one audio block (LOOKAHEAD).
+// A note on reaches both outputs or neither, so they never disagree.
+class NoteScheduler {
+public:
+    NoteScheduler();
+    ~NoteScheduler();
+    
+    // Initialization
+    void Init(TimedNoteSink* synth, NoteOutput* midi, ConfigManager* config);
+    
+    // Scheduling (main loop)
+    uint32_t Now() const;
+    void ScheduleNoteOn(uint32_t time, uint8_t note, uint8_t velocity, uint8_t beam);
+    void ScheduleNoteOff(uint32_t time, uint8_t note);
+    
+    // Main loop processing, sends the MIDI notes that are due
+    void Update();
+    
+    static const uint32_t LOOKAHEAD = 480;      // Samples, 10ms at 48kHz
+    static const uint8_t MAX_PENDING = 64;
+    
+private:
+    TimedNoteSink* synth_;
+    NoteOutput* midi_;
+    ConfigManager* config_;
+    
+    // Pending MIDI notes, latest first so the next one is at the end
+    ScheduledNote pending_[MAX_PENDING];
+    uint8_t pendingCount_;
+    
+    // Private methods
+    void QueueMidi(uint32_t time, uint8_t note, uint8_t velocity);
+    void SendMidi(const ScheduledNote& event);
+};
\ No newline at end of file
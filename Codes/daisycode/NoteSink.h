@@ -0,0 +1,21 @@
+#pragma once
+#include <stdint.h>
+
+// Outputs of the NoteScheduler. The synthesizer takes notes ahead of time and
+// starts them on their sample; MIDI takes them once they are due.
+class TimedNoteSink {
+public:
+    virtual ~TimedNoteSink() {}
+    virtual uint32_t GetSampleTime() const = 0;     // First sample of the next block to render
+    
+    // False if the note could not be queued
+    virtual bool NoteOnAt(uint32_t time, uint8_t note, uint8_t velocity, uint8_t beamIndex) = 0;
+    virtual bool NoteOffAt(uint32_t time, uint8_t note) = 0;
+};
+
+class NoteOutput {
+public:
+    virtual ~NoteOutput() {}
+    virtual void SendNoteOn(uint8_t note, uint8_t velocity) = 0;
+    virtual void SendNoteOff(uint8_t note) = 0;
+};
\ No newline at end of file
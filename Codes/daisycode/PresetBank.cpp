@@ -0,0 +1,191 @@
+#include "PresetBank.h"
+#include <cmath>
+#include <cstring>
+
+// Constants
+const uint32_t PRESET_STORE_ADDRESS = 0x7F4000;    // 32KB below the configuration region
+const uint8_t PRESET_STORE_SECTORS = 8;
+const uint16_t PRESET_RECORD_VERSION = 1;
+const float MIN_ENVELOPE_TIME = 0.001f;
+const float MAX_ENVELOPE_TIME = 10.0f;
+const float MIN_CUTOFF = 20.0f;
+const float MAX_CUTOFF = 20000.0f;
+const float MIN_DELAY_TIME = 0.001f;
+const float MAX_DELAY_TIME = 0.999f;
+const float MAX_DELAY_FEEDBACK = 0.95f;
+
+static_assert(sizeof(Preset) == 16, "Preset layout is stored in flash");
+
+// Constructor
+PresetBank::PresetBank() : storageReady_(false), saveRequested_(false) {
+    LoadFactoryPresets();
+}
+
+// Destructor
+PresetBank::~PresetBank() {
+}
+
+// Initialization
+void PresetBank::Init(FlashDevice* flash) {
+    LoadFactoryPresets();
+
+    if (flash) {
+        store_.Init(flash, PRESET_STORE_ADDRESS, PRESET_STORE_SECTORS,
+                    storageBuffer_, STORAGE_BUFFER_SIZE);
+        storageReady_ = true;
+
+        if (store_.GetRecordVersion() == PRESET_RECORD_VERSION &&
+            store_.GetRecordLength() == sizeof(presets_)) {
+            store_.ReadRecord(presets_, sizeof(presets_));
+        }
+    }
+}
+
+void PresetBank::Update() {
+    if (!storageReady_) {
+        return;
+    }
+
+    // The whole bank is one record, several Store() calls collapse into one write
+    if (saveRequested_ && !store_.IsBusy()) {
+        if (store_.BeginWrite(presets_, sizeof(presets_), PRESET_RECORD_VERSION)) {
+            saveRequested_ = false;
+        }
+    }
+
+    store_.Update();
+}
+
+// Preset access
+const Preset* PresetBank::GetPreset(uint8_t number) const {
+    if (number >= NUM_PRESETS) {
+        return nullptr;
+    }
+    return &presets_[number];
+}
+
+bool PresetBank::Recall(uint8_t number, ConfigManager* config) {
+    if (number >= NUM_PRESETS || config == nullptr) {
+        return false;
+    }
+
+    LaserHarpConfig* cfg = config->GetConfig();
+    Decode(presets_[number], cfg);
+    cfg->currentPreset = number;
+    config->Publish();
+    return true;
+}
+
+bool PresetBank::Store(uint8_t number, const LaserHarpConfig& config) {
+    if (number >= NUM_PRESETS) {
+        return false;
+    }
+
+    Encode(config, &presets_[number]);
+    if (storageReady_) {
+        saveRequested_ = true;
+    }
+    return true;
+}
+
+// Every preset starts from the default sound, cycling through the four waveforms
+void PresetBank::LoadFactoryPresets() {
+    LaserHarpConfig config;
+    ConfigManager::FillDefaults(&config);
+
+    for (int i = 0; i < NUM_PRESETS; i++) {
+        config.waveform = i % 4;
+        Encode(config, &presets_[i]);
+    }
+}
+
+bool PresetBank::IsSaving() const {
+    return saveRequested_ || store_.IsBusy();
+}
+
+// Raw bank access
+const uint8_t* PresetBank::GetRawData() const {
+    return reinterpret_cast<const uint8_t*>(presets_);
+}
+
+size_t PresetBank::GetRawSize() const {
+    return sizeof(presets_);
+}
+
+bool PresetBank::SetRawData(const uint8_t* data, size_t size) {
+    if (size != sizeof(presets_)) {
+        return false;
+    }
+    memcpy(presets_, data, sizeof(presets_));
+    return true;
+}
+
+void PresetBank::Save() {
+    if (storageReady_) {
+        saveRequested_ = true;
+    }
+}
+
+// Conversion between presets and the configuration
+void PresetBank::Encode(const LaserHarpConfig& config, Preset* preset) {
+    preset->waveform = config.waveform;
+    preset->attack = EncodeExp(config.attackTime, MIN_ENVELOPE_TIME, MAX_ENVELOPE_TIME);
+    preset->decay = EncodeExp(config.decayTime, MIN_ENVELOPE_TIME, MAX_ENVELOPE_TIME);
+    preset->sustain = EncodeLinear(config.sustainLevel, 1.0f);
+    preset->release = EncodeExp(config.releaseTime, MIN_ENVELOPE_TIME, MAX_ENVELOPE_TIME);
+    preset->cutoff = EncodeExp(config.filterCutoff, MIN_CUTOFF, MAX_CUTOFF);
+    preset->resonance = EncodeLinear(config.filterResonance, 1.0f);
+    preset->keyTracking = EncodeLinear(config.filterKeyTracking, 1.0f);
+    preset->reverbLevel = config.reverbEnabled ? EncodeLinear(config.reverbLevel, 1.0f) : 0;
+    preset->delayTime = EncodeExp(config.delayTime, MIN_DELAY_TIME, MAX_DELAY_TIME);
+    preset->delayFeedback = EncodeLinear(config.delayFeedback, MAX_DELAY_FEEDBACK);
+    preset->flags = (config.delayEnabled ? PRESET_FLAG_DELAY : 0) |
+                    ((config.chordMode << PRESET_CHORD_SHIFT) & PRESET_CHORD_MASK);
+    preset->baseNote = config.baseNote;
+    preset->noteInterval = config.noteInterval;
+    preset->scale = config.scale;
+    preset->volume = EncodeLinear(config.masterVolume, 1.0f);
+}
+
+// Only the sound and note mapping fields are touched, MIDI and beam settings stay
+void PresetBank::Decode(const Preset& preset, LaserHarpConfig* config) {
+    config->waveform = preset.waveform;
+    config->attackTime = DecodeExp(preset.attack, MIN_ENVELOPE_TIME, MAX_ENVELOPE_TIME);
+    config->decayTime = DecodeExp(preset.decay, MIN_ENVELOPE_TIME, MAX_ENVELOPE_TIME);
+    config->sustainLevel = DecodeLinear(preset.sustain, 1.0f);
+    config->releaseTime = DecodeExp(preset.release, MIN_ENVELOPE_TIME, MAX_ENVELOPE_TIME);
+    config->filterCutoff = DecodeExp(preset.cutoff, MIN_CUTOFF, MAX_CUTOFF);
+    config->filterResonance = DecodeLinear(preset.resonance, 1.0f);
+    config->filterKeyTracking = DecodeLinear(preset.keyTracking, 1.0f);
+    config->reverbEnabled = preset.reverbLevel > 0;
+    config->reverbLevel = DecodeLinear(preset.reverbLevel, 1.0f);
+    config->delayTime = DecodeExp(preset.delayTime, MIN_DELAY_TIME, MAX_DELAY_TIME);
+    config->delayFeedback = DecodeLinear(preset.delayFeedback, MAX_DELAY_FEEDBACK);
+    config->delayEnabled = (preset.flags & PRESET_FLAG_DELAY) != 0;
+    config->chordMode = (preset.flags & PRESET_CHORD_MASK) >> PRESET_CHORD_SHIFT;
+    config->baseNote = preset.baseNote < 128 ? preset.baseNote : 60;
+    config->noteInterval = preset.noteInterval;
+    config->scale = preset.scale;
+    config->masterVolume = DecodeLinear(preset.volume, 1.0f);
+}
+
+// Private methods
+uint8_t PresetBank::EncodeExp(float value, float minValue, float maxValue) {
+    if (!(value > minValue)) return 0;
+    if (value >= maxValue) return 255;
+    return (uint8_t)(255.0f * logf(value / minValue) / logf(maxValue / minValue) + 0.5f);
+}
+
+float PresetBank::DecodeExp(uint8_t code, float minValue, float maxValue) {
+    return minValue * powf(maxValue / minValue, (float)code / 255.0f);
+}
+
+uint8_t PresetBank::EncodeLinear(float value, float maxValue) {
+    if (!(value > 0.0f)) return 0;
+    if (value >= maxValue) return 255;
+    return (uint8_t)(255.0f * value / maxValue + 0.5f);
+}
+
+float PresetBank::DecodeLinear(uint8_t code, float maxValue) {
+    return maxValue * (float)code / 255.0f;
+}
\ No newline at end of file
@@ -0,0 +1,80 @@
+#pragma once
+#include <stdint.h>
+#include <stddef.h>
+#include "ConfigManager.h"
+#include "RecordStore.h"
+
+// Compact preset, 16 bytes. Times and frequencies use exponential 8-bit curves.
+struct Preset {
+    uint8_t waveform;
+    uint8_t attack;             // 1ms - 10s
+    uint8_t decay;              // 1ms - 10s
+    uint8_t sustain;            // 0.0 - 1.0
+    uint8_t release;            // 1ms - 10s
+    uint8_t cutoff;             // 20Hz - 20kHz
+    uint8_t resonance;          // 0.0 - 1.0
+    uint8_t keyTracking;        // 0.0 - 1.0
+    uint8_t reverbLevel;        // 0.0 - 1.0, 0 = reverb off
+    uint8_t delayTime;          // 1ms - 999ms
+    uint8_t delayFeedback;      // 0.0 - 0.95
+    uint8_t flags;              // PRESET_FLAG_* and chord mode
+    uint8_t baseNote;
+    uint8_t noteInterval;
+    uint8_t scale;
+    uint8_t volume;             // 0.0 - 1.0
+};
+
+// Preset flags
+enum PresetFlags {
+    PRESET_FLAG_DELAY = 0x01,
+    PRESET_CHORD_MASK = 0x0E,   // Bits 1-3: chord mode
+    PRESET_CHORD_SHIFT = 1
+};
+
+// Bank of 128 presets kept in RAM and stored as one record in QSPI flash
+class PresetBank {
+public:
+    PresetBank();
+    ~PresetBank();
+
+    // Initialization (without a flash device the bank is RAM only)
+    void Init(FlashDevice* flash = nullptr);
+
+    // Main loop processing, advances pending flash writes one step per call
+    void Update();
+
+    // Preset access
+    static const uint8_t NUM_PRESETS = 128;
+    static const size_t RAW_SIZE = NUM_PRESETS * sizeof(Preset);
+    const Preset* GetPreset(uint8_t number) const;
+    bool Recall(uint8_t number, ConfigManager* config);    // Writes the sound into the config and publishes
+    bool Store(uint8_t number, const LaserHarpConfig& config);
+    void LoadFactoryPresets();
+    bool IsSaving() const;
+
+    // Raw bank access for bulk transfers, Save() schedules a flash write
+    const uint8_t* GetRawData() const;
+    size_t GetRawSize() const;
+    bool SetRawData(const uint8_t* data, size_t size);     // Whole bank only
+    void Save();
+
+    // Conversion between presets and the configuration
+    static void Encode(const LaserHarpConfig& config, Preset* preset);
+    static void Decode(const Preset& preset, LaserHarpConfig* config);
+
+private:
+    Preset presets_[NUM_PRESETS];
+
+    // Persistent storage
+    static const size_t STORAGE_BUFFER_SIZE = 2304;     // Bank + record header, whole pages
+    RecordStore store_;
+    uint8_t storageBuffer_[STORAGE_BUFFER_SIZE];
+    bool storageReady_;
+    bool saveRequested_;
+
+    // Private methods
+    static uint8_t EncodeExp(float value, float minValue, float maxValue);
+    static float DecodeExp(uint8_t code, float minValue, float maxValue);
+    static uint8_t EncodeLinear(float value, float maxValue);
+    static float DecodeLinear(uint8_t code, float maxValue);
+};
\ No newline at end of file
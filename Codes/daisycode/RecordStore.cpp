@@ -0,0 +1,369 @@
+#include "RecordStore.h"
+#include <cstring>
+
+// Constants
+const uint32_t RECORD_MAGIC = 0x4352484C;          // "LHRC"
+const uint32_t QSPI_BASE_ADDRESS = 0x90000000;     // Memory-mapped QSPI window
+const uint32_t QSPI_SECTOR_SIZE = 4096;
+const uint32_t QSPI_PAGE_SIZE = 256;
+const uint32_t ERASED_WORD = 0xFFFFFFFF;
+
+// CRC32 nibble table (polynomial 0xEDB88320)
+static const uint32_t CRC32_TABLE[16] = {
+    0x00000000, 0x1DB71064, 0x3B6E20C8, 0x26D930AC,
+    0x76DC4190, 0x6B6B51F4, 0x4DB26158, 0x5005713C,
+    0xEDB88320, 0xF00F9344, 0xD6D6A3E8, 0xCB61B38C,
+    0x9B64C2B0, 0x86D3D2D4, 0xA00AE278, 0xBDBDF21C
+};
+
+// QspiFlashDevice
+QspiFlashDevice::QspiFlashDevice() : qspi_(nullptr) {
+}
+
+void QspiFlashDevice::Init(daisy::QSPIHandle* qspi) {
+    qspi_ = qspi;
+}
+
+uint32_t QspiFlashDevice::GetSectorSize() const {
+    return QSPI_SECTOR_SIZE;
+}
+
+uint32_t QspiFlashDevice::GetPageSize() const {
+    return QSPI_PAGE_SIZE;
+}
+
+bool QspiFlashDevice::Read(uint32_t address, void* buffer, size_t length) {
+    if (!qspi_) return false;
+    memcpy(buffer, qspi_->GetData(address), length);
+    return true;
+}
+
+bool QspiFlashDevice::Program(uint32_t address, const void* data, size_t length) {
+    if (!qspi_) return false;
+    bool ok = qspi_->Write(QSPI_BASE_ADDRESS + address, length, (uint8_t*)data)
+              == daisy::QSPIHandle::Result::OK;
+    // Drop stale cache lines of the memory-mapped window
+    SCB_InvalidateDCache_by_Addr((uint32_t*)(QSPI_BASE_ADDRESS + address), length);
+    return ok;
+}
+
+bool QspiFlashDevice::EraseSector(uint32_t address) {
+    if (!qspi_) return false;
+    bool ok = qspi_->EraseSector(QSPI_BASE_ADDRESS + address) == daisy::QSPIHandle::Result::OK;
+    SCB_InvalidateDCache_by_Addr((uint32_t*)(QSPI_BASE_ADDRESS + address), QSPI_SECTOR_SIZE);
+    return ok;
+}
+
+// Constructor
+RecordStore::RecordStore()
+    : flash_(nullptr), baseAddress_(0), numSectors_(0), sectorSize_(0), pageSize_(0),
+      hasRecord_(false), recordAddress_(0), headSector_(0), writeOffset_(0),
+      nextSequence_(1), headNeedsErase_(false), staging_(nullptr), stagingSize_(0),
+      stagedLength_(0), programOffset_(0), state_(STORE_IDLE), lastWriteFailed_(false) {
+    memset(&recordHeader_, 0, sizeof(recordHeader_));
+}
+
+// Destructor
+RecordStore::~RecordStore() {
+}
+
+// Initialization
+bool RecordStore::Init(FlashDevice* flash, uint32_t baseAddress, uint8_t numSectors,
+                       uint8_t* stagingBuffer, size_t stagingSize) {
+    if (!flash || !stagingBuffer || numSectors < MIN_SECTORS || numSectors > MAX_SECTORS) {
+        return false;
+    }
+
+    flash_ = flash;
+    baseAddress_ = baseAddress;
+    numSectors_ = numSectors;
+    sectorSize_ = flash->GetSectorSize();
+    pageSize_ = flash->GetPageSize();
+    staging_ = stagingBuffer;
+    stagingSize_ = stagingSize;
+    state_ = STORE_IDLE;
+    return Mount();
+}
+
+// Boot scan: the sector whose first record is valid and has the highest
+// sequence is the head, and only that sector is walked. A sector starting with
+// a torn record (power loss during its first write or its erase) holds nothing
+// valid and takes no part: its sequence field cannot be trusted.
+bool RecordStore::Mount() {
+    hasRecord_ = false;
+    nextSequence_ = 1;
+
+    bool anyValid = false;
+    uint32_t headSequence = 0;
+    headSector_ = 0;
+
+    for (uint8_t s = 0; s < numSectors_; s++) {
+        RecordHeader header;
+        uint32_t address = SectorAddress(s);
+        if (!ReadHeader(address, &header) || !ValidateRecord(address, header)) {
+            continue;
+        }
+        if (header.sequence >= nextSequence_) {
+            nextSequence_ = header.sequence + 1;
+        }
+        if (!anyValid || header.sequence > headSequence) {
+            headSector_ = s;
+            headSequence = header.sequence;
+        }
+        anyValid = true;
+    }
+
+    if (!anyValid) {
+        // Empty region, the first write erases sector 0 unless it is already blank
+        writeOffset_ = 0;
+        headNeedsErase_ = !IsSectorBlank(0);
+        return false;
+    }
+
+    ScanSector(headSector_, true, &writeOffset_);
+    headNeedsErase_ = false;
+    return hasRecord_;
+}
+
+// Latest record access
+bool RecordStore::HasRecord() const {
+    return hasRecord_;
+}
+
+uint32_t RecordStore::GetRecordLength() const {
+    return hasRecord_ ? recordHeader_.length : 0;
+}
+
+uint16_t RecordStore::GetRecordVersion() const {
+    return hasRecord_ ? recordHeader_.version : 0;
+}
+
+uint32_t RecordStore::GetRecordSequence() const {
+    return hasRecord_ ? recordHeader_.sequence : 0;
+}
+
+bool RecordStore::ReadRecord(void* buffer, size_t maxLength) {
+    if (!hasRecord_ || recordHeader_.length > maxLength) {
+        return false;
+    }
+    return flash_->Read(recordAddress_ + sizeof(RecordHeader), buffer, recordHeader_.length);
+}
+
+// Non-blocking write
+bool RecordStore::BeginWrite(const void* data, size_t length, uint16_t version) {
+    if (!flash_ || state_ != STORE_IDLE) {
+        return false;
+    }
+
+    uint32_t total = AlignToPage(sizeof(RecordHeader) + length);
+    if (total > stagingSize_ || total > sectorSize_) {
+        return false;
+    }
+
+    RecordHeader header;
+    header.magic = RECORD_MAGIC;
+    header.version = version;
+    header.reserved = 0xFFFF;
+    header.sequence = nextSequence_;
+    header.length = (uint32_t)length;
+    header.crc = 0;
+
+    // Padding stays erased so it costs no program time
+    memset(staging_, 0xFF, total);
+    memcpy(staging_, &header, sizeof(header));
+    memcpy(staging_ + sizeof(header), data, length);
+    header.crc = Crc32(staging_, sizeof(header) + length);
+    memcpy(staging_, &header, sizeof(header));
+
+    stagedLength_ = total;
+    programOffset_ = 0;
+    lastWriteFailed_ = false;
+
+    // Roll over to the next sector when the record does not fit
+    if (writeOffset_ + total > sectorSize_) {
+        headSector_ = (headSector_ + 1) % numSectors_;
+        writeOffset_ = 0;
+        headNeedsErase_ = true;
+    }
+
+    state_ = (writeOffset_ == 0 && headNeedsErase_) ? STORE_ERASING : STORE_PROGRAMMING;
+    return true;
+}
+
+// One flash operation per call so the main loop keeps running between steps.
+// Sector erase is the longest step (typically 45ms on the IS25LP064); the audio
+// callback runs from internal flash and is never blocked by it.
+void RecordStore::Update() {
+    switch (state_) {
+        case STORE_ERASING:
+            if (flash_->EraseSector(SectorAddress(headSector_))) {
+                headNeedsErase_ = false;
+                state_ = STORE_PROGRAMMING;
+            } else {
+                lastWriteFailed_ = true;
+                state_ = STORE_IDLE;
+            }
+            break;
+
+        case STORE_PROGRAMMING: {
+            uint32_t address = SectorAddress(headSector_) + writeOffset_ + programOffset_;
+            if (!flash_->Program(address, staging_ + programOffset_, pageSize_)) {
+                FinishWrite();
+                break;
+            }
+            programOffset_ += pageSize_;
+            if (programOffset_ >= stagedLength_) {
+                state_ = STORE_VERIFYING;
+            }
+            break;
+        }
+
+        case STORE_VERIFYING:
+            FinishWrite();
+            break;
+
+        case STORE_IDLE:
+        default:
+            break;
+    }
+}
+
+bool RecordStore::IsBusy() const {
+    return state_ != STORE_IDLE;
+}
+
+RecordStoreState RecordStore::GetState() const {
+    return state_;
+}
+
+bool RecordStore::LastWriteFailed() const {
+    return lastWriteFailed_;
+}
+
+uint32_t RecordStore::Crc32(const void* data, size_t length, uint32_t crc) {
+    const uint8_t* bytes = (const uint8_t*)data;
+    crc = ~crc;
+    for (size_t i = 0; i < length; i++) {
+        crc ^= bytes[i];
+        crc = (crc >> 4) ^ CRC32_TABLE[crc & 0x0F];
+        crc = (crc >> 4) ^ CRC32_TABLE[crc & 0x0F];
+    }
+    return ~crc;
+}
+
+// Private methods
+uint32_t RecordStore::SectorAddress(uint8_t sector) const {
+    return baseAddress_ + (uint32_t)sector * sectorSize_;
+}
+
+uint32_t RecordStore::AlignToPage(uint32_t length) const {
+    return (length + pageSize_ - 1) / pageSize_ * pageSize_;
+}
+
+bool RecordStore::ReadHeader(uint32_t address, RecordHeader* header) {
+    if (!flash_->Read(address, header, sizeof(RecordHeader))) {
+        return false;
+    }
+    return header->magic == RECORD_MAGIC;
+}
+
+bool RecordStore::ValidateRecord(uint32_t address, const RecordHeader& header) {
+    if (header.length > sectorSize_ - sizeof(RecordHeader)) {
+        return false;
+    }
+
+    RecordHeader zeroed = header;
+    zeroed.crc = 0;
+    uint32_t crc = Crc32(&zeroed, sizeof(zeroed));
+
+    // CRC the payload in small chunks to keep the stack small
+    uint8_t chunk[64];
+    uint32_t offset = 0;
+    while (offset < header.length) {
+        uint32_t n = header.length - offset;
+        if (n > sizeof(chunk)) n = sizeof(chunk);
+        if (!flash_->Read(address + sizeof(RecordHeader) + offset, chunk, n)) {
+            return false;
+        }
+        crc = Crc32(chunk, n, crc);
+        offset += n;
+    }
+    return crc == header.crc;
+}
+
+// Walks the records of one sector and reports where the next append may start
+bool RecordStore::ScanSector(uint8_t sector, bool updateIndex, uint32_t* endOffset) {
+    uint32_t sectorAddress = SectorAddress(sector);
+    uint32_t offset = 0;
+    bool found = false;
+
+    while (offset + sizeof(RecordHeader) <= sectorSize_) {
+        RecordHeader header;
+        if (!flash_->Read(sectorAddress + offset, &header, sizeof(header)) ||
+            header.magic == ERASED_WORD) {
+            break;
+        }
+
+        // A torn or foreign record cannot be measured, so the rest of the
+        // sector is closed and the next append rolls over to a fresh sector.
+        // Its sequence is not trusted either: a header torn after the magic
+        // reads 0xFFFFFFFF and would wrap the counter.
+        if (header.magic != RECORD_MAGIC || !ValidateRecord(sectorAddress + offset, header)) {
+            offset = sectorSize_;
+            break;
+        }
+
+        if (header.sequence >= nextSequence_) {
+            nextSequence_ = header.sequence + 1;
+        }
+
+        if (updateIndex && (!hasRecord_ || header.sequence > recordHeader_.sequence)) {
+            hasRecord_ = true;
+            recordAddress_ = sectorAddress + offset;
+            recordHeader_ = header;
+            found = true;
+        }
+        offset += AlignToPage(sizeof(RecordHeader) + header.length);
+    }
+
+    if (endOffset) {
+        *endOffset = offset;
+    }
+    return found;
+}
+
+bool RecordStore::IsSectorBlank(uint8_t sector) {
+    uint32_t address = SectorAddress(sector);
+    uint32_t words[16];
+    for (uint32_t offset = 0; offset < sectorSize_; offset += sizeof(words)) {
+        if (!flash_->Read(address + offset, words, sizeof(words))) {
+            return false;
+        }
+        for (int i = 0; i < 16; i++) {
+            if (words[i] != ERASED_WORD) return false;
+        }
+    }
+    return true;
+}
+
+void RecordStore::FinishWrite() {
+    uint32_t address = SectorAddress(headSector_) + writeOffset_;
+    RecordHeader header;
+    memcpy(&header, staging_, sizeof(header));
+
+    // The space is consumed whether or not the record verifies
+    writeOffset_ += stagedLength_;
+    nextSequence_ = header.sequence + 1;
+
+    RecordHeader stored;
+    if (state_ == STORE_VERIFYING && ReadHeader(address, &stored) &&
+        stored.crc == header.crc && ValidateRecord(address, stored)) {
+        hasRecord_ = true;
+        recordAddress_ = address;
+        recordHeader_ = stored;
+    } else {
+        lastWriteFailed_ = true;
+    }
+
+    state_ = STORE_IDLE;
+}
\ No newline at end of file
@@ -0,0 +1,124 @@
+#pragma once
+#include <stdint.h>
+#include <stddef.h>
+#include "daisy_seed.h"
+
+// Minimal flash interface so the record store does not depend on the QSPI driver
+// Addresses are offsets from the start of the flash device.
+class FlashDevice {
+public:
+    virtual ~FlashDevice() {}
+    virtual uint32_t GetSectorSize() const = 0;
+    virtual uint32_t GetPageSize() const = 0;
+    virtual bool Read(uint32_t address, void* buffer, size_t length) = 0;
+    virtual bool Program(uint32_t address, const void* data, size_t length) = 0;
+    virtual bool EraseSector(uint32_t address) = 0;
+};
+
+// Daisy Seed external QSPI flash (IS25LP064, 4KB sectors, 256 byte pages)
+class QspiFlashDevice : public FlashDevice {
+public:
+    QspiFlashDevice();
+    void Init(daisy::QSPIHandle* qspi);
+
+    uint32_t GetSectorSize() const override;
+    uint32_t GetPageSize() const override;
+    bool Read(uint32_t address, void* buffer, size_t length) override;
+    bool Program(uint32_t address, const void* data, size_t length) override;
+    bool EraseSector(uint32_t address) override;
+
+private:
+    daisy::QSPIHandle* qspi_;
+};
+
+// Record store states
+enum RecordStoreState {
+    STORE_IDLE,
+    STORE_ERASING,      // Next Update() erases the head sector
+    STORE_PROGRAMMING,  // Each Update() programs one page
+    STORE_VERIFYING     // Next Update() checks the CRC of the written record
+};
+
+// Header stored in front of every record
+struct RecordHeader {
+    uint32_t magic;
+    uint16_t version;       // Payload format version
+    uint16_t reserved;
+    uint32_t sequence;      // Increases with every write, highest valid record wins
+    uint32_t length;        // Payload length in bytes
+    uint32_t crc;           // CRC32 over header (crc = 0) and payload
+};
+
+// Append-only, CRC32-checked record log in a range of flash sectors
+// Only the latest record matters. Records are appended page-aligned; when the
+// head sector is full the next sector is erased and becomes the new head, so
+// erases rotate through the region. The sector being erased never holds the
+// latest valid record, which keeps a save interrupted by power loss harmless.
+// Writes are split into single flash operations driven from Update().
+class RecordStore {
+public:
+    RecordStore();
+    ~RecordStore();
+
+    // Initialization (region of MIN_SECTORS to MAX_SECTORS sectors)
+    bool Init(FlashDevice* flash, uint32_t baseAddress, uint8_t numSectors,
+              uint8_t* stagingBuffer, size_t stagingSize);
+
+    // Rebuild the in-RAM index of the latest record
+    bool Mount();
+
+    // Latest record access
+    bool HasRecord() const;
+    uint32_t GetRecordLength() const;
+    uint16_t GetRecordVersion() const;
+    uint32_t GetRecordSequence() const;
+    bool ReadRecord(void* buffer, size_t maxLength);
+
+    // Non-blocking write, the payload is copied into the staging buffer
+    bool BeginWrite(const void* data, size_t length, uint16_t version);
+    void Update();          // Call from the main loop, one flash operation per call
+    bool IsBusy() const;
+    RecordStoreState GetState() const;
+    bool LastWriteFailed() const;
+
+    // CRC32 (IEEE 802.3, reflected)
+    static uint32_t Crc32(const void* data, size_t length, uint32_t crc = 0);
+
+    static const uint8_t MIN_SECTORS = 3;
+    static const uint8_t MAX_SECTORS = 32;
+
+private:
+    FlashDevice* flash_;
+    uint32_t baseAddress_;
+    uint8_t numSectors_;
+    uint32_t sectorSize_;
+    uint32_t pageSize_;
+
+    // Index of the latest valid record
+    bool hasRecord_;
+    uint32_t recordAddress_;
+    RecordHeader recordHeader_;
+
+    // Write position
+    uint8_t headSector_;
+    uint32_t writeOffset_;
+    uint32_t nextSequence_;
+    bool headNeedsErase_;
+
+    // Pending write
+    uint8_t* staging_;
+    size_t stagingSize_;
+    uint32_t stagedLength_;     // Header + payload, padded to whole pages
+    uint32_t programOffset_;
+    RecordStoreState state_;
+    bool lastWriteFailed_;
+
+    // Private methods
+    uint32_t SectorAddress(uint8_t sector) const;
+    uint32_t AlignToPage(uint32_t length) const;
+    bool ReadHeader(uint32_t address, RecordHeader* header);
+    bool ValidateRecord(uint32_t address, const RecordHeader& header);
+    bool ScanSector(uint8_t sector, bool updateIndex, uint32_t* endOffset);
+    bool IsSectorBlank(uint8_t sector);
+    void FinishWrite();
+};
\ No newline at end of file
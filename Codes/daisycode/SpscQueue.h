@@ -0,0 +1,78 @@
+#pragma once
+#include <stdint.h>
+#include <atomic>
+
+// Lock-free single producer/single consumer ring. One context pushes (an
+// interrupt), one other context pops (the main loop); neither ever waits.
+// A push on a full queue drops the item and counts it as overflow.
+template <typename T, uint8_t N>
+class SpscQueue {
+    // The 8-bit indices wrap at 256, a power of two up to 128 divides that
+    static_assert(N > 0 && N <= 128 && (N & (N - 1)) == 0, "SpscQueue size must be a power of two up to 128");
+
+public:
+    static const uint8_t CAPACITY = N;
+
+    SpscQueue() : head_(0), tail_(0), overflowCount_(0), highWater_(0) {}
+
+    // Producer side: copy the item in, then publish it
+    bool Push(const T& item) {
+        uint8_t tail = tail_.load(std::memory_order_relaxed);
+        uint8_t head = head_.load(std::memory_order_acquire);
+        if ((uint8_t)(tail - head) >= N) {
+            overflowCount_.store(overflowCount_.load(std::memory_order_relaxed) + 1,
+                                 std::memory_order_relaxed);
+            return false;
+        }
+
+        items_[tail & (N - 1)] = item;
+        tail_.store(tail + 1, std::memory_order_release);
+
+        uint8_t waiting = tail + 1 - head;
+        if (waiting > highWater_.load(std::memory_order_relaxed)) {
+            highWater_.store(waiting, std::memory_order_relaxed);
+        }
+        return true;
+    }
+
+    bool IsFull() const {
+        uint8_t tail = tail_.load(std::memory_order_relaxed);
+        return (uint8_t)(tail - head_.load(std::memory_order_acquire)) >= N;
+    }
+
+    // Consumer side
+    bool Pop(T* item) {
+        uint8_t head = head_.load(std::memory_order_relaxed);
+        uint8_t tail = tail_.load(std::memory_order_acquire);
+        if (head == tail) {
+            return false;
+        }
+
+        *item = items_[head & (N - 1)];
+        head_.store(head + 1, std::memory_order_release);
+        return true;
+    }
+
+    bool IsEmpty() const {
+        return head_.load(std::memory_order_relaxed) == tail_.load(std::memory_order_acquire);
+    }
+
+    // Drops the waiting items, only the consumer index moves
+    void Clear() {
+        head_.store(tail_.load(std::memory_order_acquire), std::memory_order_release);
+    }
+
+    // Statistics, written by the producer
+    uint32_t GetOverflowCount() const { return overflowCount_.load(std::memory_order_relaxed); }
+    uint8_t GetHighWater() const { return highWater_.load(std::memory_order_relaxed); }
+
+private:
+    T items_[N];
+    std::atomic<uint8_t> head_;             // Written by the consumer
+    std::atomic<uint8_t> tail_;             // Written by the producer
+    std::atomic<uint32_t> overflowCount_;   // Items dropped on a full queue
+    std::atomic<uint8_t> highWater_;        // Most items ever waiting
+};
+
+template <typename T, uint8_t N>
+const uint8_t SpscQueue<T, N>::CAPACITY;
\ No newline at end of file
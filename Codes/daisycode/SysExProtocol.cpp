@@ -0,0 +1,503 @@
+#include "SysExProtocol.h"
+#include "daisy_seed.h"
+#include <cstring>
+
+// Constants
+const uint8_t HEADER_UNKNOWN = 0xFF;
+const uint8_t CALIBRATION_SIZE = 32;        // 16 thresholds, 16-bit little-endian
+const uint8_t TELEMETRY_SIZE = 28;
+const uint32_t TELEMETRY_INTERVAL_UNIT = 10;    // ms
+
+// Little-endian helpers
+static uint8_t* PutU16(uint8_t* out, uint16_t value) {
+    out[0] = value & 0xFF;
+    out[1] = value >> 8;
+    return out + 2;
+}
+
+static uint8_t* PutU32(uint8_t* out, uint32_t value) {
+    for (int i = 0; i < 4; i++) {
+        out[i] = (value >> (8 * i)) & 0xFF;
+    }
+    return out + 4;
+}
+
+static uint8_t* PutFloat(uint8_t* out, float value) {
+    uint32_t bits;
+    memcpy(&bits, &value, sizeof(bits));
+    return PutU32(out, bits);
+}
+
+static float GetFloat(const uint8_t* in) {
+    uint32_t bits = in[0] | (in[1] << 8) | (in[2] << 16) | ((uint32_t)in[3] << 24);
+    float value;
+    memcpy(&value, &bits, sizeof(value));
+    return value;
+}
+
+// Constructor
+SysExProtocol::SysExProtocol()
+    : config_(nullptr), presets_(nullptr), midi_(nullptr), telemetryProvider_(nullptr),
+      looperHandler_(nullptr),
+      state_(PARSE_IDLE), command_(0), headerLength_(0), headerCount_(0),
+      groupMsbs_(0), groupIndex_(0), payloadCount_(0), payloadChecksum_(0), status_(SYSEX_OK),
+      loadTarget_(-1), loadNextChunk_(0), loadTotalChunks_(0), loadLength_(0),
+      dumpTarget_(-1), dumpData_(nullptr), dumpLength_(0), dumpNextChunk_(0), lastDumpTime_(0),
+      telemetryInterval_(0), lastTelemetryTime_(0) {
+}
+
+// Destructor
+SysExProtocol::~SysExProtocol() {
+}
+
+// Initialization
+void SysExProtocol::Init(ConfigManager* config, PresetBank* presets, MidiController* midi) {
+    config_ = config;
+    presets_ = presets;
+    midi_ = midi;
+    state_ = PARSE_IDLE;
+    loadTarget_ = -1;
+    dumpTarget_ = -1;
+    telemetryInterval_ = 0;
+}
+
+void SysExProtocol::SetTelemetryProvider(TelemetryProvider provider) {
+    telemetryProvider_ = provider;
+}
+
+void SysExProtocol::SetLooperHandler(LooperHandler handler) {
+    looperHandler_ = handler;
+}
+
+// Input
+void SysExProtocol::Feed(uint8_t byte) {
+    if (byte == 0xF0) {
+        state_ = PARSE_MANUFACTURER;
+        return;
+    }
+    if (byte == 0xF7) {
+        if (state_ == PARSE_PAYLOAD) {
+            EndMessage();
+        } else if (state_ == PARSE_HEADER) {
+            SendAck(command_, SYSEX_ERR_PARAMETER);     // Truncated header
+        }
+        state_ = PARSE_IDLE;
+        return;
+    }
+    if (byte & 0x80) {
+        // Real-time bytes may be interleaved, any other status byte aborts the message
+        if (byte < 0xF8) {
+            state_ = PARSE_IDLE;
+        }
+        return;
+    }
+
+    switch (state_) {
+        case PARSE_MANUFACTURER:
+            state_ = (byte == MANUFACTURER_ID) ? PARSE_DEVICE : PARSE_SKIP;
+            break;
+
+        case PARSE_DEVICE:
+            state_ = (byte == DEVICE_ID) ? PARSE_COMMAND : PARSE_SKIP;
+            break;
+
+        case PARSE_COMMAND:
+            command_ = byte;
+            headerCount_ = 0;
+            headerLength_ = GetHeaderLength(command_);
+            if (headerLength_ == HEADER_UNKNOWN) {
+                // Payload is ignored, the error is acknowledged at F7
+                headerLength_ = 0;
+                status_ = SYSEX_ERR_COMMAND;
+                state_ = PARSE_PAYLOAD;
+            } else {
+                status_ = SYSEX_OK;
+                if (headerLength_ == 0) {
+                    BeginPayload();
+                } else {
+                    state_ = PARSE_HEADER;
+                }
+            }
+            break;
+
+        case PARSE_HEADER:
+            header_[headerCount_++] = byte;
+            if (headerCount_ == headerLength_) {
+                BeginPayload();
+            }
+            break;
+
+        case PARSE_PAYLOAD:
+            // Each group of 8 starts with the top bits of the next 7 bytes
+            if (groupIndex_ == 0) {
+                groupMsbs_ = byte;
+            } else {
+                uint8_t msb = (groupMsbs_ >> (7 - groupIndex_)) & 0x01;
+                OnPayloadByte(byte | (msb << 7));
+            }
+            groupIndex_ = (groupIndex_ + 1) & 0x07;
+            break;
+
+        case PARSE_IDLE:
+        case PARSE_SKIP:
+        default:
+            break;
+    }
+}
+
+void SysExProtocol::FeedMessage(const uint8_t* data, size_t length) {
+    Feed(0xF0);
+    for (size_t i = 0; i < length; i++) {
+        Feed(data[i]);
+    }
+    Feed(0xF7);
+}
+
+// Main loop processing
+void SysExProtocol::Update() {
+    uint32_t now = daisy::System::GetNow();
+
+    if (dumpTarget_ >= 0 && now - lastDumpTime_ >= DUMP_CHUNK_INTERVAL) {
+        lastDumpTime_ = now;
+        SendDumpChunk();
+    }
+
+    if (telemetryInterval_ > 0 && now - lastTelemetryTime_ >= telemetryInterval_) {
+        lastTelemetryTime_ = now;
+        SendTelemetry();
+    }
+}
+
+// Private methods
+uint8_t SysExProtocol::GetHeaderLength(uint8_t command) const {
+    switch (command) {
+        case SYSEX_GET_PARAM:           return 2;
+        case SYSEX_SET_PARAM:           return 2;
+        case SYSEX_DUMP_REQUEST:        return 1;
+        case SYSEX_LOAD_DATA:           return 7;
+        case SYSEX_STORE:               return 0;
+        case SYSEX_TELEMETRY_CONFIG:    return 1;
+        case SYSEX_LOOPER:              return 1;
+        default:                        return HEADER_UNKNOWN;
+    }
+}
+
+void SysExProtocol::BeginPayload() {
+    state_ = PARSE_PAYLOAD;
+    groupIndex_ = 0;
+    payloadCount_ = 0;
+    payloadChecksum_ = 0;
+
+    if (command_ == SYSEX_LOAD_DATA) {
+        status_ = BeginLoadChunk();
+    }
+}
+
+// Parameter values and bulk chunks are decoded into staging buffers
+void SysExProtocol::OnPayloadByte(uint8_t byte) {
+    if (status_ != SYSEX_OK) {
+        return;
+    }
+
+    if (command_ == SYSEX_SET_PARAM) {
+        if (payloadCount_ < sizeof(value_)) {
+            value_[payloadCount_] = byte;
+        }
+    } else if (command_ == SYSEX_LOAD_DATA) {
+        if (payloadCount_ >= header_[5]) {
+            status_ = SYSEX_ERR_PARAMETER;      // More data than announced
+            return;
+        }
+        loadBuffer_[(size_t)loadNextChunk_ * CHUNK_SIZE + payloadCount_] = byte;
+        payloadChecksum_ += byte;
+    }
+    payloadCount_++;
+}
+
+void SysExProtocol::EndMessage() {
+    if (status_ != SYSEX_OK) {
+        SendAck(command_, status_);
+        return;
+    }
+
+    switch (command_) {
+        case SYSEX_GET_PARAM:
+            HandleGetParam();
+            break;
+
+        case SYSEX_SET_PARAM:
+            HandleSetParam();
+            break;
+
+        case SYSEX_DUMP_REQUEST:
+            HandleDumpRequest();
+            break;
+
+        case SYSEX_LOAD_DATA:
+            SendAck(command_, EndLoadChunk());
+            break;
+
+        case SYSEX_STORE:
+            config_->SaveConfig();
+            presets_->Save();
+            SendAck(command_, SYSEX_OK);
+            break;
+
+        case SYSEX_TELEMETRY_CONFIG:
+            telemetryInterval_ = header_[0] * TELEMETRY_INTERVAL_UNIT;
+            SendAck(command_, SYSEX_OK);
+            break;
+
+        case SYSEX_LOOPER:
+            if (!looperHandler_) {
+                SendAck(command_, SYSEX_ERR_COMMAND);
+            } else {
+                SendAck(command_, looperHandler_(header_[0]) ? SYSEX_OK : SYSEX_ERR_PARAMETER);
+            }
+            break;
+
+        default:
+            break;
+    }
+}
+
+void SysExProtocol::HandleGetParam() {
+    float value;
+    if (!config_->GetParameter(header_[0], header_[1], &value)) {
+        SendAck(command_, SYSEX_ERR_PARAMETER);
+        return;
+    }
+
+    uint8_t payload[4];
+    PutFloat(payload, value);
+    SendMessage(SYSEX_PARAM_VALUE, header_, 2, payload, sizeof(payload));
+}
+
+void SysExProtocol::HandleSetParam() {
+    if (payloadCount_ != sizeof(value_)) {
+        SendAck(command_, SYSEX_ERR_PARAMETER);
+        return;
+    }
+
+    bool ok = config_->SetParameter(header_[0], header_[1], GetFloat(value_));
+    SendAck(command_, ok ? SYSEX_OK : SYSEX_ERR_PARAMETER);
+}
+
+void SysExProtocol::HandleDumpRequest() {
+    uint8_t target = header_[0];
+    if (dumpTarget_ >= 0) {
+        SendAck(command_, SYSEX_ERR_BUSY);
+        return;
+    }
+
+    const LaserHarpConfig* snapshot = config_->GetSnapshot();
+    switch (target) {
+        case SYSEX_TARGET_CONFIG:
+            dumpLength_ = ConfigSchema::Serialize(*snapshot, dumpBuffer_, sizeof(dumpBuffer_));
+            dumpData_ = dumpBuffer_;
+            break;
+
+        case SYSEX_TARGET_PRESETS:
+            dumpLength_ = presets_->GetRawSize();
+            dumpData_ = presets_->GetRawData();
+            break;
+
+        case SYSEX_TARGET_CALIBRATION: {
+            uint8_t* out = dumpBuffer_;
+            for (int i = 0; i < 16; i++) {
+                out = PutU16(out, snapshot->sensorThresholds[i]);
+            }
+            dumpLength_ = CALIBRATION_SIZE;
+            dumpData_ = dumpBuffer_;
+            break;
+        }
+
+        default:
+            SendAck(command_, SYSEX_ERR_PARAMETER);
+            return;
+    }
+
+    // Chunks follow from Update(), paced for slow links
+    SendAck(command_, SYSEX_OK);
+    dumpTarget_ = target;
+    dumpNextChunk_ = 0;
+    lastDumpTime_ = daisy::System::GetNow();
+}
+
+size_t SysExProtocol::GetTargetCapacity(uint8_t target) const {
+    switch (target) {
+        case SYSEX_TARGET_CONFIG:       return ConfigSchema::MAX_SERIALIZED_SIZE;
+        case SYSEX_TARGET_PRESETS:      return PresetBank::RAW_SIZE;
+        case SYSEX_TARGET_CALIBRATION:  return CALIBRATION_SIZE;
+        default:                        return 0;
+    }
+}
+
+// Header: [target][chunk lo][chunk hi][total lo][total hi][length][checksum]
+uint8_t SysExProtocol::BeginLoadChunk() {
+    uint8_t target = header_[0];
+    uint16_t chunk = header_[1] | (header_[2] << 7);
+    uint16_t total = header_[3] | (header_[4] << 7);
+    uint8_t length = header_[5];
+
+    size_t capacity = GetTargetCapacity(target);
+    if (capacity == 0 || total == 0 || chunk >= total || length > CHUNK_SIZE ||
+        (size_t)chunk * CHUNK_SIZE + length > capacity) {
+        return SYSEX_ERR_PARAMETER;
+    }
+    if (dumpTarget_ == (int8_t)target) {
+        return SYSEX_ERR_BUSY;
+    }
+
+    // Chunk 0 (re)starts a transfer, the others must follow in order.
+    // A failed chunk does not advance, so the host simply sends it again.
+    if (chunk == 0) {
+        loadTarget_ = target;
+        loadTotalChunks_ = total;
+        loadNextChunk_ = 0;
+    } else if (loadTarget_ != (int8_t)target || total != loadTotalChunks_ ||
+               chunk != loadNextChunk_) {
+        return SYSEX_ERR_SEQUENCE;
+    }
+    return SYSEX_OK;
+}
+
+uint8_t SysExProtocol::EndLoadChunk() {
+    uint8_t length = header_[5];
+    if (payloadCount_ != length) {
+        return SYSEX_ERR_PARAMETER;
+    }
+    if ((payloadChecksum_ & 0x7F) != header_[6]) {
+        return SYSEX_ERR_CHECKSUM;
+    }
+
+    loadNextChunk_++;
+    if (loadNextChunk_ < loadTotalChunks_) {
+        return SYSEX_OK;
+    }
+
+    loadLength_ = (loadNextChunk_ - 1) * CHUNK_SIZE + length;
+    uint8_t status = CommitLoad();
+    loadTarget_ = -1;
+    return status;
+}
+
+// Applies a complete transfer. Flash is only written on SYSEX_STORE.
+uint8_t SysExProtocol::CommitLoad() {
+    LaserHarpConfig* working = config_->GetConfig();
+
+    switch (loadTarget_) {
+        case SYSEX_TARGET_CONFIG: {
+            LaserHarpConfig loaded;
+            if (!ConfigSchema::Deserialize(loadBuffer_, loadLength_, &loaded)) {
+                return SYSEX_ERR_PARAMETER;
+            }
+            *working = loaded;
+            config_->Publish();
+            return SYSEX_OK;
+        }
+
+        case SYSEX_TARGET_PRESETS:
+            // Only a complete bank replaces the current one
+            return presets_->SetRawData(loadBuffer_, loadLength_) ? SYSEX_OK : SYSEX_ERR_PARAMETER;
+
+        case SYSEX_TARGET_CALIBRATION:
+            if (loadLength_ != CALIBRATION_SIZE) {
+                return SYSEX_ERR_PARAMETER;
+            }
+            for (int i = 0; i < 16; i++) {
+                uint16_t threshold = loadBuffer_[2 * i] | (loadBuffer_[2 * i + 1] << 8);
+                ConfigSchema::SetValue(working, CFG_SENSOR_THRESHOLDS, i, threshold);
+            }
+            config_->Publish();
+            return SYSEX_OK;
+
+        default:
+            return SYSEX_ERR_PARAMETER;
+    }
+}
+
+void SysExProtocol::SendDumpChunk() {
+    uint16_t total = (dumpLength_ + CHUNK_SIZE - 1) / CHUNK_SIZE;
+    if (total == 0) {
+        total = 1;      // An empty dump is still one (empty) chunk
+    }
+
+    size_t offset = (size_t)dumpNextChunk_ * CHUNK_SIZE;
+    uint8_t length = (dumpLength_ - offset < CHUNK_SIZE) ? dumpLength_ - offset : CHUNK_SIZE;
+
+    uint8_t checksum = 0;
+    for (int i = 0; i < length; i++) {
+        checksum += dumpData_[offset + i];
+    }
+
+    uint8_t header[7] = {
+        (uint8_t)dumpTarget_,
+        (uint8_t)(dumpNextChunk_ & 0x7F), (uint8_t)(dumpNextChunk_ >> 7),
+        (uint8_t)(total & 0x7F), (uint8_t)(total >> 7),
+        length, (uint8_t)(checksum & 0x7F)
+    };
+    SendMessage(SYSEX_DUMP_DATA, header, sizeof(header), dumpData_ + offset, length);
+
+    if (++dumpNextChunk_ >= total) {
+        dumpTarget_ = -1;
+    }
+}
+
+void SysExProtocol::SendTelemetry() {
+    SysExTelemetry frame;
+    memset(&frame, 0, sizeof(frame));
+    frame.configVersion = config_->GetVersion();
+    if (telemetryProvider_) {
+        telemetryProvider_(&frame);
+    }
+
+    // Explicit layout, independent of struct padding
+    uint8_t payload[TELEMETRY_SIZE];
+    uint8_t* out = payload;
+    out = PutFloat(out, frame.cpuLoad);
+    out = PutFloat(out, frame.peakCpuLoad);
+    out = PutFloat(out, frame.limiterGain);
+    out = PutFloat(out, frame.outputLevel);
+    out = PutU32(out, frame.messagesSent);
+    out = PutU32(out, frame.configVersion);
+    out = PutU16(out, frame.beamStates);
+    *out++ = frame.activeVoices;
+    *out++ = frame.currentPreset;
+
+    SendMessage(SYSEX_TELEMETRY, nullptr, 0, payload, sizeof(payload));
+}
+
+void SysExProtocol::SendAck(uint8_t command, uint8_t status) {
+    uint8_t header[2] = { (uint8_t)(command & 0x7F), status };
+    SendMessage(SYSEX_ACK, header, sizeof(header), nullptr, 0);
+}
+
+// Builds [manufacturer][device][command][header][packed payload], F0/F7 are added by SendSysEx()
+void SysExProtocol::SendMessage(uint8_t command, const uint8_t* header, size_t headerLength,
+                                const uint8_t* payload, size_t payloadLength) {
+    if (midi_ == nullptr) {
+        return;
+    }
+
+    size_t length = 0;
+    txBuffer_[length++] = MANUFACTURER_ID;
+    txBuffer_[length++] = DEVICE_ID;
+    txBuffer_[length++] = command;
+    for (size_t i = 0; i < headerLength; i++) {
+        txBuffer_[length++] = header[i] & 0x7F;
+    }
+
+    for (size_t i = 0; i < payloadLength; i += 7) {
+        size_t msbIndex = length++;
+        uint8_t msbs = 0;
+        for (size_t j = 0; j < 7 && i + j < payloadLength; j++) {
+            uint8_t byte = payload[i + j];
+            msbs |= (byte >> 7) << (6 - j);
+            txBuffer_[length++] = byte & 0x7F;
+        }
+        txBuffer_[msbIndex] = msbs;
+    }
+
+    midi_->SendSysEx(txBuffer_, length);
+}
\ No newline at end of file
@@ -0,0 +1,165 @@
+#pragma once
+#include <stdint.h>
+#include <stddef.h>
+#include "ConfigManager.h"
+#include "ConfigSchema.h"
+#include "PresetBank.h"
+#include "MidiController.h"
+
+// SysEx message layout: F0 7D 4C <command> <header bytes> <7-bit packed payload> F7
+// Payloads are packed in groups of 8 bytes: one byte holding the top bits of the
+// following (up to) 7 bytes, first byte in bit 6. libDaisy delivers at most 128
+// data bytes per SysEx event, so every message stays below that.
+enum SysExCommand {
+    // Host -> device
+    SYSEX_GET_PARAM = 0x01,         // [id][index]
+    SYSEX_SET_PARAM = 0x02,         // [id][index] payload: float value
+    SYSEX_DUMP_REQUEST = 0x03,      // [target]
+    SYSEX_LOAD_DATA = 0x04,         // [target][chunk lo][chunk hi][total lo][total hi][length][checksum] payload
+    SYSEX_STORE = 0x05,             // Persist configuration and presets
+    SYSEX_TELEMETRY_CONFIG = 0x06,  // [interval in 10ms units, 0 = off]
+    SYSEX_LOOPER = 0x07,            // [LooperAction]
+
+    // Device -> host
+    SYSEX_PARAM_VALUE = 0x41,       // [id][index] payload: float value
+    SYSEX_DUMP_DATA = 0x43,         // Same header as SYSEX_LOAD_DATA
+    SYSEX_TELEMETRY = 0x45,         // payload: SysExTelemetry
+    SYSEX_ACK = 0x7F                // [command][status]
+};
+
+// Bulk transfer targets
+enum SysExTarget {
+    SYSEX_TARGET_CONFIG = 0,        // ConfigSchema serialized configuration
+    SYSEX_TARGET_PRESETS = 1,       // Raw preset bank
+    SYSEX_TARGET_CALIBRATION = 2,   // Sensor thresholds
+    SYSEX_TARGET_COUNT
+};
+
+// Status codes of SYSEX_ACK
+enum SysExStatus {
+    SYSEX_OK = 0,
+    SYSEX_ERR_COMMAND = 1,
+    SYSEX_ERR_PARAMETER = 2,
+    SYSEX_ERR_CHECKSUM = 3,
+    SYSEX_ERR_SEQUENCE = 4,
+    SYSEX_ERR_BUSY = 5
+};
+
+// Telemetry frame, sent little-endian
+struct SysExTelemetry {
+    float cpuLoad;
+    float peakCpuLoad;
+    float limiterGain;
+    float outputLevel;
+    uint32_t messagesSent;
+    uint32_t configVersion;
+    uint16_t beamStates;        // Bit per beam, 1 = broken
+    uint8_t activeVoices;
+    uint8_t currentPreset;
+};
+
+// Fills a telemetry frame, called from the main loop
+typedef void (*TelemetryProvider)(SysExTelemetry* frame);
+
+// Looper transport, returns false when the action is not possible in the current state
+typedef bool (*LooperHandler)(uint8_t action);
+
+// Incremental SysEx parser and responder. Bytes are consumed one at a time;
+// only the fixed command header and one 8-byte packing group are held. Bulk
+// loads are staged and only applied once the last chunk has been verified.
+class SysExProtocol {
+public:
+    SysExProtocol();
+    ~SysExProtocol();
+
+    // Initialization
+    void Init(ConfigManager* config, PresetBank* presets, MidiController* midi);
+    void SetTelemetryProvider(TelemetryProvider provider);
+    void SetLooperHandler(LooperHandler handler);
+
+    // Input
+    void Feed(uint8_t byte);
+    void FeedMessage(const uint8_t* data, size_t length);  // SysEx body without F0/F7
+
+    // Main loop processing: paced dump chunks and telemetry
+    void Update();
+
+    static const uint8_t MANUFACTURER_ID = 0x7D;    // Non-commercial / educational
+    static const uint8_t DEVICE_ID = 0x4C;
+    static const uint8_t CHUNK_SIZE = 64;           // Raw bytes per bulk message
+    static const uint32_t DUMP_CHUNK_INTERVAL = 30; // ms, one chunk fits a 31250 baud DIN link
+
+private:
+    enum ParserState {
+        PARSE_IDLE,
+        PARSE_MANUFACTURER,
+        PARSE_DEVICE,
+        PARSE_COMMAND,
+        PARSE_HEADER,
+        PARSE_PAYLOAD,
+        PARSE_SKIP
+    };
+
+    ConfigManager* config_;
+    PresetBank* presets_;
+    MidiController* midi_;
+    TelemetryProvider telemetryProvider_;
+    LooperHandler looperHandler_;
+
+    // Parser
+    ParserState state_;
+    uint8_t command_;
+    uint8_t header_[7];
+    uint8_t headerLength_;
+    uint8_t headerCount_;
+    uint8_t groupMsbs_;
+    uint8_t groupIndex_;
+    uint16_t payloadCount_;
+    uint8_t payloadChecksum_;
+    uint8_t status_;            // Error found while parsing, reported when the message ends
+
+    // Small payloads (parameter value)
+    uint8_t value_[4];
+
+    // Bulk load in progress
+    int8_t loadTarget_;
+    uint16_t loadNextChunk_;
+    uint16_t loadTotalChunks_;
+    uint16_t loadLength_;
+    static const size_t LOAD_BUFFER_SIZE = PresetBank::RAW_SIZE > ConfigSchema::MAX_SERIALIZED_SIZE
+                                           ? PresetBank::RAW_SIZE : ConfigSchema::MAX_SERIALIZED_SIZE;
+    uint8_t loadBuffer_[LOAD_BUFFER_SIZE];     // Staging for every target
+
+    // Bulk dump in progress
+    int8_t dumpTarget_;
+    const uint8_t* dumpData_;
+    uint16_t dumpLength_;
+    uint16_t dumpNextChunk_;
+    uint32_t lastDumpTime_;
+    uint8_t dumpBuffer_[ConfigSchema::MAX_SERIALIZED_SIZE];
+
+    // Telemetry
+    uint32_t telemetryInterval_;    // ms, 0 = off
+    uint32_t lastTelemetryTime_;
+
+    // Output
+    uint8_t txBuffer_[128];
+
+    // Private methods
+    uint8_t GetHeaderLength(uint8_t command) const;
+    void BeginPayload();
+    void OnPayloadByte(uint8_t byte);
+    void EndMessage();
+    void HandleGetParam();
+    void HandleSetParam();
+    void HandleDumpRequest();
+    uint8_t BeginLoadChunk();
+    uint8_t EndLoadChunk();
+    uint8_t CommitLoad();
+    size_t GetTargetCapacity(uint8_t target) const;
+    void SendDumpChunk();
+    void SendTelemetry();
+    void SendAck(uint8_t command, uint8_t status);
+    void SendMessage(uint8_t command, const uint8_t* header, size_t headerLength,
+                     const uint8_t* payload, size_t payloadLength);
+};
\ No newline at end of file
@@ -0,0 +1,74 @@
+#include "VoiceEnvelope.h"
+#include <cmath>
+
+// Constants
+const float DEFAULT_SEGMENT_TIME = 0.1f;
+const float DEFAULT_SUSTAIN_LEVEL = 0.7f;
+const float DECAY_LOG_TARGET = -1.0f;           // Decay and release cover 1 - 1/e per time constant
+const float SUSTAIN_SETTLED = 0.001f;           // Decay within -60 dB of the sustain level
+
+constexpr float VoiceEnvelope::ATTACK_TARGET;
+constexpr float VoiceEnvelope::RELEASE_TARGET;
+
+// Constructor
+VoiceEnvelope::VoiceEnvelope()
+    : segment_(SEGMENT_IDLE), level_(0.0f), gate_(false) {
+    coefficients_.attack = 1.0f;
+    coefficients_.decay = 1.0f;
+    coefficients_.release = 1.0f;
+    coefficients_.sustain = DEFAULT_SUSTAIN_LEVEL;
+}
+
+// Destructor
+VoiceEnvelope::~VoiceEnvelope() {
+}
+
+// Initialization
+void VoiceEnvelope::Init(float sampleRate) {
+    ComputeCoefficients(DEFAULT_SEGMENT_TIME, DEFAULT_SEGMENT_TIME, DEFAULT_SUSTAIN_LEVEL,
+                        DEFAULT_SEGMENT_TIME, sampleRate, &coefficients_);
+    segment_ = SEGMENT_IDLE;
+    level_ = 0.0f;
+    gate_ = false;
+}
+
+// Main loop side, one exp() per segment
+void VoiceEnvelope::ComputeCoefficients(float attackTime, float decayTime, float sustainLevel,
+                                        float releaseTime, float sampleRate,
+                                        EnvelopeCoefficients* coefficients) {
+    coefficients->attack = SegmentCoefficient(attackTime, sampleRate,
+                                              logf(1.0f - 1.0f / ATTACK_TARGET));
+    coefficients->decay = SegmentCoefficient(decayTime, sampleRate, DECAY_LOG_TARGET);
+    coefficients->release = SegmentCoefficient(releaseTime, sampleRate, DECAY_LOG_TARGET);
+    coefficients->sustain = fmaxf(0.0f, fminf(1.0f, sustainLevel));
+}
+
+void VoiceEnvelope::SetCoefficients(const EnvelopeCoefficients& coefficients) {
+    coefficients_ = coefficients;
+}
+
+void VoiceEnvelope::Retrigger(bool hard) {
+    segment_ = SEGMENT_ATTACK;
+    if (hard) {
+        level_ = 0.0f;
+    }
+}
+
+bool VoiceEnvelope::IsRunning() const {
+    return segment_ != SEGMENT_IDLE;
+}
+
+VoiceEnvelope::Segment VoiceEnvelope::GetSegment() const {
+    if (segment_ == SEGMENT_DECAY && fabsf(level_ - coefficients_.sustain) < SUSTAIN_SETTLED) {
+        return SEGMENT_SUSTAIN;
+    }
+    return segment_;
+}
+
+// Private methods
+float VoiceEnvelope::SegmentCoefficient(float timeSeconds, float sampleRate, float logTarget) {
+    if (timeSeconds <= 0.0f) {
+        return 1.0f;    // Instant change
+    }
+    return 1.0f - expf(logTarget / (timeSeconds * sampleRate));
+}
\ No newline at end of file
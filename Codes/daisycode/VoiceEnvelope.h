@@ -0,0 +1,88 @@
+#pragma once
+#include <stdint.h>
+
+// Segment coefficients of a VoiceEnvelope, computed in the main loop (see
+// VoiceEnvelope::ComputeCoefficients) and handed to the voices with the patch
+struct EnvelopeCoefficients {
+    float attack;           // One-pole step per sample of each segment
+    float decay;
+    float release;
+    float sustain;          // Sustain level 0.0 - 1.0
+};
+
+// Per-voice ADSR with the exponential segments of daisysp::Adsr. The
+// coefficients are set from outside instead of from segment times, so the
+// audio callback never evaluates exp()/log() on a sound change.
+class VoiceEnvelope {
+public:
+    enum Segment {
+        SEGMENT_IDLE,
+        SEGMENT_ATTACK,
+        SEGMENT_DECAY,
+        SEGMENT_SUSTAIN,        // Reported once the decay has settled, processed as decay
+        SEGMENT_RELEASE
+    };
+
+    VoiceEnvelope();
+    ~VoiceEnvelope();
+
+    // Initialization (daisysp::Adsr defaults: 0.1s segments, sustain 0.7)
+    void Init(float sampleRate);
+
+    // Segment times in seconds, sustain level 0.0 - 1.0
+    static void ComputeCoefficients(float attackTime, float decayTime, float sustainLevel,
+                                    float releaseTime, float sampleRate,
+                                    EnvelopeCoefficients* coefficients);
+    void SetCoefficients(const EnvelopeCoefficients& coefficients);
+
+    // Restart the attack, from silence if hard
+    void Retrigger(bool hard);
+
+    // Audio processing, gate edges start the attack and the release
+    inline float Process(bool gate) {
+        if (gate && !gate_) {
+            segment_ = SEGMENT_ATTACK;
+        } else if (!gate && gate_) {
+            segment_ = SEGMENT_RELEASE;
+        }
+        gate_ = gate;
+
+        switch (segment_) {
+            case SEGMENT_ATTACK:
+                level_ += coefficients_.attack * (ATTACK_TARGET - level_);
+                if (level_ > 1.0f) {
+                    level_ = 1.0f;
+                    segment_ = SEGMENT_DECAY;
+                }
+                break;
+            case SEGMENT_DECAY:
+                level_ += coefficients_.decay * (coefficients_.sustain - level_);
+                break;
+            case SEGMENT_RELEASE:
+                level_ += coefficients_.release * (RELEASE_TARGET - level_);
+                if (level_ < 0.0f) {
+                    level_ = 0.0f;
+                    segment_ = SEGMENT_IDLE;
+                }
+                break;
+            default:
+                break;
+        }
+        return level_;
+    }
+
+    bool IsRunning() const;
+    Segment GetSegment() const;
+
+private:
+    // The attack and the release aim past their end level so they arrive in finite time
+    static constexpr float ATTACK_TARGET = 1.01f;
+    static constexpr float RELEASE_TARGET = -0.01f;
+
+    static float SegmentCoefficient(float timeSeconds, float sampleRate, float logTarget);
+
+    EnvelopeCoefficients coefficients_;
+    Segment segment_;
+    float level_;
+    bool gate_;
+};
\ No newline at end of file
@@ -0,0 +1,136 @@
+#include "VoiceFilter.h"
+#include <cmath>
+
+// Constants
+const float PI_F = 3.14159265358979f;
+const float MAX_NORMALIZED_CUTOFF = 0.45f;      // Keep tan() well away from its pole at fs/2
+const float MIN_CUTOFF_HZ = 20.0f;
+const float DEFAULT_CUTOFF_HZ = 1000.0f;
+const float CUTOFF_CHANGE_THRESHOLD = 0.005f;   // 0.5% (~9 cents) before recomputing
+const float MIN_DAMPING = 0.05f;                // k at full resonance (self-oscillation edge)
+
+float VoiceFilter::tanTable_[VoiceFilter::TAN_TABLE_SIZE + 1];
+bool VoiceFilter::tanTableReady_ = false;
+
+// Constructor
+VoiceFilter::VoiceFilter()
+    : sampleRate_(48000.0f), cutoff_(DEFAULT_CUTOFF_HZ), k_(2.0f), modulation_(0.0f),
+      cachedCutoff_(-1.0f), a1_(0.0f), a2_(0.0f), a3_(0.0f), ic1_(0.0f), ic2_(0.0f) {
+}
+
+// Destructor
+VoiceFilter::~VoiceFilter() {
+}
+
+// Initialization, no resonance until the first patch
+void VoiceFilter::Init(float sampleRate) {
+    sampleRate_ = sampleRate;
+    InitTanTable();
+    Reset();
+
+    modulation_ = 0.0f;
+    cutoff_ = DEFAULT_CUTOFF_HZ;
+    SetCoefficients(cutoff_, ComputeG(cutoff_, sampleRate_), ComputeK(0.0f));
+}
+
+void VoiceFilter::Reset() {
+    ic1_ = 0.0f;
+    ic2_ = 0.0f;
+}
+
+// Block processing keeps coefficients and states in registers for the whole block
+void VoiceFilter::ProcessBlock(float* buffer, size_t size) {
+    float a1 = a1_;
+    float a2 = a2_;
+    float a3 = a3_;
+    float ic1 = ic1_;
+    float ic2 = ic2_;
+    for (size_t i = 0; i < size; i++) {
+        float v3 = buffer[i] - ic2;
+        float v1 = a1 * ic1 + a2 * v3;
+        float v2 = ic2 + a2 * ic1 + a3 * v3;
+        ic1 = 2.0f * v1 - ic1;
+        ic2 = 2.0f * v2 - ic2;
+        buffer[i] = v2;
+    }
+    ic1_ = ic1;
+    ic2_ = ic2;
+}
+
+// Parameter control
+void VoiceFilter::SetPrecomputed(float cutoffHz, float g, float k) {
+    cutoff_ = cutoffHz;
+    k_ = k;
+    if (modulation_ != 0.0f) {
+        cachedCutoff_ = -1.0f;
+        SetModulation(modulation_);
+        return;
+    }
+    SetCoefficients(cutoffHz, g, k);
+}
+
+void VoiceFilter::SetModulation(float octaves) {
+    modulation_ = octaves;
+    float cutoff = cutoff_;
+    if (modulation_ != 0.0f) {
+        cutoff = ClampCutoff(cutoff_ * exp2f(modulation_), sampleRate_);
+    }
+
+    // Skip the recomputation if the cutoff did not move enough to be audible
+    if (fabsf(cutoff - cachedCutoff_) <= cachedCutoff_ * CUTOFF_CHANGE_THRESHOLD) {
+        return;
+    }
+    SetCoefficients(cutoff, LookupTan(cutoff / sampleRate_), k_);
+}
+
+// Main loop helpers
+float VoiceFilter::KeyTrackRatio(float midiNote, float amount) {
+    // Cutoff follows the note relative to C4, scaled by the tracking amount
+    return exp2f((midiNote - 60.0f) * amount / 12.0f);
+}
+
+float VoiceFilter::ClampCutoff(float cutoffHz, float sampleRate) {
+    float maxCutoff = MAX_NORMALIZED_CUTOFF * sampleRate;
+    return fmaxf(MIN_CUTOFF_HZ, fminf(maxCutoff, cutoffHz));
+}
+
+float VoiceFilter::ComputeG(float cutoffHz, float sampleRate) {
+    InitTanTable();
+    return LookupTan(cutoffHz / sampleRate);
+}
+
+float VoiceFilter::ComputeK(float resonance) {
+    return 2.0f - (2.0f - MIN_DAMPING) * fmaxf(0.0f, fminf(1.0f, resonance));
+}
+
+// Private methods
+void VoiceFilter::InitTanTable() {
+    if (tanTableReady_) {
+        return;
+    }
+
+    // Table covers normalized frequencies 0 .. MAX_NORMALIZED_CUTOFF
+    for (int i = 0; i <= TAN_TABLE_SIZE; i++) {
+        float normalized = MAX_NORMALIZED_CUTOFF * (float)i / (float)TAN_TABLE_SIZE;
+        tanTable_[i] = tanf(PI_F * normalized);
+    }
+    tanTableReady_ = true;
+}
+
+float VoiceFilter::LookupTan(float normalizedFreq) {
+    // Linear interpolation between table points
+    float position = normalizedFreq * ((float)TAN_TABLE_SIZE / MAX_NORMALIZED_CUTOFF);
+    int index = (int)position;
+    if (index >= TAN_TABLE_SIZE) {
+        return tanTable_[TAN_TABLE_SIZE];
+    }
+    float fraction = position - (float)index;
+    return tanTable_[index] + fraction * (tanTable_[index + 1] - tanTable_[index]);
+}
+
+void VoiceFilter::SetCoefficients(float cutoff, float g, float k) {
+    a1_ = 1.0f / (1.0f + g * (g + k));
+    a2_ = g * a1_;
+    a3_ = g * a2_;
+    cachedCutoff_ = cutoff;
+}
\ No newline at end of file
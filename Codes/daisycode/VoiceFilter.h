@@ -0,0 +1,71 @@
+#pragma once
+#include <stdint.h>
+#include <stddef.h>
+
+// Per-voice resonant state variable filter (trapezoidal / zero-delay-feedback SVF)
+// The cutoff and resonance arrive as coefficients precomputed in the main loop.
+// Cutoff modulation recomputes them from a shared tan() lookup table, only when
+// the modulated cutoff moves beyond a small threshold.
+class VoiceFilter {
+public:
+    VoiceFilter();
+    ~VoiceFilter();
+
+    // Initialization
+    void Init(float sampleRate);
+    void Reset();
+
+    // Coefficients precomputed in the main loop for a key-tracked cutoff (see the
+    // helpers below), no tan() lookup unless the cutoff is being modulated
+    void SetPrecomputed(float cutoffHz, float g, float k);
+
+    // Cutoff offset in octaves (control rate, call once per block)
+    void SetModulation(float octaves);
+
+    // Main loop helpers for precomputed coefficients
+    static float KeyTrackRatio(float midiNote, float amount);    // Relative to C4
+    static float ClampCutoff(float cutoffHz, float sampleRate);
+    static float ComputeG(float cutoffHz, float sampleRate);      // Clamped cutoff
+    static float ComputeK(float resonance);                       // 0.0 - 1.0
+
+    // Audio processing (low-pass output)
+    inline float Process(float input) {
+        float v3 = input - ic2_;
+        float v1 = a1_ * ic1_ + a2_ * v3;
+        float v2 = ic2_ + a2_ * ic1_ + a3_ * v3;
+        ic1_ = 2.0f * v1 - ic1_;
+        ic2_ = 2.0f * v2 - ic2_;
+        return v2;
+    }
+    void ProcessBlock(float* buffer, size_t size);
+
+private:
+    // Shared tan(pi * f / fs) lookup table
+    static const int TAN_TABLE_SIZE = 256;
+    static float tanTable_[TAN_TABLE_SIZE + 1];
+    static bool tanTableReady_;
+    static void InitTanTable();
+    static float LookupTan(float normalizedFreq);
+
+    float sampleRate_;
+
+    // Unmodulated cutoff and damping of the current coefficients
+    float cutoff_;
+    float k_;
+    float modulation_;
+
+    // Cutoff the coefficients were computed for
+    float cachedCutoff_;
+
+    // Cached coefficients
+    float a1_;
+    float a2_;
+    float a3_;
+
+    // Integrator states
+    float ic1_;
+    float ic2_;
+
+    // Private methods
+    void SetCoefficients(float cutoff, float g, float k);
+};
\ No newline at end of file
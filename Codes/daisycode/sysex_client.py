@@ -0,0 +1,508 @@
+#!/usr/bin/env python3
+"""
+SysEx client for Daisy Seed LaserHarp
+Reads and writes parameters, dumps and restores presets, configuration and
+calibration, and streams telemetry (see SysExProtocol.h for the message layout).
+
+Use --loopback to run against a built-in device emulator instead of a MIDI port.
+"""
+
+import argparse
+import struct
+import sys
+import time
+
+MANUFACTURER_ID = 0x7D
+DEVICE_ID = 0x4C
+CHUNK_SIZE = 64
+
+# Commands
+GET_PARAM = 0x01
+SET_PARAM = 0x02
+DUMP_REQUEST = 0x03
+LOAD_DATA = 0x04
+STORE = 0x05
+TELEMETRY_CONFIG = 0x06
+LOOPER = 0x07
+PARAM_VALUE = 0x41
+DUMP_DATA = 0x43
+TELEMETRY = 0x45
+ACK = 0x7F
+
+HEADER_LENGTHS = {
+    GET_PARAM: 2, SET_PARAM: 2, DUMP_REQUEST: 1, LOAD_DATA: 7, STORE: 0, TELEMETRY_CONFIG: 1, LOOPER: 1,
+    PARAM_VALUE: 2, DUMP_DATA: 7, TELEMETRY: 0, ACK: 2,
+}
+
+TARGETS = {"config": 0, "presets": 1, "calibration": 2}
+LOOPER_ACTIONS = {"stop": 0, "record": 1, "play": 2, "overdub": 3, "clear": 4}
+STATUS_NAMES = ["ok", "unknown command", "bad parameter", "checksum error", "sequence error", "busy"]
+
+# Field types and the field table, mirrors ConfigSchema.cpp
+U8, I8, U16, BOOL, FLOAT = range(5)
+TYPE_FORMATS = {U8: "<B", I8: "<b", U16: "<H", BOOL: "<B", FLOAT: "<f"}
+
+# id: (name, type, count, min, max, default)
+FIELDS = {
+    1: ("numBeams", U8, 1, 1, 16, 7),
+    2: ("baseNote", U8, 1, 0, 127, 60),
+    3: ("noteInterval", U8, 1, 0, 24, 2),
+    27: ("sensorThresholds", U16, 16, 0, 65535, 0),
+    4: ("midiChannel", U8, 1, 1, 16, 1),
+    5: ("midiVelocity", U8, 1, 1, 127, 100),
+    6: ("midiEnabled", BOOL, 1, 0, 1, 1),
+    7: ("audioEnabled", BOOL, 1, 0, 1, 1),
+    28: ("mpeEnabled", BOOL, 1, 0, 1, 0),
+    29: ("mpeMemberChannels", U8, 1, 1, 15, 15),
+    30: ("mpeBendRange", U8, 1, 1, 96, 48),
+    8: ("reverbLevel", FLOAT, 1, 0.0, 1.0, 0.3),
+    9: ("masterVolume", FLOAT, 1, 0.0, 1.0, 0.8),
+    10: ("waveform", U8, 1, 0, 4, 0),
+    11: ("attackTime", FLOAT, 1, 0.0, 10.0, 0.01),
+    12: ("decayTime", FLOAT, 1, 0.0, 10.0, 0.1),
+    13: ("sustainLevel", FLOAT, 1, 0.0, 1.0, 0.7),
+    14: ("releaseTime", FLOAT, 1, 0.0, 10.0, 0.3),
+    15: ("filterCutoff", FLOAT, 1, 20.0, 20000.0, 1000.0),
+    16: ("filterResonance", FLOAT, 1, 0.0, 1.0, 0.5),
+    17: ("filterKeyTracking", FLOAT, 1, 0.0, 1.0, 0.0),
+    18: ("reverbEnabled", BOOL, 1, 0, 1, 0),
+    19: ("delayEnabled", BOOL, 1, 0, 1, 0),
+    20: ("delayTime", FLOAT, 1, 0.001, 0.999, 0.25),
+    21: ("delayFeedback", FLOAT, 1, 0.0, 0.95, 0.4),
+    40: ("oversampling", U8, 1, 1, 4, 2),
+    22: ("scale", U8, 1, 0, 14, 0),
+    23: ("chordMode", U8, 1, 0, 4, 0),
+    24: ("transpose", I8, 1, -48, 48, 0),
+    25: ("customScaleMask", U16, 1, 1, 4095, 4095),
+    31: ("arpMode", U8, 1, 0, 6, 0),
+    32: ("arpRate", U8, 1, 0, 5, 3),
+    33: ("arpGate", FLOAT, 1, 0.05, 1.0, 0.5),
+    34: ("arpOctaves", U8, 1, 1, 4, 1),
+    35: ("arpPattern", U16, 1, 1, 65535, 65535),
+    36: ("arpSteps", U8, 1, 1, 16, 16),
+    37: ("tempo", FLOAT, 1, 20.0, 300.0, 120.0),
+    38: ("clockSource", U8, 1, 0, 1, 0),
+    39: ("loopQuantize", U8, 1, 0, 6, 0),
+    26: ("currentPreset", U8, 1, 0, 127, 0),
+}
+FIELD_IDS = {field[0]: field_id for field_id, field in FIELDS.items()}
+
+
+# 7-bit packing: each group of 7 bytes is preceded by a byte holding their top bits
+def pack7(data):
+    out = bytearray()
+    for i in range(0, len(data), 7):
+        group = data[i:i + 7]
+        msbs = 0
+        for j, byte in enumerate(group):
+            msbs |= (byte >> 7) << (6 - j)
+        out.append(msbs)
+        out.extend(byte & 0x7F for byte in group)
+    return bytes(out)
+
+
+def unpack7(data):
+    out = bytearray()
+    for i in range(0, len(data), 8):
+        msbs = data[i]
+        for j, byte in enumerate(data[i + 1:i + 8]):
+            out.append(byte | (((msbs >> (6 - j)) & 1) << 7))
+    return bytes(out)
+
+
+def build_message(command, header=b"", payload=b""):
+    """SysEx body without F0/F7"""
+    return bytes([MANUFACTURER_ID, DEVICE_ID, command]) + bytes(header) + pack7(payload)
+
+
+def parse_message(data):
+    """Returns (command, header, payload) or None for foreign messages"""
+    if len(data) < 3 or data[0] != MANUFACTURER_ID or data[1] != DEVICE_ID:
+        return None
+    command = data[2]
+    length = HEADER_LENGTHS.get(command, 0)
+    return command, bytes(data[3:3 + length]), unpack7(data[3 + length:])
+
+
+def chunk_header(target, chunk, total, data):
+    return bytes([target, chunk & 0x7F, chunk >> 7, total & 0x7F, total >> 7,
+                  len(data), sum(data) & 0x7F])
+
+
+class ProtocolError(Exception):
+    pass
+
+
+class LaserHarpClient:
+    """Request/response client on top of a transport with send(body) and receive(timeout)"""
+
+    def __init__(self, transport, timeout=1.0):
+        self.transport = transport
+        self.timeout = timeout
+
+    def request(self, command, header=b"", payload=b"", expect=(ACK,)):
+        self.transport.send(build_message(command, header, payload))
+        return self.wait_for(expect)
+
+    def wait_for(self, expect):
+        deadline = time.time() + self.timeout
+        while time.time() < deadline:
+            message = self.transport.receive(deadline - time.time())
+            if message is None:
+                continue
+            parsed = parse_message(message)
+            if parsed and parsed[0] in expect:
+                return parsed
+        raise ProtocolError("timeout waiting for reply")
+
+    @staticmethod
+    def check_ack(reply, command):
+        _, header, _ = reply
+        if header[0] != command or header[1] != 0:
+            status = STATUS_NAMES[header[1]] if header[1] < len(STATUS_NAMES) else header[1]
+            raise ProtocolError(f"command 0x{header[0]:02X} failed: {status}")
+
+    def get_param(self, field_id, index=0):
+        reply = self.request(GET_PARAM, [field_id, index], expect=(PARAM_VALUE, ACK))
+        if reply[0] == ACK:
+            self.check_ack(reply, GET_PARAM)
+        return struct.unpack("<f", reply[2][:4])[0]
+
+    def set_param(self, field_id, value, index=0):
+        self.check_ack(self.request(SET_PARAM, [field_id, index], struct.pack("<f", value)), SET_PARAM)
+
+    def dump(self, target):
+        self.check_ack(self.request(DUMP_REQUEST, [target]), DUMP_REQUEST)
+        data = bytearray()
+        expected = 0
+        while True:
+            _, header, payload = self.wait_for((DUMP_DATA,))
+            chunk = header[1] | (header[2] << 7)
+            total = header[3] | (header[4] << 7)
+            if chunk != expected or len(payload) != header[5] or (sum(payload) & 0x7F) != header[6]:
+                raise ProtocolError(f"corrupt dump chunk {chunk}")
+            data.extend(payload)
+            expected += 1
+            if expected == total:
+                return bytes(data)
+
+    def load(self, target, data, retries=3):
+        total = max(1, (len(data) + CHUNK_SIZE - 1) // CHUNK_SIZE)
+        for chunk in range(total):
+            part = data[chunk * CHUNK_SIZE:(chunk + 1) * CHUNK_SIZE]
+            for attempt in range(retries):
+                reply = self.request(LOAD_DATA, chunk_header(target, chunk, total, part), part)
+                if reply[1][1] == 0:
+                    break
+                if attempt == retries - 1:
+                    self.check_ack(reply, LOAD_DATA)
+
+    def store(self):
+        self.check_ack(self.request(STORE), STORE)
+
+    def configure_telemetry(self, interval_ms):
+        self.check_ack(self.request(TELEMETRY_CONFIG, [min(127, interval_ms // 10)]), TELEMETRY_CONFIG)
+
+    def looper(self, action):
+        self.check_ack(self.request(LOOPER, [LOOPER_ACTIONS[action]]), LOOPER)
+
+    def read_telemetry(self):
+        _, _, payload = self.wait_for((TELEMETRY,))
+        values = struct.unpack("<4f2IH2B", payload[:28])
+        keys = ("cpuLoad", "peakCpuLoad", "limiterGain", "outputLevel", "messagesSent",
+                "configVersion", "beamStates", "activeVoices", "currentPreset")
+        return dict(zip(keys, values))
+
+
+class MidoTransport:
+    """SysEx over a MIDI port (mido strips F0/F7 from sysex data)"""
+
+    def __init__(self, input_name, output_name):
+        import mido
+        self.mido = mido
+        self.inport = mido.open_input(input_name)
+        self.outport = mido.open_output(output_name)
+
+    def send(self, body):
+        self.outport.send(self.mido.Message("sysex", data=list(body)))
+
+    def receive(self, timeout):
+        deadline = time.time() + max(0.0, timeout)
+        while time.time() < deadline:
+            for message in self.inport.iter_pending():
+                if message.type == "sysex":
+                    return bytes(message.data)
+            time.sleep(0.001)
+        return None
+
+
+class DeviceEmulator:
+    """In-process stand-in for the device, implements the same protocol"""
+
+    def __init__(self):
+        self.values = {field_id: [f[5]] * f[2] for field_id, f in FIELDS.items()}
+        self.presets = bytearray(16 * 128)
+        self.pending_load = bytearray()
+        self.load_state = None          # (target, next chunk, total)
+        self.outbox = []
+        self.telemetry_interval = 0
+        self.last_telemetry = 0.0
+        self.messages_sent = 0
+        self.version = 1
+
+    def clamp(self, field_id, value):
+        _, field_type, _, low, high, _ = FIELDS[field_id]
+        value = min(max(value, low), high)
+        return value if field_type == FLOAT else int(value)
+
+    def serialize(self):
+        out = bytearray()
+        for field_id, (_, field_type, count, _, _, _) in FIELDS.items():
+            out += bytes([field_id, field_type, count])
+            for value in self.values[field_id]:
+                out += struct.pack(TYPE_FORMATS[field_type], value)
+        return bytes(out)
+
+    def deserialize(self, data):
+        values = {field_id: [f[5]] * f[2] for field_id, f in FIELDS.items()}
+        position = 0
+        while position + 3 <= len(data):
+            field_id, field_type, count = data[position:position + 3]
+            position += 3
+            size = struct.calcsize(TYPE_FORMATS.get(field_type, "<B"))
+            if field_type not in TYPE_FORMATS or position + count * size > len(data):
+                return False
+            if field_id in FIELDS:
+                for i in range(min(count, FIELDS[field_id][2])):
+                    raw = struct.unpack_from(TYPE_FORMATS[field_type], data, position + i * size)[0]
+                    values[field_id][i] = self.clamp(field_id, raw)
+            position += count * size
+        self.values = values
+        return True
+
+    def reply(self, command, header=b"", payload=b""):
+        self.outbox.append(build_message(command, header, payload))
+        self.messages_sent += 1
+
+    def ack(self, command, status=0):
+        self.reply(ACK, [command, status])
+
+    def target_bytes(self, target):
+        if target == 0:
+            return self.serialize()
+        if target == 1:
+            return bytes(self.presets)
+        return b"".join(struct.pack("<H", v) for v in self.values[27])
+
+    def handle(self, body):
+        parsed = parse_message(body)
+        if parsed is None:
+            return
+        command, header, payload = parsed
+        if command not in HEADER_LENGTHS or command >= PARAM_VALUE:
+            self.ack(command, 1)
+        elif len(header) != HEADER_LENGTHS[command]:
+            self.ack(command, 2)
+        elif command in (GET_PARAM, SET_PARAM):
+            field_id, index = header
+            if field_id not in FIELDS or index >= FIELDS[field_id][2]:
+                self.ack(command, 2)
+            elif command == GET_PARAM:
+                self.reply(PARAM_VALUE, header, struct.pack("<f", self.values[field_id][index]))
+            elif len(payload) != 4:
+                self.ack(command, 2)
+            else:
+                self.values[field_id][index] = self.clamp(field_id, struct.unpack("<f", payload)[0])
+                self.version += 1
+                self.ack(command)
+        elif command == DUMP_REQUEST:
+            if header[0] not in TARGETS.values():
+                self.ack(command, 2)
+                return
+            self.ack(command)
+            data = self.target_bytes(header[0])
+            total = max(1, (len(data) + CHUNK_SIZE - 1) // CHUNK_SIZE)
+            for chunk in range(total):
+                part = data[chunk * CHUNK_SIZE:(chunk + 1) * CHUNK_SIZE]
+                self.reply(DUMP_DATA, chunk_header(header[0], chunk, total, part), part)
+        elif command == LOAD_DATA:
+            self.ack(command, self.load_chunk(header, payload))
+        elif command == STORE:
+            self.ack(command)
+        elif command == TELEMETRY_CONFIG:
+            self.telemetry_interval = header[0] * 0.01
+            self.ack(command)
+        elif command == LOOPER:
+            self.ack(command, 0 if header[0] < len(LOOPER_ACTIONS) else 2)
+
+    def load_chunk(self, header, payload):
+        target = header[0]
+        chunk = header[1] | (header[2] << 7)
+        total = header[3] | (header[4] << 7)
+        if target not in TARGETS.values() or chunk >= total or len(payload) != header[5]:
+            return 2
+        if (sum(payload) & 0x7F) != header[6]:
+            return 3
+        if chunk == 0:
+            self.load_state = (target, 0, total)
+            self.pending_load = bytearray()
+        elif self.load_state != (target, chunk, total):
+            return 4
+        self.pending_load += payload
+        self.load_state = (target, chunk + 1, total)
+        if chunk + 1 < total:
+            return 0
+
+        data = bytes(self.pending_load)
+        self.load_state = None
+        if target == 0:
+            ok = self.deserialize(data)
+        elif target == 1:
+            ok = len(data) == len(self.presets)
+            if ok:
+                self.presets[:] = data
+        else:
+            ok = len(data) == 32
+            if ok:
+                self.values[27] = [self.clamp(27, v) for v in struct.unpack("<16H", data)]
+        self.version += 1
+        return 0 if ok else 2
+
+    def poll(self):
+        now = time.time()
+        if self.telemetry_interval and now - self.last_telemetry >= self.telemetry_interval:
+            self.last_telemetry = now
+            self.reply(TELEMETRY, b"", struct.pack("<4f2IH2B", 0.12, 0.2, 1.0, 0.05,
+                                                   self.messages_sent, self.version, 0, 0,
+                                                   self.values[26][0]))
+
+
+class LoopbackTransport:
+    """Connects the client directly to a DeviceEmulator"""
+
+    def __init__(self, device=None):
+        self.device = device or DeviceEmulator()
+
+    def send(self, body):
+        self.device.handle(body)
+
+    def receive(self, timeout):
+        deadline = time.time() + max(0.0, timeout)
+        while True:
+            self.device.poll()
+            if self.device.outbox:
+                return self.device.outbox.pop(0)
+            if time.time() >= deadline:
+                return None
+            time.sleep(0.001)
+
+
+def resolve_field(name):
+    if name.isdigit() and int(name) in FIELDS:
+        return int(name)
+    if name in FIELD_IDS:
+        return FIELD_IDS[name]
+    raise SystemExit(f"Unknown parameter '{name}', use 'fields' to list them")
+
+
+def list_ports():
+    """List all available MIDI ports"""
+    import mido
+    print("\n=== MIDI Input Ports ===")
+    for i, port in enumerate(mido.get_input_names()):
+        print(f"{i}: {port}")
+    print("\n=== MIDI Output Ports ===")
+    for i, port in enumerate(mido.get_output_names()):
+        print(f"{i}: {port}")
+
+
+def find_port(names, hint):
+    for name in names:
+        if hint.lower() in name.lower():
+            return name
+    raise SystemExit(f"No MIDI port matching '{hint}'")
+
+
+def main():
+    parser = argparse.ArgumentParser(description="LaserHarp SysEx client")
+    parser.add_argument("--port", default="Daisy", help="MIDI port name (substring match)")
+    parser.add_argument("--loopback", action="store_true", help="Use the built-in device emulator")
+    sub = parser.add_subparsers(dest="command", required=True)
+    sub.add_parser("ports", help="List MIDI ports")
+    sub.add_parser("fields", help="List parameters")
+    p = sub.add_parser("get", help="Read a parameter")
+    p.add_argument("name")
+    p.add_argument("index", type=int, nargs="?", default=0)
+    p = sub.add_parser("set", help="Write a parameter")
+    p.add_argument("name")
+    p.add_argument("value", type=float)
+    p.add_argument("index", type=int, nargs="?", default=0)
+    p = sub.add_parser("dump", help="Save presets, config or calibration to a file")
+    p.add_argument("target", choices=TARGETS)
+    p.add_argument("file")
+    p = sub.add_parser("load", help="Restore presets, config or calibration from a file")
+    p.add_argument("target", choices=TARGETS)
+    p.add_argument("file")
+    sub.add_parser("store", help="Write configuration and presets to flash")
+    p = sub.add_parser("loop", help="Looper transport")
+    p.add_argument("action", choices=LOOPER_ACTIONS)
+    p = sub.add_parser("telemetry", help="Stream telemetry")
+    p.add_argument("--interval", type=int, default=100, help="ms")
+    p.add_argument("--count", type=int, default=0, help="Frames to show, 0 = until Ctrl+C")
+    args = parser.parse_args()
+
+    if args.command == "ports":
+        list_ports()
+        return
+    if args.command == "fields":
+        for field_id, (name, _, count, low, high, default) in sorted(FIELDS.items()):
+            label = f"{name}[{count}]" if count > 1 else name
+            print(f"{field_id:3d} {label:22s} {low} - {high} (default {default})")
+        return
+
+    if args.loopback:
+        transport = LoopbackTransport()
+    else:
+        import mido
+        transport = MidoTransport(find_port(mido.get_input_names(), args.port),
+                                  find_port(mido.get_output_names(), args.port))
+    client = LaserHarpClient(transport)
+
+    try:
+        if args.command == "get":
+            print(client.get_param(resolve_field(args.name), args.index))
+        elif args.command == "set":
+            client.set_param(resolve_field(args.name), args.value, args.index)
+        elif args.command == "dump":
+            data = client.dump(TARGETS[args.target])
+            with open(args.file, "wb") as f:
+                f.write(data)
+            print(f"{len(data)} bytes written to {args.file}")
+        elif args.command == "load":
+            with open(args.file, "rb") as f:
+                client.load(TARGETS[args.target], f.read())
+            print("Loaded, use 'store' to keep it after power off")
+        elif args.command == "store":
+            client.store()
+        elif args.command == "loop":
+            client.looper(args.action)
+        elif args.command == "telemetry":
+            client.configure_telemetry(args.interval)
+            shown = 0
+            try:
+                while args.count == 0 or shown < args.count:
+                    frame = client.read_telemetry()
+                    print(" ".join(f"{k}={v:.3f}" if isinstance(v, float) else f"{k}={v}"
+                                   for k, v in frame.items()))
+                    shown += 1
+            except KeyboardInterrupt:
+                pass
+            finally:
+                client.configure_telemetry(0)
+    except ProtocolError as e:
+        print(f"Error: {e}")
+        sys.exit(1)
+
+
+if __name__ == "__main__":
+    main()
\ No newline at end of file
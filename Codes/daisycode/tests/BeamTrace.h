@@ -0,0 +1,87 @@
+#pragma once
+#include <math.h>
+
+#include "LaserBeamManager.h"
+
+// Synthetic LDR trace for the LaserBeamManager replays: ambient light with
+// mains flicker, the laser contribution of the beam under the mirror, a hand
+// blocking part of it, the LDR's first-order response and ADC noise.
+
+const double BEAM_TRACE_PI = 3.14159265358979;
+
+struct Scene {
+    const char* name;
+    float ambient;          // Steady ambient light, share of the ADC range
+    float flicker;          // Flicker of the ambient light, peak to peak
+    float flickerHz;        // 100 Hz from mains lamps, 50 Hz from half-wave LED drivers
+    float beamLevel;        // Laser contribution of an intact beam
+    float beamLevelEnd;     // Contribution at the end of the run (laser ageing)
+    bool hover;             // The hand rests half in the beam instead of blocking it
+    uint32_t holdUs;        // How long the hand stays in the beam
+    float attackUs;         // LDR time constant while the light rises
+    float decayUs;          // LDR time constant while the light falls
+};
+
+// Synthetic LDR trace, sampled wherever the scanner happens to be
+class TraceGenerator {
+public:
+    explicit TraceGenerator(const Scene& scene)
+        : scene_(scene), handBeam_(-1), progress_(0.0f), response_(scene.ambient), lastUs_(0), noise_(12345) {}
+
+    void SetHand(int beam) { handBeam_ = beam; }
+    int GetHand() const { return handBeam_; }
+    void SetProgress(float progress) { progress_ = progress; }
+
+    // Follows the light since the last call, which fell on the beam the mirror
+    // points at (-1 = between beams). Called every update tick.
+    void Advance(uint32_t timeUs, int beam, bool laserOn) {
+        double t = timeUs * 1e-6;
+        float light = scene_.ambient + scene_.flicker * 0.5f * (1.0f + (float)sin(2.0 * BEAM_TRACE_PI * scene_.flickerHz * t));
+        if (laserOn && beam >= 0) {
+            float level = scene_.beamLevel + (scene_.beamLevelEnd - scene_.beamLevel) * progress_;
+            light += level * Transmission(beam, t);
+        }
+        float tau = light > response_ ? scene_.attackUs : scene_.decayUs;
+        response_ += (light - response_) * (1.0f - expf(-(float)(timeUs - lastUs_) / tau));
+        lastUs_ = timeUs;
+    }
+
+    // Reading (0-1) of the LDR now
+    float Sample() {
+        float reading = response_ + Noise();
+        return reading < 0.0f ? 0.0f : (reading > 1.0f ? 1.0f : reading);
+    }
+
+private:
+    // Share of the beam reaching the LDR: a hand blocks most of it, a hovering
+    // hand trembles between 40% and 65%
+    float Transmission(int beam, double t) const {
+        if (beam != handBeam_) return 1.0f;
+        if (!scene_.hover) return 0.1f;
+        return 0.525f + 0.125f * (float)sin(2.0 * BEAM_TRACE_PI * 6.0 * t);
+    }
+
+    // About +-4 ADC counts
+    float Noise() {
+        noise_ = noise_ * 1664525u + 1013904223u;
+        return ((noise_ >> 8) / 16777216.0f - 0.5f) * 0.008f;
+    }
+
+    Scene scene_;
+    int handBeam_;
+    float progress_;
+    float response_;        // Light the LDR responds to so far
+    uint32_t lastUs_;
+    uint32_t noise_;
+};
+
+// Test hook declared a friend by LaserBeamManager
+class ScannerProbe {
+public:
+    // Beam under the mirror, -1 between beam positions
+    static int GetBeamUnderMirror(const LaserBeamManager& beams) {
+        if (beams.currentStepPosition_ % beams.stepsPerBeam_ != 0) return -1;
+        return beams.currentStepPosition_ / beams.stepsPerBeam_;
+    }
+    static bool IsLaserOn(const LaserBeamManager& beams) { return beams.laserState_; }
+};
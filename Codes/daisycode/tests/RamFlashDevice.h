@@ -0,0 +1,94 @@
+#pragma once
+#include <stdint.h>
+#include <string.h>
+#include <vector>
+#include "RecordStore.h"
+
+// RAM-backed NOR flash for host tests. Programming can only clear bits and
+// erasing sets a whole sector to 0xFF, as on the QSPI chip.
+//
+// Power loss: SetPowerBudget(n) lets the next n bytes of program/erase work
+// through and then cuts the power in the middle of the running operation.
+// From then on every operation fails until PowerOn(). A cut erase leaves the
+// rest of the sector as it was, or half erased (each remaining byte gets some
+// bits set) with SetEraseNoise(true).
+class RamFlashDevice : public FlashDevice {
+public:
+    RamFlashDevice(uint32_t sectorSize, uint32_t pageSize, uint32_t numSectors)
+        : sectorSize_(sectorSize), pageSize_(pageSize), memory_(sectorSize * numSectors, 0xFF),
+          budget_(-1), poweredOff_(false), eraseNoise_(false), noise_(1), programBytes_(0), eraseBytes_(0) {
+    }
+
+    uint32_t GetSectorSize() const override { return sectorSize_; }
+    uint32_t GetPageSize() const override { return pageSize_; }
+
+    bool Read(uint32_t address, void* buffer, size_t length) override {
+        if (poweredOff_ || address + length > memory_.size()) return false;
+        memcpy(buffer, &memory_[address], length);
+        return true;
+    }
+
+    bool Program(uint32_t address, const void* data, size_t length) override {
+        if (poweredOff_ || address + length > memory_.size()) return false;
+        const uint8_t* bytes = (const uint8_t*)data;
+        for (size_t i = 0; i < length; i++) {
+            if (!Spend()) return false;
+            memory_[address + i] &= bytes[i];
+            programBytes_++;
+        }
+        return true;
+    }
+
+    bool EraseSector(uint32_t address) override {
+        address -= address % sectorSize_;
+        if (poweredOff_ || address + sectorSize_ > memory_.size()) return false;
+        for (uint32_t i = 0; i < sectorSize_; i++) {
+            if (!Spend()) {
+                for (uint32_t j = i; eraseNoise_ && j < sectorSize_; j++) {
+                    memory_[address + j] |= NextNoise();
+                }
+                return false;
+            }
+            memory_[address + i] = 0xFF;
+            eraseBytes_++;
+        }
+        return true;
+    }
+
+    // Power control
+    void SetPowerBudget(int64_t bytes) { budget_ = bytes; }
+    void PowerOn() { poweredOff_ = false; budget_ = -1; }
+    bool IsPoweredOff() const { return poweredOff_; }
+    void SetEraseNoise(bool enabled) { eraseNoise_ = enabled; }
+
+    // Direct access
+    void Fill(uint8_t value) { memset(memory_.data(), value, memory_.size()); }
+    void FillNoise() { for (size_t i = 0; i < memory_.size(); i++) memory_[i] = NextNoise(); }
+    uint64_t GetProgramBytes() const { return programBytes_; }
+    uint64_t GetEraseBytes() const { return eraseBytes_; }
+
+private:
+    uint32_t sectorSize_;
+    uint32_t pageSize_;
+    std::vector<uint8_t> memory_;
+    int64_t budget_;            // Bytes left before the power cut, -1 = unlimited
+    bool poweredOff_;
+    bool eraseNoise_;           // A cut erase scatters set bits over the rest of the sector
+    uint32_t noise_;
+    uint64_t programBytes_;
+    uint64_t eraseBytes_;
+
+    bool Spend() {
+        if (budget_ == 0) {
+            poweredOff_ = true;
+            return false;
+        }
+        if (budget_ > 0) budget_--;
+        return true;
+    }
+
+    uint8_t NextNoise() {
+        noise_ = noise_ * 1103515245 + 12345;
+        return (uint8_t)(noise_ >> 16);
+    }
+};
\ No newline at end of file
@@ -0,0 +1,63 @@
+#pragma once
+#include <stdint.h>
+#include <vector>
+#include "NoteSink.h"
+
+// Note outputs for host tests: they record what the NoteScheduler hands over.
+// The synthesizer side owns the simulated render clock and can be made to
+// refuse notes (a full event queue) with SetAccepting(false).
+struct RecordedNote {
+    uint32_t time;          // Scheduled sample time (synth) or render clock at the send (MIDI)
+    uint8_t note;
+    uint8_t velocity;       // 0 = note off
+};
+
+class RecordingSynth : public TimedNoteSink {
+public:
+    RecordingSynth() : clock_(0), accepting_(true) {}
+
+    uint32_t GetSampleTime() const override { return clock_; }
+
+    bool NoteOnAt(uint32_t time, uint8_t note, uint8_t velocity, uint8_t beamIndex) override {
+        if (!accepting_) return false;
+        RecordedNote event = { time, note, velocity };
+        notes.push_back(event);
+        return true;
+    }
+
+    bool NoteOffAt(uint32_t time, uint8_t note) override {
+        if (!accepting_) return false;
+        RecordedNote event = { time, note, 0 };
+        notes.push_back(event);
+        return true;
+    }
+
+    void Advance(uint32_t samples) { clock_ += samples; }
+    void SetAccepting(bool accepting) { accepting_ = accepting; }
+
+    std::vector<RecordedNote> notes;
+
+private:
+    uint32_t clock_;
+    bool accepting_;
+};
+
+class RecordingMidi : public NoteOutput {
+public:
+    explicit RecordingMidi(const RecordingSynth& clock) : clock_(clock) {}
+
+    void SendNoteOn(uint8_t note, uint8_t velocity) override {
+        RecordedNote event = { clock_.GetSampleTime(), note, velocity };
+        notes.push_back(event);
+    }
+
+    void SendNoteOff(uint8_t note) override {
+        RecordedNote event = { clock_.GetSampleTime(), note, 0 };
+        notes.push_back(event);
+    }
+
+    std::vector<RecordedNote> notes;
+
+private:
+    const RecordingSynth& clock_;
+};
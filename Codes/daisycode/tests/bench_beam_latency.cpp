@@ -0,0 +1,116 @@
+// Single-MCU latency from a hand entering a beam until the main loop plays the
+// break, replayed on the simulated clock: LaserBeamManager steps in its 20 kHz
+// interrupt against the LDR trace of BeamTrace.h (steady light, 0.5/2 ms LDR),
+// and the events are drained every millisecond as LaserHarp's main loop does.
+// Prints the mean and worst latency for 5 beams and for the default beam count.
+#include <stdio.h>
+#include <stdlib.h>
+#include <vector>
+#include <algorithm>
+
+#include "LaserBeamManager.h"
+#include "ConfigManager.h"
+#include "BeamTrace.h"
+
+const uint32_t TICK_US = 1000000 / LaserBeamManager::UPDATE_RATE_HZ;   // Update interrupt period
+const uint32_t MAIN_LOOP_US = 1000;
+const uint32_t WARMUP_US = 1000000;
+const uint32_t HOLD_US = 20000;
+const uint32_t TIMEOUT_US = 300000;
+const int TRIALS = 600;
+
+static TraceGenerator* latencyTrace = nullptr;
+
+static float ReadTrace(uint8_t channel) {
+    return latencyTrace->Sample();
+}
+
+enum TrialPhase { IDLE, WAIT_BREAK, HOLD, WAIT_RESTORE };
+
+// Latencies in us of the breaks, 0 beams = the configuration default
+static std::vector<uint32_t> Measure(uint8_t numBeams, uint8_t* beamCount) {
+    const Scene scene = { "steady light", 0.05f, 0.0f, 0.0f, 0.5f, 0.5f, false, HOLD_US, 500.0f, 2000.0f };
+    ConfigManager config;
+    config.Init();
+    if (numBeams > 0) {
+        config.GetConfig()->numBeams = numBeams;
+        config.Publish();
+    }
+
+    LaserBeamManager* beams = new LaserBeamManager();
+    TraceGenerator trace(scene);
+    latencyTrace = &trace;
+    daisy::host::Adc() = ReadTrace;
+    daisy::host::Micros() = 0;
+    daisy::DaisySeed hw;
+    beams->Init(&hw, &config);
+    *beamCount = beams->GetActiveBeamCount();
+
+    std::vector<uint32_t> latencies;
+    TrialPhase phase = IDLE;
+    int trialBeam = -1;
+    uint32_t entered = 0;
+    uint32_t& now = daisy::host::Micros();
+    uint32_t deadline = WARMUP_US;
+    srand(1);
+
+    while (latencies.size() < (size_t)TRIALS) {
+        now += TICK_US;
+        trace.Advance(now, ScannerProbe::GetBeamUnderMirror(*beams), ScannerProbe::IsLaserOn(*beams));
+        beams->Update();
+
+        BeamEvent event;
+        while (now % MAIN_LOOP_US == 0 && beams->GetNextEvent(&event)) {
+            if (event.beamIndex != trialBeam) continue;
+            if (event.type == BEAM_BROKEN && phase == WAIT_BREAK) {
+                latencies.push_back(now - entered);
+                phase = HOLD;
+                deadline = now + HOLD_US;
+            } else if (event.type == BEAM_RESTORED && phase == WAIT_RESTORE) {
+                phase = IDLE;
+                deadline = now + 5000 + rand() % 50000;
+            }
+        }
+
+        if ((int32_t)(now - deadline) < 0) continue;
+        switch (phase) {
+            case IDLE:                  // A hand enters a random beam at a random time
+                trialBeam = rand() % *beamCount;
+                trace.SetHand(trialBeam);
+                entered = now;
+                phase = WAIT_BREAK;
+                deadline = now + TIMEOUT_US;
+                break;
+            case HOLD:
+                trace.SetHand(-1);
+                phase = WAIT_RESTORE;
+                deadline = now + TIMEOUT_US;
+                break;
+            case WAIT_BREAK:            // Not expected, reported and skipped
+            case WAIT_RESTORE:
+                printf("beam %d: no %s within %u ms\n", trialBeam, phase == WAIT_BREAK ? "break" : "restore",
+                       TIMEOUT_US / 1000);
+                trace.SetHand(-1);
+                phase = IDLE;
+                deadline = now + TIMEOUT_US;
+                break;
+        }
+    }
+    delete beams;
+    return latencies;
+}
+
+int main() {
+    const uint8_t beamCounts[] = { 5, 0 };
+    for (uint8_t numBeams : beamCounts) {
+        uint8_t beamCount = 0;
+        std::vector<uint32_t> latencies = Measure(numBeams, &beamCount);
+        double sum = 0.0;
+        for (uint32_t latency : latencies) sum += latency;
+        uint32_t worst = *std::max_element(latencies.begin(), latencies.end());
+        printf("single-MCU latency, %d beams%s: mean %.1f ms, max %.1f ms over %zu entries\n",
+               beamCount, numBeams == 0 ? " (default)" : "", sum / latencies.size() / 1000.0,
+               worst / 1000.0, latencies.size());
+    }
+    return 0;
+}
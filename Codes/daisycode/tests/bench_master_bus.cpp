@@ -0,0 +1,79 @@
+// MasterBus cost on the host for each clipper oversampling factor: 48-sample
+// stereo blocks of a two-tone signal driven 10 dB over full scale. Prints the
+// time per block relative to 1x and the output peak, which the limiter must
+// hold at the -0.3 dBFS ceiling. Timings are the best of several runs.
+#include <stdio.h>
+#include <math.h>
+#include <chrono>
+
+#include "MasterBus.h"
+
+const float SAMPLE_RATE = 48000.0f;
+const size_t BLOCK_SIZE = 48;
+const int BLOCKS = 100000;
+const int RUNS = 5;
+const float DRIVE = 3.1623f;            // +10 dB
+const float CEILING = 0.966f;           // MasterBus default, -0.3 dBFS
+const double PI = 3.14159265358979;
+const size_t INPUT_SIZE = 4800;         // 0.1 s, a whole number of periods of every tone
+
+static float inputLeft[INPUT_SIZE];
+static float inputRight[INPUT_SIZE];
+
+struct Measurement {
+    double nsPerBlock;
+    float peak;
+};
+
+static Measurement Measure(OversamplingFactor factor) {
+    MasterBus bus;
+    bus.Init(SAMPLE_RATE);
+    bus.SetOversampling(factor);
+
+    float left[BLOCK_SIZE];
+    float right[BLOCK_SIZE];
+    Measurement result = { 1e30, 0.0f };
+    size_t at = 0;
+    for (int run = 0; run < RUNS; run++) {
+        std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+        for (int b = 0; b < BLOCKS; b++) {
+            for (size_t i = 0; i < BLOCK_SIZE; i++) {
+                left[i] = inputLeft[at + i];
+                right[i] = inputRight[at + i];
+            }
+            at = (at + BLOCK_SIZE) % INPUT_SIZE;
+            bus.Process(left, right, BLOCK_SIZE);
+            for (size_t i = 0; i < BLOCK_SIZE; i++) {
+                result.peak = fmaxf(result.peak, fmaxf(fabsf(left[i]), fabsf(right[i])));
+            }
+        }
+        double ns = std::chrono::duration<double, std::nano>(std::chrono::steady_clock::now() - start).count();
+        if (ns < result.nsPerBlock) result.nsPerBlock = ns;
+    }
+    result.nsPerBlock /= BLOCKS;
+    return result;
+}
+
+int main() {
+    for (size_t i = 0; i < INPUT_SIZE; i++) {
+        double t = i / (double)SAMPLE_RATE;
+        inputLeft[i] = DRIVE * (float)(0.6 * sin(2.0 * PI * 220.0 * t) + 0.4 * sin(2.0 * PI * 3300.0 * t));
+        inputRight[i] = DRIVE * (float)(0.6 * sin(2.0 * PI * 330.0 * t) + 0.4 * sin(2.0 * PI * 5100.0 * t));
+    }
+
+    const OversamplingFactor factors[] = { OVERSAMPLE_1X, OVERSAMPLE_2X, OVERSAMPLE_4X };
+    double base = 0.0;
+    bool held = true;
+    for (OversamplingFactor factor : factors) {
+        Measurement m = Measure(factor);
+        if (factor == OVERSAMPLE_1X) base = m.nsPerBlock;
+        printf("master bus, %dx oversampling: %6.0f ns/block (%.1fx), output peak %.3f\n",
+               (int)factor, m.nsPerBlock, m.nsPerBlock / base, m.peak);
+        held = held && m.peak <= CEILING;
+    }
+    if (!held) {
+        printf("output peak above the %.3f ceiling\n", CEILING);
+        return 1;
+    }
+    return 0;
+}
@@ -0,0 +1,79 @@
+// Voice mix cost on the host: 16 voices of 48 samples summed into a stereo
+// pair. Compares the fused MixBuffersStereo kernel with the per-channel mono
+// mix it replaced, called once for each side. Both are kept out of line, as
+// the member functions were. Timings only, the best of several runs.
+#include <stdio.h>
+#include <math.h>
+#include <chrono>
+
+#include "StereoMix.h"
+
+const size_t BLOCK_SIZE = 48;
+const int VOICES = 16;
+const int BLOCKS = 200000;
+const int RUNS = 5;
+
+static float voices[VOICES][BLOCK_SIZE];
+static float gains[VOICES][2];
+
+// The former AudioSynthesizer::MixBuffers
+__attribute__((noinline)) static void MixBuffers(float* dest, const float* src, size_t size, float gain) {
+    for (size_t i = 0; i < size; i++) {
+        dest[i] += src[i] * gain;
+    }
+}
+
+__attribute__((noinline)) static void MixStereo(float* left, float* right, const float* src, size_t size,
+                                                 float gainLeft, float gainRight) {
+    MixBuffersStereo(left, right, src, size, gainLeft, gainRight);
+}
+
+static double NsPerBlock(bool fused, float* check) {
+    float left[BLOCK_SIZE];
+    float right[BLOCK_SIZE];
+    double best = 1e30;
+    for (int run = 0; run < RUNS; run++) {
+        *check = 0.0f;
+        std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+        for (int b = 0; b < BLOCKS; b++) {
+            for (size_t i = 0; i < BLOCK_SIZE; i++) {
+                left[i] = 0.0f;
+                right[i] = 0.0f;
+            }
+            for (int v = 0; v < VOICES; v++) {
+                if (fused) {
+                    MixStereo(left, right, voices[v], BLOCK_SIZE, gains[v][0], gains[v][1]);
+                } else {
+                    MixBuffers(left, voices[v], BLOCK_SIZE, gains[v][0]);
+                    MixBuffers(right, voices[v], BLOCK_SIZE, gains[v][1]);
+                }
+            }
+            *check += left[b % BLOCK_SIZE] + right[(b + 7) % BLOCK_SIZE];
+        }
+        double ns = std::chrono::duration<double, std::nano>(std::chrono::steady_clock::now() - start).count();
+        if (ns < best) best = ns;
+    }
+    return best / BLOCKS;
+}
+
+int main() {
+    for (int v = 0; v < VOICES; v++) {
+        for (size_t i = 0; i < BLOCK_SIZE; i++) voices[v][i] = sinf(0.05f * (v + 1) * i);
+        float pan = (float)v / (VOICES - 1) * 1.5707963f;
+        gains[v][0] = cosf(pan);
+        gains[v][1] = sinf(pan);
+    }
+
+    float perChannelCheck;
+    float fusedCheck;
+    double perChannel = NsPerBlock(false, &perChannelCheck);
+    double fused = NsPerBlock(true, &fusedCheck);
+    printf("stereo mix, %d voices x %zu samples, per-channel mix: %6.0f ns/block\n", VOICES, BLOCK_SIZE, perChannel);
+    printf("stereo mix, %d voices x %zu samples, fused kernel:    %6.0f ns/block (%.1fx)\n",
+           VOICES, BLOCK_SIZE, fused, perChannel / fused);
+    if (fabsf(perChannelCheck - fusedCheck) > 1e-3f * fabsf(perChannelCheck)) {
+        printf("outputs differ: %g %g\n", perChannelCheck, fusedCheck);
+        return 1;
+    }
+    return 0;
+}
@@ -0,0 +1,81 @@
+// VoiceFilter cost on the host, one voice in 48-sample blocks. Compares the
+// cached coefficients of the audio path with recomputing them from tanf() once
+// per block and once per sample. Timings only, the best of several runs.
+#include <stdio.h>
+#include <math.h>
+#include <chrono>
+
+#include "VoiceFilter.h"
+
+const float SAMPLE_RATE = 48000.0f;
+const size_t BLOCK_SIZE = 48;
+const int BLOCKS = 200000;
+const int RUNS = 5;
+const float PI_F = 3.14159265358979f;
+
+static float input[BLOCK_SIZE];
+static float sink = 0.0f;          // Keeps the output alive
+
+enum Mode {
+    CACHED,             // Modulation within the 0.5% threshold, no recomputation
+    LOOKUP_PER_BLOCK,   // Modulation sweep, coefficients from the tan() table every block
+    TANF_PER_BLOCK,     // SetPrecomputed() with a tanf() every block
+    TANF_PER_SAMPLE     // SetPrecomputed() with a tanf() every sample
+};
+
+static double NsPerSample(Mode mode) {
+    VoiceFilter filter;
+    filter.Init(SAMPLE_RATE);
+    float k = VoiceFilter::ComputeK(0.5f);
+    filter.SetPrecomputed(1000.0f, VoiceFilter::ComputeG(1000.0f, SAMPLE_RATE), k);
+    float buffer[BLOCK_SIZE];
+
+    double best = 1e30;
+    for (int run = 0; run < RUNS; run++) {
+        std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+        for (int b = 0; b < BLOCKS; b++) {
+            for (size_t i = 0; i < BLOCK_SIZE; i++) buffer[i] = input[i];
+            float cutoff = 1000.0f * (1.0f + 0.5f * (float)(b & 63) / 64.0f);
+            switch (mode) {
+                case CACHED:
+                    filter.SetModulation(0.5f + 0.0001f * (b & 7));
+                    filter.ProcessBlock(buffer, BLOCK_SIZE);
+                    break;
+                case LOOKUP_PER_BLOCK:
+                    filter.SetModulation(0.5f + 0.02f * (b & 7));
+                    filter.ProcessBlock(buffer, BLOCK_SIZE);
+                    break;
+                case TANF_PER_BLOCK:
+                    filter.SetPrecomputed(cutoff, tanf(PI_F * cutoff / SAMPLE_RATE), k);
+                    filter.ProcessBlock(buffer, BLOCK_SIZE);
+                    break;
+                case TANF_PER_SAMPLE:
+                    for (size_t i = 0; i < BLOCK_SIZE; i++) {
+                        float swept = cutoff * (1.0f + 0.001f * i);
+                        filter.SetPrecomputed(swept, tanf(PI_F * swept / SAMPLE_RATE), k);
+                        buffer[i] = filter.Process(buffer[i]);
+                    }
+                    break;
+            }
+            sink += buffer[BLOCK_SIZE - 1];
+        }
+        double ns = std::chrono::duration<double, std::nano>(std::chrono::steady_clock::now() - start).count();
+        if (ns < best) best = ns;
+    }
+    return best / ((double)BLOCKS * BLOCK_SIZE);
+}
+
+int main() {
+    for (size_t i = 0; i < BLOCK_SIZE; i++) input[i] = sinf(0.1f * i);
+
+    double cached = NsPerSample(CACHED);
+    double lookup = NsPerSample(LOOKUP_PER_BLOCK);
+    double perBlock = NsPerSample(TANF_PER_BLOCK);
+    double perSample = NsPerSample(TANF_PER_SAMPLE);
+    printf("voice filter, cached coefficients:        %5.1f ns/sample\n", cached);
+    printf("voice filter, table lookup every block:   %5.1f ns/sample\n", lookup);
+    printf("voice filter, tanf() every block:         %5.1f ns/sample\n", perBlock);
+    printf("voice filter, tanf() every sample:        %5.1f ns/sample\n", perSample);
+    printf("(output %g)\n", sink);
+    return 0;
+}
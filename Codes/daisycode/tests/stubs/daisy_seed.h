@@ -0,0 +1,106 @@
+#pragma once
+#include <stdint.h>
+#include <stddef.h>
+
+// Host stand-in for the parts of libDaisy the tested sources use. Only the
+// declarations have to match, the hardware classes do nothing except for the
+// few hooks a test drives (clock, ADC reading, pin states).
+
+#define DMA_BUFFER_MEM_SECTION
+#define DSY_SDRAM_BSS
+
+#define SCB_InvalidateDCache_by_Addr(address, size) ((void)0)
+
+namespace daisy {
+
+// Test hooks: the clock behind System::GetUs() and the source of ADC readings
+namespace host {
+inline uint32_t& Micros() { static uint32_t us = 0; return us; }
+typedef float (*AdcSource)(uint8_t channel);
+inline AdcSource& Adc() { static AdcSource source = nullptr; return source; }
+} // namespace host
+
+struct Pin {
+    uint8_t port;
+    uint8_t pin;
+};
+
+namespace seed {
+constexpr Pin D0 = {0, 0}, D1 = {0, 1}, D17 = {0, 17}, A0 = {1, 0};
+} // namespace seed
+
+class GPIO {
+public:
+    enum class Mode { INPUT, OUTPUT };
+    enum class Pull { NOPULL, PULLUP, PULLDOWN };
+    struct Config {
+        Pin pin;
+        Mode mode;
+        Pull pull;
+    };
+    void Init(const Config& config) { state_ = false; }
+    bool Read() { return state_; }
+    void Write(bool state) { state_ = state; }
+    void Toggle() { state_ = !state_; }
+    bool GetState() const { return state_; }
+private:
+    bool state_ = false;
+};
+
+struct System {
+    static uint32_t GetUs() { return host::Micros(); }
+    static uint32_t GetNow() { return host::Micros() / 1000; }
+    static void Delay(uint32_t ms) { host::Micros() += ms * 1000; }
+    static void DelayUs(uint32_t us) { host::Micros() += us; }
+};
+
+struct AdcChannelConfig {
+    void InitSingle(Pin pin) {}
+};
+
+class AdcHandle {
+public:
+    void Init(AdcChannelConfig* config, size_t channels) {}
+    void Start() {}
+    float GetFloat(uint8_t channel) { return host::Adc() ? host::Adc()(channel) : 0.0f; }
+};
+
+// Host tests call Update() themselves on a simulated clock, the timer never fires
+class TimerHandle {
+public:
+    struct Config {
+        enum class Peripheral { TIM_2, TIM_3, TIM_4, TIM_5 };
+        enum class CounterDir { UP, DOWN };
+        Peripheral periph;
+        CounterDir dir;
+        uint32_t period;
+        bool enable_irq;
+    };
+    enum class Result { OK, ERR };
+    typedef void (*PeriodElapsedCallback)(void* data);
+    Result Init(const Config& config) { return Result::OK; }
+    Result Start() { return Result::OK; }
+    Result Stop() { return Result::OK; }
+    Result SetPeriod(uint32_t ticks) { return Result::OK; }
+    uint32_t GetFreq() { return 200000000; }
+    void SetCallback(PeriodElapsedCallback callback, void* data = nullptr) {}
+};
+
+class QSPIHandle {
+public:
+    enum class Result { OK, ERR };
+    Result EraseSector(uint32_t address) { return Result::ERR; }
+    Result Write(uint32_t address, uint32_t size, uint8_t* buffer) { return Result::ERR; }
+    void* GetData(uint32_t offset = 0) { static uint8_t memory[4096]; return memory; }
+};
+
+// Only declared by the headers the tested sources include
+class CpuLoadMeter {};
+
+class DaisySeed {
+public:
+    AdcHandle adc;
+    QSPIHandle qspi;
+};
+
+} // namespace daisy
\ No newline at end of file
@@ -0,0 +1,14 @@
+#pragma once
+
+// Host stand-in for DaisySP: the tested sources only include headers that
+// declare DSP members, so empty types are enough.
+
+namespace daisysp {
+
+class Oscillator {};
+class Adsr {};
+class OnePole {};
+template <typename T, unsigned long max_size>
+class DelayLine {};
+
+} // namespace daisysp
\ No newline at end of file
@@ -0,0 +1,10 @@
+#pragma once
+
+// Host stand-in for the libDaisy MIDI handlers, declarations only
+namespace daisy {
+
+struct MidiEvent;
+class MidiUartHandler {};
+class MidiUsbHandler {};
+
+} // namespace daisy
\ No newline at end of file
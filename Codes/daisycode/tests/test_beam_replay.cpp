@@ -0,0 +1,137 @@
+// LaserBeamManager replay test: a synthetic trace (BeamTrace.h) models what the
+// LDR sees (ambient light with mains flicker, the laser contribution of the
+// beam under the mirror, a hand blocking part of it), the LDR's own slow first
+// order response to it, and ADC noise. The manager is replayed against it on a
+// simulated clock. Hands enter random beams; each must be reported broken once
+// and restored once after the hand leaves, and no other beam may trigger.
+#include <stdio.h>
+#include <stdlib.h>
+#include <math.h>
+#include <atomic>
+#include <cmath>
+
+#include "LaserBeamManager.h"
+#include "BeamTrace.h"
+
+const uint32_t TICK_US = 1000000 / LaserBeamManager::UPDATE_RATE_HZ;   // Update interrupt period
+const uint32_t WARMUP_US = 1000000;     // Clear beams first, the levels are learned
+const uint32_t BREAK_TIMEOUT_US = 250000;
+const uint32_t RESTORE_TIMEOUT_US = 300000;
+const int TRIALS = 300;
+
+static TraceGenerator* replayTrace = nullptr;
+
+static float ReadTrace(uint8_t channel) {
+    return replayTrace->Sample();
+}
+
+enum TrialPhase { IDLE, WAIT_BREAK, HOLD, WAIT_RESTORE };
+
+static bool Replay(const Scene& scene) {
+    LaserBeamManager* beams = new LaserBeamManager();
+    TraceGenerator trace(scene);
+    replayTrace = &trace;
+    daisy::host::Adc() = ReadTrace;
+    daisy::host::Micros() = 0;
+
+    daisy::DaisySeed hw;
+    beams->Init(&hw, nullptr);
+
+    int trials = 0, missed = 0, stuck = 0, falseBreaks = 0, dropped = 0;
+    int trialBeam = -1;
+    TrialPhase phase = IDLE;
+    uint32_t& now = daisy::host::Micros();
+    uint32_t deadline = WARMUP_US;
+    srand(1);
+
+    while (trials < TRIALS) {
+        // The light of the last tick follows the mirror and the laser Update() left
+        now += TICK_US;
+        trace.SetProgress((float)trials / TRIALS);
+        trace.Advance(now, ScannerProbe::GetBeamUnderMirror(*beams), ScannerProbe::IsLaserOn(*beams));
+        beams->Update();
+
+        BeamEvent event;
+        while (beams->GetNextEvent(&event)) {
+            bool onTrialBeam = event.beamIndex == trialBeam;
+            if (event.type == BEAM_BROKEN) {
+                if (phase == WAIT_BREAK && onTrialBeam) {
+                    phase = HOLD;
+                    deadline = now + scene.holdUs;
+                } else {
+                    falseBreaks++;      // Another beam, or a retrigger of the held one
+                }
+            } else if (event.type == BEAM_RESTORED) {
+                if (phase == WAIT_RESTORE && onTrialBeam) {
+                    phase = IDLE;
+                    deadline = now + 20000 + rand() % 50000;
+                    trials++;
+                } else if (phase == HOLD && onTrialBeam) {
+                    dropped++;          // Note released while the hand is still there
+                }
+            }
+        }
+
+        if ((int32_t)(now - deadline) < 0) continue;
+        switch (phase) {
+            case IDLE:                  // A hand enters a random beam
+                trialBeam = rand() % beams->GetActiveBeamCount();
+                trace.SetHand(trialBeam);
+                phase = WAIT_BREAK;
+                deadline = now + BREAK_TIMEOUT_US;
+                break;
+            case WAIT_BREAK:            // Never seen, the hand gives up
+                missed++;
+                trace.SetHand(-1);
+                phase = IDLE;
+                deadline = now + RESTORE_TIMEOUT_US;
+                trials++;
+                break;
+            case HOLD:                  // The hand leaves
+                trace.SetHand(-1);
+                phase = WAIT_RESTORE;
+                deadline = now + RESTORE_TIMEOUT_US;
+                break;
+            case WAIT_RESTORE:          // Note left hanging
+                stuck++;
+                phase = IDLE;
+                trials++;
+                break;
+        }
+    }
+    delete beams;
+
+    bool ok = missed == 0 && stuck == 0 && falseBreaks == 0 && dropped == 0;
+    printf("beam replay, %-16s %d trials: missed %d, stuck %d, false %d, dropped %d%s\n",
+           scene.name, trials, missed, stuck, falseBreaks, dropped, ok ? "" : "  FAIL");
+    return ok;
+}
+
+int main() {
+    const Scene scenes[] = {
+        // Flicker up to 30% of the beam contribution is tolerated with LDRs up to
+        // 1 ms rise and 3 ms fall, 40% at 100 Hz is not
+        // name               ambient flicker  Hz      level  end    hover  hold    rise    fall
+        { "steady light",     0.05f,  0.0f,    0.0f,   0.5f,  0.5f,  false, 50000,  500.0f, 2000.0f },
+        { "100 Hz flicker",   0.05f,  0.15f,   100.0f, 0.5f,  0.5f,  false, 50000,  500.0f, 2000.0f },
+        { "50 Hz flicker",    0.05f,  0.15f,   50.0f,  0.5f,  0.5f,  false, 50000,  500.0f, 2000.0f },
+        { "bright ambient",   0.35f,  0.0f,    0.0f,   0.5f,  0.5f,  false, 50000,  500.0f, 2000.0f },
+        { "fading laser",     0.05f,  0.05f,   100.0f, 0.5f,  0.3f,  false, 50000,  500.0f, 2000.0f },
+        { "hovering hand",    0.05f,  0.05f,   100.0f, 0.5f,  0.5f,  true,  400000, 500.0f, 2000.0f },
+        { "slow LDR",         0.05f,  0.15f,   50.0f,  0.5f,  0.5f,  false, 50000,  1000.0f, 3000.0f },
+    };
+
+    int failures = 0;
+    for (const Scene& scene : scenes) {
+        if (!Replay(scene)) {
+            failures++;
+        }
+    }
+
+    if (failures > 0) {
+        printf("%d failures\n", failures);
+        return 1;
+    }
+    printf("ok\n");
+    return 0;
+}
\ No newline at end of file
@@ -0,0 +1,140 @@
+// SpscQueue stress test, on the queue type LaserBeamManager carries its beam
+// events in: a producer thread (standing in for the scanning interrupt)
+// pushes sequence-numbered events while a consumer thread (the main loop)
+// drains them. With a waiting producer every event must
+// arrive once and in order; with a producer that never waits (the interrupt
+// case) events may be dropped, but only counted as overflow and never
+// reordered or duplicated. Run the tsan target to check the memory ordering.
+#include <stdio.h>
+#include <stdlib.h>
+#include <atomic>
+#include <chrono>
+#include <cmath>
+#include <thread>
+
+#include "LaserBeamManager.h"
+
+typedef SpscQueue<BeamEvent, LaserBeamManager::EVENT_QUEUE_SIZE> EventQueue;
+
+static int failures = 0;
+
+// Event i carries i in its fields: low 24 bits in the value, the rest implied
+static void QueueSequence(EventQueue& queue, uint32_t i) {
+    BeamEvent event;
+    event.type = BEAM_PRESSURE;
+    event.beamIndex = i & 15;
+    event.velocity = i & 127;
+    event.timestamp = i;
+    event.analogValue = (float)(i & 0xFFFFFF);
+    queue.Push(event);
+}
+
+// Single threaded edge cases: wrap of the 8-bit indices, full, clear
+static void CheckEdges() {
+    EventQueue queue;
+    BeamEvent event;
+    bool ok = queue.IsEmpty() && !queue.Pop(&event);
+
+    // Walk the indices past 256 several times, a few items at a time
+    uint32_t next = 0;
+    uint32_t expected = 0;
+    for (int round = 0; round < 300; round++) {
+        for (int i = 0; i < 5; i++) QueueSequence(queue, next++);
+        for (int i = 0; i < 5; i++) {
+            ok = ok && queue.Pop(&event) && event.timestamp == expected++;
+        }
+    }
+    ok = ok && queue.IsEmpty() && queue.GetOverflowCount() == 0 && queue.GetHighWater() == 5;
+
+    // Fill up: exactly CAPACITY items fit, the next ones are counted and dropped
+    for (int i = 0; i < EventQueue::CAPACITY; i++) QueueSequence(queue, next++);
+    ok = ok && queue.IsFull() && queue.GetHighWater() == EventQueue::CAPACITY;
+    QueueSequence(queue, next++);
+    QueueSequence(queue, next++);
+    ok = ok && queue.GetOverflowCount() == 2;
+    ok = ok && queue.Pop(&event) && event.timestamp == expected;
+
+    queue.Clear();
+    ok = ok && queue.IsEmpty() && !queue.IsFull() && !queue.Pop(&event);
+    QueueSequence(queue, 12345);
+    ok = ok && queue.Pop(&event) && event.timestamp == 12345 && queue.IsEmpty();
+
+    printf("event queue, edges: %s\n", ok ? "ok" : "FAIL");
+    if (!ok) failures++;
+}
+
+static void RunPass(uint32_t count, bool producerWaits) {
+    EventQueue queue;
+    std::atomic<bool> producerDone(false);
+    uint32_t received = 0;
+    uint32_t errors = 0;
+    int64_t last = -1;
+
+    auto start = std::chrono::steady_clock::now();
+    std::thread producer([&] {
+        for (uint32_t i = 0; i < count; i++) {
+            while (producerWaits && queue.IsFull()) {
+                std::this_thread::yield();
+            }
+            QueueSequence(queue, i);
+            if (!producerWaits && (i & 63) == 0) {
+                std::this_thread::yield();  // Bursts, like a periodic interrupt
+            }
+        }
+        producerDone = true;
+    });
+    std::thread consumer([&] {
+        BeamEvent event;
+        while (true) {
+            if (!queue.Pop(&event)) {
+                // The queue is empty for good once the producer has finished
+                if (producerDone && queue.IsEmpty()) break;
+                std::this_thread::yield();
+                continue;
+            }
+
+            // Rebuild the full sequence number from the low 24 bits
+            int64_t sequence = ((last + 1) & ~(int64_t)0xFFFFFF) | (uint32_t)event.analogValue;
+            if (sequence <= last) sequence += 0x1000000;
+
+            bool fieldsMatch = event.type == BEAM_PRESSURE &&
+                               event.beamIndex == (sequence & 15) &&
+                               event.velocity == (sequence & 127);
+            if (!fieldsMatch || (producerWaits && sequence != last + 1)) {
+                errors++;
+            }
+            last = sequence;
+            received++;
+        }
+    });
+    producer.join();
+    consumer.join();
+    double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+
+    uint32_t dropped = queue.GetOverflowCount();
+    bool ok = errors == 0 && received > 0 && received + dropped == count &&
+              (!producerWaits || (dropped == 0 && last == (int64_t)count - 1)) &&
+              queue.GetHighWater() <= EventQueue::CAPACITY;
+    printf("event queue, %s producer: sent %u received %u dropped %u errors %u high water %u, %.1f M events/s\n",
+           producerWaits ? "waiting" : "interrupt", count, received, dropped, errors,
+           queue.GetHighWater(), count / seconds / 1e6);
+    if (!ok) {
+        printf("FAIL: %s producer\n", producerWaits ? "waiting" : "interrupt");
+        failures++;
+    }
+}
+
+int main(int argc, char** argv) {
+    uint32_t count = argc > 1 ? (uint32_t)atoi(argv[1]) : 2000000;
+
+    CheckEdges();
+    RunPass(count, true);
+    RunPass(count, false);
+
+    if (failures > 0) {
+        printf("%d failures\n", failures);
+        return 1;
+    }
+    printf("ok\n");
+    return 0;
+}
\ No newline at end of file
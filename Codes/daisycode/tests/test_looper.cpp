@@ -0,0 +1,284 @@
+// Looper test on a simulated clock (one 48-sample block per millisecond of
+// the microsecond clock). Checks the size of the event log for fast and slow
+// playing, that a loop replays on the recorded sample offsets on every pass,
+// that an overdub is merged into the log in time order, and that quantize
+// snaps note starts to the grid and keeps the note lengths.
+#include <stdio.h>
+#include <stdlib.h>
+#include <math.h>
+#include <vector>
+#include <algorithm>
+#include "Looper.h"
+#include "RecordingNoteSinks.h"
+
+const float SAMPLE_RATE = 48000.0f;
+const uint32_t BLOCK_SIZE = 48;
+const uint32_t BLOCK_US = 1000;
+
+static int failures = 0;
+
+#define CHECK(cond) do { \
+    if (!(cond)) { \
+        if (++failures <= 10) printf("FAIL line %d: %s\n", __LINE__, #cond); \
+    } \
+} while (0)
+
+struct LoopEvent {
+    uint32_t timeUs;        // Loop time
+    uint8_t beam;
+    bool on;
+};
+
+static bool EarlierEvent(const LoopEvent& a, const LoopEvent& b) {
+    return a.timeUs < b.timeUs;
+}
+
+// Looper with recorded outputs, the clocks start at an arbitrary point
+struct Rig {
+    ConfigManager config;
+    NoteMapper mapper;
+    RecordingSynth synth;
+    RecordingMidi midi;
+    NoteScheduler scheduler;
+    Looper looper;
+
+    explicit Rig(uint8_t loopQuantize) : midi(synth) {
+        LaserHarpConfig* cfg = config.GetConfig();
+        cfg->tempo = 120.0f;
+        cfg->loopQuantize = loopQuantize;
+        config.Publish();
+        mapper.Compile(*config.GetSnapshot());
+        scheduler.Init(&synth, &midi, &config);
+        looper.Init(&scheduler, &mapper, &config, SAMPLE_RATE);
+        daisy::host::Micros() = 7000000;
+        synth.Advance(336000);
+    }
+
+    // One main loop iteration per audio block
+    void Run(uint32_t us) {
+        for (uint32_t t = 0; t < us; t += BLOCK_US) {
+            looper.Update();
+            scheduler.Update();
+            synth.Advance(BLOCK_SIZE);
+            daisy::host::Micros() += BLOCK_US;
+        }
+    }
+
+    // Records the events as a loop of the given length and starts playing it
+    uint32_t Record(const std::vector<LoopEvent>& events, uint32_t lengthUs) {
+        uint32_t start = daisy::host::Micros();
+        looper.Control(LOOPER_RECORD);
+        for (size_t i = 0; i < events.size(); i++) {
+            looper.RecordBeam(events[i].beam, events[i].on, start + events[i].timeUs);
+        }
+        Run(lengthUs);
+        uint32_t playStart = synth.GetSampleTime();
+        looper.Control(LOOPER_PLAY);
+        return playStart;
+    }
+
+    uint8_t BeamOf(uint8_t note) const {
+        for (uint8_t beam = 0; beam < Looper::MAX_LOOP_BEAMS; beam++) {
+            if (mapper.GetBeamNotes(beam).notes[0] == note) return beam;
+        }
+        return 0xFF;
+    }
+};
+
+// Played notes, one per beam at a time, with a chord of two beams every few notes
+static std::vector<LoopEvent> MakeSession(uint32_t minGapUs, uint32_t maxGapUs, int chordEvery, int notes,
+                                          uint32_t* lengthUs) {
+    std::vector<LoopEvent> events;
+    uint32_t time = 50000;
+    for (int i = 0; i < notes; i++) {
+        uint32_t gap = minGapUs + (uint32_t)rand() % (maxGapUs - minGapUs);
+        uint32_t length = gap / 4 + (uint32_t)rand() % (gap / 2);
+        uint8_t beam = (uint8_t)(i % 6);
+        LoopEvent on = { time, beam, true };
+        LoopEvent off = { time + length, beam, false };
+        events.push_back(on);
+        events.push_back(off);
+        if (chordEvery > 0 && rand() % chordEvery == 0) {
+            // Second beam of a chord, broken a few milliseconds later
+            uint32_t skew = 500 + (uint32_t)rand() % 4000;
+            LoopEvent chordOn = { time + skew, (uint8_t)(beam + 7), true };
+            LoopEvent chordOff = { time + length + skew, (uint8_t)(beam + 7), false };
+            events.push_back(chordOn);
+            events.push_back(chordOff);
+        }
+        time += gap;
+    }
+    std::stable_sort(events.begin(), events.end(), EarlierEvent);
+    *lengthUs = time;
+    return events;
+}
+
+static void CheckLogSize(const char* name, uint32_t minGapUs, uint32_t maxGapUs, int chordEvery) {
+    Rig rig(0);
+    uint32_t lengthUs;
+    std::vector<LoopEvent> events = MakeSession(minGapUs, maxGapUs, chordEvery, 200, &lengthUs);
+    uint32_t start = daisy::host::Micros();
+    rig.looper.Control(LOOPER_RECORD);
+    for (size_t i = 0; i < events.size(); i++) {
+        rig.looper.RecordBeam(events[i].beam, events[i].on, start + events[i].timeUs);
+    }
+    daisy::host::Micros() += lengthUs;
+    rig.looper.Control(LOOPER_STOP);
+
+    double perEvent = (double)rig.looper.GetUsedBytes() / rig.looper.GetEventCount();
+    CHECK(rig.looper.GetEventCount() == events.size());
+    // Gaps under 2.1s cost 3 bytes, the second note of a chord 2
+    CHECK(perEvent <= 3.0);
+    printf("log size, %s (%u-%u ms gaps): %u events in %u bytes, %.2f bytes per event\n",
+           name, minGapUs / 1000, maxGapUs / 1000, rig.looper.GetEventCount(),
+           rig.looper.GetUsedBytes(), perEvent);
+}
+
+// Loop of beam 0, 2 and 4 at odd microsecond times
+static std::vector<LoopEvent> MakeLoop() {
+    const LoopEvent loop[] = {
+        { 100000, 0, true }, { 300000, 0, false },
+        { 412345, 2, true }, { 700001, 2, false },
+        { 850007, 4, true }, { 990000, 4, false },
+    };
+    return std::vector<LoopEvent>(loop, loop + sizeof(loop) / sizeof(loop[0]));
+}
+
+// Note events the synthesizer got during pass p, as loop events
+static std::vector<LoopEvent> PassEvents(const Rig& rig, uint32_t playStart, uint32_t loopSamples, int pass,
+                                         std::vector<uint32_t>* offsets) {
+    std::vector<LoopEvent> events;
+    offsets->clear();
+    uint32_t passStart = playStart + pass * loopSamples;
+    for (size_t i = 0; i < rig.synth.notes.size(); i++) {
+        const RecordedNote& note = rig.synth.notes[i];
+        uint32_t offset = note.time - passStart;
+        if (offset >= loopSamples) continue;
+        LoopEvent event = { 0, rig.BeamOf(note.note), note.velocity > 0 };
+        events.push_back(event);
+        offsets->push_back(offset);
+    }
+    return events;
+}
+
+static void CheckReplay() {
+    const uint32_t LOOP_US = 1000000;
+    const uint32_t LOOP_SAMPLES = 48000;
+    const int PASSES = 5;
+    Rig rig(0);
+    std::vector<LoopEvent> loop = MakeLoop();
+    uint32_t playStart = rig.Record(loop, LOOP_US);
+    rig.Run(PASSES * LOOP_US + 100000);
+
+    int wrong = 0;
+    for (int pass = 0; pass < PASSES; pass++) {
+        std::vector<uint32_t> offsets;
+        std::vector<LoopEvent> events = PassEvents(rig, playStart, LOOP_SAMPLES, pass, &offsets);
+        if (events.size() != loop.size()) {
+            wrong++;
+            continue;
+        }
+        for (size_t i = 0; i < loop.size(); i++) {
+            // Within a sample of the recorded time, the same on every pass
+            double recorded = loop[i].timeUs * (SAMPLE_RATE / 1e6);
+            if (events[i].beam != loop[i].beam || events[i].on != loop[i].on ||
+                fabs(offsets[i] - recorded) > 1.0) {
+                wrong++;
+            }
+        }
+    }
+    CHECK(wrong == 0);
+    CHECK(rig.looper.GetLoopLengthUs() == LOOP_US);
+    printf("replay: %d passes of %zu events, %d off their recorded sample\n", PASSES, loop.size(), wrong);
+}
+
+static void CheckOverdub() {
+    const uint32_t LOOP_US = 1000000;
+    const uint32_t LOOP_SAMPLES = 48000;
+    Rig rig(0);
+    std::vector<LoopEvent> loop = MakeLoop();
+    uint32_t playStart = rig.Record(loop, LOOP_US);
+
+    // Overdub during the second pass: beam 1 and 3 between the recorded notes
+    const LoopEvent added[] = {
+        { 200000, 1, true }, { 250000, 1, false },
+        { 600000, 3, true }, { 650000, 3, false },
+    };
+    rig.Run(LOOP_US + 50000);
+    rig.looper.Control(LOOPER_OVERDUB);
+    uint32_t at = 50000;
+    for (size_t i = 0; i < 4; i++) {
+        rig.Run(added[i].timeUs - at);
+        at = added[i].timeUs;
+        rig.looper.RecordBeam(added[i].beam, added[i].on, daisy::host::Micros());
+    }
+    rig.Run(900000 - at);
+    rig.looper.Control(LOOPER_PLAY);
+    rig.Run(LOOP_US * 2 + 100000);
+
+    // From the third pass on, both sets of notes in time order
+    std::vector<LoopEvent> merged = loop;
+    merged.insert(merged.end(), added, added + 4);
+    std::stable_sort(merged.begin(), merged.end(), EarlierEvent);
+
+    std::vector<uint32_t> offsets;
+    std::vector<LoopEvent> events = PassEvents(rig, playStart, LOOP_SAMPLES, 2, &offsets);
+    bool ordered = events.size() == merged.size();
+    for (size_t i = 0; ordered && i < merged.size(); i++) {
+        ordered = events[i].beam == merged[i].beam && events[i].on == merged[i].on &&
+                  (i == 0 || offsets[i] >= offsets[i - 1]);
+    }
+    CHECK(ordered);
+    CHECK(rig.looper.GetEventCount() == merged.size());
+    printf("overdub: %zu events merged in time order: %s\n", merged.size(), ordered ? "yes" : "no");
+}
+
+static void CheckQuantize() {
+    const uint32_t LOOP_US = 1000000;
+    const uint32_t LOOP_SAMPLES = 48000;
+    const uint32_t GRID = 6000;         // 1/16 at 120 BPM
+    Rig rig(ARP_RATE_SIXTEENTH + 1);
+    std::vector<LoopEvent> loop = MakeLoop();
+    uint32_t playStart = rig.Record(loop, LOOP_US);
+    rig.Run(2 * LOOP_US + 100000);
+
+    // The notes of the second pass in log order. A shifted note off can land
+    // in the next pass, so they are taken from the first note on of the pass.
+    uint32_t passStart = playStart + LOOP_SAMPLES;
+    size_t first = 0;
+    while (first < rig.synth.notes.size() &&
+           !(rig.synth.notes[first].velocity > 0 && rig.synth.notes[first].time - passStart < LOOP_SAMPLES)) {
+        first++;
+    }
+    bool ok = first + loop.size() <= rig.synth.notes.size();
+    for (size_t i = 0; ok && i < loop.size(); i += 2) {
+        // Starts on the nearest grid line, lengths within a sample of the recorded ones
+        const RecordedNote& on = rig.synth.notes[first + i];
+        const RecordedNote& off = rig.synth.notes[first + i + 1];
+        uint32_t offset = on.time - passStart;
+        double start = loop[i].timeUs * (SAMPLE_RATE / 1e6);
+        double length = (loop[i + 1].timeUs - loop[i].timeUs) * (SAMPLE_RATE / 1e6);
+        ok = rig.BeamOf(on.note) == loop[i].beam && off.note == on.note && off.velocity == 0 &&
+             offset % GRID == 0 && fabs(offset - start) <= GRID / 2 &&
+             fabs((double)(off.time - on.time) - length) <= 1.0;
+    }
+    CHECK(ok);
+    printf("quantize: note starts on the %u-sample grid, lengths kept: %s\n", GRID, ok ? "yes" : "no");
+}
+
+int main() {
+    srand(3);
+    CheckLogSize("fast chords", 100000, 300000, 5);
+    CheckLogSize("slow chords", 600000, 2000000, 5);
+    CheckLogSize("slow melody", 600000, 2000000, 0);
+    CheckReplay();
+    CheckOverdub();
+    CheckQuantize();
+
+    if (failures > 0) {
+        printf("%d failures\n", failures);
+        return 1;
+    }
+    printf("ok\n");
+    return 0;
+}
@@ -0,0 +1,196 @@
+// NoteScheduler and Arpeggiator timing test on a simulated render clock. The
+// main loop runs once per 48-sample audio block. Internal clock steps must
+// start on their exact sample times, MIDI copies must go out on the block that
+// renders them, and received MIDI clock ticks, delayed by a jittery main loop
+// (up to 144 samples), must still give steps spaced within half a block. A
+// full output must drop a note on from both outputs, never from one only.
+#include <stdio.h>
+#include <stdlib.h>
+#include <math.h>
+#include "Arpeggiator.h"
+#include "MidiController.h"
+#include "RecordingNoteSinks.h"
+
+const float SAMPLE_RATE = 48000.0f;
+const uint32_t BLOCK_SIZE = 48;
+
+static int failures = 0;
+
+#define CHECK(cond) do { \
+    if (!(cond)) { \
+        if (++failures <= 10) printf("FAIL line %d: %s\n", __LINE__, #cond); \
+    } \
+} while (0)
+
+static std::vector<RecordedNote> NoteOns(const std::vector<RecordedNote>& notes) {
+    std::vector<RecordedNote> ons;
+    for (size_t i = 0; i < notes.size(); i++) {
+        if (notes[i].velocity > 0) ons.push_back(notes[i]);
+    }
+    return ons;
+}
+
+static void SetupArpeggiator(ConfigManager& config, uint8_t clockSource, float tempo) {
+    LaserHarpConfig* cfg = config.GetConfig();
+    cfg->arpMode = ARP_UP;
+    cfg->arpRate = ARP_RATE_SIXTEENTH;
+    cfg->arpGate = 0.5f;
+    cfg->arpOctaves = 1;
+    cfg->arpPattern = 0xFFFF;
+    cfg->arpSteps = 16;
+    cfg->tempo = tempo;
+    cfg->clockSource = clockSource;
+    cfg->audioEnabled = true;
+    cfg->midiEnabled = true;
+    config.Publish();
+}
+
+// Internal clock at a tempo with a fractional step length
+static void CheckInternalClock() {
+    const float tempo = 133.0f;
+    const float period = SAMPLE_RATE * 60.0f / tempo / 4.0f;    // 1/16, 5413.5 samples
+    const int STEPS = 200;
+
+    ConfigManager config;
+    SetupArpeggiator(config, CLOCK_INTERNAL, tempo);
+    RecordingSynth synth;
+    RecordingMidi midi(synth);
+    NoteScheduler scheduler;
+    scheduler.Init(&synth, &midi, &config);
+    Arpeggiator arp;
+    arp.Init(&scheduler, &config, SAMPLE_RATE);
+
+    synth.Advance(1000);    // Start off the block grid
+    arp.NoteOn(60, 100, 0);
+    arp.NoteOn(64, 90, 1);
+    while (NoteOns(midi.notes).size() < (size_t)STEPS) {
+        arp.Update();
+        scheduler.Update();
+        synth.Advance(BLOCK_SIZE);
+    }
+
+    std::vector<RecordedNote> ons = NoteOns(synth.notes);
+    std::vector<RecordedNote> midiOns = NoteOns(midi.notes);
+    uint32_t start = ons[0].time;
+    double worst = 0.0;
+    int late = 0;
+    for (int k = 0; k < STEPS; k++) {
+        // Each step within a sample of its ideal time, no drift from rounding
+        double error = fabs((double)(ons[k].time - start) - k * (double)period);
+        if (error > worst) worst = error;
+
+        // MIDI on the block that renders the note
+        uint32_t delay = midiOns[k].time - ons[k].time;
+        if (delay >= BLOCK_SIZE || midiOns[k].note != ons[k].note) late++;
+        CHECK(ons[k].note == (k % 2 == 0 ? 60 : 64));
+    }
+    CHECK(worst < 1.0);
+    CHECK(late == 0);
+
+    // The scheduler never ran out of room, so both outputs saw the same notes
+    CHECK(synth.notes.size() >= midi.notes.size());
+    printf("internal clock: %d steps of %.2f samples, worst error %.3f samples, %d late MIDI notes\n",
+           STEPS, period, worst, late);
+}
+
+// MIDI clock at 24 PPQN. The ticks arrive on time but the main loop only sees
+// them at a block boundary, a random 0-3 blocks late.
+static void CheckMidiClock() {
+    const uint32_t TICK_SAMPLES = 1008;                 // 119.05 BPM
+    const uint32_t STEP_SAMPLES = TICK_SAMPLES * 6;     // 1/16
+    const int STEPS = 100;
+
+    ConfigManager config;
+    SetupArpeggiator(config, CLOCK_MIDI, 120.0f);
+    RecordingSynth synth;
+    RecordingMidi midi(synth);
+    NoteScheduler scheduler;
+    scheduler.Init(&synth, &midi, &config);
+    Arpeggiator arp;
+    arp.Init(&scheduler, &config, SAMPLE_RATE);
+    arp.NoteOn(67, 100, 2);
+
+    srand(7);
+    uint32_t nextTick = 5000;
+    uint32_t tickSeen = 0;
+    bool tickWaiting = false;
+    arp.OnMidiClock(MIDI_START, synth.GetSampleTime());
+    while (NoteOns(synth.notes).size() < (size_t)STEPS) {
+        uint32_t blockEnd = synth.GetSampleTime() + BLOCK_SIZE;
+        if (!tickWaiting && (int32_t)(nextTick - blockEnd) < 0) {
+            tickWaiting = true;
+            tickSeen = blockEnd + BLOCK_SIZE * (rand() % 4);
+        }
+        if (tickWaiting && (int32_t)(synth.GetSampleTime() - tickSeen) >= 0) {
+            arp.OnMidiClock(MIDI_TIMING_CLOCK, synth.GetSampleTime());
+            tickWaiting = false;
+            nextTick += TICK_SAMPLES;
+        }
+        arp.Update();
+        scheduler.Update();
+        synth.Advance(BLOCK_SIZE);
+    }
+
+    // Skip the first steps while the tick period estimate settles
+    std::vector<RecordedNote> ons = NoteOns(synth.notes);
+    const int SETTLE = 8;
+    int worst = 0;
+    for (int k = SETTLE + 1; k < STEPS; k++) {
+        int spacing = (int)(ons[k].time - ons[k - 1].time);
+        if (abs(spacing - (int)STEP_SAMPLES) > worst) worst = abs(spacing - (int)STEP_SAMPLES);
+    }
+    double mean = (double)(ons[STEPS - 1].time - ons[SETTLE].time) / (STEPS - 1 - SETTLE);
+    CHECK(worst <= (int)BLOCK_SIZE / 2);
+    CHECK(fabs(mean - STEP_SAMPLES) < 1.0);
+    printf("MIDI clock: %d steps of %u samples, mean %.2f, worst deviation %d samples\n",
+           STEPS, STEP_SAMPLES, mean, worst);
+}
+
+// A note on either reaches both outputs or neither
+static void CheckFullOutputs() {
+    ConfigManager config;
+    SetupArpeggiator(config, CLOCK_INTERNAL, 120.0f);
+    RecordingSynth synth;
+    RecordingMidi midi(synth);
+    NoteScheduler scheduler;
+    scheduler.Init(&synth, &midi, &config);
+
+    // Fill the MIDI side with far future note ons
+    for (int i = 0; i < NoteScheduler::MAX_PENDING; i++) {
+        scheduler.ScheduleNoteOn(100000 + i, 40 + (i % 40), 100, 0);
+    }
+    CHECK(synth.notes.size() == NoteScheduler::MAX_PENDING);
+    scheduler.ScheduleNoteOn(200000, 90, 100, 0);
+    CHECK(synth.notes.size() == NoteScheduler::MAX_PENDING);
+
+    // A note off still reaches both, MIDI sends it early rather than losing it
+    scheduler.ScheduleNoteOff(200000, 40);
+    CHECK(synth.notes.size() == NoteScheduler::MAX_PENDING + 1);
+    CHECK(midi.notes.size() == 1 && midi.notes[0].velocity == 0);
+
+    // A refused synth note on is not sent to MIDI
+    NoteScheduler fresh;
+    RecordingMidi freshMidi(synth);
+    fresh.Init(&synth, &freshMidi, &config);
+    synth.SetAccepting(false);
+    fresh.ScheduleNoteOn(0, 70, 100, 0);
+    synth.SetAccepting(true);
+    synth.Advance(BLOCK_SIZE);
+    fresh.Update();
+    CHECK(freshMidi.notes.empty());
+
+    printf("full outputs: note ons dropped from both outputs\n");
+}
+
+int main() {
+    CheckInternalClock();
+    CheckMidiClock();
+    CheckFullOutputs();
+
+    if (failures > 0) {
+        printf("%d failures\n", failures);
+        return 1;
+    }
+    printf("ok\n");
+    return 0;
+}
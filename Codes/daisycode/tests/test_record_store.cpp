@@ -0,0 +1,149 @@
+// RecordStore power-loss test: a series of saves is replayed on a RAM flash
+// with the power cut after every possible number of programmed or erased
+// bytes, so every byte, page and sector boundary of every flash operation is
+// hit once. After each cut the store is mounted again and must return the last
+// completed save (or the one in flight if it made it to flash), and must keep
+// accepting saves.
+#include <stdio.h>
+#include <string.h>
+#include "RecordStore.h"
+#include "RamFlashDevice.h"
+
+// Small geometry so a few saves rotate through the region several times
+const uint32_t SECTOR_SIZE = 512;
+const uint32_t PAGE_SIZE = 32;
+const uint8_t NUM_SECTORS = 3;
+const int NUM_SAVES = 24;
+const uint16_t RECORD_VERSION = 7;
+
+static int failures = 0;
+
+#define CHECK(cond, cut) do { \
+    if (!(cond)) { \
+        if (++failures <= 10) printf("FAIL line %d, cut at %lld: %s\n", __LINE__, (long long)(cut), #cond); \
+    } \
+} while (0)
+
+// Save k: length and content depend on k, the first bytes hold k itself
+static size_t MakePayload(int k, uint8_t* out) {
+    size_t length = 8 + (k * 53) % 120;
+    for (size_t i = 0; i < length; i++) {
+        out[i] = (uint8_t)(k * 31 + i * 7);
+    }
+    memcpy(out, &k, sizeof(k));
+    return length;
+}
+
+struct Session {
+    int completed;      // Last save that verified, -1 = none
+    int inFlight;       // Save running at the power cut, -1 = none
+};
+
+// Runs saves first..first+count-1 until they are done or the power goes
+static Session RunSaves(RamFlashDevice& flash, int first, int count, int completed) {
+    static uint8_t staging[SECTOR_SIZE];
+    uint8_t payload[256];
+    Session session = { completed, -1 };
+
+    RecordStore store;
+    store.Init(&flash, 0, NUM_SECTORS, staging, sizeof(staging));
+    for (int k = first; k < first + count; k++) {
+        size_t length = MakePayload(k, payload);
+        if (!store.BeginWrite(payload, length, RECORD_VERSION)) {
+            session.inFlight = k;
+            return session;
+        }
+        while (store.IsBusy() && !flash.IsPoweredOff()) {
+            store.Update();
+        }
+        if (flash.IsPoweredOff()) {
+            session.inFlight = k;
+            return session;
+        }
+        if (!store.LastWriteFailed()) {
+            session.completed = k;
+        }
+    }
+    return session;
+}
+
+// Reads the latest record after a reboot, -1 = none
+static int MountAndRead(RamFlashDevice& flash, int64_t cut) {
+    static uint8_t staging[SECTOR_SIZE];
+    uint8_t payload[256];
+    uint8_t expected[256];
+
+    RecordStore store;
+    store.Init(&flash, 0, NUM_SECTORS, staging, sizeof(staging));
+    if (!store.HasRecord()) {
+        return -1;
+    }
+
+    int k = -1;
+    CHECK(store.GetRecordVersion() == RECORD_VERSION, cut);
+    CHECK(store.ReadRecord(payload, sizeof(payload)), cut);
+    memcpy(&k, payload, sizeof(k));
+    size_t length = MakePayload(k, expected);
+    CHECK(store.GetRecordLength() == length, cut);
+    CHECK(memcmp(payload, expected, length) == 0, cut);
+    return k;
+}
+
+static void CheckCut(bool noiseStart, bool eraseNoise, int64_t cut) {
+    RamFlashDevice flash(SECTOR_SIZE, PAGE_SIZE, NUM_SECTORS);
+    if (noiseStart) {
+        flash.FillNoise();
+    }
+    flash.SetEraseNoise(eraseNoise);
+
+    flash.SetPowerBudget(cut);
+    Session session = RunSaves(flash, 0, NUM_SAVES, -1);
+    flash.PowerOn();
+
+    // Nothing older than the last completed save, nothing that was not saved
+    int found = MountAndRead(flash, cut);
+    if (session.completed >= 0) {
+        CHECK(found == session.completed || found == session.inFlight, cut);
+    } else {
+        CHECK(found == -1 || found == session.inFlight, cut);
+    }
+
+    // The store recovers: new saves land and win over everything before them
+    for (int k = 1000; k < 1003; k++) {
+        Session after = RunSaves(flash, k, 1, -1);
+        CHECK(after.completed == k, cut);
+        CHECK(MountAndRead(flash, cut) == k, cut);
+    }
+}
+
+static void RunSweep(bool noiseStart, bool eraseNoise) {
+    // Bytes touched by the whole series without a cut
+    RamFlashDevice reference(SECTOR_SIZE, PAGE_SIZE, NUM_SECTORS);
+    if (noiseStart) {
+        reference.FillNoise();
+    }
+    Session session = RunSaves(reference, 0, NUM_SAVES, -1);
+    CHECK(session.completed == NUM_SAVES - 1, -1);
+    int64_t total = reference.GetProgramBytes() + reference.GetEraseBytes();
+
+    for (int64_t cut = 0; cut <= total; cut++) {
+        CheckCut(noiseStart, eraseNoise, cut);
+    }
+    printf("record store, %s flash, %s erase cut: %lld power cuts (%llu bytes programmed, %llu erased)\n",
+           noiseStart ? "unformatted" : "blank", eraseNoise ? "noisy" : "clean", (long long)total + 1,
+           (unsigned long long)reference.GetProgramBytes(),
+           (unsigned long long)reference.GetEraseBytes());
+}
+
+int main() {
+    RunSweep(false, false);
+    RunSweep(false, true);
+    RunSweep(true, true);
+
+    if (failures > 0) {
+        printf("%d failures\n", failures);
+        return 1;
+    }
+    printf("ok\n");
+    return 0;
+}
\ No newline at end of file